@@ -401,3 +401,72 @@ foreach(TARGET_FLAG
   string(REGEX REPLACE "^ +" "" "${TARGET_FLAG}" "${${TARGET_FLAG}}")
   string(REGEX REPLACE "  +" " " "${TARGET_FLAG}" "${${TARGET_FLAG}}")
 endforeach(TARGET_FLAG)
+
+set(SIMDUTIL_INCLUDE_DIR "${CMAKE_CURRENT_LIST_DIR}/../include")
+
+# Compile kernel sources once per instruction set level and collect all builds in one static library.
+#
+#   add_multi_isa_kernel_library(<name> <namespace> <source>...)
+#
+# Each build is an object library <name>_<level> compiled with the flags of its level
+# (the same instruction sets as the SIMDUTIL_TARGET_* attributes in dispatch.hpp), overriding -march=native,
+# and with the definitions
+#   SIMDUTIL_KERNEL_NAMESPACE  <namespace>_scalar, <namespace>_sse42, <namespace>_avx2, <namespace>_avx512, <namespace>_avx512icl
+#   SIMDUTIL_KERNEL_ISA        simdutil::IsaLevel::kScalar, ..., simdutil::IsaLevel::kAvx512Icl
+# The sources put their entry points into namespace SIMDUTIL_KERNEL_NAMESPACE so that the builds do not collide,
+# and SIMDUTIL_DECLARE_MULTI_ISA_KERNEL() / SIMDUTIL_MULTI_ISA_KERNEL_ENTRIES() in dispatch.hpp
+# declare them and register them to a simdutil::Dispatcher.
+function(add_multi_isa_kernel_library NAME NAMESPACE)
+  if(NOT (SYSTEM_PROCESSOR_IS_X86 OR SYSTEM_PROCESSOR_IS_X64))
+    message(FATAL_ERROR "add_multi_isa_kernel_library() supports x86 and x86-64 only")
+  endif()
+
+  set(ISA_NAMES scalar sse42 avx2 avx512 avx512icl)
+  set(ISA_LEVELS kScalar kSse42 kAvx2 kAvx512 kAvx512Icl)
+  if(MSVC)
+    # MSVC has no switch for SSE4.2; its SSE2 baseline is used for the scalar and SSE4.2 builds
+    set(ISA_FLAGS_scalar "")
+    set(ISA_FLAGS_sse42 "")
+    set(ISA_FLAGS_avx2 /arch:AVX2)
+    set(ISA_FLAGS_avx512 /arch:AVX512)
+    set(ISA_FLAGS_avx512icl /arch:AVX512)
+  else()
+    if(SYSTEM_PROCESSOR_IS_X64)
+      set(ISA_FLAGS_scalar -march=x86-64)
+    else()
+      set(ISA_FLAGS_scalar -march=i686)
+    endif()
+    set(ISA_FLAGS_sse42 ${ISA_FLAGS_scalar} -msse2 -mssse3 -msse4.1 -msse4.2 -mpopcnt)
+    set(ISA_FLAGS_avx2 ${ISA_FLAGS_sse42} -mavx -mavx2 -mfma -mbmi -mbmi2 -mlzcnt)
+    set(ISA_FLAGS_avx512 ${ISA_FLAGS_avx2} -mavx512f -mavx512cd -mavx512bw -mavx512dq -mavx512vl)
+    set(ISA_FLAGS_avx512icl ${ISA_FLAGS_avx512}
+      -mavx512ifma -mavx512vbmi -mavx512vbmi2 -mavx512vnni -mavx512bitalg -mavx512vpopcntdq)
+    # Without this, GCC and Clang tune for Skylake-X and auto-vectorize with 256-bit vectors only
+    if((CMAKE_COMPILER_IS_GNUCXX AND NOT CMAKE_CXX_COMPILER_VERSION VERSION_LESS 8.0)
+        OR ("${CMAKE_CXX_COMPILER_ID}" MATCHES "Clang" AND NOT CMAKE_CXX_COMPILER_VERSION VERSION_LESS 7.0))
+      list(APPEND ISA_FLAGS_avx512 -mprefer-vector-width=512)
+      list(APPEND ISA_FLAGS_avx512icl -mprefer-vector-width=512)
+    endif()
+  endif()
+
+  set(OBJECTS)
+  list(LENGTH ISA_NAMES N_ISAS)
+  math(EXPR LAST_INDEX "${N_ISAS} - 1")
+  foreach(INDEX RANGE ${LAST_INDEX})
+    list(GET ISA_NAMES ${INDEX} ISA)
+    list(GET ISA_LEVELS ${INDEX} LEVEL)
+    add_library(${NAME}_${ISA} OBJECT ${ARGN})
+    target_compile_options(${NAME}_${ISA} PRIVATE ${ISA_FLAGS_${ISA}})
+    target_compile_definitions(
+      ${NAME}_${ISA}
+      PRIVATE SIMDUTIL_KERNEL_NAMESPACE=${NAMESPACE}_${ISA}
+      PRIVATE SIMDUTIL_KERNEL_ISA=simdutil::IsaLevel::${LEVEL})
+    target_include_directories(
+      ${NAME}_${ISA}
+      PRIVATE ${SIMDUTIL_INCLUDE_DIR})
+    list(APPEND OBJECTS $<TARGET_OBJECTS:${NAME}_${ISA}>)
+  endforeach()
+
+  add_library(${NAME} STATIC ${OBJECTS})
+  set_target_properties(${NAME} PROPERTIES LINKER_LANGUAGE CXX)
+endfunction()
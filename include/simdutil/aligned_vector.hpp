@@ -0,0 +1,443 @@
+#ifndef SIMDUTIL_ALIGNED_VECTOR_HPP
+#define SIMDUTIL_ALIGNED_VECTOR_HPP
+
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <initializer_list>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include "allocator.hpp"
+#include "cpuid.hpp"
+
+
+namespace simdutil
+{
+/*!
+ * @brief Dynamic array whose storage is aligned and padded for full-width SIMD access
+ *
+ * - The default alignment is the size of the widest SIMD register of this CPU (getMaxSimdRegisterSize()).
+ * - The capacity is always a whole number of SIMD registers, so full-width loads and stores
+ *   of the last register touching size() never leave the allocation.
+ * - Elements between size() and capacity() are zero unless a kernel wrote them.
+ *
+ * Elements must be trivially copyable (arithmetic types, plain structs, ...),
+ * which also allows resizeUninitialized() to skip value-initialization.
+ */
+template<typename T>
+class AlignedVector
+{
+  static_assert(std::is_trivially_copyable<T>::value, "Element type must be trivially copyable");
+
+public:
+  //! Element type
+  using value_type = T;
+  //! Size type
+  using size_type = std::size_t;
+  //! Difference type
+  using difference_type = std::ptrdiff_t;
+  //! Reference type
+  using reference = value_type&;
+  //! Const reference type
+  using const_reference = const value_type&;
+  //! Pointer type
+  using pointer = value_type*;
+  //! Const pointer type
+  using const_pointer = const value_type*;
+  //! Iterator type
+  using iterator = pointer;
+  //! Const iterator type
+  using const_iterator = const_pointer;
+
+  /*!
+   * @brief Construct an empty vector aligned to the widest SIMD register
+   */
+  AlignedVector() noexcept
+    : AlignedVector(AlignmentTag{getMaxSimdRegisterSize()})
+  {}
+
+  /*!
+   * @brief Construct a vector of value-initialized elements
+   * @param [in] n  Number of elements
+   */
+  explicit AlignedVector(size_type n)
+    : AlignedVector()
+  {
+    resize(n);
+  }
+
+  /*!
+   * @brief Construct a vector of copies of a value
+   * @param [in] n      Number of elements
+   * @param [in] value  Value of elements
+   */
+  AlignedVector(size_type n, const value_type& value)
+    : AlignedVector()
+  {
+    resize(n, value);
+  }
+
+  /*!
+   * @brief Construct a vector from an initializer list
+   * @param [in] values  Values of elements
+   */
+  AlignedVector(std::initializer_list<value_type> values)
+    : AlignedVector()
+  {
+    resizeUninitialized(values.size());
+    std::copy(values.begin(), values.end(), data_);
+  }
+
+  /*!
+   * @brief Copy constructor
+   * @param [in] other  Vector to copy
+   */
+  AlignedVector(const AlignedVector& other)
+    : AlignedVector(AlignmentTag{other.alignment_})
+  {
+    resizeUninitialized(other.size_);
+    copyElements(data_, other.data_, size_);
+  }
+
+  /*!
+   * @brief Move constructor
+   * @param [in,out] other  Vector to move
+   */
+  AlignedVector(AlignedVector&& other) noexcept
+    : data_{other.data_}
+    , size_{other.size_}
+    , capacity_{other.capacity_}
+    , alignment_{other.alignment_}
+  {
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.capacity_ = 0;
+  }
+
+  /*!
+   * @brief Construct an empty vector with an explicit alignment
+   * @param [in] alignment  Alignment and padding unit (Must be power of 2; raised to at least alignof(T) and sizeof(void*))
+   * @return  Empty vector
+   */
+  static AlignedVector
+  withAlignment(size_type alignment) noexcept
+  {
+    return AlignedVector(AlignmentTag{alignment});
+  }
+
+  /*!
+   * @brief Free the storage
+   */
+  ~AlignedVector()
+  {
+    alignedFree(data_);
+  }
+
+  /*!
+   * @brief Copy assignment operator
+   * @param [in] other  Vector to copy
+   * @return  Reference to this vector
+   */
+  AlignedVector&
+  operator=(const AlignedVector& other)
+  {
+    if (this != &other) {
+      AlignedVector tmp{other};
+      swap(tmp);
+    }
+    return *this;
+  }
+
+  /*!
+   * @brief Move assignment operator
+   * @param [in,out] other  Vector to move
+   * @return  Reference to this vector
+   */
+  AlignedVector&
+  operator=(AlignedVector&& other) noexcept
+  {
+    AlignedVector tmp{std::move(other)};
+    swap(tmp);
+    return *this;
+  }
+
+  iterator begin() noexcept { return data_; }
+  const_iterator begin() const noexcept { return data_; }
+  const_iterator cbegin() const noexcept { return data_; }
+  iterator end() noexcept { return data_ + size_; }
+  const_iterator end() const noexcept { return data_ + size_; }
+  const_iterator cend() const noexcept { return data_ + size_; }
+
+  pointer data() noexcept { return data_; }
+  const_pointer data() const noexcept { return data_; }
+  reference operator[](size_type i) noexcept { return data_[i]; }
+  const_reference operator[](size_type i) const noexcept { return data_[i]; }
+  reference front() noexcept { return data_[0]; }
+  const_reference front() const noexcept { return data_[0]; }
+  reference back() noexcept { return data_[size_ - 1]; }
+  const_reference back() const noexcept { return data_[size_ - 1]; }
+
+  reference
+  at(size_type i)
+  {
+    if (i >= size_) {
+      throw std::out_of_range{"AlignedVector::at"};
+    }
+    return data_[i];
+  }
+
+  const_reference
+  at(size_type i) const
+  {
+    if (i >= size_) {
+      throw std::out_of_range{"AlignedVector::at"};
+    }
+    return data_[i];
+  }
+
+  bool empty() const noexcept { return size_ == 0; }
+  size_type size() const noexcept { return size_; }
+  size_type capacity() const noexcept { return capacity_; }
+
+  /*!
+   * @brief Get the alignment, which is also the unit of padding
+   * @return  Alignment in bytes
+   */
+  size_type
+  alignment() const noexcept
+  {
+    return alignment_;
+  }
+
+  /*!
+   * @brief Get the number of elements rounded up to a whole number of SIMD registers
+   *
+   * Kernels may process this many elements without a scalar remainder loop.
+   *
+   * @return  Padded number of elements
+   */
+  size_type
+  paddedSize() const noexcept
+  {
+    return std::min(roundUpCapacity(size_), capacity_);
+  }
+
+  /*!
+   * @brief Reserve storage
+   * @param [in] n  Number of elements to reserve
+   */
+  void
+  reserve(size_type n)
+  {
+    if (n > capacity_) {
+      reallocate(roundUpCapacity(n));
+    }
+  }
+
+  /*!
+   * @brief Release unused storage beyond the padding
+   */
+  void
+  shrink_to_fit()
+  {
+    const auto capacity = roundUpCapacity(size_);
+    if (capacity < capacity_) {
+      reallocate(capacity);
+    }
+  }
+
+  /*!
+   * @brief Remove all elements, keeping the storage
+   */
+  void
+  clear() noexcept
+  {
+    zeroElements(data_, size_);
+    size_ = 0;
+  }
+
+  /*!
+   * @brief Resize, value-initializing new elements
+   * @param [in] n  New number of elements
+   */
+  void
+  resize(size_type n)
+  {
+    resize(n, value_type{});
+  }
+
+  /*!
+   * @brief Resize, initializing new elements with a value
+   * @param [in] n      New number of elements
+   * @param [in] value  Value of new elements
+   */
+  void
+  resize(size_type n, const value_type& value)
+  {
+    const auto oldSize = size_;
+    resizeUninitialized(n);
+    if (n > oldSize) {
+      std::fill(data_ + oldSize, data_ + n, value);
+    }
+  }
+
+  /*!
+   * @brief Resize without initializing new elements
+   *
+   * Useful for large buffers which are overwritten entirely, since zeroing them costs memory bandwidth.
+   * The padding beyond the new size is still zeroed.
+   *
+   * @param [in] n  New number of elements
+   */
+  void
+  resizeUninitialized(size_type n)
+  {
+    if (n > capacity_) {
+      reallocate(growCapacity(n), n);
+    } else if (n < size_) {
+      zeroElements(data_ + n, size_ - n);
+    }
+    size_ = n;
+  }
+
+  /*!
+   * @brief Append an element
+   * @param [in] value  Element to append
+   */
+  void
+  push_back(const value_type& value)
+  {
+    if (size_ == capacity_) {
+      const auto v = value;
+      reallocate(growCapacity(size_ + 1));
+      data_[size_++] = v;
+    } else {
+      data_[size_++] = value;
+    }
+  }
+
+  /*!
+   * @brief Remove the last element
+   */
+  void
+  pop_back() noexcept
+  {
+    zeroElements(data_ + --size_, 1);
+  }
+
+  /*!
+   * @brief Swap contents with another vector
+   * @param [in,out] other  Vector to swap with
+   */
+  void
+  swap(AlignedVector& other) noexcept
+  {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    std::swap(capacity_, other.capacity_);
+    std::swap(alignment_, other.alignment_);
+  }
+
+private:
+  //! Tag to select the constructor which takes an alignment
+  struct AlignmentTag
+  {
+    //! Alignment
+    size_type alignment;
+  };  // struct AlignmentTag
+
+  explicit AlignedVector(AlignmentTag tag) noexcept
+    : data_{nullptr}
+    , size_{0}
+    , capacity_{0}
+    , alignment_{std::max({tag.alignment, alignOf<T>(), sizeof(void*)})}
+  {}
+
+  static void
+  copyElements(pointer dst, const_pointer src, size_type n) noexcept
+  {
+    if (n != 0) {
+      std::memcpy(static_cast<void*>(dst), static_cast<const void*>(src), n * sizeof(value_type));
+    }
+  }
+
+  static void
+  zeroElements(pointer p, size_type n) noexcept
+  {
+    if (n != 0) {
+      std::memset(static_cast<void*>(p), 0, n * sizeof(value_type));
+    }
+  }
+
+  size_type
+  roundUpCapacity(size_type n) const noexcept
+  {
+    const auto nBytes = (n * sizeof(value_type) + alignment_ - 1) & ~(alignment_ - 1);
+    return nBytes / sizeof(value_type);
+  }
+
+  size_type
+  growCapacity(size_type n) const noexcept
+  {
+    return roundUpCapacity(std::max(n, capacity_ * 2));
+  }
+
+  /*!
+   * @brief Move elements to new storage
+   * @param [in] capacity  New capacity (a whole number of SIMD registers)
+   * @param [in] nInit     Number of leading elements which the caller initializes (not zeroed)
+   */
+  void
+  reallocate(size_type capacity, size_type nInit = 0)
+  {
+    // Allocate whole registers even if sizeof(T) does not divide the alignment
+    const auto nBytes = (capacity * sizeof(value_type) + alignment_ - 1) & ~(alignment_ - 1);
+    auto p = alignedMalloc<value_type>(nBytes, alignment_);
+    if (p == nullptr) {
+      throw std::bad_alloc{};
+    }
+    copyElements(p, data_, size_);
+    const auto first = std::max(size_, nInit) * sizeof(value_type);
+    if (first < nBytes) {
+      std::memset(reinterpret_cast<unsigned char*>(p) + first, 0, nBytes - first);
+    }
+    alignedFree(data_);
+    data_ = p;
+    capacity_ = capacity;
+  }
+
+  //! Aligned storage
+  pointer data_;
+  //! Number of elements
+  size_type size_;
+  //! Number of elements the storage can hold
+  size_type capacity_;
+  //! Alignment and padding unit in bytes
+  size_type alignment_;
+};  // class AlignedVector
+
+
+template<typename T>
+static inline bool
+operator==(const AlignedVector<T>& lhs, const AlignedVector<T>& rhs) noexcept
+{
+  return lhs.size() == rhs.size() && std::equal(lhs.begin(), lhs.end(), rhs.begin());
+}
+
+
+template<typename T>
+static inline bool
+operator!=(const AlignedVector<T>& lhs, const AlignedVector<T>& rhs) noexcept
+{
+  return !(lhs == rhs);
+}
+
+
+}  // namespace simdutil
+
+
+#endif  // SIMDUTIL_ALIGNED_VECTOR_HPP
@@ -2,7 +2,9 @@
 #define SIMDUTIL_ALLOCATOR_HPP
 
 
+#include <cstdint>
 #include <iterator>
+#include <new>
 #include <stdexcept>
 #include <type_traits>
 
@@ -13,6 +15,10 @@
 #  include <cstdlib>
 #endif  // defined(_MSC_VER) || defined(__MINGW32__)
 
+#if defined(__linux__)
+#  include <sys/mman.h>
+#endif  // defined(__linux__)
+
 
 #if __cplusplus >= 201103L \
     || defined(_MSC_VER) && (_MSC_VER > 1800 || (_MSC_VER == 1800 && _MSC_FULL_VER == 180021114))
@@ -77,7 +83,7 @@ alignedMalloc(std::size_t nBytes, std::size_t alignment) noexcept
  */
 template<typename T = std::uint8_t>
 static inline T*
-alignedAllocArray(std::size_t size, std::size_t alignment = alingOf<T>()) noexcept
+alignedAllocArray(std::size_t size, std::size_t alignment = alignOf<T>()) noexcept
 {
   return alignedMalloc<T>(size * sizeof(T), alignment);
 }
@@ -214,6 +220,270 @@ operator!=(const AlignedAllocator<T, kAlignment1>& lhs, const AlignedAllocator<U
 }
 
 
+//! Size of huge pages used by hugePageMalloc()
+constexpr std::size_t kHugePageSize = 2 * 1024 * 1024;
+
+
+/*!
+ * @brief How hugePageMalloc() obtains huge pages
+ */
+enum class HugePagePolicy : int
+{
+  //! Transparent huge pages (madvise(MADV_HUGEPAGE))
+  kTransparent,
+  //! Pre-reserved huge pages (MAP_HUGETLB), falling back to kTransparent if none are available
+  kExplicit
+};  // enum class HugePagePolicy
+
+
+/*!
+ * @brief Allocate memory backed by 2 MiB pages
+ *
+ * The memory is aligned to kHugePageSize and its size is rounded up to a multiple of kHugePageSize.
+ * On Linux it is mapped by mmap(); elsewhere it falls back to alignedMalloc().
+ *
+ * @param [in] nBytes  Memory size
+ * @param [in] policy  How to obtain huge pages
+ * @return  Allocated memory, or nullptr on failure
+ */
+static inline void*
+hugePageMalloc(std::size_t nBytes, HugePagePolicy policy = HugePagePolicy::kTransparent) noexcept
+{
+  const auto size = (nBytes + kHugePageSize - 1) & ~(kHugePageSize - 1);
+#if defined(__linux__)
+#  if defined(MAP_HUGETLB)
+  if (policy == HugePagePolicy::kExplicit) {
+    const auto p = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (p != MAP_FAILED) {
+      return p;
+    }
+  }
+#  else
+  static_cast<void>(policy);
+#  endif  // defined(MAP_HUGETLB)
+  // Map one more huge page and trim both ends so that the mapping is aligned to kHugePageSize
+  const auto mapSize = size + kHugePageSize;
+  const auto p = ::mmap(nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED) {
+    return nullptr;
+  }
+  const std::uintptr_t mask = kHugePageSize - 1;
+  const auto addr = reinterpret_cast<std::uintptr_t>(p);
+  const auto alignedAddr = (addr + mask) & ~mask;
+  const std::size_t head = alignedAddr - addr;
+  if (head != 0) {
+    ::munmap(p, head);
+  }
+  if (mapSize - head != size) {
+    ::munmap(reinterpret_cast<void*>(alignedAddr + size), mapSize - head - size);
+  }
+  const auto aligned = reinterpret_cast<void*>(alignedAddr);
+#  if defined(MADV_HUGEPAGE)
+  ::madvise(aligned, size, MADV_HUGEPAGE);
+#  endif  // defined(MADV_HUGEPAGE)
+  return aligned;
+#else
+  static_cast<void>(policy);
+  return alignedMalloc(size, kHugePageSize);
+#endif  // defined(__linux__)
+}
+
+/*!
+ * @brief Free memory allocated by hugePageMalloc()
+ * @param [in] ptr     Memory to free
+ * @param [in] nBytes  Size which was passed to hugePageMalloc()
+ */
+static inline void
+hugePageFree(void* ptr, std::size_t nBytes) noexcept
+{
+  if (ptr == nullptr) {
+    return;
+  }
+#if defined(__linux__)
+  ::munmap(ptr, (nBytes + kHugePageSize - 1) & ~(kHugePageSize - 1));
+#else
+  static_cast<void>(nBytes);
+  alignedFree(ptr);
+#endif  // defined(__linux__)
+}
+
+/*!
+ * @brief Allocate aligned memory, using huge pages for large sizes
+ *
+ * Alignments below sizeof(void*), which posix_memalign() rejects, are raised to sizeof(void*).
+ *
+ * @param [in] nBytes     Memory size
+ * @param [in] alignment  Alignment (Must be power of 2)
+ * @param [in] threshold  Sizes of this or more are allocated by hugePageMalloc()
+ * @param [in] policy     How to obtain huge pages
+ * @return  Allocated aligned memory, or nullptr on failure
+ */
+static inline void*
+alignedHugeMalloc(
+    std::size_t nBytes,
+    std::size_t alignment,
+    std::size_t threshold = kHugePageSize,
+    HugePagePolicy policy = HugePagePolicy::kTransparent) noexcept
+{
+  return nBytes >= threshold && alignment <= kHugePageSize
+    ? hugePageMalloc(nBytes, policy)
+    : alignedMalloc(nBytes, alignment < sizeof(void*) ? sizeof(void*) : alignment);
+}
+
+/*!
+ * @brief Free memory allocated by alignedHugeMalloc()
+ * @param [in] ptr        Memory to free
+ * @param [in] nBytes     Size which was passed to alignedHugeMalloc()
+ * @param [in] alignment  Alignment which was passed to alignedHugeMalloc()
+ * @param [in] threshold  Threshold which was passed to alignedHugeMalloc()
+ */
+static inline void
+alignedHugeFree(void* ptr, std::size_t nBytes, std::size_t alignment, std::size_t threshold = kHugePageSize) noexcept
+{
+  if (nBytes >= threshold && alignment <= kHugePageSize) {
+    hugePageFree(ptr, nBytes);
+  } else {
+    alignedFree(ptr);
+  }
+}
+
+/*!
+ * @brief Custom deleter for std::unique_ptr or std::shared_ptr, for memory allocated by alignedHugeMalloc()
+ */
+struct AlignedHugeDeleter
+{
+  //! Size which was passed to alignedHugeMalloc()
+  std::size_t nBytes;
+  //! Alignment which was passed to alignedHugeMalloc()
+  std::size_t alignment;
+  //! Threshold which was passed to alignedHugeMalloc()
+  std::size_t threshold;
+
+  /*!
+   * @brief Operator: () for delete action
+   * @param [in,out] p  A pointer to alignd memory
+   */
+  void
+  operator()(void* p) const noexcept
+  {
+    alignedHugeFree(p, nBytes, alignment, threshold);
+  }
+};  // struct AlignedHugeDeleter
+
+
+/*!
+ * @brief Custom allocator for STL. This class allocates aligned memory and puts large blocks on huge pages.
+ */
+template<
+  typename T,
+  std::size_t kAlignment = sizeof(T),
+  std::size_t kThreshold = kHugePageSize,
+  HugePagePolicy kPolicy = HugePagePolicy::kTransparent
+>
+class HugePageAllocator
+{
+public:
+  //! Element type
+  using value_type = T;
+  //! Size type
+  using size_type = std::size_t;
+  //! Pointer type
+  using pointer = typename std::add_pointer<value_type>::type;
+  //! Const pointer type
+  using const_pointer = typename std::add_pointer<const value_type>::type;
+
+  /*!
+   * @brief Definition for rebinded allocator.
+   *
+   * This definition is neccessary because type parameter of this class is not only one.
+   */
+  template<class U>
+  struct rebind
+  {
+    //! Rebinded allocator type
+    using other = HugePageAllocator<U, kAlignment, kThreshold, kPolicy>;
+  };
+
+  /*!
+   * Default constructor
+   */
+  HugePageAllocator() noexcept
+  {}
+
+  /*!
+   * Converting copy constructor
+   */
+  template<typename U>
+  HugePageAllocator(const HugePageAllocator<U, kAlignment, kThreshold, kPolicy>&) noexcept
+  {}
+
+  /*!
+   * @brief Allocate memory block for STL container
+   * @param [in] n     Number of elements to allocate
+   * @param [in] hint  Hint parameter (unused)
+   * @return  Pointer to aligned memroy
+   */
+  pointer
+  allocate(size_type n, const_pointer /* hint */ = nullptr) const
+  {
+    auto p = static_cast<pointer>(alignedHugeMalloc(n * sizeof(value_type), kAlignment, kThreshold, kPolicy));
+    if (p == nullptr) {
+      throw std::bad_alloc{};
+    }
+    return p;
+  }
+
+  /*!
+   * @brief Free allocated STL memory
+   * @param [in,out] p  Pointer to dynamic allocated memory
+   * @param [in]     n  Number of elements
+   */
+  void
+  deallocate(pointer p, size_type n) const noexcept
+  {
+    alignedHugeFree(p, n * sizeof(value_type), kAlignment, kThreshold);
+  }
+};  // class HugePageAllocator
+
+
+template<
+  typename T,
+  std::size_t kAlignment1,
+  std::size_t kThreshold1,
+  HugePagePolicy kPolicy1,
+  typename U,
+  std::size_t kAlignment2,
+  std::size_t kThreshold2,
+  HugePagePolicy kPolicy2
+>
+static inline bool
+operator==(
+    const HugePageAllocator<T, kAlignment1, kThreshold1, kPolicy1>&,
+    const HugePageAllocator<U, kAlignment2, kThreshold2, kPolicy2>&) noexcept
+{
+  return kAlignment1 == kAlignment2 && kThreshold1 == kThreshold2;
+}
+
+
+template<
+  typename T,
+  std::size_t kAlignment1,
+  std::size_t kThreshold1,
+  HugePagePolicy kPolicy1,
+  typename U,
+  std::size_t kAlignment2,
+  std::size_t kThreshold2,
+  HugePagePolicy kPolicy2
+>
+static inline bool
+operator!=(
+    const HugePageAllocator<T, kAlignment1, kThreshold1, kPolicy1>& lhs,
+    const HugePageAllocator<U, kAlignment2, kThreshold2, kPolicy2>& rhs) noexcept
+{
+  return !(lhs == rhs);
+}
+
+
 }  // namespace simdutil
 
 
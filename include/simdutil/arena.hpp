@@ -0,0 +1,357 @@
+#ifndef SIMDUTIL_ARENA_HPP
+#define SIMDUTIL_ARENA_HPP
+
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include "allocator.hpp"
+
+
+namespace simdutil
+{
+/*!
+ * @brief Monotonic (bump pointer) arena for SIMD scratch buffers
+ *
+ * Large blocks are obtained by alignedMalloc() and sliced by bumping a pointer.
+ * Individual slices are never freed; reset() or ArenaScope rewinds the arena at once,
+ * and the blocks are kept for reuse until the arena is destroyed or release() is called.
+ */
+class MonotonicArena
+{
+public:
+  //! Default alignment of slices
+  static constexpr std::size_t kAlignment = 64;
+  //! Default size of blocks
+  static constexpr std::size_t kDefaultBlockSize = 1024 * 1024;
+
+  /*!
+   * @brief Position in the arena, used to rewind it
+   */
+  struct Marker
+  {
+    //! Index of the current block
+    std::size_t index;
+    //! Offset in the current block
+    std::size_t offset;
+  };  // struct Marker
+
+  /*!
+   * @brief Construct an empty arena
+   * @param [in] blockSize  Size of blocks to obtain from alignedMalloc()
+   */
+  explicit MonotonicArena(std::size_t blockSize = kDefaultBlockSize) noexcept
+    : blockSize_{blockSize}
+    , blocks_{}
+    , index_{0}
+    , offset_{0}
+  {}
+
+  MonotonicArena(const MonotonicArena&) = delete;
+  MonotonicArena& operator=(const MonotonicArena&) = delete;
+
+  /*!
+   * @brief Free all blocks
+   */
+  ~MonotonicArena()
+  {
+    release();
+  }
+
+  /*!
+   * @brief Allocate aligned memory from the arena
+   * @param [in] nBytes     Memory size
+   * @param [in] alignment  Alignment (Must be power of 2 and no more than kAlignment)
+   * @return  Allocated aligned memory, or nullptr on failure
+   */
+  void*
+  allocate(std::size_t nBytes, std::size_t alignment = kAlignment) noexcept
+  {
+    if (index_ < blocks_.size()) {
+      const auto offset = alignUp(offset_, alignment);
+      if (offset + nBytes <= blocks_[index_].size) {
+        offset_ = offset + nBytes;
+        return blocks_[index_].data + offset;
+      }
+    }
+    // Move to the next block which is large enough, or insert a new one
+    auto index = blocks_.empty() ? 0 : index_ + 1;
+    if (index >= blocks_.size() || blocks_[index].size < nBytes) {
+      const auto size = nBytes > blockSize_ ? nBytes : blockSize_;
+      Block block{alignedMalloc<unsigned char>(size, kAlignment), size};
+      if (block.data == nullptr) {
+        return nullptr;
+      }
+      try {
+        blocks_.insert(blocks_.begin() + static_cast<std::ptrdiff_t>(index), block);
+      } catch (...) {
+        alignedFree(block.data);
+        return nullptr;
+      }
+    }
+    index_ = index;
+    offset_ = nBytes;
+    return blocks_[index_].data;
+  }
+
+  /*!
+   * @brief Allocate an aligned array from the arena
+   *
+   * Elements are not initialized.
+   *
+   * @param [in] n          Number of elements
+   * @param [in] alignment  Alignment (Must be power of 2 and no more than kAlignment)
+   * @return  Allocated aligned array, or nullptr on failure
+   */
+  template<typename T>
+  T*
+  allocateArray(std::size_t n, std::size_t alignment = kAlignment) noexcept
+  {
+    return static_cast<T*>(allocate(n * sizeof(T), alignment));
+  }
+
+  /*!
+   * @brief Get the current position of the arena
+   * @return  Current position
+   */
+  Marker
+  mark() const noexcept
+  {
+    return Marker{index_, offset_};
+  }
+
+  /*!
+   * @brief Rewind the arena to a position obtained by mark()
+   *
+   * All memory allocated after the position becomes invalid.
+   *
+   * @param [in] marker  Position to rewind to
+   */
+  void
+  rewind(const Marker& marker) noexcept
+  {
+    index_ = marker.index;
+    offset_ = marker.offset;
+  }
+
+  /*!
+   * @brief Rewind the arena to the beginning, keeping its blocks
+   */
+  void
+  reset() noexcept
+  {
+    rewind(Marker{0, 0});
+  }
+
+  /*!
+   * @brief Free all blocks
+   */
+  void
+  release() noexcept
+  {
+    for (const auto& block : blocks_) {
+      alignedFree(block.data);
+    }
+    blocks_.clear();
+    reset();
+  }
+
+  /*!
+   * @brief Get the total size of blocks owned by the arena
+   * @return  Size in bytes
+   */
+  std::size_t
+  capacity() const noexcept
+  {
+    std::size_t size = 0;
+    for (const auto& block : blocks_) {
+      size += block.size;
+    }
+    return size;
+  }
+
+private:
+  //! Memory block obtained by alignedMalloc()
+  struct Block
+  {
+    //! Beginning of the block
+    unsigned char* data;
+    //! Size of the block
+    std::size_t size;
+  };  // struct Block
+
+  static std::size_t
+  alignUp(std::size_t offset, std::size_t alignment) noexcept
+  {
+    return (offset + alignment - 1) & ~(alignment - 1);
+  }
+
+  //! Minimum size of blocks
+  std::size_t blockSize_;
+  //! Blocks owned by the arena
+  std::vector<Block> blocks_;
+  //! Index of the current block
+  std::size_t index_;
+  //! Offset in the current block
+  std::size_t offset_;
+};  // class MonotonicArena
+
+
+/*!
+ * @brief Rewinds an arena to the position at construction when the scope exits
+ */
+class ArenaScope
+{
+public:
+  /*!
+   * @brief Remember the current position of an arena
+   * @param [in,out] arena  Arena to rewind at scope exit
+   */
+  explicit ArenaScope(MonotonicArena& arena) noexcept
+    : arena_(arena)
+    , marker_{arena.mark()}
+  {}
+
+  ArenaScope(const ArenaScope&) = delete;
+  ArenaScope& operator=(const ArenaScope&) = delete;
+
+  /*!
+   * @brief Rewind the arena
+   */
+  ~ArenaScope()
+  {
+    arena_.rewind(marker_);
+  }
+
+private:
+  //! Arena to rewind
+  MonotonicArena& arena_;
+  //! Position at construction
+  MonotonicArena::Marker marker_;
+};  // class ArenaScope
+
+
+/*!
+ * @brief Custom allocator for STL. This class allocates aligned memory from MonotonicArena.
+ *
+ * deallocate() does nothing; memory is reclaimed when the arena is rewound.
+ */
+template<
+  typename T,
+  std::size_t kAlignment = MonotonicArena::kAlignment
+>
+class ArenaAllocator
+{
+  static_assert(kAlignment <= MonotonicArena::kAlignment, "Alignment must not exceed the alignment of arena blocks");
+
+public:
+  //! Element type
+  using value_type = T;
+  //! Size type
+  using size_type = std::size_t;
+  //! Pointer type
+  using pointer = typename std::add_pointer<value_type>::type;
+  //! Const pointer type
+  using const_pointer = typename std::add_pointer<const value_type>::type;
+
+  /*!
+   * @brief Definition for rebinded allocator.
+   *
+   * This definition is neccessary because type parameter of this class is not only one.
+   */
+  template<class U>
+  struct rebind
+  {
+    //! Rebinded allocator type
+    using other = ArenaAllocator<U, kAlignment>;
+  };
+
+  /*!
+   * Construct with an arena
+   * @param [in] arena  Arena to allocate from
+   */
+  explicit ArenaAllocator(MonotonicArena& arena) noexcept
+    : arena_{&arena}
+  {}
+
+  /*!
+   * Converting copy constructor
+   */
+  template<typename U>
+  ArenaAllocator(const ArenaAllocator<U, kAlignment>& other) noexcept
+    : arena_{other.arena()}
+  {}
+
+  /*!
+   * @brief Allocate memory block for STL container
+   * @param [in] n     Number of elements to allocate
+   * @param [in] hint  Hint parameter (unused)
+   * @return  Pointer to aligned memroy
+   */
+  pointer
+  allocate(size_type n, const_pointer /* hint */ = nullptr) const
+  {
+    auto p = arena_->allocateArray<value_type>(n, kAlignment);
+    if (p == nullptr) {
+      throw std::bad_alloc{};
+    }
+    return p;
+  }
+
+  /*!
+   * @brief Do nothing (memory is reclaimed by rewinding the arena)
+   * @param [in] p  Pointer to dynamic allocated memory (unused)
+   * @param [in] n  Number of elements (unused)
+   */
+  void
+  deallocate(pointer /* p */, size_type /* n */) const noexcept
+  {}
+
+  /*!
+   * @brief Get the arena
+   * @return  Pointer to the arena
+   */
+  MonotonicArena*
+  arena() const noexcept
+  {
+    return arena_;
+  }
+
+private:
+  //! Arena to allocate from
+  MonotonicArena* arena_;
+};  // class ArenaAllocator
+
+
+template<
+  typename T,
+  std::size_t kAlignment1,
+  typename U,
+  std::size_t kAlignment2
+>
+static inline bool
+operator==(const ArenaAllocator<T, kAlignment1>& lhs, const ArenaAllocator<U, kAlignment2>& rhs) noexcept
+{
+  return kAlignment1 == kAlignment2 && lhs.arena() == rhs.arena();
+}
+
+
+template<
+  typename T,
+  std::size_t kAlignment1,
+  typename U,
+  std::size_t kAlignment2
+>
+static inline bool
+operator!=(const ArenaAllocator<T, kAlignment1>& lhs, const ArenaAllocator<U, kAlignment2>& rhs) noexcept
+{
+  return !(lhs == rhs);
+}
+
+
+}  // namespace simdutil
+
+
+#endif  // SIMDUTIL_ARENA_HPP
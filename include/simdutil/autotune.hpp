@@ -0,0 +1,365 @@
+#ifndef SIMDUTIL_AUTOTUNE_HPP
+#define SIMDUTIL_AUTOTUNE_HPP
+
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "aligned_vector.hpp"
+#include "cpuid.hpp"
+#include "dispatch.hpp"
+#include "reduce.hpp"
+#include "tsc.hpp"
+
+
+namespace simdutil
+{
+/*!
+ * @brief Where the level chosen by VectorWidthTuner came from
+ */
+enum class VectorWidthSource
+{
+  //! No 512-bit kernels are usable on this CPU, so nothing was measured
+  kDetected,
+  //! Read from the profile file
+  kProfile,
+  //! Measured by VectorWidthTuner::tune()
+  kMeasured
+};  // enum class VectorWidthSource
+
+
+/*!
+ * @brief Result of the vector width tuning
+ */
+struct VectorWidthProfile
+{
+  //! Machine key (See VectorWidthTuner::machineKey())
+  std::string key;
+  //! Maximum instruction set level for dispatching
+  IsaLevel level;
+  //! Where the level came from
+  VectorWidthSource source;
+  //! Geometric mean of 512-bit time / 256-bit time over the benchmark kernels (0 unless measured)
+  double ratio;
+};  // struct VectorWidthProfile
+
+
+/*!
+ * @brief Chooses between 256-bit and 512-bit kernels by measuring them
+ *
+ * Whether AVX-512 pays off depends on more than the CPUID bits:
+ * on Skylake-SP the 512-bit license lowers the core frequency, which may cost more than the wider vectors gain,
+ * while Ice Lake and Zen 4 run them at (nearly) full speed.
+ * The tuner times a few representative kernels (float sum, float dot product, std::int32_t maximum)
+ * at IsaLevel::kAvx2 and IsaLevel::kAvx512 in interleaved rounds of a few milliseconds,
+ * long enough for a license change to show in the wall-clock time measured with the TSC.
+ * The 512-bit kernels are kept only if they are at least kMinSpeedup times faster,
+ * because the lowered frequency also slows down the surrounding scalar code, which is not measured.
+ *
+ * apply() stores the result in a small text file, one line per machine key,
+ * so that only the first process on a machine pays the ~100 ms of tuning.
+ * The key contains the CPU brand string, family, model, stepping and microcode revision,
+ * so a shared home directory or a microcode update does not reuse a stale result.
+ *
+ * @code
+ * int main()
+ * {
+ *   simdutil::VectorWidthTuner::apply();  // Before the first kernel call
+ *   ...
+ * }
+ * @endcode
+ */
+class VectorWidthTuner
+{
+public:
+  //! Speedup the 512-bit kernels need to be chosen
+  static constexpr double kMinSpeedup = 1.05;
+  //! Number of interleaved measurement rounds (the median is used)
+  static constexpr int kRounds = 7;
+  //! Length of one measurement in microseconds
+  static constexpr int kSampleUs = 2000;
+  //! Number of elements of the benchmark arrays (L1-resident)
+  static constexpr std::size_t kElements = 2048;
+
+  /*!
+   * @brief Load or measure the vector width once per process and apply it to the dispatchers
+   *
+   * The profile file is read from defaultProfilePath(); if it has no entry for this machine,
+   * tune() is run and the result is written back.
+   * The level is passed to IsaLevelSetting::setLimit(), so call this before the first kernel call.
+   *
+   * @return  Chosen profile
+   */
+  static const VectorWidthProfile&
+  apply()
+  {
+    static const VectorWidthProfile profile = []() {
+      const auto path = defaultProfilePath();
+      auto result = VectorWidthProfile{machineKey(), IsaLevelSetting::detected(), VectorWidthSource::kProfile, 0.0};
+      if (path.empty() || !loadProfile(path, result.key, result.level)) {
+        result = tune();
+        if (!path.empty() && result.source == VectorWidthSource::kMeasured) {
+          storeProfile(path, result.key, result.level);
+        }
+      }
+      IsaLevelSetting::setLimit(result.level);
+      return result;
+    }();
+    return profile;
+  }
+
+  /*!
+   * @brief Measure the benchmark kernels at both widths, without file I/O or changing the dispatchers
+   * @return  Profile whose level is IsaLevelSetting::detected() if the 512-bit kernels win, IsaLevel::kAvx2 otherwise
+   */
+  static VectorWidthProfile
+  tune()
+  {
+    auto result = VectorWidthProfile{machineKey(), IsaLevelSetting::detected(), VectorWidthSource::kDetected, 0.0};
+    if (result.level < IsaLevel::kAvx512) {
+      return result;
+    }
+
+    AlignedVector<float> x(kElements);
+    AlignedVector<float> y(kElements);
+    AlignedVector<std::int32_t> z(kElements);
+    for (std::size_t i = 0; i < kElements; i++) {
+      x[i] = static_cast<float>(i % 17) * 0.25f;
+      y[i] = static_cast<float>(i % 13) * 0.5f;
+      z[i] = static_cast<std::int32_t>((i * 2654435761U) >> 8);
+    }
+
+    const auto ticks = TscClock::get().toTicks(kSampleUs * 1000.0);
+    const std::array<std::function<double(IsaLevel)>, 3> kernels{{
+      [&](IsaLevel level) {
+        const auto f = VecDispatcher<SumKernel, float, float(const float*, std::size_t)>::get().select(level);
+        return measure([&]() { return f(x.data(), kElements); }, ticks);
+      },
+      [&](IsaLevel level) {
+        const auto f = VecDispatcher<DotKernel, float, float(const float*, const float*, std::size_t)>::get().select(level);
+        return measure([&]() { return f(x.data(), y.data(), kElements); }, ticks);
+      },
+      [&](IsaLevel level) {
+        const auto f = VecDispatcher<MaxKernel, std::int32_t, std::int32_t(const std::int32_t*, std::size_t)>::get().select(level);
+        return measure([&]() { return f(z.data(), kElements); }, ticks);
+      }}};
+
+    // Interleave the widths and alternate their order, so frequency changes hit both alike
+    std::vector<std::array<std::array<double, kRounds>, 2>> times(kernels.size());
+    for (int round = 0; round < kRounds; round++) {
+      for (std::size_t k = 0; k < kernels.size(); k++) {
+        for (int w = 0; w < 2; w++) {
+          const auto wide = (w + round) % 2;
+          times[k][static_cast<std::size_t>(wide)][static_cast<std::size_t>(round)] = kernels[k](wide == 0 ? IsaLevel::kAvx2 : IsaLevel::kAvx512);
+        }
+      }
+    }
+
+    double logRatio = 0.0;
+    for (auto& kernelTimes : times) {
+      for (auto& t : kernelTimes) {
+        std::nth_element(t.begin(), t.begin() + kRounds / 2, t.end());
+      }
+      logRatio += std::log(kernelTimes[1][kRounds / 2] / kernelTimes[0][kRounds / 2]);
+    }
+    result.ratio = std::exp(logRatio / static_cast<double>(times.size()));
+    result.source = VectorWidthSource::kMeasured;
+    if (result.ratio * kMinSpeedup > 1.0) {
+      result.level = IsaLevel::kAvx2;
+    }
+    return result;
+  }
+
+  /*!
+   * @brief Get the key which identifies this machine in the profile file
+   * @return  "<brand string>;<family>-<model>-<stepping>;<microcode revision>" (e.g. "Intel(R) Xeon(R) Gold 6148 CPU @ 2.40GHz;06-55-4;0x2007006")
+   */
+  static std::string
+  machineKey()
+  {
+    auto brand = getCpuBrandString();
+    const auto first = brand.find_first_not_of(' ');
+    brand = first == std::string::npos ? std::string{} : brand.substr(first, brand.find_last_not_of(' ') - first + 1);
+
+    const auto signature = getCpuSignature();
+    std::array<char, 32> buf;
+    std::snprintf(
+      buf.data(),
+      buf.size(),
+      "%02x-%02x-%x",
+      static_cast<unsigned>(signature.family),
+      static_cast<unsigned>(signature.model),
+      static_cast<unsigned>(signature.stepping));
+    return brand + ';' + buf.data() + ';' + readMicrocodeRevision();
+  }
+
+  /*!
+   * @brief Get the path of the profile file
+   *
+   * The environment variable SIMDUTIL_TUNE_PROFILE overrides the default, and an empty value disables the file.
+   * The default is %LOCALAPPDATA%\\simdutil_tune.txt on Windows,
+   * $XDG_CACHE_HOME/simdutil_tune.txt or $HOME/.cache/simdutil_tune.txt elsewhere.
+   *
+   * @return  Path of the profile file (empty if there is none)
+   */
+  static std::string
+  defaultProfilePath()
+  {
+    const auto path = std::getenv("SIMDUTIL_TUNE_PROFILE");
+    if (path != nullptr) {
+      return path;
+    }
+#if defined(_WIN32)
+    const auto localAppData = std::getenv("LOCALAPPDATA");
+    return localAppData == nullptr ? std::string{} : std::string{localAppData} + "\\simdutil_tune.txt";
+#else
+    const auto cacheHome = std::getenv("XDG_CACHE_HOME");
+    if (cacheHome != nullptr && cacheHome[0] != '\0') {
+      return std::string{cacheHome} + "/simdutil_tune.txt";
+    }
+    const auto home = std::getenv("HOME");
+    return home == nullptr ? std::string{} : std::string{home} + "/.cache/simdutil_tune.txt";
+#endif  // defined(_WIN32)
+  }
+
+  /*!
+   * @brief Find the level of a machine in a profile file
+   * @param [in] path    Path of the profile file
+   * @param [in] key     Machine key
+   * @param [out] level  Level of the machine, if found
+   * @return  true if the file has a valid entry for the key
+   */
+  static bool
+  loadProfile(const std::string& path, const std::string& key, IsaLevel& level)
+  {
+    // Format: "<level name>\t<machine key>" per line
+    std::ifstream ifs{path};
+    std::string line;
+    while (std::getline(ifs, line)) {
+      const auto pos = line.find('\t');
+      if (pos == std::string::npos || line.compare(pos + 1, std::string::npos, key) != 0) {
+        continue;
+      }
+      const auto name = line.substr(0, pos);
+      const auto parsed = parseIsaLevel(name.c_str(), IsaLevel::kScalar);
+      if (name != getIsaLevelName(parsed)) {
+        return false;
+      }
+      level = std::min(parsed, IsaLevelSetting::detected());
+      return true;
+    }
+    return false;
+  }
+
+  /*!
+   * @brief Set the level of a machine in a profile file
+   *
+   * The file is rewritten to a temporary file which is renamed over it,
+   * so concurrent readers see either the old or the new contents.
+   *
+   * @param [in] path   Path of the profile file
+   * @param [in] key    Machine key
+   * @param [in] level  Level of the machine
+   * @return  true on success
+   */
+  static bool
+  storeProfile(const std::string& path, const std::string& key, IsaLevel level)
+  {
+    std::vector<std::string> lines;
+    {
+      std::ifstream ifs{path};
+      std::string line;
+      while (std::getline(ifs, line)) {
+        const auto pos = line.find('\t');
+        if (pos != std::string::npos && line.compare(pos + 1, std::string::npos, key) != 0) {
+          lines.push_back(line);
+        }
+      }
+    }
+    lines.push_back(std::string{getIsaLevelName(level)} + '\t' + key);
+
+    const auto tmpPath = path + ".tmp" + std::to_string(TscClock::now());
+    {
+      std::ofstream ofs{tmpPath};
+      for (const auto& line : lines) {
+        ofs << line << '\n';
+      }
+      if (!ofs.flush()) {
+        ofs.close();
+        std::remove(tmpPath.c_str());
+        return false;
+      }
+    }
+#if defined(_WIN32)
+    std::remove(path.c_str());
+#endif  // defined(_WIN32)
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+      std::remove(tmpPath.c_str());
+      return false;
+    }
+    return true;
+  }
+
+private:
+  /*!
+   * @brief Measure the time of one call
+   * @param [in] f      Kernel call
+   * @param [in] ticks  Minimum measurement length in TSC ticks
+   * @return  Average TSC ticks per call
+   */
+  template<typename F>
+  static double
+  measure(const F& f, std::uint64_t ticks)
+  {
+    volatile double sink = 0.0;
+    const auto start = TscClock::start();
+    auto now = start;
+    std::uint64_t nCalls = 0;
+    do {
+      for (int i = 0; i < 8; i++) {
+        sink = static_cast<double>(f());
+      }
+      nCalls += 8;
+      now = TscClock::now();
+    } while (now - start < ticks);
+    static_cast<void>(sink);
+    return static_cast<double>(now - start) / static_cast<double>(nCalls);
+  }
+
+  static std::string
+  readMicrocodeRevision()
+  {
+#if defined(__linux__)
+    // Format: "microcode\t: 0x2007006"
+    std::ifstream ifs{"/proc/cpuinfo"};
+    std::string line;
+    while (std::getline(ifs, line)) {
+      if (line.compare(0, 9, "microcode") == 0) {
+        const auto pos = line.find_first_not_of(" \t:", 9);
+        return pos == std::string::npos ? std::string{} : line.substr(pos);
+      }
+    }
+#endif  // defined(__linux__)
+    return std::string{};
+  }
+};  // class VectorWidthTuner
+
+constexpr double VectorWidthTuner::kMinSpeedup;
+constexpr int VectorWidthTuner::kRounds;
+constexpr int VectorWidthTuner::kSampleUs;
+constexpr std::size_t VectorWidthTuner::kElements;
+
+
+}  // namespace simdutil
+
+
+#endif  // SIMDUTIL_AUTOTUNE_HPP
@@ -0,0 +1,75 @@
+#ifndef SIMDUTIL_BITOPS_HPP
+#define SIMDUTIL_BITOPS_HPP
+
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#endif  // defined(_MSC_VER)
+
+
+namespace simdutil
+{
+/*!
+ * @brief Count trailing zero bits
+ *
+ * Inside a function compiled for BMI or POPCNT, the compiler emits the single instruction.
+ *
+ * @param [in] x  Value (Must not be 0)
+ * @return  Index of the lowest set bit
+ */
+static inline int
+countTrailingZeros(std::uint64_t x) noexcept
+{
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanForward64(&index, x);
+  return static_cast<int>(index);
+#else
+  return __builtin_ctzll(x);
+#endif  // defined(_MSC_VER)
+}
+
+
+/*!
+ * @brief Count leading zero bits
+ * @param [in] x  Value (Must not be 0)
+ * @return  63 minus the index of the highest set bit
+ */
+static inline int
+countLeadingZeros(std::uint64_t x) noexcept
+{
+#if defined(_MSC_VER)
+  unsigned long index;
+  _BitScanReverse64(&index, x);
+  return 63 - static_cast<int>(index);
+#else
+  return __builtin_clzll(x);
+#endif  // defined(_MSC_VER)
+}
+
+
+/*!
+ * @brief Count set bits
+ *
+ * Inside a function compiled with POPCNT (every SIMDUTIL_TARGET_* level), this is the single instruction.
+ *
+ * @param [in] x  Value
+ * @return  Number of set bits
+ */
+static inline int
+popCount(std::uint64_t x) noexcept
+{
+#if defined(_MSC_VER)
+  return static_cast<int>(__popcnt64(x));
+#else
+  return __builtin_popcountll(x);
+#endif  // defined(_MSC_VER)
+}
+
+
+}  // namespace simdutil
+
+
+#endif  // SIMDUTIL_BITOPS_HPP
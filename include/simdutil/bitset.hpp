@@ -0,0 +1,564 @@
+#ifndef SIMDUTIL_BITSET_HPP
+#define SIMDUTIL_BITSET_HPP
+
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#else
+#  include <immintrin.h>
+#endif  // defined(_MSC_VER)
+
+#include "bitops.hpp"
+#include "dispatch.hpp"
+#include "vec.hpp"
+
+
+namespace simdutil
+{
+/*!
+ * @brief Word operation a & b
+ */
+struct BitAnd
+{
+  static std::uint64_t apply(std::uint64_t a, std::uint64_t b) noexcept { return a & b; }
+  SIMDUTIL_TARGET_AVX2 static __m256i apply(__m256i a, __m256i b) noexcept { return _mm256_and_si256(a, b); }
+  SIMDUTIL_TARGET_AVX512ICL static __m512i apply(__m512i a, __m512i b) noexcept { return _mm512_and_si512(a, b); }
+};  // struct BitAnd
+
+/*!
+ * @brief Word operation a | b
+ */
+struct BitOr
+{
+  static std::uint64_t apply(std::uint64_t a, std::uint64_t b) noexcept { return a | b; }
+  SIMDUTIL_TARGET_AVX2 static __m256i apply(__m256i a, __m256i b) noexcept { return _mm256_or_si256(a, b); }
+  SIMDUTIL_TARGET_AVX512ICL static __m512i apply(__m512i a, __m512i b) noexcept { return _mm512_or_si512(a, b); }
+};  // struct BitOr
+
+/*!
+ * @brief Word operation a ^ b
+ */
+struct BitXor
+{
+  static std::uint64_t apply(std::uint64_t a, std::uint64_t b) noexcept { return a ^ b; }
+  SIMDUTIL_TARGET_AVX2 static __m256i apply(__m256i a, __m256i b) noexcept { return _mm256_xor_si256(a, b); }
+  SIMDUTIL_TARGET_AVX512ICL static __m512i apply(__m512i a, __m512i b) noexcept { return _mm512_xor_si512(a, b); }
+};  // struct BitXor
+
+/*!
+ * @brief Word operation a & ~b
+ */
+struct BitAndNot
+{
+  static std::uint64_t apply(std::uint64_t a, std::uint64_t b) noexcept { return a & ~b; }
+  SIMDUTIL_TARGET_AVX2 static __m256i apply(__m256i a, __m256i b) noexcept { return _mm256_andnot_si256(b, a); }
+  // The zero-masked form avoids the undefined merge source of _mm512_andnot_si512 in GCC 12
+  SIMDUTIL_TARGET_AVX512ICL static __m512i apply(__m512i a, __m512i b) noexcept { return _mm512_maskz_andnot_epi64(0xff, b, a); }
+};  // struct BitAndNot
+
+/*!
+ * @brief Word operation a (b is ignored), for plain population counts
+ */
+struct BitFirst
+{
+  static std::uint64_t apply(std::uint64_t a, std::uint64_t) noexcept { return a; }
+  SIMDUTIL_TARGET_AVX2 static __m256i apply(__m256i a, __m256i) noexcept { return a; }
+  SIMDUTIL_TARGET_AVX512ICL static __m512i apply(__m512i a, __m512i) noexcept { return a; }
+};  // struct BitFirst
+
+
+/*!
+ * @brief Word-at-a-time bitset kernels
+ *
+ * combine<Op, kStore>() computes Op word by word, optionally stores the result to dst,
+ * and returns the population count of the result.
+ * Compiled without POPCNT, the count is the compiler's bit-twiddling fallback.
+ */
+struct BitsetScalar
+{
+  template<
+    typename Op,
+    bool kStore
+  >
+  static std::size_t
+  combine(std::uint64_t* dst, const std::uint64_t* a, const std::uint64_t* b, std::size_t n) noexcept
+  {
+    // Four counters break the dependency chain of the additions
+    std::size_t count0 = 0, count1 = 0, count2 = 0, count3 = 0;
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      const auto w0 = Op::apply(a[i], b[i]);
+      const auto w1 = Op::apply(a[i + 1], b[i + 1]);
+      const auto w2 = Op::apply(a[i + 2], b[i + 2]);
+      const auto w3 = Op::apply(a[i + 3], b[i + 3]);
+      if (kStore) {
+        dst[i] = w0;
+        dst[i + 1] = w1;
+        dst[i + 2] = w2;
+        dst[i + 3] = w3;
+      }
+      count0 += static_cast<std::size_t>(popCount(w0));
+      count1 += static_cast<std::size_t>(popCount(w1));
+      count2 += static_cast<std::size_t>(popCount(w2));
+      count3 += static_cast<std::size_t>(popCount(w3));
+    }
+    for (; i < n; i++) {
+      const auto w = Op::apply(a[i], b[i]);
+      if (kStore) {
+        dst[i] = w;
+      }
+      count0 += static_cast<std::size_t>(popCount(w));
+    }
+    return (count0 + count1) + (count2 + count3);
+  }
+};  // struct BitsetScalar
+
+
+/*!
+ * @brief Bitset kernels with the POPCNT instruction
+ */
+struct BitsetPopcnt
+{
+  template<
+    typename Op,
+    bool kStore
+  >
+  SIMDUTIL_TARGET_SSE42 SIMDUTIL_FLATTEN static std::size_t
+  combine(std::uint64_t* dst, const std::uint64_t* a, const std::uint64_t* b, std::size_t n) noexcept
+  {
+    return BitsetScalar::combine<Op, kStore>(dst, a, b, n);
+  }
+};  // struct BitsetPopcnt
+
+
+/*!
+ * @brief AVX2 bitset kernels with the Harley-Seal population count
+ *
+ * Blocks of 16 vectors are reduced by a tree of carry-save adders into ones, twos, fours, eights and sixteens,
+ * so only one vector population count (PSHUFB nibble lookup and PSADBW) is needed per 16 vectors
+ * (W. Mula, N. Kurz and D. Lemire, "Faster Population Counts Using AVX2 Instructions").
+ */
+struct BitsetAvx2
+{
+  template<
+    typename Op,
+    bool kStore
+  >
+  SIMDUTIL_TARGET_AVX2 SIMDUTIL_FLATTEN static std::size_t
+  combine(std::uint64_t* dst, const std::uint64_t* a, const std::uint64_t* b, std::size_t n) noexcept
+  {
+    auto total = _mm256_setzero_si256();
+    auto ones = _mm256_setzero_si256();
+    auto twos = _mm256_setzero_si256();
+    auto fours = _mm256_setzero_si256();
+    auto eights = _mm256_setzero_si256();
+    __m256i twosA, twosB, foursA, foursB, eightsA, eightsB, sixteens;
+    std::size_t i = 0;
+    for (; i + 64 <= n; i += 64) {
+      csa(twosA, ones, ones, load<Op, kStore>(dst, a, b, i), load<Op, kStore>(dst, a, b, i + 4));
+      csa(twosB, ones, ones, load<Op, kStore>(dst, a, b, i + 8), load<Op, kStore>(dst, a, b, i + 12));
+      csa(foursA, twos, twos, twosA, twosB);
+      csa(twosA, ones, ones, load<Op, kStore>(dst, a, b, i + 16), load<Op, kStore>(dst, a, b, i + 20));
+      csa(twosB, ones, ones, load<Op, kStore>(dst, a, b, i + 24), load<Op, kStore>(dst, a, b, i + 28));
+      csa(foursB, twos, twos, twosA, twosB);
+      csa(eightsA, fours, fours, foursA, foursB);
+      csa(twosA, ones, ones, load<Op, kStore>(dst, a, b, i + 32), load<Op, kStore>(dst, a, b, i + 36));
+      csa(twosB, ones, ones, load<Op, kStore>(dst, a, b, i + 40), load<Op, kStore>(dst, a, b, i + 44));
+      csa(foursA, twos, twos, twosA, twosB);
+      csa(twosA, ones, ones, load<Op, kStore>(dst, a, b, i + 48), load<Op, kStore>(dst, a, b, i + 52));
+      csa(twosB, ones, ones, load<Op, kStore>(dst, a, b, i + 56), load<Op, kStore>(dst, a, b, i + 60));
+      csa(foursB, twos, twos, twosA, twosB);
+      csa(eightsB, fours, fours, foursA, foursB);
+      csa(sixteens, eights, eights, eightsA, eightsB);
+      total = _mm256_add_epi64(total, popCount(sixteens));
+    }
+    total = _mm256_slli_epi64(total, 4);
+    total = _mm256_add_epi64(total, _mm256_slli_epi64(popCount(eights), 3));
+    total = _mm256_add_epi64(total, _mm256_slli_epi64(popCount(fours), 2));
+    total = _mm256_add_epi64(total, _mm256_slli_epi64(popCount(twos), 1));
+    total = _mm256_add_epi64(total, popCount(ones));
+    for (; i + 4 <= n; i += 4) {
+      total = _mm256_add_epi64(total, popCount(load<Op, kStore>(dst, a, b, i)));
+    }
+    const auto sum = _mm_add_epi64(_mm256_castsi256_si128(total), _mm256_extracti128_si256(total, 1));
+    const auto count = static_cast<std::uint64_t>(_mm_cvtsi128_si64(sum)) + static_cast<std::uint64_t>(_mm_extract_epi64(sum, 1));
+    return static_cast<std::size_t>(count) + BitsetScalar::combine<Op, kStore>(dst + i, a + i, b + i, n - i);
+  }
+
+private:
+  template<
+    typename Op,
+    bool kStore
+  >
+  SIMDUTIL_TARGET_AVX2 static __m256i
+  load(std::uint64_t* dst, const std::uint64_t* a, const std::uint64_t* b, std::size_t i) noexcept
+  {
+    const auto w = Op::apply(
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(static_cast<const void*>(a + i))),
+      _mm256_loadu_si256(reinterpret_cast<const __m256i*>(static_cast<const void*>(b + i))));
+    if (kStore) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(static_cast<void*>(dst + i)), w);
+    }
+    return w;
+  }
+
+  SIMDUTIL_TARGET_AVX2 static void
+  csa(__m256i& high, __m256i& low, __m256i a, __m256i b, __m256i c) noexcept
+  {
+    const auto u = _mm256_xor_si256(a, b);
+    high = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(u, c));
+    low = _mm256_xor_si256(u, c);
+  }
+
+  SIMDUTIL_TARGET_AVX2 static __m256i
+  popCount(__m256i v) noexcept
+  {
+    const auto lookup = _mm256_setr_epi8(
+      0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+      0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const auto nibbleMask = _mm256_set1_epi8(0x0f);
+    const auto counts = _mm256_add_epi8(
+      _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, nibbleMask)),
+      _mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibbleMask)));
+    return _mm256_sad_epu8(counts, _mm256_setzero_si256());
+  }
+};  // struct BitsetAvx2
+
+
+/*!
+ * @brief AVX-512 bitset kernels with VPOPCNTQ (Ice Lake and later)
+ */
+struct BitsetAvx512Icl
+{
+  template<
+    typename Op,
+    bool kStore
+  >
+  SIMDUTIL_TARGET_AVX512ICL SIMDUTIL_FLATTEN static std::size_t
+  combine(std::uint64_t* dst, const std::uint64_t* a, const std::uint64_t* b, std::size_t n) noexcept
+  {
+    auto acc0 = _mm512_setzero_si512();
+    auto acc1 = _mm512_setzero_si512();
+    std::size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+      acc0 = _mm512_add_epi64(acc0, _mm512_popcnt_epi64(load<Op, kStore>(dst, a, b, i, 0xff)));
+      acc1 = _mm512_add_epi64(acc1, _mm512_popcnt_epi64(load<Op, kStore>(dst, a, b, i + 8, 0xff)));
+    }
+    for (; i < n; i += 8) {
+      // Masked-off words are loaded as 0, and Op(0, 0) is 0 for every operation
+      const auto mask = static_cast<__mmask8>(n - i >= 8 ? 0xff : (1u << (n - i)) - 1);
+      acc0 = _mm512_add_epi64(acc0, _mm512_popcnt_epi64(load<Op, kStore>(dst, a, b, i, mask)));
+    }
+    // Not _mm512_reduce_add_epi64(), whose 256-bit extract has an undefined merge source in GCC 12
+    const auto acc = _mm512_add_epi64(acc0, acc1);
+    const auto half = _mm256_add_epi64(_mm512_extracti32x8_epi32(acc, 0), _mm512_extracti32x8_epi32(acc, 1));
+    const auto sum = _mm_add_epi64(_mm256_castsi256_si128(half), _mm256_extracti128_si256(half, 1));
+    return static_cast<std::size_t>(_mm_cvtsi128_si64(sum) + _mm_extract_epi64(sum, 1));
+  }
+
+private:
+  template<
+    typename Op,
+    bool kStore
+  >
+  SIMDUTIL_TARGET_AVX512ICL static __m512i
+  load(std::uint64_t* dst, const std::uint64_t* a, const std::uint64_t* b, std::size_t i, __mmask8 mask) noexcept
+  {
+    const auto w = Op::apply(_mm512_maskz_loadu_epi64(mask, a + i), _mm512_maskz_loadu_epi64(mask, b + i));
+    if (kStore) {
+      _mm512_mask_storeu_epi64(dst + i, mask, w);
+    }
+    return w;
+  }
+};  // struct BitsetAvx512Icl
+
+
+/*!
+ * @brief Apply a word operation over bitsets with a fused population count
+ *
+ * The implementation is selected at runtime: VPOPCNTQ (AVX-512 Ice Lake level), AVX2 Harley-Seal,
+ * POPCNT (SSE4.2 level) or portable code.
+ *
+ * @tparam Op  BitAnd, BitOr, BitXor, BitAndNot or BitFirst
+ * @tparam kStore  true to store the result to dst
+ * @param [out] dst  Result words (may be a or b, unused if kStore is false)
+ * @param [in] a  First operand words
+ * @param [in] b  Second operand words
+ * @param [in] n  Number of words
+ * @return  Number of set bits in the result
+ */
+template<
+  typename Op,
+  bool kStore
+>
+static inline std::size_t
+combineBitsets(std::uint64_t* dst, const std::uint64_t* a, const std::uint64_t* b, std::size_t n) noexcept
+{
+  static const Dispatcher<std::size_t(std::uint64_t*, const std::uint64_t*, const std::uint64_t*, std::size_t)> dispatcher{
+    {IsaLevel::kAvx512Icl, &BitsetAvx512Icl::combine<Op, kStore>},
+    {IsaLevel::kAvx2, &BitsetAvx2::combine<Op, kStore>},
+    {IsaLevel::kSse42, &BitsetPopcnt::combine<Op, kStore>},
+    {IsaLevel::kScalar, &BitsetScalar::combine<Op, kStore>}};
+  return dispatcher(dst, a, b, n);
+}
+
+
+/*!
+ * @brief Count set bits of a bitset
+ * @param [in] a  Words
+ * @param [in] n  Number of words
+ * @return  Number of set bits
+ */
+static inline std::size_t
+bitsetCount(const std::uint64_t* a, std::size_t n) noexcept
+{
+  return combineBitsets<BitFirst, false>(nullptr, a, a, n);
+}
+
+/*!
+ * @brief dst = a & b
+ * @param [out] dst  Result words (may be a or b)
+ * @param [in] a  First operand words
+ * @param [in] b  Second operand words
+ * @param [in] n  Number of words
+ * @return  Number of set bits of the result
+ */
+static inline std::size_t
+bitsetAnd(std::uint64_t* dst, const std::uint64_t* a, const std::uint64_t* b, std::size_t n) noexcept
+{
+  return combineBitsets<BitAnd, true>(dst, a, b, n);
+}
+
+/*!
+ * @brief dst = a | b
+ * @param [out] dst  Result words (may be a or b)
+ * @param [in] a  First operand words
+ * @param [in] b  Second operand words
+ * @param [in] n  Number of words
+ * @return  Number of set bits of the result
+ */
+static inline std::size_t
+bitsetOr(std::uint64_t* dst, const std::uint64_t* a, const std::uint64_t* b, std::size_t n) noexcept
+{
+  return combineBitsets<BitOr, true>(dst, a, b, n);
+}
+
+/*!
+ * @brief dst = a ^ b
+ * @param [out] dst  Result words (may be a or b)
+ * @param [in] a  First operand words
+ * @param [in] b  Second operand words
+ * @param [in] n  Number of words
+ * @return  Number of set bits of the result
+ */
+static inline std::size_t
+bitsetXor(std::uint64_t* dst, const std::uint64_t* a, const std::uint64_t* b, std::size_t n) noexcept
+{
+  return combineBitsets<BitXor, true>(dst, a, b, n);
+}
+
+/*!
+ * @brief dst = a & ~b
+ * @param [out] dst  Result words (may be a or b)
+ * @param [in] a  First operand words
+ * @param [in] b  Second operand words
+ * @param [in] n  Number of words
+ * @return  Number of set bits of the result
+ */
+static inline std::size_t
+bitsetAndNot(std::uint64_t* dst, const std::uint64_t* a, const std::uint64_t* b, std::size_t n) noexcept
+{
+  return combineBitsets<BitAndNot, true>(dst, a, b, n);
+}
+
+/*!
+ * @brief Count set bits of a & b without storing it (intersection cardinality)
+ * @param [in] a  First operand words
+ * @param [in] b  Second operand words
+ * @param [in] n  Number of words
+ * @return  Number of set bits of a & b
+ */
+static inline std::size_t
+bitsetAndCount(const std::uint64_t* a, const std::uint64_t* b, std::size_t n) noexcept
+{
+  return combineBitsets<BitAnd, false>(nullptr, a, b, n);
+}
+
+/*!
+ * @brief Count set bits of a | b without storing it (union cardinality)
+ * @param [in] a  First operand words
+ * @param [in] b  Second operand words
+ * @param [in] n  Number of words
+ * @return  Number of set bits of a | b
+ */
+static inline std::size_t
+bitsetOrCount(const std::uint64_t* a, const std::uint64_t* b, std::size_t n) noexcept
+{
+  return combineBitsets<BitOr, false>(nullptr, a, b, n);
+}
+
+/*!
+ * @brief Count set bits of a ^ b without storing it (Hamming distance)
+ * @param [in] a  First operand words
+ * @param [in] b  Second operand words
+ * @param [in] n  Number of words
+ * @return  Number of set bits of a ^ b
+ */
+static inline std::size_t
+bitsetXorCount(const std::uint64_t* a, const std::uint64_t* b, std::size_t n) noexcept
+{
+  return combineBitsets<BitXor, false>(nullptr, a, b, n);
+}
+
+/*!
+ * @brief Count set bits of a & ~b without storing it (difference cardinality)
+ * @param [in] a  First operand words
+ * @param [in] b  Second operand words
+ * @param [in] n  Number of words
+ * @return  Number of set bits of a & ~b
+ */
+static inline std::size_t
+bitsetAndNotCount(const std::uint64_t* a, const std::uint64_t* b, std::size_t n) noexcept
+{
+  return combineBitsets<BitAndNot, false>(nullptr, a, b, n);
+}
+
+
+/*!
+ * @brief Count set bits before a position (rank)
+ * @param [in] a  Words
+ * @param [in] pos  Bit position (Must be at most the number of bits)
+ * @return  Number of set bits in [0, pos)
+ */
+static inline std::size_t
+bitsetRank(const std::uint64_t* a, std::size_t pos) noexcept
+{
+  const auto nWords = pos / 64;
+  const auto nBits = pos % 64;
+  const auto count = bitsetCount(a, nWords);
+  return nBits == 0 ? count : count + static_cast<std::size_t>(popCount(a[nWords] & ((std::uint64_t{1} << nBits) - 1)));
+}
+
+
+/*!
+ * @brief Get the position of the k-th set bit of a word with portable code
+ * @param [in] w  Word
+ * @param [in] k  0-based rank of the set bit (Must be less than the number of set bits)
+ * @return  Bit position
+ */
+static inline int
+selectInWordPortable(std::uint64_t w, int k) noexcept
+{
+  auto base = 0;
+  for (auto c = popCount(w & 0xff); c <= k; c = popCount(w & 0xff)) {
+    k -= c;
+    w >>= 8;
+    base += 8;
+  }
+  for (; k > 0; k--) {
+    w &= w - 1;
+  }
+  return base + countTrailingZeros(w);
+}
+
+
+/*!
+ * @brief Get the position of the k-th set bit of a word with PDEP (BMI2, part of the AVX2 level)
+ * @param [in] w  Word
+ * @param [in] k  0-based rank of the set bit (Must be less than the number of set bits)
+ * @return  Bit position
+ */
+SIMDUTIL_TARGET_AVX2 static inline int
+selectInWordBmi2(std::uint64_t w, int k) noexcept
+{
+  return countTrailingZeros(_pdep_u64(std::uint64_t{1} << k, w));
+}
+
+
+/*!
+ * @brief Get the position of the k-th set bit of a word
+ *
+ * The implementation is selected at runtime: PDEP (AVX2 level) or portable code.
+ *
+ * @param [in] w  Word
+ * @param [in] k  0-based rank of the set bit (Must be less than the number of set bits)
+ * @return  Bit position
+ */
+static inline int
+selectInWord(std::uint64_t w, int k) noexcept
+{
+  static const Dispatcher<int(std::uint64_t, int)> dispatcher{
+    {IsaLevel::kAvx2, &selectInWordBmi2},
+    {IsaLevel::kScalar, &selectInWordPortable}};
+  return dispatcher(w, k);
+}
+
+
+/*!
+ * @brief Get the position of the k-th set bit (select)
+ *
+ * The words are skipped in chunks with the dispatched population count,
+ * so the cost is close to bitsetCount() over the bits before the result.
+ *
+ * @param [in] a  Words
+ * @param [in] n  Number of words
+ * @param [in] k  0-based rank of the set bit
+ * @return  Bit position (n * 64 if there are at most k set bits)
+ */
+static inline std::size_t
+bitsetSelect(const std::uint64_t* a, std::size_t n, std::size_t k) noexcept
+{
+  constexpr std::size_t kChunkWords = 64;
+  std::size_t i = 0;
+  for (; i + kChunkWords <= n; i += kChunkWords) {
+    const auto count = bitsetCount(a + i, kChunkWords);
+    if (k < count) {
+      break;
+    }
+    k -= count;
+  }
+  for (; i < n; i++) {
+    const auto count = static_cast<std::size_t>(popCount(a[i]));
+    if (k < count) {
+      return i * 64 + static_cast<std::size_t>(selectInWord(a[i], static_cast<int>(k)));
+    }
+    k -= count;
+  }
+  return n * 64;
+}
+
+
+/*!
+ * @brief Call a function with the position of each set bit in increasing order
+ *
+ * @code
+ * std::vector<std::uint32_t> ids;
+ * simdutil::forEachSetBit(words, nWords, [&](std::size_t pos) {
+ *   ids.push_back(static_cast<std::uint32_t>(pos));
+ * });
+ * @endcode
+ *
+ * @tparam F  Type of the function
+ * @param [in] a  Words
+ * @param [in] n  Number of words
+ * @param [in] f  Function called as f(std::size_t pos)
+ */
+template<typename F>
+static inline void
+forEachSetBit(const std::uint64_t* a, std::size_t n, F&& f)
+{
+  for (std::size_t i = 0; i < n; i++) {
+    for (auto w = a[i]; w != 0; w &= w - 1) {
+      f(i * 64 + static_cast<std::size_t>(countTrailingZeros(w)));
+    }
+  }
+}
+
+
+}  // namespace simdutil
+
+
+#endif  // SIMDUTIL_BITSET_HPP
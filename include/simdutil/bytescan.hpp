@@ -0,0 +1,1039 @@
+#ifndef SIMDUTIL_BYTESCAN_HPP
+#define SIMDUTIL_BYTESCAN_HPP
+
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#else
+#  include <immintrin.h>
+#endif  // defined(_MSC_VER)
+
+#include "bitops.hpp"
+#include "dispatch.hpp"
+#include "vec.hpp"
+
+
+namespace simdutil
+{
+/*!
+ * @brief Set of bytes for findAnyOf(), held as nibble lookup tables for byte shuffles
+ *
+ * A byte b is in the set if and only if
+ * (table(b >> 7)[b & 0x0f] & highNibbleTable()[b >> 4]) != 0,
+ * where table(0) is asciiTable() and table(1) is nonAsciiTable().
+ * The high nibble selects one of eight bits and bit 7 of the byte selects the table,
+ * so any set of bytes is represented exactly, not only sets of up to 16 bytes.
+ */
+class ByteSet
+{
+public:
+  //! Lookup table type
+  using TableType = std::array<std::uint8_t, 16>;
+
+  /*!
+   * @brief Construct an empty set
+   */
+  ByteSet() noexcept
+    : asciiTable_{}
+    , nonAsciiTable_{}
+    , highNibbleTable_{{0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80}}
+  {}
+
+  /*!
+   * @brief Construct with bytes
+   * @param [in] chars  Bytes of the set
+   * @param [in] n  Number of bytes
+   */
+  ByteSet(const char* chars, std::size_t n) noexcept
+    : ByteSet{}
+  {
+    for (std::size_t i = 0; i < n; i++) {
+      insert(chars[i]);
+    }
+  }
+
+  /*!
+   * @brief Construct with the bytes of a NUL-terminated string
+   * @param [in] str  Bytes of the set
+   */
+  explicit ByteSet(const char* str) noexcept
+    : ByteSet{str, std::strlen(str)}
+  {}
+
+  /*!
+   * @brief Add a byte to the set
+   * @param [in] c  Byte to add
+   */
+  void
+  insert(char c) noexcept
+  {
+    const auto b = static_cast<std::uint8_t>(c);
+    auto& table = b < 0x80 ? asciiTable_ : nonAsciiTable_;
+    table[b & 0x0f] = static_cast<std::uint8_t>(table[b & 0x0f] | highNibbleTable_[b >> 4]);
+  }
+
+  /*!
+   * @brief Check whether a byte is in the set
+   * @param [in] c  Byte
+   * @return  true if c is in the set
+   */
+  bool
+  contains(char c) const noexcept
+  {
+    const auto b = static_cast<std::uint8_t>(c);
+    const auto& table = b < 0x80 ? asciiTable_ : nonAsciiTable_;
+    return (table[b & 0x0f] & highNibbleTable_[b >> 4]) != 0;
+  }
+
+  const std::uint8_t* asciiTable() const noexcept { return asciiTable_.data(); }
+  const std::uint8_t* nonAsciiTable() const noexcept { return nonAsciiTable_.data(); }
+  const std::uint8_t* highNibbleTable() const noexcept { return highNibbleTable_.data(); }
+
+private:
+  //! Bits of the high nibbles 0x0 - 0x7, indexed by the low nibble
+  alignas(16) TableType asciiTable_;
+  //! Bits of the high nibbles 0x8 - 0xf, indexed by the low nibble
+  alignas(16) TableType nonAsciiTable_;
+  //! Bit of each high nibble
+  alignas(16) TableType highNibbleTable_;
+};  // class ByteSet
+
+
+/*!
+ * @brief Get a lookup table of the UTF-8 validation
+ *
+ * The three tables classify the high nibble of the previous byte, the low nibble of the previous byte
+ * and the high nibble of the current byte into error bits.
+ * A pair of bytes is invalid if an error bit is set in all three lookups
+ * (the lookup algorithm of Keiser and Lemire, "Validating UTF-8 In Less Than One Instruction Per Byte").
+ *
+ * @param [in] index  0, 1 or 2
+ * @return  16-byte aligned table
+ */
+static inline const std::uint8_t*
+getUtf8LookupTable(int index) noexcept
+{
+  enum : std::uint8_t
+  {
+    // Lead byte or ASCII followed by a lead byte or ASCII
+    kTooShort = 1 << 0,
+    // ASCII followed by a continuation byte
+    kTooLong = 1 << 1,
+    kOverlong3 = 1 << 2,
+    kTooLarge = 1 << 3,
+    kSurrogate = 1 << 4,
+    kOverlong2 = 1 << 5,
+    kTooLarge1000 = 1 << 6,
+    kOverlong4 = 1 << 6,
+    kTwoConts = 1 << 7,
+    kCarry = kTooShort | kTooLong | kTwoConts
+  };
+
+  alignas(16) static const std::uint8_t kTables[3][16] = {
+    {
+      // 0xxx xxxx
+      kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong, kTooLong,
+      // 10xx xxxx
+      kTwoConts, kTwoConts, kTwoConts, kTwoConts,
+      // 1100 xxxx
+      kTooShort | kOverlong2,
+      // 1101 xxxx
+      kTooShort,
+      // 1110 xxxx
+      kTooShort | kOverlong3 | kSurrogate,
+      // 1111 xxxx
+      kTooShort | kTooLarge | kTooLarge1000 | kOverlong4
+    },
+    {
+      // xxxx 0000
+      kCarry | kOverlong3 | kOverlong2 | kOverlong4,
+      // xxxx 0001
+      kCarry | kOverlong2,
+      // xxxx 001x
+      kCarry, kCarry,
+      // xxxx 0100
+      kCarry | kTooLarge,
+      // xxxx 0101 - xxxx 1100
+      kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000,
+      kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000,
+      // xxxx 1101
+      kCarry | kTooLarge | kTooLarge1000 | kSurrogate,
+      // xxxx 111x
+      kCarry | kTooLarge | kTooLarge1000, kCarry | kTooLarge | kTooLarge1000
+    },
+    {
+      // 0xxx xxxx
+      kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort, kTooShort,
+      // 1000 xxxx
+      kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge1000 | kOverlong4,
+      // 1001 xxxx
+      kTooLong | kOverlong2 | kTwoConts | kOverlong3 | kTooLarge,
+      // 101x xxxx
+      kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+      kTooLong | kOverlong2 | kTwoConts | kSurrogate | kTooLarge,
+      // 11xx xxxx
+      kTooShort, kTooShort, kTooShort, kTooShort
+    }
+  };
+  return kTables[index];
+}
+
+
+/*!
+ * @brief Portable byte scanning implementations
+ */
+struct ByteScanScalar
+{
+  static std::size_t
+  findByte(const char* p, std::size_t n, char c) noexcept
+  {
+    const auto q = n == 0 ? nullptr : static_cast<const char*>(std::memchr(p, c, n));
+    return q == nullptr ? n : static_cast<std::size_t>(q - p);
+  }
+
+  static std::size_t
+  findLastByte(const char* p, std::size_t n, char c) noexcept
+  {
+    for (auto i = n; i > 0; i--) {
+      if (p[i - 1] == c) {
+        return i - 1;
+      }
+    }
+    return n;
+  }
+
+  static std::size_t
+  findAnyOf(const char* p, std::size_t n, const ByteSet& set) noexcept
+  {
+    for (std::size_t i = 0; i < n; i++) {
+      if (set.contains(p[i])) {
+        return i;
+      }
+    }
+    return n;
+  }
+
+  static std::size_t
+  countByte(const char* p, std::size_t n, char c) noexcept
+  {
+    return static_cast<std::size_t>(std::count(p, p + n, c));
+  }
+
+  static bool
+  isAscii(const char* p, std::size_t n) noexcept
+  {
+    return std::all_of(p, p + n, [](char c) {
+      return static_cast<std::uint8_t>(c) < 0x80;
+    });
+  }
+
+  static bool
+  isValidUtf8(const char* p, std::size_t n) noexcept
+  {
+    std::size_t i = 0;
+    while (i < n) {
+      const auto b = static_cast<std::uint8_t>(p[i]);
+      if (b < 0x80) {
+        i++;
+        continue;
+      }
+      // Length of the sequence and the valid range of its second byte
+      std::size_t length = 0;
+      std::uint8_t lower = 0x80;
+      std::uint8_t upper = 0xbf;
+      if (b >= 0xc2 && b <= 0xdf) {
+        length = 2;
+      } else if (b >= 0xe0 && b <= 0xef) {
+        length = 3;
+        lower = b == 0xe0 ? 0xa0 : 0x80;
+        upper = b == 0xed ? 0x9f : 0xbf;
+      } else if (b >= 0xf0 && b <= 0xf4) {
+        length = 4;
+        lower = b == 0xf0 ? 0x90 : 0x80;
+        upper = b == 0xf4 ? 0x8f : 0xbf;
+      } else {
+        return false;
+      }
+      if (n - i < length) {
+        return false;
+      }
+      const auto second = static_cast<std::uint8_t>(p[i + 1]);
+      if (second < lower || second > upper) {
+        return false;
+      }
+      for (std::size_t k = 2; k < length; k++) {
+        if ((static_cast<std::uint8_t>(p[i + k]) & 0xc0) != 0x80) {
+          return false;
+        }
+      }
+      i += length;
+    }
+    return true;
+  }
+};  // struct ByteScanScalar
+
+
+/*!
+ * @brief Byte scanning algorithms over 64-byte blocks
+ *
+ * Ops provides 64-bit match masks of 64-byte blocks for one instruction set level:
+ * matchByte<kAligned>(p, c), matchSet<kAligned>(p, set) and matchNonAscii<kAligned>(p),
+ * and kAlignment, the width of its vectors.
+ * An unaligned head block is scanned once, then the loop runs on blocks aligned to kAlignment,
+ * and the tail is an unaligned block which ends at the last byte.
+ * Buffers from AlignedAllocator, AlignedVector or Arena have no head block and use aligned loads only.
+ * No byte outside [p, p + n) is read.
+ */
+template<typename Ops>
+struct ByteScanKernel
+{
+  //! Number of bytes of a block
+  static constexpr std::size_t kBlockSize = 64;
+
+  struct ByteMatcher
+  {
+    char c;
+
+    std::uint64_t aligned(const char* p) const noexcept { return Ops::template matchByte<true>(p, c); }
+    std::uint64_t unaligned(const char* p) const noexcept { return Ops::template matchByte<false>(p, c); }
+  };  // struct ByteMatcher
+
+  struct SetMatcher
+  {
+    const ByteSet& set;
+
+    std::uint64_t aligned(const char* p) const noexcept { return Ops::template matchSet<true>(p, set); }
+    std::uint64_t unaligned(const char* p) const noexcept { return Ops::template matchSet<false>(p, set); }
+  };  // struct SetMatcher
+
+  struct NonAsciiMatcher
+  {
+    std::uint64_t aligned(const char* p) const noexcept { return Ops::template matchNonAscii<true>(p); }
+    std::uint64_t unaligned(const char* p) const noexcept { return Ops::template matchNonAscii<false>(p); }
+  };  // struct NonAsciiMatcher
+
+  static std::size_t
+  findByte(const char* p, std::size_t n, char c) noexcept
+  {
+    return findFirst(p, n, ByteMatcher{c});
+  }
+
+  static std::size_t
+  findLastByte(const char* p, std::size_t n, char c) noexcept
+  {
+    return findLast(p, n, ByteMatcher{c});
+  }
+
+  static std::size_t
+  findAnyOf(const char* p, std::size_t n, const ByteSet& set) noexcept
+  {
+    return findFirst(p, n, SetMatcher{set});
+  }
+
+  static std::size_t
+  countByte(const char* p, std::size_t n, char c) noexcept
+  {
+    return count(p, n, ByteMatcher{c});
+  }
+
+  static bool
+  isAscii(const char* p, std::size_t n) noexcept
+  {
+    return findFirst(p, n, NonAsciiMatcher{}) == n;
+  }
+
+private:
+  template<typename Matcher>
+  static std::size_t
+  findFirst(const char* p, std::size_t n, const Matcher& matcher) noexcept
+  {
+    if (n < kBlockSize) {
+      const auto mask = matchPartial(p, n, matcher);
+      return mask == 0 ? n : static_cast<std::size_t>(countTrailingZeros(mask));
+    }
+    auto i = getHeadSize(p);
+    if (i != 0) {
+      const auto mask = matcher.unaligned(p);
+      if (mask != 0) {
+        return static_cast<std::size_t>(countTrailingZeros(mask));
+      }
+    }
+    for (; i + kBlockSize <= n; i += kBlockSize) {
+      const auto mask = matcher.aligned(p + i);
+      if (mask != 0) {
+        return i + static_cast<std::size_t>(countTrailingZeros(mask));
+      }
+    }
+    if (i < n) {
+      // Bytes before i have no match, so the first match in the overlapping block is at or after i
+      const auto mask = matcher.unaligned(p + n - kBlockSize);
+      if (mask != 0) {
+        return n - kBlockSize + static_cast<std::size_t>(countTrailingZeros(mask));
+      }
+    }
+    return n;
+  }
+
+  template<typename Matcher>
+  static std::size_t
+  findLast(const char* p, std::size_t n, const Matcher& matcher) noexcept
+  {
+    if (n < kBlockSize) {
+      const auto mask = matchPartial(p, n, matcher);
+      return mask == 0 ? n : static_cast<std::size_t>(63 - countLeadingZeros(mask));
+    }
+    auto i = n - (reinterpret_cast<std::uintptr_t>(p + n) & (Ops::kAlignment - 1));
+    if (i != n) {
+      const auto mask = matcher.unaligned(p + n - kBlockSize);
+      if (mask != 0) {
+        return n - kBlockSize + static_cast<std::size_t>(63 - countLeadingZeros(mask));
+      }
+    }
+    for (; i >= kBlockSize; i -= kBlockSize) {
+      const auto mask = matcher.aligned(p + i - kBlockSize);
+      if (mask != 0) {
+        return i - kBlockSize + static_cast<std::size_t>(63 - countLeadingZeros(mask));
+      }
+    }
+    if (i > 0) {
+      const auto mask = matcher.unaligned(p) & getLowBits(i);
+      if (mask != 0) {
+        return static_cast<std::size_t>(63 - countLeadingZeros(mask));
+      }
+    }
+    return n;
+  }
+
+  template<typename Matcher>
+  static std::size_t
+  count(const char* p, std::size_t n, const Matcher& matcher) noexcept
+  {
+    if (n < kBlockSize) {
+      return static_cast<std::size_t>(popCount(matchPartial(p, n, matcher)));
+    }
+    std::size_t result = 0;
+    auto i = getHeadSize(p);
+    if (i != 0) {
+      result += static_cast<std::size_t>(popCount(matcher.unaligned(p) & getLowBits(i)));
+    }
+    for (; i + kBlockSize <= n; i += kBlockSize) {
+      result += static_cast<std::size_t>(popCount(matcher.aligned(p + i)));
+    }
+    if (i < n) {
+      // Drop the bytes of the overlapping block which are already counted
+      result += static_cast<std::size_t>(popCount(matcher.unaligned(p + n - kBlockSize) >> (kBlockSize - (n - i))));
+    }
+    return result;
+  }
+
+  template<typename Matcher>
+  static std::uint64_t
+  matchPartial(const char* p, std::size_t n, const Matcher& matcher) noexcept
+  {
+    if (n == 0) {
+      return 0;
+    }
+    alignas(kBlockSize) char block[kBlockSize] = {};
+    std::memcpy(block, p, n);
+    return matcher.aligned(block) & getLowBits(n);
+  }
+
+  static std::size_t
+  getHeadSize(const char* p) noexcept
+  {
+    return (Ops::kAlignment - (reinterpret_cast<std::uintptr_t>(p) & (Ops::kAlignment - 1))) & (Ops::kAlignment - 1);
+  }
+
+  static std::uint64_t
+  getLowBits(std::size_t n) noexcept
+  {
+    return n >= 64 ? ~std::uint64_t{0} : (std::uint64_t{1} << n) - 1;
+  }
+};  // struct ByteScanKernel
+
+template<typename Ops>
+constexpr std::size_t ByteScanKernel<Ops>::kBlockSize;
+
+
+/*!
+ * @brief SSE4.2 byte scanning implementations (PSHUFB of SSSE3 for set matching and UTF-8 validation)
+ */
+struct ByteScanSse42
+{
+  //! Vector width in bytes
+  static constexpr std::size_t kAlignment = 16;
+
+  template<bool kAligned>
+  SIMDUTIL_TARGET_SSE42 static std::uint64_t
+  matchByte(const char* p, char c) noexcept
+  {
+    const auto x = _mm_set1_epi8(c);
+    return combine(
+      _mm_cmpeq_epi8(load<kAligned>(p), x),
+      _mm_cmpeq_epi8(load<kAligned>(p + 16), x),
+      _mm_cmpeq_epi8(load<kAligned>(p + 32), x),
+      _mm_cmpeq_epi8(load<kAligned>(p + 48), x));
+  }
+
+  template<bool kAligned>
+  SIMDUTIL_TARGET_SSE42 static std::uint64_t
+  matchSet(const char* p, const ByteSet& set) noexcept
+  {
+    // Match is non-zero where the byte is in the set, so the mask of zero bytes is inverted
+    return ~combine(
+      matchSet(load<kAligned>(p), set),
+      matchSet(load<kAligned>(p + 16), set),
+      matchSet(load<kAligned>(p + 32), set),
+      matchSet(load<kAligned>(p + 48), set));
+  }
+
+  template<bool kAligned>
+  SIMDUTIL_TARGET_SSE42 static std::uint64_t
+  matchNonAscii(const char* p) noexcept
+  {
+    return combine(load<kAligned>(p), load<kAligned>(p + 16), load<kAligned>(p + 32), load<kAligned>(p + 48));
+  }
+
+  SIMDUTIL_TARGET_SSE42 SIMDUTIL_FLATTEN static bool
+  isValidUtf8(const char* p, std::size_t n) noexcept
+  {
+    auto error = _mm_setzero_si128();
+    auto prevInput = _mm_setzero_si128();
+    auto prevIncomplete = _mm_setzero_si128();
+    std::size_t i = 0;
+    for (; i + kAlignment <= n; i += kAlignment) {
+      checkUtf8(load<false>(p + i), error, prevInput, prevIncomplete);
+    }
+    if (i < n) {
+      alignas(kAlignment) char block[kAlignment] = {};
+      std::memcpy(block, p + i, n - i);
+      checkUtf8(load<true>(block), error, prevInput, prevIncomplete);
+    }
+    error = _mm_or_si128(error, prevIncomplete);
+    return _mm_testz_si128(error, error) != 0;
+  }
+
+  SIMDUTIL_TARGET_SSE42 SIMDUTIL_FLATTEN static std::size_t
+  findByte(const char* p, std::size_t n, char c) noexcept
+  {
+    return ByteScanKernel<ByteScanSse42>::findByte(p, n, c);
+  }
+
+  SIMDUTIL_TARGET_SSE42 SIMDUTIL_FLATTEN static std::size_t
+  findLastByte(const char* p, std::size_t n, char c) noexcept
+  {
+    return ByteScanKernel<ByteScanSse42>::findLastByte(p, n, c);
+  }
+
+  SIMDUTIL_TARGET_SSE42 SIMDUTIL_FLATTEN static std::size_t
+  findAnyOf(const char* p, std::size_t n, const ByteSet& set) noexcept
+  {
+    return ByteScanKernel<ByteScanSse42>::findAnyOf(p, n, set);
+  }
+
+  SIMDUTIL_TARGET_SSE42 SIMDUTIL_FLATTEN static std::size_t
+  countByte(const char* p, std::size_t n, char c) noexcept
+  {
+    return ByteScanKernel<ByteScanSse42>::countByte(p, n, c);
+  }
+
+  SIMDUTIL_TARGET_SSE42 SIMDUTIL_FLATTEN static bool
+  isAscii(const char* p, std::size_t n) noexcept
+  {
+    return ByteScanKernel<ByteScanSse42>::isAscii(p, n);
+  }
+
+private:
+  template<bool kAligned>
+  SIMDUTIL_TARGET_SSE42 static __m128i
+  load(const char* p) noexcept
+  {
+    const auto q = reinterpret_cast<const __m128i*>(static_cast<const void*>(p));
+    return kAligned ? _mm_load_si128(q) : _mm_loadu_si128(q);
+  }
+
+  SIMDUTIL_TARGET_SSE42 static std::uint64_t
+  combine(__m128i a, __m128i b, __m128i c, __m128i d) noexcept
+  {
+    return static_cast<std::uint64_t>(static_cast<std::uint16_t>(_mm_movemask_epi8(a)))
+      | static_cast<std::uint64_t>(static_cast<std::uint16_t>(_mm_movemask_epi8(b))) << 16
+      | static_cast<std::uint64_t>(static_cast<std::uint16_t>(_mm_movemask_epi8(c))) << 32
+      | static_cast<std::uint64_t>(static_cast<std::uint16_t>(_mm_movemask_epi8(d))) << 48;
+  }
+
+  SIMDUTIL_TARGET_SSE42 static __m128i
+  table(const std::uint8_t* p) noexcept
+  {
+    return _mm_load_si128(reinterpret_cast<const __m128i*>(static_cast<const void*>(p)));
+  }
+
+  SIMDUTIL_TARGET_SSE42 static __m128i
+  highNibble(__m128i x) noexcept
+  {
+    return _mm_and_si128(_mm_srli_epi16(x, 4), _mm_set1_epi8(0x0f));
+  }
+
+  SIMDUTIL_TARGET_SSE42 static __m128i
+  matchSet(__m128i x, const ByteSet& set) noexcept
+  {
+    // PSHUFB yields 0 for indices with bit 7 set, so each low nibble table only sees its half of the bytes
+    const auto low = _mm_or_si128(
+      _mm_shuffle_epi8(table(set.asciiTable()), x),
+      _mm_shuffle_epi8(table(set.nonAsciiTable()), _mm_xor_si128(x, _mm_set1_epi8(static_cast<char>(0x80)))));
+    const auto m = _mm_and_si128(low, _mm_shuffle_epi8(table(set.highNibbleTable()), highNibble(x)));
+    return _mm_cmpeq_epi8(m, _mm_setzero_si128());
+  }
+
+  SIMDUTIL_TARGET_SSE42 static void
+  checkUtf8(__m128i input, __m128i& error, __m128i& prevInput, __m128i& prevIncomplete) noexcept
+  {
+    if (_mm_movemask_epi8(input) == 0) {
+      // ASCII only: the previous block must have ended with a complete sequence
+      error = _mm_or_si128(error, prevIncomplete);
+      return;
+    }
+    const auto prev1 = _mm_alignr_epi8(input, prevInput, 15);
+    const auto prev2 = _mm_alignr_epi8(input, prevInput, 14);
+    const auto prev3 = _mm_alignr_epi8(input, prevInput, 13);
+    const auto special = _mm_and_si128(
+      _mm_and_si128(
+        _mm_shuffle_epi8(table(getUtf8LookupTable(0)), highNibble(prev1)),
+        _mm_shuffle_epi8(table(getUtf8LookupTable(1)), _mm_and_si128(prev1, _mm_set1_epi8(0x0f)))),
+      _mm_shuffle_epi8(table(getUtf8LookupTable(2)), highNibble(input)));
+    // Bit 7 is set where the byte must be the 2nd continuation of a 3-byte or the 3rd of a 4-byte sequence
+    const auto must23 = _mm_and_si128(
+      _mm_or_si128(_mm_subs_epu8(prev2, _mm_set1_epi8(0x60)), _mm_subs_epu8(prev3, _mm_set1_epi8(0x70))),
+      _mm_set1_epi8(static_cast<char>(0x80)));
+    error = _mm_or_si128(error, _mm_xor_si128(must23, special));
+    // Non-zero if the last 3 bytes start a sequence which continues into the next block
+    prevIncomplete = _mm_subs_epu8(input, _mm_set_epi32(static_cast<int>(0xbfdfefffu), -1, -1, -1));
+    prevInput = input;
+  }
+};  // struct ByteScanSse42
+
+
+/*!
+ * @brief AVX2 byte scanning implementations
+ */
+struct ByteScanAvx2
+{
+  //! Vector width in bytes
+  static constexpr std::size_t kAlignment = 32;
+
+  template<bool kAligned>
+  SIMDUTIL_TARGET_AVX2 static std::uint64_t
+  matchByte(const char* p, char c) noexcept
+  {
+    const auto x = _mm256_set1_epi8(c);
+    return combine(_mm256_cmpeq_epi8(load<kAligned>(p), x), _mm256_cmpeq_epi8(load<kAligned>(p + 32), x));
+  }
+
+  template<bool kAligned>
+  SIMDUTIL_TARGET_AVX2 static std::uint64_t
+  matchSet(const char* p, const ByteSet& set) noexcept
+  {
+    return ~combine(matchSet(load<kAligned>(p), set), matchSet(load<kAligned>(p + 32), set));
+  }
+
+  template<bool kAligned>
+  SIMDUTIL_TARGET_AVX2 static std::uint64_t
+  matchNonAscii(const char* p) noexcept
+  {
+    return combine(load<kAligned>(p), load<kAligned>(p + 32));
+  }
+
+  SIMDUTIL_TARGET_AVX2 SIMDUTIL_FLATTEN static bool
+  isValidUtf8(const char* p, std::size_t n) noexcept
+  {
+    auto error = _mm256_setzero_si256();
+    auto prevInput = _mm256_setzero_si256();
+    auto prevIncomplete = _mm256_setzero_si256();
+    std::size_t i = 0;
+    for (; i + kAlignment <= n; i += kAlignment) {
+      checkUtf8(load<false>(p + i), error, prevInput, prevIncomplete);
+    }
+    if (i < n) {
+      alignas(kAlignment) char block[kAlignment] = {};
+      std::memcpy(block, p + i, n - i);
+      checkUtf8(load<true>(block), error, prevInput, prevIncomplete);
+    }
+    error = _mm256_or_si256(error, prevIncomplete);
+    return _mm256_testz_si256(error, error) != 0;
+  }
+
+  SIMDUTIL_TARGET_AVX2 SIMDUTIL_FLATTEN static std::size_t
+  findByte(const char* p, std::size_t n, char c) noexcept
+  {
+    return ByteScanKernel<ByteScanAvx2>::findByte(p, n, c);
+  }
+
+  SIMDUTIL_TARGET_AVX2 SIMDUTIL_FLATTEN static std::size_t
+  findLastByte(const char* p, std::size_t n, char c) noexcept
+  {
+    return ByteScanKernel<ByteScanAvx2>::findLastByte(p, n, c);
+  }
+
+  SIMDUTIL_TARGET_AVX2 SIMDUTIL_FLATTEN static std::size_t
+  findAnyOf(const char* p, std::size_t n, const ByteSet& set) noexcept
+  {
+    return ByteScanKernel<ByteScanAvx2>::findAnyOf(p, n, set);
+  }
+
+  SIMDUTIL_TARGET_AVX2 SIMDUTIL_FLATTEN static std::size_t
+  countByte(const char* p, std::size_t n, char c) noexcept
+  {
+    return ByteScanKernel<ByteScanAvx2>::countByte(p, n, c);
+  }
+
+  SIMDUTIL_TARGET_AVX2 SIMDUTIL_FLATTEN static bool
+  isAscii(const char* p, std::size_t n) noexcept
+  {
+    return ByteScanKernel<ByteScanAvx2>::isAscii(p, n);
+  }
+
+private:
+  template<bool kAligned>
+  SIMDUTIL_TARGET_AVX2 static __m256i
+  load(const char* p) noexcept
+  {
+    const auto q = reinterpret_cast<const __m256i*>(static_cast<const void*>(p));
+    return kAligned ? _mm256_load_si256(q) : _mm256_loadu_si256(q);
+  }
+
+  SIMDUTIL_TARGET_AVX2 static std::uint64_t
+  combine(__m256i a, __m256i b) noexcept
+  {
+    return static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(a)))
+      | static_cast<std::uint64_t>(static_cast<std::uint32_t>(_mm256_movemask_epi8(b))) << 32;
+  }
+
+  SIMDUTIL_TARGET_AVX2 static __m256i
+  table(const std::uint8_t* p) noexcept
+  {
+    return _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(static_cast<const void*>(p))));
+  }
+
+  SIMDUTIL_TARGET_AVX2 static __m256i
+  highNibble(__m256i x) noexcept
+  {
+    return _mm256_and_si256(_mm256_srli_epi16(x, 4), _mm256_set1_epi8(0x0f));
+  }
+
+  SIMDUTIL_TARGET_AVX2 static __m256i
+  matchSet(__m256i x, const ByteSet& set) noexcept
+  {
+    const auto low = _mm256_or_si256(
+      _mm256_shuffle_epi8(table(set.asciiTable()), x),
+      _mm256_shuffle_epi8(table(set.nonAsciiTable()), _mm256_xor_si256(x, _mm256_set1_epi8(static_cast<char>(0x80)))));
+    const auto m = _mm256_and_si256(low, _mm256_shuffle_epi8(table(set.highNibbleTable()), highNibble(x)));
+    return _mm256_cmpeq_epi8(m, _mm256_setzero_si256());
+  }
+
+  template<int kShift>
+  SIMDUTIL_TARGET_AVX2 static __m256i
+  prev(__m256i input, __m256i prevInput) noexcept
+  {
+    // [upper half of prevInput, lower half of input] supplies the bytes shifted into each 128-bit lane
+    return _mm256_alignr_epi8(input, _mm256_permute2x128_si256(prevInput, input, 0x21), 16 - kShift);
+  }
+
+  SIMDUTIL_TARGET_AVX2 static void
+  checkUtf8(__m256i input, __m256i& error, __m256i& prevInput, __m256i& prevIncomplete) noexcept
+  {
+    if (_mm256_movemask_epi8(input) == 0) {
+      error = _mm256_or_si256(error, prevIncomplete);
+      return;
+    }
+    const auto prev1 = prev<1>(input, prevInput);
+    const auto special = _mm256_and_si256(
+      _mm256_and_si256(
+        _mm256_shuffle_epi8(table(getUtf8LookupTable(0)), highNibble(prev1)),
+        _mm256_shuffle_epi8(table(getUtf8LookupTable(1)), _mm256_and_si256(prev1, _mm256_set1_epi8(0x0f)))),
+      _mm256_shuffle_epi8(table(getUtf8LookupTable(2)), highNibble(input)));
+    const auto must23 = _mm256_and_si256(
+      _mm256_or_si256(
+        _mm256_subs_epu8(prev<2>(input, prevInput), _mm256_set1_epi8(0x60)),
+        _mm256_subs_epu8(prev<3>(input, prevInput), _mm256_set1_epi8(0x70))),
+      _mm256_set1_epi8(static_cast<char>(0x80)));
+    error = _mm256_or_si256(error, _mm256_xor_si256(must23, special));
+    prevIncomplete = _mm256_subs_epu8(input, _mm256_set_epi32(static_cast<int>(0xbfdfefffu), -1, -1, -1, -1, -1, -1, -1));
+    prevInput = input;
+  }
+};  // struct ByteScanAvx2
+
+
+/*!
+ * @brief AVX-512BW byte scanning implementations
+ */
+struct ByteScanAvx512
+{
+  //! Vector width in bytes
+  static constexpr std::size_t kAlignment = 64;
+
+  template<bool kAligned>
+  SIMDUTIL_TARGET_AVX512 static std::uint64_t
+  matchByte(const char* p, char c) noexcept
+  {
+    return _mm512_cmpeq_epi8_mask(load<kAligned>(p), _mm512_set1_epi8(c));
+  }
+
+  template<bool kAligned>
+  SIMDUTIL_TARGET_AVX512 static std::uint64_t
+  matchSet(const char* p, const ByteSet& set) noexcept
+  {
+    const auto x = load<kAligned>(p);
+    const auto low = _mm512_or_si512(
+      _mm512_shuffle_epi8(table(set.asciiTable()), x),
+      _mm512_shuffle_epi8(table(set.nonAsciiTable()), _mm512_xor_si512(x, _mm512_set1_epi8(static_cast<char>(0x80)))));
+    return _mm512_test_epi8_mask(low, _mm512_shuffle_epi8(table(set.highNibbleTable()), highNibble(x)));
+  }
+
+  template<bool kAligned>
+  SIMDUTIL_TARGET_AVX512 static std::uint64_t
+  matchNonAscii(const char* p) noexcept
+  {
+    return _mm512_movepi8_mask(load<kAligned>(p));
+  }
+
+  SIMDUTIL_TARGET_AVX512 SIMDUTIL_FLATTEN static bool
+  isValidUtf8(const char* p, std::size_t n) noexcept
+  {
+    auto error = _mm512_setzero_si512();
+    auto prevInput = _mm512_setzero_si512();
+    auto prevIncomplete = _mm512_setzero_si512();
+    std::size_t i = 0;
+    for (; i + kAlignment <= n; i += kAlignment) {
+      checkUtf8(load<false>(p + i), error, prevInput, prevIncomplete);
+    }
+    if (i < n) {
+      // Masked-off bytes are zero (ASCII), which terminates the input like a NUL padding
+      const auto mask = static_cast<__mmask64>((std::uint64_t{1} << (n - i)) - 1);
+      checkUtf8(_mm512_maskz_loadu_epi8(mask, p + i), error, prevInput, prevIncomplete);
+    }
+    error = _mm512_or_si512(error, prevIncomplete);
+    return _mm512_test_epi8_mask(error, error) == 0;
+  }
+
+  SIMDUTIL_TARGET_AVX512 SIMDUTIL_FLATTEN static std::size_t
+  findByte(const char* p, std::size_t n, char c) noexcept
+  {
+    return ByteScanKernel<ByteScanAvx512>::findByte(p, n, c);
+  }
+
+  SIMDUTIL_TARGET_AVX512 SIMDUTIL_FLATTEN static std::size_t
+  findLastByte(const char* p, std::size_t n, char c) noexcept
+  {
+    return ByteScanKernel<ByteScanAvx512>::findLastByte(p, n, c);
+  }
+
+  SIMDUTIL_TARGET_AVX512 SIMDUTIL_FLATTEN static std::size_t
+  findAnyOf(const char* p, std::size_t n, const ByteSet& set) noexcept
+  {
+    return ByteScanKernel<ByteScanAvx512>::findAnyOf(p, n, set);
+  }
+
+  SIMDUTIL_TARGET_AVX512 SIMDUTIL_FLATTEN static std::size_t
+  countByte(const char* p, std::size_t n, char c) noexcept
+  {
+    return ByteScanKernel<ByteScanAvx512>::countByte(p, n, c);
+  }
+
+  SIMDUTIL_TARGET_AVX512 SIMDUTIL_FLATTEN static bool
+  isAscii(const char* p, std::size_t n) noexcept
+  {
+    return ByteScanKernel<ByteScanAvx512>::isAscii(p, n);
+  }
+
+private:
+  template<bool kAligned>
+  SIMDUTIL_TARGET_AVX512 static __m512i
+  load(const char* p) noexcept
+  {
+    return kAligned ? _mm512_load_si512(p) : _mm512_loadu_si512(p);
+  }
+
+  SIMDUTIL_TARGET_AVX512 static __m512i
+  table(const std::uint8_t* p) noexcept
+  {
+    // The zero-masked broadcast avoids the undefined merge source of _mm512_broadcast_i32x4 in GCC 12,
+    // and still compiles to one unmasked vbroadcasti32x4 from memory
+    const auto x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(static_cast<const void*>(p)));
+    return _mm512_maskz_broadcast_i32x4(static_cast<__mmask16>(0xffff), x);
+  }
+
+  SIMDUTIL_TARGET_AVX512 static __m512i
+  highNibble(__m512i x) noexcept
+  {
+    return _mm512_and_si512(_mm512_srli_epi16(x, 4), _mm512_set1_epi8(0x0f));
+  }
+
+  template<int kShift>
+  SIMDUTIL_TARGET_AVX512 static __m512i
+  prev(__m512i input, __m512i prevInput) noexcept
+  {
+    // [last 128-bit lane of prevInput, first three lanes of input] supplies the bytes shifted into each lane
+    const auto shifted = _mm512_permutex2var_epi64(prevInput, _mm512_set_epi64(13, 12, 11, 10, 9, 8, 7, 6), input);
+    return _mm512_alignr_epi8(input, shifted, 16 - kShift);
+  }
+
+  SIMDUTIL_TARGET_AVX512 static void
+  checkUtf8(__m512i input, __m512i& error, __m512i& prevInput, __m512i& prevIncomplete) noexcept
+  {
+    if (_mm512_movepi8_mask(input) == 0) {
+      error = _mm512_or_si512(error, prevIncomplete);
+      return;
+    }
+    const auto prev1 = prev<1>(input, prevInput);
+    const auto special = _mm512_and_si512(
+      _mm512_and_si512(
+        _mm512_shuffle_epi8(table(getUtf8LookupTable(0)), highNibble(prev1)),
+        _mm512_shuffle_epi8(table(getUtf8LookupTable(1)), _mm512_and_si512(prev1, _mm512_set1_epi8(0x0f)))),
+      _mm512_shuffle_epi8(table(getUtf8LookupTable(2)), highNibble(input)));
+    const auto must23 = _mm512_and_si512(
+      _mm512_or_si512(
+        _mm512_subs_epu8(prev<2>(input, prevInput), _mm512_set1_epi8(0x60)),
+        _mm512_subs_epu8(prev<3>(input, prevInput), _mm512_set1_epi8(0x70))),
+      _mm512_set1_epi8(static_cast<char>(0x80)));
+    error = _mm512_or_si512(error, _mm512_xor_si512(must23, special));
+    prevIncomplete = _mm512_subs_epu8(input, _mm512_set_epi32(
+      static_cast<int>(0xbfdfefffu), -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1));
+    prevInput = input;
+  }
+};  // struct ByteScanAvx512
+
+
+/*!
+ * @brief Find the first occurrence of a byte
+ * @param [in] p  Bytes
+ * @param [in] n  Number of bytes
+ * @param [in] c  Byte to find
+ * @return  Index of the first occurrence (n if not found)
+ */
+static inline std::size_t
+findByte(const char* p, std::size_t n, char c) noexcept
+{
+  static const Dispatcher<std::size_t(const char*, std::size_t, char)> dispatcher{
+    {IsaLevel::kAvx512, &ByteScanAvx512::findByte},
+    {IsaLevel::kAvx2, &ByteScanAvx2::findByte},
+    {IsaLevel::kSse42, &ByteScanSse42::findByte},
+    {IsaLevel::kScalar, &ByteScanScalar::findByte}};
+  return dispatcher(p, n, c);
+}
+
+
+/*!
+ * @brief Find the last occurrence of a byte
+ * @param [in] p  Bytes
+ * @param [in] n  Number of bytes
+ * @param [in] c  Byte to find
+ * @return  Index of the last occurrence (n if not found)
+ */
+static inline std::size_t
+findLastByte(const char* p, std::size_t n, char c) noexcept
+{
+  static const Dispatcher<std::size_t(const char*, std::size_t, char)> dispatcher{
+    {IsaLevel::kAvx512, &ByteScanAvx512::findLastByte},
+    {IsaLevel::kAvx2, &ByteScanAvx2::findLastByte},
+    {IsaLevel::kSse42, &ByteScanSse42::findLastByte},
+    {IsaLevel::kScalar, &ByteScanScalar::findLastByte}};
+  return dispatcher(p, n, c);
+}
+
+
+/*!
+ * @brief Find the first byte which is in a set
+ *
+ * @code
+ * static const simdutil::ByteSet kDelimiters{" \t\r\n"};
+ * auto pos = simdutil::findAnyOf(line, length, kDelimiters);
+ * @endcode
+ *
+ * @param [in] p  Bytes
+ * @param [in] n  Number of bytes
+ * @param [in] set  Bytes to find
+ * @return  Index of the first byte in the set (n if not found)
+ */
+static inline std::size_t
+findAnyOf(const char* p, std::size_t n, const ByteSet& set) noexcept
+{
+  static const Dispatcher<std::size_t(const char*, std::size_t, const ByteSet&)> dispatcher{
+    {IsaLevel::kAvx512, &ByteScanAvx512::findAnyOf},
+    {IsaLevel::kAvx2, &ByteScanAvx2::findAnyOf},
+    {IsaLevel::kSse42, &ByteScanSse42::findAnyOf},
+    {IsaLevel::kScalar, &ByteScanScalar::findAnyOf}};
+  return dispatcher(p, n, set);
+}
+
+
+/*!
+ * @brief Count the occurrences of a byte (e.g. newlines)
+ * @param [in] p  Bytes
+ * @param [in] n  Number of bytes
+ * @param [in] c  Byte to count
+ * @return  Number of occurrences
+ */
+static inline std::size_t
+countByte(const char* p, std::size_t n, char c) noexcept
+{
+  static const Dispatcher<std::size_t(const char*, std::size_t, char)> dispatcher{
+    {IsaLevel::kAvx512, &ByteScanAvx512::countByte},
+    {IsaLevel::kAvx2, &ByteScanAvx2::countByte},
+    {IsaLevel::kSse42, &ByteScanSse42::countByte},
+    {IsaLevel::kScalar, &ByteScanScalar::countByte}};
+  return dispatcher(p, n, c);
+}
+
+
+/*!
+ * @brief Check whether all bytes are ASCII
+ * @param [in] p  Bytes
+ * @param [in] n  Number of bytes
+ * @return  true if no byte has bit 7 set
+ */
+static inline bool
+isAscii(const char* p, std::size_t n) noexcept
+{
+  static const Dispatcher<bool(const char*, std::size_t)> dispatcher{
+    {IsaLevel::kAvx512, &ByteScanAvx512::isAscii},
+    {IsaLevel::kAvx2, &ByteScanAvx2::isAscii},
+    {IsaLevel::kSse42, &ByteScanSse42::isAscii},
+    {IsaLevel::kScalar, &ByteScanScalar::isAscii}};
+  return dispatcher(p, n);
+}
+
+
+/*!
+ * @brief Check whether bytes are valid UTF-8
+ *
+ * Overlong forms, surrogates (U+D800 - U+DFFF), code points above U+10FFFF
+ * and sequences truncated at the end are rejected.
+ * ASCII-only blocks are skipped with a single test.
+ *
+ * @param [in] p  Bytes
+ * @param [in] n  Number of bytes
+ * @return  true if the bytes are valid UTF-8
+ */
+static inline bool
+isValidUtf8(const char* p, std::size_t n) noexcept
+{
+  static const Dispatcher<bool(const char*, std::size_t)> dispatcher{
+    {IsaLevel::kAvx512, &ByteScanAvx512::isValidUtf8},
+    {IsaLevel::kAvx2, &ByteScanAvx2::isValidUtf8},
+    {IsaLevel::kSse42, &ByteScanSse42::isValidUtf8},
+    {IsaLevel::kScalar, &ByteScanScalar::isValidUtf8}};
+  return dispatcher(p, n);
+}
+
+
+}  // namespace simdutil
+
+
+#endif  // SIMDUTIL_BYTESCAN_HPP
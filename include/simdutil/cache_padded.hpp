@@ -0,0 +1,311 @@
+#ifndef SIMDUTIL_CACHE_PADDED_HPP
+#define SIMDUTIL_CACHE_PADDED_HPP
+
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "allocator.hpp"
+#include "cpuid.hpp"
+
+
+namespace simdutil
+{
+//! Compile-time padding of CachePadded: two 64-byte lines, the unit of the adjacent-line prefetcher
+constexpr std::size_t kCachePadSize = 128;
+
+
+/*!
+ * @brief Get the cache line size
+ *
+ * The line size of the first level data cache is used (CacheHierarchy),
+ * falling back to the CLFLUSH line size of CPUID leaf 1 and to 64 bytes.
+ *
+ * @return  Cache line size in bytes
+ */
+static inline std::size_t
+getCacheLineSize() noexcept
+{
+  static const std::size_t lineSize = []() -> std::size_t {
+    const auto hierarchyLineSize = CacheHierarchy::get().lineSize();
+    if (hierarchyLineSize > 0) {
+      return static_cast<std::size_t>(hierarchyLineSize);
+    }
+    std::array<int, 4> cpuinfo;
+    cpuid(cpuinfo, 1);
+    const auto clflushSize = static_cast<std::size_t>((static_cast<std::uint32_t>(cpuinfo[1]) >> 8) & 0xffU) * 8;
+    return clflushSize != 0 ? clflushSize : 64;
+  }();
+  return lineSize;
+}
+
+/*!
+ * @brief Get the distance at which writes of two threads do not interfere
+ *
+ * Intel CPUs since Sandy Bridge and AMD Zen fetch 128-byte aligned pairs of lines into L2
+ * (the adjacent-line / spatial prefetcher), so two lines of the same pair still ping-pong between cores.
+ * This is therefore twice getCacheLineSize().
+ *
+ * @return  False sharing range in bytes
+ */
+static inline std::size_t
+getFalseSharingRange() noexcept
+{
+  return getCacheLineSize() * 2;
+}
+
+
+/*!
+ * @brief Value aligned and padded to its own pair of cache lines
+ *
+ * The padding is the compile-time kCachePadSize, which covers the 64-byte lines and the adjacent-line prefetcher
+ * of current x86 CPUs (getFalseSharingRange() is the value detected at run time).
+ * Before C++17, operator new ignores the alignment, so allocate arrays with CachePaddedVector
+ * or AlignedAllocator<CachePadded<T>, kCachePadSize>.
+ *
+ * @code
+ * simdutil::CachePaddedVector<std::atomic<int>> flags(nThreads);
+ * flags[threadId]->store(1, std::memory_order_release);
+ * @endcode
+ */
+template<typename T>
+class alignas(kCachePadSize) CachePadded
+{
+public:
+  /*!
+   * @brief Construct the value in place
+   * @param [in] args  Arguments of the constructor of T
+   */
+  template<typename... Args>
+  explicit CachePadded(Args&&... args)
+    : value_(std::forward<Args>(args)...)
+  {}
+
+  /*!
+   * @brief Get the value
+   * @return  Reference to the value
+   */
+  T&
+  get() noexcept
+  {
+    return value_;
+  }
+
+  /*!
+   * @brief Get the value
+   * @return  Reference to the value
+   */
+  const T&
+  get() const noexcept
+  {
+    return value_;
+  }
+
+  T& operator*() noexcept { return value_; }
+  const T& operator*() const noexcept { return value_; }
+  T* operator->() noexcept { return &value_; }
+  const T* operator->() const noexcept { return &value_; }
+
+private:
+  //! Padded value
+  T value_;
+};  // class CachePadded
+
+
+//! Vector of padded values, allocated with the padding alignment
+template<typename T>
+using CachePaddedVector = std::vector<CachePadded<T>, AlignedAllocator<CachePadded<T>, kCachePadSize>>;
+
+
+/*!
+ * @brief Shard index of the calling thread
+ *
+ * Threads are numbered in the order of their first call, so up to N threads get distinct indices modulo N.
+ */
+class ShardIndex
+{
+public:
+  /*!
+   * @brief Get the index of the calling thread
+   * @return  Index of the calling thread (0, 1, 2, ...)
+   */
+  static std::size_t
+  current() noexcept
+  {
+    static thread_local const std::size_t index = next().fetch_add(1, std::memory_order_relaxed);
+    return index;
+  }
+
+private:
+  static std::atomic<std::size_t>&
+  next() noexcept
+  {
+    static std::atomic<std::size_t> counter{0};
+    return counter;
+  }
+};  // class ShardIndex
+
+
+/*!
+ * @brief Counter (or floating-point accumulator) split into per-thread shards to avoid false sharing
+ *
+ * Each thread adds to its own shard (ShardIndex::current() modulo the number of shards)
+ * with a relaxed read-modify-write, which stays in the thread's L1 as long as no other thread uses the shard.
+ * The shards are getFalseSharingRange() apart in one block from alignedMalloc().
+ * read() sums the shards with relaxed loads: it is cheap and never blocks writers,
+ * but it is not a snapshot of one instant while other threads keep adding.
+ *
+ * @code
+ * static simdutil::ShardedCounter<std::uint64_t> nRequests;
+ * nRequests.increment();          // Hot path, any thread
+ * auto total = nRequests.read();  // Rarely, e.g. from a statistics thread
+ * @endcode
+ */
+template<typename T>
+class ShardedCounter
+{
+  static_assert(std::is_arithmetic<T>::value, "Counter type must be an integer or floating-point type");
+
+public:
+  /*!
+   * @brief Allocate the shards
+   * @param [in] nShards  Number of shards (0: the number of hardware threads), rounded up to a power of 2
+   */
+  explicit ShardedCounter(std::size_t nShards = 0)
+    : stride_{std::max(getFalseSharingRange(), sizeof(std::atomic<T>))}
+    , mask_{roundUpToPowerOf2(nShards != 0 ? nShards : std::max<std::size_t>(std::thread::hardware_concurrency(), 1)) - 1}
+    , shards_{alignedMalloc<unsigned char>((mask_ + 1) * stride_, stride_)}
+  {
+    if (shards_ == nullptr) {
+      throw std::bad_alloc{};
+    }
+    for (std::size_t i = 0; i <= mask_; i++) {
+      new(shards_ + i * stride_) std::atomic<T>{T{}};
+    }
+  }
+
+  ShardedCounter(const ShardedCounter&) = delete;
+  ShardedCounter& operator=(const ShardedCounter&) = delete;
+
+  ~ShardedCounter()
+  {
+    alignedFree(shards_);
+  }
+
+  /*!
+   * @brief Add a value to the shard of the calling thread
+   * @param [in] delta  Value to add
+   */
+  void
+  add(T delta) noexcept
+  {
+    addTo(shard(ShardIndex::current() & mask_), delta, std::is_integral<T>{});
+  }
+
+  /*!
+   * @brief Add one to the shard of the calling thread
+   */
+  void
+  increment() noexcept
+  {
+    add(T{1});
+  }
+
+  /*!
+   * @brief Sum all shards with relaxed loads
+   * @return  Total of the values added so far (not ordered with concurrent add())
+   */
+  T
+  read() const noexcept
+  {
+    T sum{};
+    for (std::size_t i = 0; i <= mask_; i++) {
+      sum += shard(i).load(std::memory_order_relaxed);
+    }
+    return sum;
+  }
+
+  /*!
+   * @brief Set all shards to zero (additions racing with this may be lost)
+   */
+  void
+  reset() noexcept
+  {
+    for (std::size_t i = 0; i <= mask_; i++) {
+      shard(i).store(T{}, std::memory_order_relaxed);
+    }
+  }
+
+  /*!
+   * @brief Get the number of shards
+   * @return  Number of shards
+   */
+  std::size_t
+  shardCount() const noexcept
+  {
+    return mask_ + 1;
+  }
+
+  /*!
+   * @brief Get the distance between two shards
+   * @return  Distance in bytes
+   */
+  std::size_t
+  stride() const noexcept
+  {
+    return stride_;
+  }
+
+private:
+  static std::size_t
+  roundUpToPowerOf2(std::size_t n) noexcept
+  {
+    std::size_t p = 1;
+    while (p < n) {
+      p <<= 1;
+    }
+    return p;
+  }
+
+  std::atomic<T>&
+  shard(std::size_t index) const noexcept
+  {
+    return *static_cast<std::atomic<T>*>(static_cast<void*>(shards_ + index * stride_));
+  }
+
+  static void
+  addTo(std::atomic<T>& counter, T delta, std::true_type) noexcept
+  {
+    counter.fetch_add(delta, std::memory_order_relaxed);
+  }
+
+  static void
+  addTo(std::atomic<T>& counter, T delta, std::false_type) noexcept
+  {
+    // No fetch_add for floating-point atomics before C++20; the shard is normally uncontended
+    auto expected = counter.load(std::memory_order_relaxed);
+    while (!counter.compare_exchange_weak(expected, expected + delta, std::memory_order_relaxed)) {
+    }
+  }
+
+  //! Distance between two shards in bytes
+  std::size_t stride_;
+  //! Number of shards - 1
+  std::size_t mask_;
+  //! Shards, stride_ bytes apart
+  unsigned char* shards_;
+};  // class ShardedCounter
+
+
+}  // namespace simdutil
+
+
+#endif  // SIMDUTIL_CACHE_PADDED_HPP
@@ -3,9 +3,13 @@
 
 #include <algorithm>
 #include <array>
+#include <bitset>
+#include <cstdint>
+#include <cstring>
 #include <string>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
 #if defined(__GNUC__)
 #  include <cpuid.h>
@@ -13,6 +17,20 @@
 #  include <intrin.h>
 #endif
 
+#if defined(__linux__)
+#  include <sched.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#elif defined(_WIN32)
+#  if defined(NOMINMAX)
+#    include <windows.h>
+#  else
+#    define NOMINMAX
+#    include <windows.h>
+#    undef NOMINMAX
+#  endif  // defined(NOMINMAX)
+#endif  // defined(__linux__)
+
 
 namespace simdutil
 {
@@ -26,26 +44,12 @@ static inline void
 cpuid(T cpuinfo, int eax) noexcept
 {
 #if defined(__GNUC__)
-  ::__cpuid(eax, cpuinfo[0], cpuinfo[1], cpuinfo[2], cpuinfo[3]);
+  __cpuid(eax, cpuinfo[0], cpuinfo[1], cpuinfo[2], cpuinfo[3]);
 #elif defined(_MSC_VER)
   ::__cpuid(cpuinfo, eax);
 #endif  // defined(__GNUC__)
 }
 
-template<
-  typename T,
-  typename std::enable_if<std::is_same<T, int*>::value, std::nullptr_t>::type = nullptr
->
-static inline void
-cpuid(T cpuInfo, int eax) noexcept
-{
-#if defined(__GNUC__)
-  ::__cpuid(eax, cpuInfo[0], cpuInfo[1], cpuInfo[2], cpuInfo[3]);
-#elif defined(_MSC_VER)
-  ::__cpuid(cpuInfo, eax);
-#endif  // defined(__GNUC__)
-}
-
 template<std::size_t kSize>
 static inline void
 cpuid(int (&cpuInfo)[kSize], int eax) noexcept
@@ -72,7 +76,7 @@ static inline void
 cpuidex(T cpuInfo, int eax, int ecx) noexcept
 {
 #if defined(__GNUC__)
-  ::__cpuid_count(eax, ecx, cpuInfo[0], cpuInfo[1], cpuInfo[2], cpuInfo[3]);
+  __cpuid_count(eax, ecx, cpuInfo[0], cpuInfo[1], cpuInfo[2], cpuInfo[3]);
 #elif defined(_MSC_VER)
   ::__cpuidex(cpuInfo, eax, ecx);
 #endif  // defined(__GNUC__)
@@ -112,165 +116,736 @@ cpuidexBit(int eax, int ecx, int index, int nBit) noexcept
   return (cpuinfo[index] & (1 << nBit)) != 0;
 }
 
+static inline std::uint64_t
+xgetbv(std::uint32_t ecx) noexcept
+{
+#if defined(__GNUC__)
+  std::uint32_t eax, edx;
+  __asm__ volatile ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(ecx));
+  return (static_cast<std::uint64_t>(edx) << 32) | eax;
+#elif defined(_MSC_VER)
+  return ::_xgetbv(ecx);
+#endif  // defined(__GNUC__)
+}
+
+
+//! XCR0 bits of SSE state (XMM registers)
+constexpr std::uint64_t kXcr0Xmm = 0x2U;
+//! XCR0 bits of AVX state (XMM and upper halves of YMM registers)
+constexpr std::uint64_t kXcr0Ymm = kXcr0Xmm | 0x4U;
+//! XCR0 bits of AVX-512 state (YMM, opmask, upper halves of ZMM0-15 and ZMM16-31)
+constexpr std::uint64_t kXcr0Zmm = kXcr0Ymm | 0xe0U;
+//! XCR0 bits of AMX state (XTILECFG and XTILEDATA)
+constexpr std::uint64_t kXcr0Amx = 0x60000U;
+
+
+/*!
+ * @brief CPUID leaves which are cached in CpuFeatures
+ */
+enum class CpuidLeaf : int
+{
+  //! EAX = 0x00000001
+  k1,
+  //! EAX = 0x00000007, ECX = 0
+  k7,
+  //! EAX = 0x00000007, ECX = 1
+  k7Sub1,
+  //! EAX = 0x80000001
+  k80000001,
+  //! EAX = 0x80000007
+  k80000007,
+  //! Number of cached leaves
+  kCount
+};  // enum class CpuidLeaf
+
+
+/*!
+ * @brief Process-wide snapshot of CPUID feature leaves
+ *
+ * CPUID is a serializing instruction and costs hundreds of cycles (much more under a hypervisor),
+ * so all feature leaves are read only once, on first use, and kept in a bitset.
+ * Initialization is thread-safe (function-local static).
+ */
+class CpuFeatures
+{
+public:
+  /*!
+   * @brief Get the process-wide snapshot
+   * @return  Reference to the snapshot
+   */
+  static const CpuFeatures&
+  get() noexcept
+  {
+    static const CpuFeatures instance;
+    return instance;
+  }
+
+  /*!
+   * @brief Test one bit of a cached CPUID leaf
+   * @param [in] leaf   Cached leaf
+   * @param [in] index  Register index (0: EAX, 1: EBX, 2: ECX, 3: EDX)
+   * @param [in] nBit   Bit position
+   * @return  true if the bit is set, otherwise false
+   */
+  bool
+  test(CpuidLeaf leaf, int index, int nBit) const noexcept
+  {
+    return bits_[static_cast<std::size_t>((static_cast<int>(leaf) * 4 + index) * 32 + nBit)];
+  }
+
+  /*!
+   * @brief Get one register of a cached CPUID leaf
+   * @param [in] leaf   Cached leaf
+   * @param [in] index  Register index (0: EAX, 1: EBX, 2: ECX, 3: EDX)
+   * @return  Register value
+   */
+  std::uint32_t
+  reg(CpuidLeaf leaf, int index) const noexcept
+  {
+    return regs_[static_cast<std::size_t>(leaf)][static_cast<std::size_t>(index)];
+  }
+
+  /*!
+   * @brief Get the highest basic leaf
+   * @return  Highest basic leaf (EAX of leaf 0)
+   */
+  std::uint32_t
+  maxLeaf() const noexcept
+  {
+    return maxLeaf_;
+  }
+
+  /*!
+   * @brief Get the highest extended leaf
+   * @return  Highest extended leaf (EAX of leaf 0x80000000)
+   */
+  std::uint32_t
+  maxExtendedLeaf() const noexcept
+  {
+    return maxExtendedLeaf_;
+  }
+
+  /*!
+   * @brief Get XCR0, the register states enabled by the OS
+   * @return  Value of XCR0 (0 if OSXSAVE is not supported)
+   */
+  std::uint64_t
+  xcr0() const noexcept
+  {
+    return xcr0_;
+  }
+
+  /*!
+   * @brief Check whether the OS has enabled all of the specified register states
+   * @param [in] mask  XCR0 bits (kXcr0Ymm, kXcr0Zmm, kXcr0Amx, ...)
+   * @return  true if all states are enabled, otherwise false
+   */
+  bool
+  isXcr0Enabled(std::uint64_t mask) const noexcept
+  {
+    return (xcr0_ & mask) == mask;
+  }
+
+private:
+  //! Number of cached leaves
+  static constexpr std::size_t kNLeaves = static_cast<std::size_t>(CpuidLeaf::kCount);
+
+  CpuFeatures() noexcept
+    : maxLeaf_{0}
+    , maxExtendedLeaf_{0}
+    , xcr0_{0}
+    , regs_{}
+    , bits_{}
+  {
+    std::array<int, 4> cpuinfo;
+
+    cpuid(cpuinfo, 0);
+    maxLeaf_ = static_cast<std::uint32_t>(cpuinfo[0]);
+    cpuid(cpuinfo, 0x80000000);
+    maxExtendedLeaf_ = static_cast<std::uint32_t>(cpuinfo[0]);
+
+    if (maxLeaf_ >= 1) {
+      load(CpuidLeaf::k1, 1, 0);
+    }
+    if (maxLeaf_ >= 7) {
+      load(CpuidLeaf::k7, 7, 0);
+      if (reg(CpuidLeaf::k7, 0) >= 1) {
+        load(CpuidLeaf::k7Sub1, 7, 1);
+      }
+    }
+    if (maxExtendedLeaf_ >= 0x80000001U) {
+      load(CpuidLeaf::k80000001, static_cast<int>(0x80000001U), 0);
+    }
+    if (maxExtendedLeaf_ >= 0x80000007U) {
+      load(CpuidLeaf::k80000007, static_cast<int>(0x80000007U), 0);
+    }
+    // OSXSAVE: XGETBV is usable
+    if ((reg(CpuidLeaf::k1, 2) & (1U << 27)) != 0) {
+      xcr0_ = xgetbv(0);
+    }
+
+    for (std::size_t i = 0; i < kNLeaves; i++) {
+      for (std::size_t j = 0; j < 4; j++) {
+        for (std::size_t k = 0; k < 32; k++) {
+          bits_[(i * 4 + j) * 32 + k] = ((regs_[i][j] >> k) & 1U) != 0;
+        }
+      }
+    }
+  }
+
+  void
+  load(CpuidLeaf leaf, int eax, int ecx) noexcept
+  {
+    std::array<int, 4> cpuinfo;
+    cpuidex(cpuinfo, eax, ecx);
+    auto& r = regs_[static_cast<std::size_t>(leaf)];
+    for (std::size_t i = 0; i < r.size(); i++) {
+      r[i] = static_cast<std::uint32_t>(cpuinfo[i]);
+    }
+  }
+
+  //! Highest basic leaf
+  std::uint32_t maxLeaf_;
+  //! Highest extended leaf
+  std::uint32_t maxExtendedLeaf_;
+  //! Register states enabled by the OS
+  std::uint64_t xcr0_;
+  //! Raw register values of each cached leaf
+  std::array<std::array<std::uint32_t, 4>, kNLeaves> regs_;
+  //! Feature bits of each cached leaf
+  std::bitset<kNLeaves * 4 * 32> bits_;
+};  // class CpuFeatures
+
+
 static inline bool
 isMmxAvailable() noexcept
 {
-  return cpuidBit(1, 3, 23);
+#if defined(__MMX__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k1, 3, 23);
+#endif  // defined(__MMX__)
 }
 
 static inline bool
 isSseAvailable() noexcept
 {
-  return cpuidBit(1, 3, 25);
+#if defined(__SSE__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k1, 3, 25);
+#endif  // defined(__SSE__)
 }
 
 static inline bool
 isSse2Available() noexcept
 {
-  return cpuidBit(1, 3, 26);
+#if defined(__SSE2__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k1, 3, 26);
+#endif  // defined(__SSE2__)
 }
 
 static inline bool
 isSse3Available() noexcept
 {
-  return cpuidBit(1, 2, 0);
+#if defined(__SSE3__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k1, 2, 0);
+#endif  // defined(__SSE3__)
 }
 
 static inline bool
 isSsse3Available() noexcept
 {
-  return cpuidBit(1, 2, 9);
+#if defined(__SSSE3__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k1, 2, 9);
+#endif  // defined(__SSSE3__)
 }
 
 static inline bool
 isSse41Available() noexcept
 {
-  return cpuidBit(1, 2, 19);
+#if defined(__SSE4_1__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k1, 2, 19);
+#endif  // defined(__SSE4_1__)
 }
 
 static inline bool
 isSse42Available() noexcept
 {
-  return cpuidBit(1, 2, 20);
+#if defined(__SSE4_2__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k1, 2, 20);
+#endif  // defined(__SSE4_2__)
+}
+
+static inline bool
+isPopcntAvailable() noexcept
+{
+#if defined(__POPCNT__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k1, 2, 23);
+#endif  // defined(__POPCNT__)
 }
 
 static inline bool
 isSse4aAvailable() noexcept
 {
-  std::array<int, 4> cpuinfo;
-  cpuid(cpuinfo, 0x80000000);
-  if (static_cast<unsigned int>(cpuinfo[0]) < 0x80000001U) {
-    return false;
-  }
-  return cpuidBit(0x80000001, 2, 6);
+#if defined(__SSE4A__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k80000001, 2, 6);
+#endif  // defined(__SSE4A__)
 }
 
 static inline bool
 isAvxAvailable() noexcept
 {
-  return cpuidBit(1, 2, 28);
+#if defined(__AVX__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k1, 2, 28)
+    && CpuFeatures::get().isXcr0Enabled(kXcr0Ymm);
+#endif  // defined(__AVX__)
 }
 
 static inline bool
 isAvx2Available() noexcept
 {
-  return cpuidBit(7, 1, 5);
+#if defined(__AVX2__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k7, 1, 5)
+    && CpuFeatures::get().isXcr0Enabled(kXcr0Ymm);
+#endif  // defined(__AVX2__)
 }
 
 static inline bool
 isFmaAvailable() noexcept
 {
-  return cpuidBit(1, 2, 12);
+#if defined(__FMA__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k1, 2, 12)
+    && CpuFeatures::get().isXcr0Enabled(kXcr0Ymm);
+#endif  // defined(__FMA__)
+}
+
+static inline bool
+isBmi1Available() noexcept
+{
+#if defined(__BMI__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k7, 1, 3);
+#endif  // defined(__BMI__)
+}
+
+static inline bool
+isBmi2Available() noexcept
+{
+#if defined(__BMI2__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k7, 1, 8);
+#endif  // defined(__BMI2__)
+}
+
+static inline bool
+isLzcntAvailable() noexcept
+{
+#if defined(__LZCNT__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k80000001, 2, 5);
+#endif  // defined(__LZCNT__)
+}
+
+/*!
+ * @brief Check whether PREFETCHW is available (3DNowPrefetch, AMD K8 and Intel Broadwell or later)
+ * @return  true if available, otherwise false
+ */
+static inline bool
+isPrefetchwAvailable() noexcept
+{
+#if defined(__PRFCHW__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k80000001, 2, 8);
+#endif  // defined(__PRFCHW__)
+}
+
+/*!
+ * @brief Check whether PREFETCHWT1 is available (Xeon Phi)
+ * @return  true if available, otherwise false
+ */
+static inline bool
+isPrefetchwt1Available() noexcept
+{
+#if defined(__PREFETCHWT1__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k7, 2, 0);
+#endif  // defined(__PREFETCHWT1__)
+}
+
+/*!
+ * @brief Check whether REP MOVSB / REP STOSB are enhanced (ERMS)
+ * @return  true if available, otherwise false
+ */
+static inline bool
+isErmsAvailable() noexcept
+{
+  return CpuFeatures::get().test(CpuidLeaf::k7, 1, 9);
+}
+
+/*!
+ * @brief Check whether short REP MOVSB is fast (FSRM, Ice Lake and later)
+ * @return  true if available, otherwise false
+ */
+static inline bool
+isFsrmAvailable() noexcept
+{
+  return CpuFeatures::get().test(CpuidLeaf::k7, 3, 4);
 }
 
 static inline bool
 isAvx512FAvailable() noexcept
 {
-  return cpuidBit(7, 1, 16);
+#if defined(__AVX512F__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k7, 1, 16)
+    && CpuFeatures::get().isXcr0Enabled(kXcr0Zmm);
+#endif  // defined(__AVX512F__)
 }
 
 static inline bool
 isAvx512BwAvailable() noexcept
 {
-  return cpuidBit(7, 1, 30);
+#if defined(__AVX512BW__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k7, 1, 30)
+    && CpuFeatures::get().isXcr0Enabled(kXcr0Zmm);
+#endif  // defined(__AVX512BW__)
 }
 
 static inline bool
 isAvx512CdAvailable() noexcept
 {
-  return cpuidBit(7, 1, 28);
+#if defined(__AVX512CD__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k7, 1, 28)
+    && CpuFeatures::get().isXcr0Enabled(kXcr0Zmm);
+#endif  // defined(__AVX512CD__)
 }
 
 static inline bool
 isAvx512DqAvailable() noexcept
 {
-  return cpuidBit(7, 1, 17);
+#if defined(__AVX512DQ__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k7, 1, 17)
+    && CpuFeatures::get().isXcr0Enabled(kXcr0Zmm);
+#endif  // defined(__AVX512DQ__)
 }
 
 static inline bool
 isAvx512ErAvailable() noexcept
 {
-  return cpuidBit(7, 1, 27);
+#if defined(__AVX512ER__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k7, 1, 27)
+    && CpuFeatures::get().isXcr0Enabled(kXcr0Zmm);
+#endif  // defined(__AVX512ER__)
 }
 
 static inline bool
 isAvx512Ifma52Available() noexcept
 {
-  return cpuidBit(7, 1, 21);
+#if defined(__AVX512IFMA__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k7, 1, 21)
+    && CpuFeatures::get().isXcr0Enabled(kXcr0Zmm);
+#endif  // defined(__AVX512IFMA__)
 }
 
 static inline bool
 isAvx512PfAvailable() noexcept
 {
-  return cpuidBit(7, 1, 26);
+#if defined(__AVX512PF__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k7, 1, 26)
+    && CpuFeatures::get().isXcr0Enabled(kXcr0Zmm);
+#endif  // defined(__AVX512PF__)
 }
 
 static inline bool
 isAvx512VlAvailable() noexcept
 {
-  return cpuidBit(7, 1, 31);
+#if defined(__AVX512VL__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k7, 1, 31)
+    && CpuFeatures::get().isXcr0Enabled(kXcr0Zmm);
+#endif  // defined(__AVX512VL__)
 }
 
 static inline bool
 isAvx512_4fmapsAvailable() noexcept
 {
-  return cpuidBit(7, 3, 2);
+#if defined(__AVX5124FMAPS__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k7, 3, 2)
+    && CpuFeatures::get().isXcr0Enabled(kXcr0Zmm);
+#endif  // defined(__AVX5124FMAPS__)
 }
 
 static inline bool
 isAvx512_4vnniwAvailable() noexcept
 {
-  return cpuidBit(7, 3, 3);
+#if defined(__AVX5124VNNIW__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k7, 3, 3)
+    && CpuFeatures::get().isXcr0Enabled(kXcr0Zmm);
+#endif  // defined(__AVX5124VNNIW__)
 }
 
 static inline bool
 isAvx512BitalgAvailable() noexcept
 {
-  return cpuidBit(7, 2, 12);
+#if defined(__AVX512BITALG__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k7, 2, 12)
+    && CpuFeatures::get().isXcr0Enabled(kXcr0Zmm);
+#endif  // defined(__AVX512BITALG__)
 }
 
 static inline bool
 isAvx512VpopcntdqAvailable() noexcept
 {
-  return cpuidBit(7, 2, 14);
+#if defined(__AVX512VPOPCNTDQ__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k7, 2, 14)
+    && CpuFeatures::get().isXcr0Enabled(kXcr0Zmm);
+#endif  // defined(__AVX512VPOPCNTDQ__)
 }
 
 static inline bool
 isAvx512VbmiAvailable() noexcept
 {
-  return cpuidBit(7, 2, 1);
+#if defined(__AVX512VBMI__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k7, 2, 1)
+    && CpuFeatures::get().isXcr0Enabled(kXcr0Zmm);
+#endif  // defined(__AVX512VBMI__)
 }
 
 static inline bool
 isAvx512Vbmi2Available() noexcept
 {
-  return cpuidBit(7, 2, 6);
+#if defined(__AVX512VBMI2__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k7, 2, 6)
+    && CpuFeatures::get().isXcr0Enabled(kXcr0Zmm);
+#endif  // defined(__AVX512VBMI2__)
 }
 
 static inline bool
 isAvx512VnniAvailable() noexcept
 {
-  return cpuidBit(7, 2, 6);
+#if defined(__AVX512VNNI__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k7, 2, 11)
+    && CpuFeatures::get().isXcr0Enabled(kXcr0Zmm);
+#endif  // defined(__AVX512VNNI__)
+}
+
+static inline bool
+isAvx512Fp16Available() noexcept
+{
+#if defined(__AVX512FP16__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k7, 3, 23)
+    && CpuFeatures::get().isXcr0Enabled(kXcr0Zmm);
+#endif  // defined(__AVX512FP16__)
+}
+
+static inline bool
+isAvx512Bf16Available() noexcept
+{
+#if defined(__AVX512BF16__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k7Sub1, 0, 5)
+    && CpuFeatures::get().isXcr0Enabled(kXcr0Zmm);
+#endif  // defined(__AVX512BF16__)
+}
+
+static inline bool
+isAvxVnniAvailable() noexcept
+{
+#if defined(__AVXVNNI__)
+  return true;
+#else
+  return CpuFeatures::get().test(CpuidLeaf::k7Sub1, 0, 4)
+    && CpuFeatures::get().isXcr0Enabled(kXcr0Ymm);
+#endif  // defined(__AVXVNNI__)
+}
+
+/*!
+ * @brief Check whether AMX tile instructions are available
+ *
+ * On Linux, the process must also request permission with requestAmxTilePermission()
+ * before executing any AMX instruction.
+ *
+ * @return  true if available, otherwise false
+ */
+static inline bool
+isAmxTileAvailable() noexcept
+{
+  return CpuFeatures::get().test(CpuidLeaf::k7, 3, 24)
+    && CpuFeatures::get().isXcr0Enabled(kXcr0Amx);
+}
+
+static inline bool
+isAmxInt8Available() noexcept
+{
+  return isAmxTileAvailable() && CpuFeatures::get().test(CpuidLeaf::k7, 3, 25);
+}
+
+static inline bool
+isAmxBf16Available() noexcept
+{
+  return isAmxTileAvailable() && CpuFeatures::get().test(CpuidLeaf::k7, 3, 22);
+}
+
+/*!
+ * @brief Request permission to use AMX tile data for this process
+ *
+ * Linux (5.16 or later) enables the AMX tile data state lazily per process through arch_prctl(ARCH_REQ_XCOMP_PERM),
+ * and executing AMX instructions without the permission raises SIGILL.
+ * Other OSes enable the state without any request.
+ *
+ * @return  true if AMX can be used, otherwise false
+ */
+static inline bool
+requestAmxTilePermission() noexcept
+{
+  if (!isAmxTileAvailable()) {
+    return false;
+  }
+#if defined(__linux__)
+  constexpr long kArchGetXcompPerm = 0x1022;
+  constexpr long kArchReqXcompPerm = 0x1023;
+  constexpr unsigned long kXfeatureXtiledata = 18;
+  if (::syscall(SYS_arch_prctl, kArchReqXcompPerm, kXfeatureXtiledata) != 0) {
+    return false;
+  }
+  unsigned long permitted = 0;
+  return ::syscall(SYS_arch_prctl, kArchGetXcompPerm, &permitted) == 0
+    && (permitted & (1UL << kXfeatureXtiledata)) != 0;
+#else
+  return true;
+#endif  // defined(__linux__)
+}
+
+/*!
+ * @brief Check whether RDTSCP is available
+ * @return  true if available, otherwise false
+ */
+static inline bool
+isRdtscpAvailable() noexcept
+{
+  return CpuFeatures::get().test(CpuidLeaf::k80000001, 3, 27);
+}
+
+/*!
+ * @brief Check whether the TSC is invariant: it ticks at a constant rate in all P-, C- and T-states
+ * @return  true if available, otherwise false
+ */
+static inline bool
+isInvariantTscAvailable() noexcept
+{
+  return CpuFeatures::get().test(CpuidLeaf::k80000007, 3, 8);
+}
+
+/*!
+ * @brief Get the TSC frequency reported by CPUID
+ *
+ * Leaf 0x15 gives the TSC / core crystal clock ratio and, on most CPUs since Skylake, the crystal frequency.
+ * If the crystal frequency is not enumerated, it is derived from the processor base frequency of leaf 0x16,
+ * which the TSC runs at. Under a hypervisor, the TSC frequency in kHz of the timing leaf 0x40000010
+ * (VMware, KVM and others) is used when the native leaves are missing, as they usually are in guests.
+ *
+ * @return  TSC frequency in Hz, or 0 if CPUID does not report it
+ */
+static inline std::uint64_t
+getCpuidTscFrequency() noexcept
+{
+  const auto& features = CpuFeatures::get();
+  std::array<int, 4> cpuinfo;
+  if (features.maxLeaf() >= 0x15) {
+    cpuid(cpuinfo, 0x15);
+    const auto denominator = static_cast<std::uint32_t>(cpuinfo[0]);
+    const auto numerator = static_cast<std::uint32_t>(cpuinfo[1]);
+    auto crystalHz = static_cast<std::uint64_t>(static_cast<std::uint32_t>(cpuinfo[2]));
+    if (denominator != 0 && numerator != 0) {
+      if (crystalHz == 0 && features.maxLeaf() >= 0x16) {
+        cpuid(cpuinfo, 0x16);
+        const auto baseMhz = static_cast<std::uint64_t>(cpuinfo[0] & 0xffff);
+        crystalHz = baseMhz * 1000000 * denominator / numerator;
+      }
+      if (crystalHz != 0) {
+        return crystalHz * numerator / denominator;
+      }
+    }
+  }
+  // Hypervisor present bit
+  if (features.test(CpuidLeaf::k1, 2, 31)) {
+    cpuid(cpuinfo, 0x40000000);
+    if (static_cast<std::uint32_t>(cpuinfo[0]) >= 0x40000010U) {
+      cpuid(cpuinfo, 0x40000010);
+      const auto tscKhz = static_cast<std::uint64_t>(static_cast<std::uint32_t>(cpuinfo[0]));
+      if (tscKhz != 0) {
+        return tscKhz * 1000;
+      }
+    }
+  }
+  return 0;
+}
+
+/*!
+ * @brief Get the size of the widest SIMD register usable on this CPU
+ * @return  64 (AVX-512), 32 (AVX) or 16 (SSE)
+ */
+static inline std::size_t
+getMaxSimdRegisterSize() noexcept
+{
+  return isAvx512FAvailable() ? 64 : isAvxAvailable() ? 32 : 16;
 }
 
 
@@ -286,10 +861,10 @@ copyCpuVendorId(T vendorId) noexcept
   std::array<int, 4> cpuinfo;
   cpuid(cpuinfo, 0);
 
-  const auto p = reinterpret_cast<int*>(vendorId);
-  p[0] = cpuinfo[1];
-  p[1] = cpuinfo[3];
-  p[2] = cpuinfo[2];
+  // The buffer may not be aligned for int, so copy the registers bytewise
+  std::memcpy(&vendorId[0], &cpuinfo[1], sizeof(int));
+  std::memcpy(&vendorId[4], &cpuinfo[3], sizeof(int));
+  std::memcpy(&vendorId[8], &cpuinfo[2], sizeof(int));
 }
 
 template<std::size_t kSize>
@@ -298,7 +873,7 @@ copyCpuVendorId(char (&vendorId)[kSize]) noexcept
 {
   static_assert(kSize >= 12, "CPU vendor ID array size must be 12 or more");
 
-  copyCpuVendorId(vendorId.data());
+  copyCpuVendorId(&vendorId[0]);
 }
 
 template<std::size_t kSize>
@@ -331,21 +906,20 @@ copyCpuBrandString(T dst) noexcept
   std::array<int, 4> cpuinfo;
 
   cpuid(cpuinfo, 0x80000000);
-  if (cpuinfo[0] >= 0x80000004) {
+  if (static_cast<std::uint32_t>(cpuinfo[0]) < 0x80000004U) {
     dst[0] = '\0';
     return;
   }
 
-  const auto p = reinterpret_cast<int*>(dst);
-
+  // The buffer may not be aligned for int, so copy the registers bytewise
   cpuid(cpuinfo, 0x80000002);
-  std::copy(std::begin(cpuinfo), std::end(cpuinfo), &p[0]);
+  std::memcpy(&dst[0], cpuinfo.data(), sizeof(cpuinfo));
 
   cpuid(cpuinfo, 0x80000003);
-  std::copy(std::begin(cpuinfo), std::end(cpuinfo), &p[cpuinfo.size()]);
+  std::memcpy(&dst[sizeof(cpuinfo)], cpuinfo.data(), sizeof(cpuinfo));
 
   cpuid(cpuinfo, 0x80000004);
-  std::copy(std::begin(cpuinfo), std::end(cpuinfo), &p[cpuinfo.size() * 2]);
+  std::memcpy(&dst[sizeof(cpuinfo) * 2], cpuinfo.data(), sizeof(cpuinfo));
 }
 
 template<std::size_t kSize>
@@ -354,7 +928,7 @@ copyCpuBrandString(char (&vendorId)[kSize]) noexcept
 {
   static_assert(kSize >= 64, "CPU brand string array size must be 64 or more");
 
-  copyCpuBrandString(vendorId);
+  copyCpuBrandString(&vendorId[0]);
 }
 
 template<std::size_t kSize>
@@ -372,26 +946,624 @@ getCpuBrandString() noexcept
   std::array<char, 64> brandStringArray;
   std::fill(std::begin(brandStringArray), std::end(brandStringArray), '\0');
 
-  copyCpuVendorId(brandStringArray);
+  copyCpuBrandString(brandStringArray);
 
   return std::string{ brandStringArray.data() };
 }
 
+
+/*!
+ * @brief Processor signature decoded from CPUID leaf 1
+ */
+struct CpuSignature
+{
+  //! Family, including the extended family
+  int family;
+  //! Model, including the extended model
+  int model;
+  //! Stepping
+  int stepping;
+};  // struct CpuSignature
+
+
+/*!
+ * @brief Get the processor signature
+ *
+ * The extended family is added for family 0x0F and the extended model is prepended for families 0x06 and 0x0F,
+ * as both Intel and AMD document.
+ *
+ * @return  Family, model and stepping (e.g. 6, 0x55, 4 for Skylake-SP)
+ */
+static inline CpuSignature
+getCpuSignature() noexcept
+{
+  std::array<int, 4> cpuinfo;
+  cpuid(cpuinfo, 1);
+  const auto eax = static_cast<std::uint32_t>(cpuinfo[0]);
+  const auto baseFamily = static_cast<int>((eax >> 8) & 0x0fU);
+  const auto baseModel = static_cast<int>((eax >> 4) & 0x0fU);
+
+  CpuSignature signature;
+  signature.family = baseFamily == 0x0f ? baseFamily + static_cast<int>((eax >> 20) & 0xffU) : baseFamily;
+  signature.model = baseFamily == 0x06 || baseFamily == 0x0f ? (static_cast<int>((eax >> 16) & 0x0fU) << 4) + baseModel : baseModel;
+  signature.stepping = static_cast<int>(eax & 0x0fU);
+  return signature;
+}
+
+/*!
+ * @brief Cache type reported by the deterministic cache parameters leaf
+ */
+enum class CacheType : int
+{
+  //! No more caches
+  kNull = 0,
+  //! Data cache
+  kData = 1,
+  //! Instruction cache
+  kInstruction = 2,
+  //! Unified cache
+  kUnified = 3
+};  // enum class CacheType
+
+
+/*!
+ * @brief Parameters of one cache
+ */
+struct CacheInfo
+{
+  //! Cache level (1, 2, 3, ...)
+  int level;
+  //! Cache type
+  CacheType type;
+  //! Cache size in bytes
+  std::size_t size;
+  //! Number of ways of associativity
+  int ways;
+  //! Number of sets
+  int sets;
+  //! Physical line partitions
+  int partitions;
+  //! Line size in bytes
+  int lineSize;
+  //! Maximum number of logical processors sharing this cache
+  int nSharingThreads;
+  //! true if the cache is fully associative
+  bool isFullyAssociative;
+  //! true if the cache is inclusive of lower levels
+  bool isInclusive;
+};  // struct CacheInfo
+
+
+/*!
+ * @brief Process-wide snapshot of the cache hierarchy
+ *
+ * The deterministic cache parameters are walked once, on first use:
+ * leaf 0x8000001D on AMD and Hygon CPUs with topology extensions, leaf 4 otherwise.
+ * If neither is available, the legacy AMD leaves 0x80000005 and 0x80000006 are decoded,
+ * which leaves ways/sets/sharing partially unknown (zero).
+ */
+class CacheHierarchy
+{
+public:
+  /*!
+   * @brief Get the process-wide snapshot
+   * @return  Reference to the snapshot
+   */
+  static const CacheHierarchy&
+  get()
+  {
+    static const CacheHierarchy instance;
+    return instance;
+  }
+
+  /*!
+   * @brief Get all caches, ordered by level as reported by CPUID
+   * @return  Caches of this CPU
+   */
+  const std::vector<CacheInfo>&
+  caches() const noexcept
+  {
+    return caches_;
+  }
+
+  /*!
+   * @brief Find a cache
+   * @param [in] level  Cache level
+   * @param [in] type   Cache type
+   * @return  Pointer to the cache parameters, or nullptr if there is no such cache
+   */
+  const CacheInfo*
+  find(int level, CacheType type) const noexcept
+  {
+    for (const auto& cache : caches_) {
+      if (cache.level == level && cache.type == type) {
+        return &cache;
+      }
+    }
+    return nullptr;
+  }
+
+  /*!
+   * @brief Find the data or unified cache of a level
+   * @param [in] level  Cache level
+   * @return  Pointer to the cache parameters, or nullptr if there is no such cache
+   */
+  const CacheInfo*
+  findData(int level) const noexcept
+  {
+    const auto cache = find(level, CacheType::kData);
+    return cache != nullptr ? cache : find(level, CacheType::kUnified);
+  }
+
+  /*!
+   * @brief Get the size of the data or unified cache of a level
+   * @param [in] level  Cache level
+   * @return  Cache size in bytes, or 0 if there is no such cache
+   */
+  std::size_t
+  dataCacheSize(int level) const noexcept
+  {
+    const auto cache = findData(level);
+    return cache != nullptr ? cache->size : 0;
+  }
+
+  /*!
+   * @brief Get the line size of the first level data cache
+   * @return  Line size in bytes, or 0 if unknown
+   */
+  int
+  lineSize() const noexcept
+  {
+    const auto cache = findData(1);
+    return cache != nullptr ? cache->lineSize : 0;
+  }
+
+private:
+  CacheHierarchy()
+    : caches_{}
+  {
+    const auto& features = CpuFeatures::get();
+    const auto vendorId = getCpuVendorId();
+    const bool isAmd = vendorId == "AuthenticAMD" || vendorId == "HygonGenuine";
+    if (isAmd && features.maxExtendedLeaf() >= 0x8000001DU && features.test(CpuidLeaf::k80000001, 2, 22)) {
+      walk(static_cast<int>(0x8000001DU));
+    } else if (!isAmd && features.maxLeaf() >= 4) {
+      walk(4);
+    }
+    if (caches_.empty()) {
+      decodeLegacy();
+    }
+  }
+
+  void
+  walk(int eax)
+  {
+    std::array<int, 4> cpuinfo;
+    for (int i = 0; ; i++) {
+      cpuidex(cpuinfo, eax, i);
+      const auto a = static_cast<std::uint32_t>(cpuinfo[0]);
+      const auto b = static_cast<std::uint32_t>(cpuinfo[1]);
+      const auto c = static_cast<std::uint32_t>(cpuinfo[2]);
+      const auto d = static_cast<std::uint32_t>(cpuinfo[3]);
+      const auto type = static_cast<int>(a & 0x1fU);
+      if (type == static_cast<int>(CacheType::kNull) || type > static_cast<int>(CacheType::kUnified)) {
+        break;
+      }
+      CacheInfo cache;
+      cache.level = static_cast<int>((a >> 5) & 0x7U);
+      cache.type = static_cast<CacheType>(type);
+      cache.ways = static_cast<int>(((b >> 22) & 0x3ffU) + 1);
+      cache.partitions = static_cast<int>(((b >> 12) & 0x3ffU) + 1);
+      cache.lineSize = static_cast<int>((b & 0xfffU) + 1);
+      cache.sets = static_cast<int>(c + 1);
+      cache.size = static_cast<std::size_t>(cache.ways) * static_cast<std::size_t>(cache.partitions)
+        * static_cast<std::size_t>(cache.lineSize) * static_cast<std::size_t>(cache.sets);
+      cache.nSharingThreads = static_cast<int>(((a >> 14) & 0xfffU) + 1);
+      cache.isFullyAssociative = (a & (1U << 9)) != 0;
+      cache.isInclusive = (d & (1U << 1)) != 0;
+      caches_.push_back(cache);
+    }
+  }
+
+  void
+  decodeLegacy()
+  {
+    const auto maxExtendedLeaf = CpuFeatures::get().maxExtendedLeaf();
+    std::array<int, 4> cpuinfo;
+    if (maxExtendedLeaf >= 0x80000005U) {
+      cpuid(cpuinfo, static_cast<int>(0x80000005U));
+      addLegacy(1, CacheType::kData, (static_cast<std::uint32_t>(cpuinfo[2]) >> 24) * 1024U,
+                (static_cast<std::uint32_t>(cpuinfo[2]) >> 16) & 0xffU, static_cast<std::uint32_t>(cpuinfo[2]) & 0xffU);
+      addLegacy(1, CacheType::kInstruction, (static_cast<std::uint32_t>(cpuinfo[3]) >> 24) * 1024U,
+                (static_cast<std::uint32_t>(cpuinfo[3]) >> 16) & 0xffU, static_cast<std::uint32_t>(cpuinfo[3]) & 0xffU);
+    }
+    if (maxExtendedLeaf >= 0x80000006U) {
+      cpuid(cpuinfo, static_cast<int>(0x80000006U));
+      const auto c = static_cast<std::uint32_t>(cpuinfo[2]);
+      const auto d = static_cast<std::uint32_t>(cpuinfo[3]);
+      addLegacy(2, CacheType::kUnified, (c >> 16) * 1024U, 0, c & 0xffU);
+      addLegacy(3, CacheType::kUnified, (d >> 18) * 512U * 1024U, 0, d & 0xffU);
+    }
+  }
+
+  void
+  addLegacy(int level, CacheType type, std::uint32_t size, std::uint32_t ways, std::uint32_t lineSize)
+  {
+    if (size == 0 || lineSize == 0) {
+      return;
+    }
+    CacheInfo cache;
+    cache.level = level;
+    cache.type = type;
+    cache.size = size;
+    cache.ways = static_cast<int>(ways == 0xffU ? 0 : ways);
+    cache.partitions = 1;
+    cache.lineSize = static_cast<int>(lineSize);
+    cache.sets = cache.ways == 0 ? 0 : static_cast<int>(size / (ways * lineSize));
+    cache.nSharingThreads = 0;
+    cache.isFullyAssociative = ways == 0xffU;
+    cache.isInclusive = false;
+    caches_.push_back(cache);
+  }
+
+  //! Caches of this CPU
+  std::vector<CacheInfo> caches_;
+};  // class CacheHierarchy
+
+
+/*!
+ * @brief Get the size and the line size of the L2 cache
+ *
+ * CacheHierarchy is used; if building it fails (it allocates), the sizes are read from CPUID leaf 0x80000006.
+ *
+ * @param [out] cacheSize      Cache size in bytes, or -1 if unknown
+ * @param [out] cacheLineSize  Line size in bytes, or -1 if unknown
+ */
 static inline void
 getL2CacheSize(int& cacheSize, int& cacheLineSize) noexcept
 {
-  std::array<int, 4> cpuInfo;
-  cpuid(cpuInfo, 0x80000000);
-  if (cpuInfo[0] < 0x80000006u) {
-    cacheSize = -1;
-    cacheLineSize = -1;
+  try {
+    const auto cache = CacheHierarchy::get().findData(2);
+    if (cache != nullptr) {
+      cacheSize = static_cast<int>(cache->size);
+      cacheLineSize = cache->lineSize;
+      return;
+    }
+  } catch (...) {
+    std::array<int, 4> cpuinfo;
+    cpuid(cpuinfo, static_cast<int>(0x80000000U));
+    if (static_cast<std::uint32_t>(cpuinfo[0]) >= 0x80000006U) {
+      cpuid(cpuinfo, static_cast<int>(0x80000006U));
+      cacheSize = static_cast<int>((static_cast<std::uint32_t>(cpuinfo[2]) & 0xffff0000U) >> 6);
+      cacheLineSize = cpuinfo[2] & 0xff;
+      return;
+    }
+  }
+  cacheSize = -1;
+  cacheLineSize = -1;
+}
+
+/*!
+ * @brief Core type of hybrid CPUs (CPUID leaf 0x1A)
+ */
+enum class CoreType : int
+{
+  //! Not a hybrid CPU or unknown
+  kUnknown = 0,
+  //! Efficient core (Intel Atom)
+  kEfficient = 0x20,
+  //! Performance core (Intel Core)
+  kPerformance = 0x40
+};  // enum class CoreType
+
+
+/*!
+ * @brief Topology information of one logical CPU
+ */
+struct LogicalCpuInfo
+{
+  //! OS processor index (-1 if unknown)
+  int cpu;
+  //! x2APIC ID (initial APIC ID if leaf 0xB is not supported)
+  std::uint32_t apicId;
+  //! SMT sibling index within the core
+  std::uint32_t smtId;
+  //! Physical core ID, unique within the system
+  std::uint32_t coreId;
+  //! Package ID
+  std::uint32_t packageId;
+  //! Core type (hybrid CPUs only)
+  CoreType coreType;
+};  // struct LogicalCpuInfo
+
+
+/*!
+ * @brief Get APIC ID bit shifts of SMT and core levels
+ *
+ * Leaf 0x1F is preferred to leaf 0xB because module/tile/die levels are reported only by the former.
+ *
+ * @param [out] smtShift      Number of APIC ID bits used for SMT siblings
+ * @param [out] packageShift  Number of APIC ID bits used inside one package
+ */
+static inline void
+getApicIdShifts(int& smtShift, int& packageShift) noexcept
+{
+  const auto& features = CpuFeatures::get();
+  std::array<int, 4> cpuinfo;
+
+  smtShift = 0;
+  packageShift = 0;
+  for (const auto leaf : {0x1f, 0x0b}) {
+    if (features.maxLeaf() < static_cast<std::uint32_t>(leaf)) {
+      continue;
+    }
+    cpuidex(cpuinfo, leaf, 0);
+    if (cpuinfo[1] == 0) {
+      continue;
+    }
+    for (int i = 0; ; i++) {
+      cpuidex(cpuinfo, leaf, i);
+      const auto levelType = (static_cast<std::uint32_t>(cpuinfo[2]) >> 8) & 0xffU;
+      if (levelType == 0) {
+        return;
+      }
+      const auto shift = static_cast<int>(static_cast<std::uint32_t>(cpuinfo[0]) & 0x1fU);
+      if (levelType == 1) {
+        smtShift = shift;
+      }
+      packageShift = shift;
+    }
+  }
+
+  // Legacy: leaf 1 and leaf 4
+  if (features.maxLeaf() < 1) {
     return;
   }
-  cpuid(cpuInfo, 0x80000006);
-  cacheSize = (cpuInfo[2] & 0xffff0000u) >> 6;
-  cacheLineSize = (cpuInfo[2] & 0xffu);
+  const auto nLogical = (features.reg(CpuidLeaf::k1, 1) >> 16) & 0xffU;
+  std::uint32_t nCores = 1;
+  if (features.maxLeaf() >= 4) {
+    cpuidex(cpuinfo, 4, 0);
+    nCores = ((static_cast<std::uint32_t>(cpuinfo[0]) >> 26) & 0x3fU) + 1;
+  }
+  const auto log2Ceil = [](std::uint32_t n) {
+    int k = 0;
+    for (; (1U << k) < n; k++) {
+    }
+    return k;
+  };
+  if (features.test(CpuidLeaf::k1, 3, 28) && nLogical > nCores) {
+    smtShift = log2Ceil(nLogical / nCores);
+  }
+  packageShift = log2Ceil(std::max(nLogical, nCores));
 }
 
+/*!
+ * @brief Get the topology information of the logical CPU which executes this function
+ *
+ * The result is only meaningful if the calling thread cannot migrate, see setCurrentThreadAffinity().
+ *
+ * @return  Topology information (cpu is -1)
+ */
+static inline LogicalCpuInfo
+getCurrentLogicalCpuInfo() noexcept
+{
+  const auto& features = CpuFeatures::get();
+  std::array<int, 4> cpuinfo;
+  int smtShift, packageShift;
+  getApicIdShifts(smtShift, packageShift);
+
+  LogicalCpuInfo info;
+  info.cpu = -1;
+  // The cached leaf 1 belongs to the CPU which created the snapshot, so read it again
+  cpuid(cpuinfo, 1);
+  info.apicId = static_cast<std::uint32_t>(cpuinfo[1]) >> 24;
+  if (features.maxLeaf() >= 0x0b) {
+    cpuidex(cpuinfo, 0x0b, 0);
+    if (cpuinfo[1] != 0) {
+      info.apicId = static_cast<std::uint32_t>(cpuinfo[3]);
+    }
+  }
+  info.smtId = info.apicId & ((1U << smtShift) - 1U);
+  info.coreId = info.apicId >> smtShift;
+  info.packageId = info.apicId >> packageShift;
+  info.coreType = CoreType::kUnknown;
+  if (features.test(CpuidLeaf::k7, 3, 15) && features.maxLeaf() >= 0x1a) {
+    cpuidex(cpuinfo, 0x1a, 0);
+    const auto coreType = static_cast<std::uint32_t>(cpuinfo[0]) >> 24;
+    if (coreType == static_cast<std::uint32_t>(CoreType::kEfficient)
+        || coreType == static_cast<std::uint32_t>(CoreType::kPerformance)) {
+      info.coreType = static_cast<CoreType>(coreType);
+    }
+  }
+  return info;
+}
+
+/*!
+ * @brief Pin the calling thread to one logical CPU
+ * @param [in] cpu  OS processor index
+ * @return  true if succeeded, otherwise false
+ */
+static inline bool
+setCurrentThreadAffinity(int cpu) noexcept
+{
+#if defined(__linux__)
+  if (cpu < 0 || cpu >= CPU_SETSIZE) {
+    return false;
+  }
+  cpu_set_t cpuSet;
+  CPU_ZERO(&cpuSet);
+  CPU_SET(static_cast<std::size_t>(cpu), &cpuSet);
+  return ::sched_setaffinity(0, sizeof(cpuSet), &cpuSet) == 0;
+#elif defined(_WIN32)
+  if (cpu < 0 || cpu >= static_cast<int>(sizeof(DWORD_PTR) * 8)) {
+    return false;
+  }
+  return ::SetThreadAffinityMask(::GetCurrentThread(), static_cast<DWORD_PTR>(1) << cpu) != 0;
+#else
+  static_cast<void>(cpu);
+  return false;
+#endif  // defined(__linux__)
+}
+
+
+/*!
+ * @brief Process-wide snapshot of the logical CPU topology
+ *
+ * On first use, the calling thread visits every logical CPU it is allowed to run on
+ * and restores its affinity afterwards.
+ * Where thread affinity is not supported, only the current CPU is reported.
+ */
+class CpuTopology
+{
+public:
+  /*!
+   * @brief Get the process-wide snapshot
+   * @return  Reference to the snapshot
+   */
+  static const CpuTopology&
+  get()
+  {
+    static const CpuTopology instance;
+    return instance;
+  }
+
+  /*!
+   * @brief Get all logical CPUs available to this process
+   * @return  Logical CPUs ordered by OS processor index
+   */
+  const std::vector<LogicalCpuInfo>&
+  cpus() const noexcept
+  {
+    return cpus_;
+  }
+
+  /*!
+   * @brief Check whether this is a hybrid CPU (P-cores and E-cores)
+   * @return  true if hybrid, otherwise false
+   */
+  bool
+  isHybrid() const noexcept
+  {
+    return CpuFeatures::get().test(CpuidLeaf::k7, 3, 15);
+  }
+
+  /*!
+   * @brief Get the number of logical CPUs
+   * @return  Number of logical CPUs
+   */
+  std::size_t
+  nLogicalCpus() const noexcept
+  {
+    return cpus_.size();
+  }
+
+  /*!
+   * @brief Get the number of physical cores
+   * @return  Number of physical cores
+   */
+  std::size_t
+  nPhysicalCores() const noexcept
+  {
+    return physicalCoreCpus_.size();
+  }
+
+  /*!
+   * @brief Get the number of packages
+   * @return  Number of packages
+   */
+  std::size_t
+  nPackages() const noexcept
+  {
+    return nPackages_;
+  }
+
+  /*!
+   * @brief Get one logical CPU per physical core, suitable for pinning throughput threads
+   *
+   * Performance cores come first on hybrid CPUs.
+   *
+   * @param [in] includeEfficientCores  false to exclude E-cores of hybrid CPUs
+   * @return  OS processor indices
+   */
+  std::vector<int>
+  physicalCoreCpus(bool includeEfficientCores = true) const
+  {
+    std::vector<int> result;
+    for (const auto index : physicalCoreCpus_) {
+      if (includeEfficientCores || cpus_[index].coreType != CoreType::kEfficient) {
+        result.push_back(cpus_[index].cpu);
+      }
+    }
+    return result;
+  }
+
+private:
+  CpuTopology()
+    : cpus_{}
+    , physicalCoreCpus_{}
+    , nPackages_{0}
+  {
+    enumerate();
+    if (cpus_.empty()) {
+      cpus_.push_back(getCurrentLogicalCpuInfo());
+      cpus_.back().cpu = 0;
+    }
+
+    std::vector<std::uint32_t> coreIds;
+    std::vector<std::uint32_t> packageIds;
+    for (std::size_t i = 0; i < cpus_.size(); i++) {
+      if (std::find(coreIds.begin(), coreIds.end(), cpus_[i].coreId) == coreIds.end()) {
+        coreIds.push_back(cpus_[i].coreId);
+        physicalCoreCpus_.push_back(i);
+      }
+      if (std::find(packageIds.begin(), packageIds.end(), cpus_[i].packageId) == packageIds.end()) {
+        packageIds.push_back(cpus_[i].packageId);
+      }
+    }
+    nPackages_ = packageIds.size();
+    std::stable_sort(physicalCoreCpus_.begin(), physicalCoreCpus_.end(), [this](std::size_t x, std::size_t y) {
+      return cpus_[x].coreType == CoreType::kPerformance && cpus_[y].coreType != CoreType::kPerformance;
+    });
+  }
+
+  void
+  enumerate()
+  {
+#if defined(__linux__)
+    cpu_set_t original;
+    if (::sched_getaffinity(0, sizeof(original), &original) != 0) {
+      return;
+    }
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(static_cast<std::size_t>(cpu), &original) && setCurrentThreadAffinity(cpu)) {
+        cpus_.push_back(getCurrentLogicalCpuInfo());
+        cpus_.back().cpu = cpu;
+      }
+    }
+    ::sched_setaffinity(0, sizeof(original), &original);
+#elif defined(_WIN32)
+    DWORD_PTR processMask, systemMask;
+    if (!::GetProcessAffinityMask(::GetCurrentProcess(), &processMask, &systemMask)) {
+      return;
+    }
+    const auto original = ::SetThreadAffinityMask(::GetCurrentThread(), processMask);
+    for (int cpu = 0; cpu < static_cast<int>(sizeof(DWORD_PTR) * 8); cpu++) {
+      if ((processMask & (static_cast<DWORD_PTR>(1) << cpu)) != 0 && setCurrentThreadAffinity(cpu)) {
+        cpus_.push_back(getCurrentLogicalCpuInfo());
+        cpus_.back().cpu = cpu;
+      }
+    }
+    ::SetThreadAffinityMask(::GetCurrentThread(), original);
+#endif  // defined(__linux__)
+  }
+
+  //! Logical CPUs
+  std::vector<LogicalCpuInfo> cpus_;
+  //! Indices of cpus_, one per physical core
+  std::vector<std::size_t> physicalCoreCpus_;
+  //! Number of packages
+  std::size_t nPackages_;
+};  // class CpuTopology
 
 }  // namespace simdutil
 
@@ -0,0 +1,455 @@
+#ifndef SIMDUTIL_DISPATCH_HPP
+#define SIMDUTIL_DISPATCH_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cctype>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+#include <utility>
+
+#include "cpuid.hpp"
+
+
+#if defined(__GNUC__)
+#  define SIMDUTIL_TARGET(isa) __attribute__((target(isa)))
+#else
+#  define SIMDUTIL_TARGET(isa)
+#endif  // defined(__GNUC__)
+
+//! Target attribute for SSE4.2 kernels
+#define SIMDUTIL_TARGET_SSE42 SIMDUTIL_TARGET("sse2,ssse3,sse4.1,sse4.2,popcnt")
+//! Target attribute for AVX kernels
+#define SIMDUTIL_TARGET_AVX SIMDUTIL_TARGET("sse2,ssse3,sse4.1,sse4.2,popcnt,avx")
+//! Target attribute for AVX2 + FMA kernels
+#define SIMDUTIL_TARGET_AVX2 SIMDUTIL_TARGET("sse2,ssse3,sse4.1,sse4.2,popcnt,avx,avx2,fma,bmi,bmi2,lzcnt")
+//! Target attribute for AVX-512 (Skylake-X) kernels
+#define SIMDUTIL_TARGET_AVX512 \
+  SIMDUTIL_TARGET("sse2,ssse3,sse4.1,sse4.2,popcnt,avx,avx2,fma,bmi,bmi2,lzcnt,avx512f,avx512cd,avx512bw,avx512dq,avx512vl")
+//! Target attribute for AVX-512 (Ice Lake and later) kernels
+#define SIMDUTIL_TARGET_AVX512ICL \
+  SIMDUTIL_TARGET("sse2,ssse3,sse4.1,sse4.2,popcnt,avx,avx2,fma,bmi,bmi2,lzcnt,avx512f,avx512cd,avx512bw,avx512dq,avx512vl," \
+                  "avx512ifma,avx512vbmi,avx512vbmi2,avx512vnni,avx512bitalg,avx512vpopcntdq")
+
+/*!
+ * @brief Declare a kernel built once per level by add_multi_isa_kernel_library() in cmake/flags.cmake
+ *
+ * Use this at namespace scope in a header which both the kernel source and the dispatching code include.
+ * The kernel source defines the function in namespace SIMDUTIL_KERNEL_NAMESPACE.
+ *
+ * @code
+ * // saxpy.hpp
+ * SIMDUTIL_DECLARE_MULTI_ISA_KERNEL(saxpy_kernels, void, saxpy, (float* y, const float* x, float a, std::size_t n))
+ *
+ * // saxpy.cpp, passed to add_multi_isa_kernel_library(saxpy_lib saxpy_kernels saxpy.cpp)
+ * namespace SIMDUTIL_KERNEL_NAMESPACE
+ * {
+ * void saxpy(float* y, const float* x, float a, std::size_t n) { ... }
+ * }
+ *
+ * // Caller
+ * static const simdutil::Dispatcher<void(float*, const float*, float, std::size_t)> saxpyDispatcher{
+ *   SIMDUTIL_MULTI_ISA_KERNEL_ENTRIES(saxpy_kernels, saxpy)};
+ * @endcode
+ *
+ * The builds only differ in their compiler flags, so inline functions and templates with external linkage
+ * (standard containers, class members, ...) used by the kernel source are merged by the linker,
+ * and the copy of a wider level may be picked for all levels.
+ * Keep such code out of the kernel sources; loops, intrinsics and the static inline functions of this library are safe.
+ */
+#define SIMDUTIL_DECLARE_MULTI_ISA_KERNEL(ns, ret, name, params) \
+  namespace ns##_scalar { ret name params; } \
+  namespace ns##_sse42 { ret name params; } \
+  namespace ns##_avx2 { ret name params; } \
+  namespace ns##_avx512 { ret name params; } \
+  namespace ns##_avx512icl { ret name params; }
+
+//! Dispatcher entries of a kernel declared with SIMDUTIL_DECLARE_MULTI_ISA_KERNEL()
+#define SIMDUTIL_MULTI_ISA_KERNEL_ENTRIES(ns, name) \
+  {simdutil::IsaLevel::kAvx512Icl, &ns##_avx512icl::name}, \
+  {simdutil::IsaLevel::kAvx512, &ns##_avx512::name}, \
+  {simdutil::IsaLevel::kAvx2, &ns##_avx2::name}, \
+  {simdutil::IsaLevel::kSse42, &ns##_sse42::name}, \
+  {simdutil::IsaLevel::kScalar, &ns##_scalar::name}
+
+
+namespace simdutil
+{
+
+
+/*!
+ * @brief Instruction set levels used for kernel dispatching
+ *
+ * Each level implies all lower levels.
+ */
+enum class IsaLevel : int
+{
+  //! Portable C++ only
+  kScalar,
+  //! SSE2
+  kSse2,
+  //! SSE2, SSSE3, SSE4.1, SSE4.2 and POPCNT
+  kSse42,
+  //! AVX
+  kAvx,
+  //! AVX2, FMA, BMI1, BMI2 and LZCNT
+  kAvx2,
+  //! AVX-512 F, CD, BW, DQ and VL (Skylake-X)
+  kAvx512,
+  //! AVX-512 Skylake-X set plus IFMA, VBMI, VBMI2, VNNI, BITALG and VPOPCNTDQ (Ice Lake and later)
+  kAvx512Icl
+};  // enum class IsaLevel
+
+
+/*!
+ * @brief Get the name of an instruction set level
+ *
+ * The names are the ones accepted by the environment variable SIMDUTIL_MAX_ISA.
+ *
+ * @param [in] level  Instruction set level
+ * @return  Name of the level
+ */
+static inline const char*
+getIsaLevelName(IsaLevel level) noexcept
+{
+  switch (level) {
+    case IsaLevel::kScalar:
+      return "scalar";
+    case IsaLevel::kSse2:
+      return "sse2";
+    case IsaLevel::kSse42:
+      return "sse4.2";
+    case IsaLevel::kAvx:
+      return "avx";
+    case IsaLevel::kAvx2:
+      return "avx2";
+    case IsaLevel::kAvx512:
+      return "avx512";
+    case IsaLevel::kAvx512Icl:
+      return "avx512icl";
+    default:
+      return "unknown";
+  }
+}
+
+/*!
+ * @brief Parse the name of an instruction set level (case insensitive)
+ * @param [in] name      Level name (See getIsaLevelName())
+ * @param [in] fallback  Value returned if the name is unknown
+ * @return  Parsed level
+ */
+static inline IsaLevel
+parseIsaLevel(const char* name, IsaLevel fallback) noexcept
+{
+  if (name == nullptr) {
+    return fallback;
+  }
+  std::array<char, 16> lower;
+  std::size_t n = 0;
+  for (; name[n] != '\0'; n++) {
+    if (n == lower.size() - 1) {
+      return fallback;
+    }
+    lower[n] = static_cast<char>(std::tolower(static_cast<unsigned char>(name[n])));
+  }
+  lower[n] = '\0';
+  for (int i = static_cast<int>(IsaLevel::kScalar); i <= static_cast<int>(IsaLevel::kAvx512Icl); i++) {
+    if (std::strcmp(lower.data(), getIsaLevelName(static_cast<IsaLevel>(i))) == 0) {
+      return static_cast<IsaLevel>(i);
+    }
+  }
+  return fallback;
+}
+
+/*!
+ * @brief Check whether all features of an instruction set level are available
+ * @param [in] level  Instruction set level
+ * @return  true if available, otherwise false
+ */
+static inline bool
+isIsaLevelAvailable(IsaLevel level) noexcept
+{
+  switch (level) {
+    case IsaLevel::kScalar:
+      return true;
+    case IsaLevel::kSse2:
+      return isSse2Available();
+    case IsaLevel::kSse42:
+      return isIsaLevelAvailable(IsaLevel::kSse2)
+        && isSsse3Available()
+        && isSse41Available()
+        && isSse42Available()
+        && isPopcntAvailable();
+    case IsaLevel::kAvx:
+      return isIsaLevelAvailable(IsaLevel::kSse42) && isAvxAvailable();
+    case IsaLevel::kAvx2:
+      return isIsaLevelAvailable(IsaLevel::kAvx)
+        && isAvx2Available()
+        && isFmaAvailable()
+        && isBmi1Available()
+        && isBmi2Available()
+        && isLzcntAvailable();
+    case IsaLevel::kAvx512:
+      return isIsaLevelAvailable(IsaLevel::kAvx2)
+        && isAvx512FAvailable()
+        && isAvx512CdAvailable()
+        && isAvx512BwAvailable()
+        && isAvx512DqAvailable()
+        && isAvx512VlAvailable();
+    case IsaLevel::kAvx512Icl:
+      return isIsaLevelAvailable(IsaLevel::kAvx512)
+        && isAvx512Ifma52Available()
+        && isAvx512VbmiAvailable()
+        && isAvx512Vbmi2Available()
+        && isAvx512VnniAvailable()
+        && isAvx512BitalgAvailable()
+        && isAvx512VpopcntdqAvailable();
+    default:
+      return false;
+  }
+}
+
+
+/*!
+ * @brief Process-wide instruction set level used for dispatching
+ */
+class IsaLevelSetting
+{
+public:
+  /*!
+   * @brief Get the highest instruction set level supported by this CPU
+   * @return  Detected level
+   */
+  static IsaLevel
+  detected() noexcept
+  {
+    static const IsaLevel level = detect();
+    return level;
+  }
+
+  /*!
+   * @brief Get the highest instruction set level kernels may use
+   *
+   * This is the detected level, lowered by the environment variable SIMDUTIL_MAX_ISA if it is set
+   * (e.g. SIMDUTIL_MAX_ISA=avx2), which is useful for A/B performance testing,
+   * and by setLimit().
+   *
+   * @return  Maximum level for dispatching
+   */
+  static IsaLevel
+  maximum() noexcept
+  {
+    static const IsaLevel level = std::min(detected(), parseIsaLevel(std::getenv("SIMDUTIL_MAX_ISA"), IsaLevel::kAvx512Icl));
+    return std::min(level, limitStorage().load(std::memory_order_acquire));
+  }
+
+  /*!
+   * @brief Lower the maximum level from the program (e.g. with the result of the vector width tuner)
+   *
+   * Dispatchers cache their implementation on the first call,
+   * so this only affects dispatchers which have not been called yet; call it at the start of the program.
+   *
+   * @param [in] level  Maximum level (IsaLevel::kAvx512Icl removes the limit)
+   */
+  static void
+  setLimit(IsaLevel level) noexcept
+  {
+    limitStorage().store(level, std::memory_order_release);
+  }
+
+private:
+  static std::atomic<IsaLevel>&
+  limitStorage() noexcept
+  {
+    static std::atomic<IsaLevel> limit{IsaLevel::kAvx512Icl};
+    return limit;
+  }
+
+  static IsaLevel
+  detect() noexcept
+  {
+    auto level = IsaLevel::kScalar;
+    for (int i = static_cast<int>(IsaLevel::kSse2); i <= static_cast<int>(IsaLevel::kAvx512Icl); i++) {
+      if (!isIsaLevelAvailable(static_cast<IsaLevel>(i))) {
+        break;
+      }
+      level = static_cast<IsaLevel>(i);
+    }
+    return level;
+  }
+};  // class IsaLevelSetting
+
+
+/*!
+ * @brief One kernel implementation and the instruction set level it requires
+ */
+template<typename F>
+struct KernelEntry
+{
+  //! Required instruction set level
+  IsaLevel level;
+  //! Kernel function
+  F* function;
+};  // struct KernelEntry
+
+
+template<typename F>
+class Dispatcher;
+
+/*!
+ * @brief Runtime dispatcher which selects the best kernel implementation once
+ *
+ * The best implementation is resolved on the first call and its function pointer is cached,
+ * so later calls are a single load and an indirect call.
+ * The implementation list must contain an IsaLevel::kScalar entry as a fallback, so a call always has a target.
+ *
+ * @code
+ * static const simdutil::Dispatcher<float(const float*, std::size_t)> sumDispatcher{
+ *   {simdutil::IsaLevel::kAvx512, &sumAvx512},
+ *   {simdutil::IsaLevel::kAvx2, &sumAvx2},
+ *   {simdutil::IsaLevel::kScalar, &sumScalar}};
+ * auto s = sumDispatcher(data, n);
+ * @endcode
+ */
+template<typename R, typename... Args>
+class Dispatcher<R(Args...)>
+{
+public:
+  //! Kernel function type
+  using FunctionType = R(Args...);
+  //! Kernel function pointer type
+  using FunctionPointer = FunctionType*;
+  //! Implementation entry type
+  using Entry = KernelEntry<FunctionType>;
+  //! Maximum number of implementations
+  static constexpr std::size_t kMaxEntries = static_cast<std::size_t>(IsaLevel::kAvx512Icl) + 1;
+
+  /*!
+   * @brief Construct with implementations
+   *
+   * There is one parameter per instruction set level, so a list of more than kMaxEntries implementations
+   * does not compile.
+   *
+   * @param [in] entry0, entry1, entry2, entry3, entry4, entry5, entry6  Implementations (in any order)
+   * @throw std::invalid_argument  If there is no IsaLevel::kScalar implementation to fall back to
+   */
+  Dispatcher(
+    const Entry& entry0,
+    const Entry& entry1 = Entry{},
+    const Entry& entry2 = Entry{},
+    const Entry& entry3 = Entry{},
+    const Entry& entry4 = Entry{},
+    const Entry& entry5 = Entry{},
+    const Entry& entry6 = Entry{})
+    : entries_{}
+    , nEntries_{0}
+    , function_{nullptr}
+    , level_{IsaLevel::kScalar}
+  {
+    static_assert(kMaxEntries == 7, "Dispatcher must take one constructor parameter per IsaLevel");
+    bool hasScalar = false;
+    for (const auto& entry : {entry0, entry1, entry2, entry3, entry4, entry5, entry6}) {
+      // Entry{} marks an unused parameter
+      if (entry.function != nullptr) {
+        entries_[nEntries_++] = entry;
+        hasScalar = hasScalar || entry.level == IsaLevel::kScalar;
+      }
+    }
+    if (!hasScalar) {
+      throw std::invalid_argument{"Dispatcher requires an IsaLevel::kScalar implementation"};
+    }
+  }
+
+  Dispatcher(const Dispatcher&) = delete;
+  Dispatcher& operator=(const Dispatcher&) = delete;
+
+  /*!
+   * @brief Call the selected implementation
+   * @param [in] args  Arguments of the kernel
+   * @return  Return value of the kernel
+   */
+  R
+  operator()(Args... args) const
+  {
+    return get()(std::forward<Args>(args)...);
+  }
+
+  /*!
+   * @brief Get the selected implementation, resolving it on the first call
+   * @return  Function pointer to the selected implementation
+   */
+  FunctionPointer
+  get() const noexcept
+  {
+    const auto function = function_.load(std::memory_order_acquire);
+    return function != nullptr ? function : resolve();
+  }
+
+  /*!
+   * @brief Get the instruction set level of the selected implementation
+   * @return  Level of the selected implementation
+   */
+  IsaLevel
+  selectedLevel() const noexcept
+  {
+    get();
+    return level_.load(std::memory_order_relaxed);
+  }
+
+  /*!
+   * @brief Select the implementation for the specified maximum level, ignoring the cached one
+   * @param [in] maxLevel  Maximum instruction set level
+   * @return  Function pointer to the implementation
+   */
+  FunctionPointer
+  select(IsaLevel maxLevel) const noexcept
+  {
+    return find(maxLevel)->function;
+  }
+
+private:
+  //! Never nullptr: the kScalar entry is usable at every level
+  const Entry*
+  find(IsaLevel maxLevel) const noexcept
+  {
+    const Entry* best = nullptr;
+    for (std::size_t i = 0; i < nEntries_; i++) {
+      const auto& entry = entries_[i];
+      if (entry.level <= maxLevel && (best == nullptr || best->level < entry.level)) {
+        best = &entry;
+      }
+    }
+    return best;
+  }
+
+  FunctionPointer
+  resolve() const noexcept
+  {
+    const auto entry = find(IsaLevelSetting::maximum());
+    level_.store(entry->level, std::memory_order_relaxed);
+    function_.store(entry->function, std::memory_order_release);
+    return entry->function;
+  }
+
+  //! Implementations
+  std::array<Entry, kMaxEntries> entries_;
+  //! Number of implementations
+  std::size_t nEntries_;
+  //! Cached function pointer of the selected implementation
+  mutable std::atomic<FunctionPointer> function_;
+  //! Level of the selected implementation
+  mutable std::atomic<IsaLevel> level_;
+};  // class Dispatcher
+
+template<typename R, typename... Args>
+constexpr std::size_t Dispatcher<R(Args...)>::kMaxEntries;
+
+
+}  // namespace simdutil
+
+
+#endif  // SIMDUTIL_DISPATCH_HPP
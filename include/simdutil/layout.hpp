@@ -0,0 +1,558 @@
+#ifndef SIMDUTIL_LAYOUT_HPP
+#define SIMDUTIL_LAYOUT_HPP
+
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#else
+#  include <immintrin.h>
+#endif  // defined(_MSC_VER)
+
+#include "aligned_vector.hpp"
+#include "cpuid.hpp"
+#include "dispatch.hpp"
+#include "vec.hpp"
+
+
+namespace simdutil
+{
+/*!
+ * @brief Structure-of-arrays storage: one aligned plane per field
+ *
+ * All planes live in one AlignedVector. Each plane starts at a multiple of the widest SIMD register
+ * and is padded to it, so kernels may use full-width aligned loads and stores on every plane.
+ */
+template<typename T>
+class SoaBuffer
+{
+public:
+  //! Element type
+  using value_type = T;
+
+  /*!
+   * @brief Allocate zero-initialized planes
+   * @param [in] n  Number of records (elements per plane)
+   * @param [in] nFields  Number of fields (planes)
+   */
+  SoaBuffer(std::size_t n, std::size_t nFields)
+    : size_{n}
+    , stride_{getPlaneStride(n)}
+    , storage_(stride_ * nFields)
+    , planes_(nFields)
+  {
+    for (std::size_t k = 0; k < nFields; k++) {
+      planes_[k] = storage_.data() + k * stride_;
+    }
+  }
+
+  SoaBuffer(const SoaBuffer&) = delete;
+  SoaBuffer& operator=(const SoaBuffer&) = delete;
+  SoaBuffer(SoaBuffer&&) = default;
+  SoaBuffer& operator=(SoaBuffer&&) = default;
+
+  std::size_t size() const noexcept { return size_; }
+  std::size_t fieldCount() const noexcept { return planes_.size(); }
+  //! Distance between the first elements of adjacent planes
+  std::size_t stride() const noexcept { return stride_; }
+  T* plane(std::size_t k) noexcept { return planes_[k]; }
+  const T* plane(std::size_t k) const noexcept { return planes_[k]; }
+  //! Plane pointers, for aosToSoa()
+  T* const* planes() noexcept { return planes_.data(); }
+  //! Plane pointers, for soaToAos()
+  const T* const* planes() const noexcept { return planes_.data(); }
+
+private:
+  static std::size_t
+  getPlaneStride(std::size_t n) noexcept
+  {
+    const auto unit = std::max<std::size_t>(getMaxSimdRegisterSize() / sizeof(T), 1);
+    return (n + unit - 1) / unit * unit;
+  }
+
+  //! Number of records
+  std::size_t size_;
+  //! Distance between planes in elements
+  std::size_t stride_;
+  //! Storage of all planes
+  AlignedVector<T> storage_;
+  //! Pointer to each plane
+  std::vector<T*> planes_;
+};  // class SoaBuffer
+
+
+/*!
+ * @brief Portable layout conversion of the records [first, last)
+ */
+struct LayoutScalar
+{
+  template<typename T>
+  static void
+  aosToSoa(const T* aos, std::size_t first, std::size_t last, std::size_t nFields, T* const* planes) noexcept
+  {
+    for (std::size_t j = first; j < last; j++) {
+      for (std::size_t k = 0; k < nFields; k++) {
+        planes[k][j] = aos[j * nFields + k];
+      }
+    }
+  }
+
+  template<typename T>
+  static void
+  soaToAos(const T* const* planes, std::size_t first, std::size_t last, std::size_t nFields, T* aos) noexcept
+  {
+    for (std::size_t j = first; j < last; j++) {
+      for (std::size_t k = 0; k < nFields; k++) {
+        aos[j * nFields + k] = planes[k][j];
+      }
+    }
+  }
+
+  template<typename T>
+  static void
+  aosToSoa(const T* aos, std::size_t n, std::size_t nFields, T* const* planes) noexcept
+  {
+    aosToSoa(aos, 0, n, nFields, planes);
+  }
+
+  template<typename T>
+  static void
+  soaToAos(const T* const* planes, std::size_t n, std::size_t nFields, T* aos) noexcept
+  {
+    soaToAos(planes, 0, n, nFields, aos);
+  }
+};  // struct LayoutScalar
+
+
+/*!
+ * @brief 4x4 transpose of 32-bit lanes with SSE2 unpacks
+ */
+struct Transpose4x4
+{
+  //! Number of rows and columns
+  static constexpr std::size_t kSize = 4;
+
+  /*!
+   * @brief Transpose 4 rows of src (stride elements apart) into columns j of 4 planes
+   */
+  template<typename T>
+  SIMDUTIL_TARGET_SSE42 static void
+  rowsToPlanes(const T* src, std::size_t stride, T* const* planes, std::size_t j) noexcept
+  {
+    __m128i r[kSize];
+    for (std::size_t i = 0; i < kSize; i++) {
+      r[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(static_cast<const void*>(src + i * stride)));
+    }
+    transpose(r);
+    for (std::size_t i = 0; i < kSize; i++) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(static_cast<void*>(planes[i] + j)), r[i]);
+    }
+  }
+
+  /*!
+   * @brief Transpose columns j of 4 planes into 4 rows of dst (stride elements apart)
+   */
+  template<typename T>
+  SIMDUTIL_TARGET_SSE42 static void
+  planesToRows(const T* const* planes, std::size_t j, T* dst, std::size_t stride) noexcept
+  {
+    __m128i r[kSize];
+    for (std::size_t i = 0; i < kSize; i++) {
+      r[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(static_cast<const void*>(planes[i] + j)));
+    }
+    transpose(r);
+    for (std::size_t i = 0; i < kSize; i++) {
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(static_cast<void*>(dst + i * stride)), r[i]);
+    }
+  }
+
+  SIMDUTIL_TARGET_SSE42 static void
+  transpose(__m128i (&r)[kSize]) noexcept
+  {
+    const auto t0 = _mm_unpacklo_epi32(r[0], r[1]);
+    const auto t1 = _mm_unpacklo_epi32(r[2], r[3]);
+    const auto t2 = _mm_unpackhi_epi32(r[0], r[1]);
+    const auto t3 = _mm_unpackhi_epi32(r[2], r[3]);
+    r[0] = _mm_unpacklo_epi64(t0, t1);
+    r[1] = _mm_unpackhi_epi64(t0, t1);
+    r[2] = _mm_unpacklo_epi64(t2, t3);
+    r[3] = _mm_unpackhi_epi64(t2, t3);
+  }
+};  // struct Transpose4x4
+
+
+/*!
+ * @brief 8x8 transpose of 32-bit lanes with AVX2 unpacks and 128-bit lane permutes
+ */
+struct Transpose8x8
+{
+  //! Number of rows and columns
+  static constexpr std::size_t kSize = 8;
+
+  template<typename T>
+  SIMDUTIL_TARGET_AVX2 static void
+  rowsToPlanes(const T* src, std::size_t stride, T* const* planes, std::size_t j) noexcept
+  {
+    __m256i r[kSize];
+    for (std::size_t i = 0; i < kSize; i++) {
+      r[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(static_cast<const void*>(src + i * stride)));
+    }
+    transpose(r);
+    for (std::size_t i = 0; i < kSize; i++) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(static_cast<void*>(planes[i] + j)), r[i]);
+    }
+  }
+
+  template<typename T>
+  SIMDUTIL_TARGET_AVX2 static void
+  planesToRows(const T* const* planes, std::size_t j, T* dst, std::size_t stride) noexcept
+  {
+    __m256i r[kSize];
+    for (std::size_t i = 0; i < kSize; i++) {
+      r[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(static_cast<const void*>(planes[i] + j)));
+    }
+    transpose(r);
+    for (std::size_t i = 0; i < kSize; i++) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(static_cast<void*>(dst + i * stride)), r[i]);
+    }
+  }
+
+  SIMDUTIL_TARGET_AVX2 static void
+  transpose(__m256i (&r)[kSize]) noexcept
+  {
+    // 4x4 transposes inside each 128-bit lane
+    __m256i t[kSize], u[kSize];
+    for (std::size_t i = 0; i < kSize; i += 2) {
+      t[i] = _mm256_unpacklo_epi32(r[i], r[i + 1]);
+      t[i + 1] = _mm256_unpackhi_epi32(r[i], r[i + 1]);
+    }
+    for (std::size_t i = 0; i < kSize; i += 4) {
+      u[i] = _mm256_unpacklo_epi64(t[i], t[i + 2]);
+      u[i + 1] = _mm256_unpackhi_epi64(t[i], t[i + 2]);
+      u[i + 2] = _mm256_unpacklo_epi64(t[i + 1], t[i + 3]);
+      u[i + 3] = _mm256_unpackhi_epi64(t[i + 1], t[i + 3]);
+    }
+    // Swap the off-diagonal 4x4 blocks
+    for (std::size_t i = 0; i < 4; i++) {
+      r[i] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x20);
+      r[i + 4] = _mm256_permute2x128_si256(u[i], u[i + 4], 0x31);
+    }
+  }
+};  // struct Transpose8x8
+
+
+/*!
+ * @brief 16x16 transpose of 32-bit lanes with AVX-512 unpacks and 128-bit lane shuffles
+ */
+struct Transpose16x16
+{
+  //! Number of rows and columns
+  static constexpr std::size_t kSize = 16;
+
+  template<typename T>
+  SIMDUTIL_TARGET_AVX512 static void
+  rowsToPlanes(const T* src, std::size_t stride, T* const* planes, std::size_t j) noexcept
+  {
+    __m512i r[kSize] = {};
+    for (std::size_t i = 0; i < kSize; i++) {
+      r[i] = _mm512_loadu_si512(src + i * stride);
+    }
+    transpose(r);
+    for (std::size_t i = 0; i < kSize; i++) {
+      _mm512_storeu_si512(planes[i] + j, r[i]);
+    }
+  }
+
+  template<typename T>
+  SIMDUTIL_TARGET_AVX512 static void
+  planesToRows(const T* const* planes, std::size_t j, T* dst, std::size_t stride) noexcept
+  {
+    __m512i r[kSize] = {};
+    for (std::size_t i = 0; i < kSize; i++) {
+      r[i] = _mm512_loadu_si512(planes[i] + j);
+    }
+    transpose(r);
+    for (std::size_t i = 0; i < kSize; i++) {
+      _mm512_storeu_si512(dst + i * stride, r[i]);
+    }
+  }
+
+  SIMDUTIL_TARGET_AVX512 static void
+  transpose(__m512i (&r)[kSize]) noexcept
+  {
+    // The zero-masked forms with a full mask compile to the plain instructions,
+    // and unlike _mm512_unpacklo_epi32() etc. they have no undefined merge source in GCC 12
+    constexpr __mmask16 kAll32 = 0xffff;
+    constexpr __mmask8 kAll64 = 0xff;
+    // 4x4 transposes inside each 128-bit lane
+    __m512i t[kSize] = {};
+    __m512i u[kSize] = {};
+    for (std::size_t i = 0; i < kSize; i += 2) {
+      t[i] = _mm512_maskz_unpacklo_epi32(kAll32, r[i], r[i + 1]);
+      t[i + 1] = _mm512_maskz_unpackhi_epi32(kAll32, r[i], r[i + 1]);
+    }
+    for (std::size_t i = 0; i < kSize; i += 4) {
+      u[i] = _mm512_maskz_unpacklo_epi64(kAll64, t[i], t[i + 2]);
+      u[i + 1] = _mm512_maskz_unpackhi_epi64(kAll64, t[i], t[i + 2]);
+      u[i + 2] = _mm512_maskz_unpacklo_epi64(kAll64, t[i + 1], t[i + 3]);
+      u[i + 3] = _mm512_maskz_unpackhi_epi64(kAll64, t[i + 1], t[i + 3]);
+    }
+    // 4x4 transpose of the 128-bit blocks: u[4 * g + c] holds column 4 * lane + c of rows 4 * g to 4 * g + 3
+    for (std::size_t c = 0; c < 4; c++) {
+      const auto x0 = _mm512_maskz_shuffle_i32x4(kAll32, u[c], u[c + 4], 0x88);
+      const auto x1 = _mm512_maskz_shuffle_i32x4(kAll32, u[c], u[c + 4], 0xdd);
+      const auto y0 = _mm512_maskz_shuffle_i32x4(kAll32, u[c + 8], u[c + 12], 0x88);
+      const auto y1 = _mm512_maskz_shuffle_i32x4(kAll32, u[c + 8], u[c + 12], 0xdd);
+      r[c] = _mm512_maskz_shuffle_i32x4(kAll32, x0, y0, 0x88);
+      r[c + 4] = _mm512_maskz_shuffle_i32x4(kAll32, x1, y1, 0x88);
+      r[c + 8] = _mm512_maskz_shuffle_i32x4(kAll32, x0, y0, 0xdd);
+      r[c + 12] = _mm512_maskz_shuffle_i32x4(kAll32, x1, y1, 0xdd);
+    }
+  }
+};  // struct Transpose16x16
+
+
+/*!
+ * @brief Layout conversion with square in-register transposes
+ *
+ * Blocks of Tile::kSize records are transposed Tile::kSize fields at a time.
+ * If the number of fields is not a multiple of the tile size, the last field group overlaps the previous one,
+ * so the overlapping planes or fields are written twice with the same values.
+ * Records after the last whole block are converted by LayoutScalar.
+ *
+ * @tparam Tile  Transpose4x4, Transpose8x8 or Transpose16x16 (nFields must be at least Tile::kSize)
+ */
+template<typename Tile>
+struct TransposeLayoutKernel
+{
+  template<typename T>
+  static void
+  aosToSoa(const T* aos, std::size_t n, std::size_t nFields, T* const* planes) noexcept
+  {
+    constexpr auto kSize = Tile::kSize;
+    std::size_t j = 0;
+    for (; j + kSize <= n; j += kSize) {
+      for (std::size_t k = 0; k < nFields; k += kSize) {
+        const auto k0 = std::min(k, nFields - kSize);
+        Tile::rowsToPlanes(aos + j * nFields + k0, nFields, planes + k0, j);
+      }
+    }
+    LayoutScalar::aosToSoa(aos, j, n, nFields, planes);
+  }
+
+  template<typename T>
+  static void
+  soaToAos(const T* const* planes, std::size_t n, std::size_t nFields, T* aos) noexcept
+  {
+    constexpr auto kSize = Tile::kSize;
+    std::size_t j = 0;
+    for (; j + kSize <= n; j += kSize) {
+      for (std::size_t k = 0; k < nFields; k += kSize) {
+        const auto k0 = std::min(k, nFields - kSize);
+        Tile::planesToRows(planes + k0, j, aos + j * nFields + k0, nFields);
+      }
+    }
+    LayoutScalar::soaToAos(planes, j, n, nFields, aos);
+  }
+};  // struct TransposeLayoutKernel
+
+
+/*!
+ * @brief SSE4.2 layout conversion: 4x4 transposes
+ */
+struct LayoutSse42
+{
+  template<typename T>
+  SIMDUTIL_TARGET_SSE42 SIMDUTIL_FLATTEN static void
+  aosToSoa(const T* aos, std::size_t n, std::size_t nFields, T* const* planes) noexcept
+  {
+    if (nFields >= 4) {
+      TransposeLayoutKernel<Transpose4x4>::aosToSoa(aos, n, nFields, planes);
+    } else {
+      LayoutScalar::aosToSoa(aos, n, nFields, planes);
+    }
+  }
+
+  template<typename T>
+  SIMDUTIL_TARGET_SSE42 SIMDUTIL_FLATTEN static void
+  soaToAos(const T* const* planes, std::size_t n, std::size_t nFields, T* aos) noexcept
+  {
+    if (nFields >= 4) {
+      TransposeLayoutKernel<Transpose4x4>::soaToAos(planes, n, nFields, aos);
+    } else {
+      LayoutScalar::soaToAos(planes, n, nFields, aos);
+    }
+  }
+};  // struct LayoutSse42
+
+
+/*!
+ * @brief AVX2 layout conversion: 8x8 transposes, 4x4 transposes for 4 - 7 fields
+ */
+struct LayoutAvx2
+{
+  template<typename T>
+  SIMDUTIL_TARGET_AVX2 SIMDUTIL_FLATTEN static void
+  aosToSoa(const T* aos, std::size_t n, std::size_t nFields, T* const* planes) noexcept
+  {
+    if (nFields >= 8) {
+      TransposeLayoutKernel<Transpose8x8>::aosToSoa(aos, n, nFields, planes);
+    } else if (nFields >= 4) {
+      TransposeLayoutKernel<Transpose4x4>::aosToSoa(aos, n, nFields, planes);
+    } else {
+      LayoutScalar::aosToSoa(aos, n, nFields, planes);
+    }
+  }
+
+  template<typename T>
+  SIMDUTIL_TARGET_AVX2 SIMDUTIL_FLATTEN static void
+  soaToAos(const T* const* planes, std::size_t n, std::size_t nFields, T* aos) noexcept
+  {
+    if (nFields >= 8) {
+      TransposeLayoutKernel<Transpose8x8>::soaToAos(planes, n, nFields, aos);
+    } else if (nFields >= 4) {
+      TransposeLayoutKernel<Transpose4x4>::soaToAos(planes, n, nFields, aos);
+    } else {
+      LayoutScalar::soaToAos(planes, n, nFields, aos);
+    }
+  }
+};  // struct LayoutAvx2
+
+
+/*!
+ * @brief AVX-512 layout conversion: 16x16, 8x8 or 4x4 transposes, gather / scatter for 2 or 3 fields
+ *
+ * Records of 2 or 3 fields are too narrow for a square transpose,
+ * where one gather (or scatter) with the indices 0, nFields, 2 * nFields, ... moves 16 elements of a plane.
+ */
+struct LayoutAvx512
+{
+  template<typename T>
+  SIMDUTIL_TARGET_AVX512 SIMDUTIL_FLATTEN static void
+  aosToSoa(const T* aos, std::size_t n, std::size_t nFields, T* const* planes) noexcept
+  {
+    if (nFields >= 16) {
+      TransposeLayoutKernel<Transpose16x16>::aosToSoa(aos, n, nFields, planes);
+    } else if (nFields >= 8) {
+      TransposeLayoutKernel<Transpose8x8>::aosToSoa(aos, n, nFields, planes);
+    } else if (nFields >= 4) {
+      TransposeLayoutKernel<Transpose4x4>::aosToSoa(aos, n, nFields, planes);
+    } else if (nFields >= 2) {
+      const auto indices = getIndices(nFields);
+      // Merge source of the gather, which _mm512_i32gather_epi32() leaves undefined
+      const auto zero = _mm512_setzero_si512();
+      std::size_t j = 0;
+      for (; j + 16 <= n; j += 16) {
+        for (std::size_t k = 0; k < nFields; k++) {
+          _mm512_storeu_si512(planes[k] + j, _mm512_mask_i32gather_epi32(zero, static_cast<__mmask16>(0xffff), indices, aos + j * nFields + k, 4));
+        }
+      }
+      LayoutScalar::aosToSoa(aos, j, n, nFields, planes);
+    } else {
+      LayoutScalar::aosToSoa(aos, n, nFields, planes);
+    }
+  }
+
+  template<typename T>
+  SIMDUTIL_TARGET_AVX512 SIMDUTIL_FLATTEN static void
+  soaToAos(const T* const* planes, std::size_t n, std::size_t nFields, T* aos) noexcept
+  {
+    if (nFields >= 16) {
+      TransposeLayoutKernel<Transpose16x16>::soaToAos(planes, n, nFields, aos);
+    } else if (nFields >= 8) {
+      TransposeLayoutKernel<Transpose8x8>::soaToAos(planes, n, nFields, aos);
+    } else if (nFields >= 4) {
+      TransposeLayoutKernel<Transpose4x4>::soaToAos(planes, n, nFields, aos);
+    } else if (nFields >= 2) {
+      const auto indices = getIndices(nFields);
+      std::size_t j = 0;
+      for (; j + 16 <= n; j += 16) {
+        for (std::size_t k = 0; k < nFields; k++) {
+          _mm512_i32scatter_epi32(aos + j * nFields + k, indices, _mm512_loadu_si512(planes[k] + j), 4);
+        }
+      }
+      LayoutScalar::soaToAos(planes, j, n, nFields, aos);
+    } else {
+      LayoutScalar::soaToAos(planes, n, nFields, aos);
+    }
+  }
+
+private:
+  SIMDUTIL_TARGET_AVX512 static __m512i
+  getIndices(std::size_t nFields) noexcept
+  {
+    return _mm512_mullo_epi32(
+      _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+      _mm512_set1_epi32(static_cast<int>(nFields)));
+  }
+};  // struct LayoutAvx512
+
+
+/*!
+ * @brief Convert an array of structures into a structure of arrays
+ *
+ * planes[k][j] = aos[j * nFields + k].
+ * Records are moved by in-register transposes (16x16, 8x8 or 4x4 lanes, the largest which fits nFields),
+ * or by AVX-512 gathers for records of 2 or 3 fields.
+ * Planes of a SoaBuffer are aligned, so the plane stores never split cache lines.
+ *
+ * @code
+ * struct Point { float x, y, z, w; };
+ * simdutil::SoaBuffer<float> soa{points.size(), 4};
+ * simdutil::aosToSoa(reinterpret_cast<const float*>(points.data()), points.size(), 4, soa.planes());
+ * @endcode
+ *
+ * @tparam T  4-byte element type (float, std::int32_t, std::uint32_t)
+ * @param [in] aos  Records of nFields elements each
+ * @param [in] n  Number of records
+ * @param [in] nFields  Number of elements per record
+ * @param [out] planes  nFields planes of at least n elements
+ */
+template<typename T>
+static inline void
+aosToSoa(const T* aos, std::size_t n, std::size_t nFields, T* const* planes) noexcept
+{
+  static_assert(sizeof(T) == 4 && std::is_trivially_copyable<T>::value, "Element type must be a 4-byte trivially copyable type");
+  static const Dispatcher<void(const T*, std::size_t, std::size_t, T* const*)> dispatcher{
+    {IsaLevel::kAvx512, &LayoutAvx512::aosToSoa<T>},
+    {IsaLevel::kAvx2, &LayoutAvx2::aosToSoa<T>},
+    {IsaLevel::kSse42, &LayoutSse42::aosToSoa<T>},
+    {IsaLevel::kScalar, &LayoutScalar::aosToSoa<T>}};
+  dispatcher(aos, n, nFields, planes);
+}
+
+
+/*!
+ * @brief Convert a structure of arrays into an array of structures
+ *
+ * aos[j * nFields + k] = planes[k][j], the inverse of aosToSoa().
+ *
+ * @tparam T  4-byte element type (float, std::int32_t, std::uint32_t)
+ * @param [in] planes  nFields planes of at least n elements
+ * @param [in] n  Number of records
+ * @param [in] nFields  Number of elements per record
+ * @param [out] aos  Records of nFields elements each
+ */
+template<typename T>
+static inline void
+soaToAos(const T* const* planes, std::size_t n, std::size_t nFields, T* aos) noexcept
+{
+  static_assert(sizeof(T) == 4 && std::is_trivially_copyable<T>::value, "Element type must be a 4-byte trivially copyable type");
+  static const Dispatcher<void(const T* const*, std::size_t, std::size_t, T*)> dispatcher{
+    {IsaLevel::kAvx512, &LayoutAvx512::soaToAos<T>},
+    {IsaLevel::kAvx2, &LayoutAvx2::soaToAos<T>},
+    {IsaLevel::kSse42, &LayoutSse42::soaToAos<T>},
+    {IsaLevel::kScalar, &LayoutScalar::soaToAos<T>}};
+  dispatcher(planes, n, nFields, aos);
+}
+
+
+}  // namespace simdutil
+
+
+#endif  // SIMDUTIL_LAYOUT_HPP
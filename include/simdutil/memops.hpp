@@ -0,0 +1,586 @@
+#ifndef SIMDUTIL_MEMOPS_HPP
+#define SIMDUTIL_MEMOPS_HPP
+
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#else
+#  include <immintrin.h>
+#endif  // defined(_MSC_VER)
+
+#include "cpuid.hpp"
+#include "dispatch.hpp"
+#include "vec.hpp"
+
+
+namespace simdutil
+{
+/*!
+ * @brief How copyMemory() and fillMemory() move the bytes
+ */
+enum class MemoryStrategy
+{
+  //! Choose from the size and MemoryThresholds
+  kAuto,
+  //! Vector loads and stores, aligned to the destination (std::memcpy / std::memset below two vectors)
+  kVector,
+  //! REP MOVSB / REP STOSB, which is microcoded into full cache line writes on ERMS CPUs
+  kRepString,
+  //! Non-temporal (streaming) stores that bypass the caches, followed by SFENCE
+  kNonTemporal
+};  // enum class MemoryStrategy
+
+
+/*!
+ * @brief Size thresholds between the strategies, derived from the cache hierarchy
+ *
+ * - Below repStringMinSize(), the vector loop wins, because REP MOVSB has a startup cost of a few dozen cycles.
+ *   The threshold is 1/16 of the L1 data cache (2 KiB on a 32 KiB L1D, the break-even point glibc measured).
+ *   FSRM only speeds up copies far below that, so it does not lower the threshold;
+ *   without ERMS or FSRM, REP string instructions are never chosen.
+ * - From nonTemporalMinSize() on, the destination would not fit in this thread's share of the last level cache anyway,
+ *   so writing it through the caches only evicts useful data and costs a read-for-ownership per line.
+ *   The threshold is 3/4 of the last level cache divided by the number of threads sharing it,
+ *   but never less than the L2 cache.
+ */
+class MemoryThresholds
+{
+public:
+  /*!
+   * @brief Get the process-wide thresholds
+   * @return  Reference to the thresholds
+   */
+  static const MemoryThresholds&
+  get()
+  {
+    static const MemoryThresholds instance;
+    return instance;
+  }
+
+  /*!
+   * @brief Get the smallest size copied or filled with REP MOVSB / REP STOSB
+   * @return  Size in bytes (std::numeric_limits<std::size_t>::max() without ERMS or FSRM)
+   */
+  std::size_t
+  repStringMinSize() const noexcept
+  {
+    return repStringMinSize_;
+  }
+
+  /*!
+   * @brief Get the smallest size copied or filled with non-temporal stores
+   * @return  Size in bytes
+   */
+  std::size_t
+  nonTemporalMinSize() const noexcept
+  {
+    return nonTemporalMinSize_;
+  }
+
+  /*!
+   * @brief Choose the strategy for a size
+   * @param [in] n  Number of bytes
+   * @return  MemoryStrategy::kVector, MemoryStrategy::kRepString or MemoryStrategy::kNonTemporal
+   */
+  MemoryStrategy
+  select(std::size_t n) const noexcept
+  {
+    return n >= nonTemporalMinSize_ ? MemoryStrategy::kNonTemporal
+      : n >= repStringMinSize_ ? MemoryStrategy::kRepString
+      : MemoryStrategy::kVector;
+  }
+
+private:
+  //! L1 data cache size assumed if CPUID does not report one
+  static constexpr std::size_t kDefaultL1Size = 32 * 1024;
+  //! Last level cache share assumed if CPUID does not report one
+  static constexpr std::size_t kDefaultLlcShare = 1024 * 1024;
+
+  MemoryThresholds()
+    : repStringMinSize_{std::numeric_limits<std::size_t>::max()}
+    , nonTemporalMinSize_{}
+  {
+    const auto& hierarchy = CacheHierarchy::get();
+    if (isErmsAvailable() || isFsrmAvailable()) {
+      const auto l1Size = hierarchy.dataCacheSize(1);
+      repStringMinSize_ = (l1Size != 0 ? l1Size : kDefaultL1Size) / 16;
+    }
+
+    std::size_t llcShare = 0;
+    for (int level = 4; level >= 2 && llcShare == 0; level--) {
+      const auto cache = hierarchy.findData(level);
+      if (cache != nullptr && cache->size != 0) {
+        llcShare = cache->size / static_cast<std::size_t>(cache->nSharingThreads > 0 ? cache->nSharingThreads : 1);
+      }
+    }
+    nonTemporalMinSize_ = llcShare != 0 ? llcShare / 4 * 3 : kDefaultLlcShare;
+    if (nonTemporalMinSize_ < hierarchy.dataCacheSize(2)) {
+      nonTemporalMinSize_ = hierarchy.dataCacheSize(2);
+    }
+  }
+
+  //! Smallest size for REP MOVSB / REP STOSB
+  std::size_t repStringMinSize_;
+  //! Smallest size for non-temporal stores
+  std::size_t nonTemporalMinSize_;
+};  // class MemoryThresholds
+
+constexpr std::size_t MemoryThresholds::kDefaultL1Size;
+constexpr std::size_t MemoryThresholds::kDefaultLlcShare;
+
+
+/*!
+ * @brief Copy with REP MOVSB
+ * @param [out] dst  Destination
+ * @param [in] src  Source (Must not overlap dst)
+ * @param [in] n  Number of bytes
+ */
+static inline void
+repMovsb(void* dst, const void* src, std::size_t n) noexcept
+{
+#if defined(_MSC_VER)
+  __movsb(static_cast<unsigned char*>(dst), static_cast<const unsigned char*>(src), n);
+#else
+  __asm__ __volatile__("rep movsb" : "+D"(dst), "+S"(src), "+c"(n) : : "memory");
+#endif  // defined(_MSC_VER)
+}
+
+
+/*!
+ * @brief Fill with REP STOSB
+ * @param [out] dst  Destination
+ * @param [in] value  Byte value
+ * @param [in] n  Number of bytes
+ */
+static inline void
+repStosb(void* dst, unsigned char value, std::size_t n) noexcept
+{
+#if defined(_MSC_VER)
+  __stosb(static_cast<unsigned char*>(dst), value, n);
+#else
+  __asm__ __volatile__("rep stosb" : "+D"(dst), "+c"(n) : "a"(value) : "memory");
+#endif  // defined(_MSC_VER)
+}
+
+
+/*!
+ * @brief Vector copy and fill loops, generic over the ISA
+ *
+ * Ops provides kWidth, the vector width in bytes, and single-vector and four-vector copy and fill primitives.
+ * The first and the last vector are stored unaligned and overlap the body, whose stores are aligned to kWidth;
+ * the non-temporal stores require that alignment.
+ * Sizes below two vectors are left to std::memcpy / std::memset.
+ */
+template<typename Ops>
+struct MemoryKernel
+{
+  template<bool kNonTemporal>
+  static void
+  copy(void* dst, const void* src, std::size_t n) noexcept
+  {
+    constexpr std::size_t kWidth = Ops::kWidth;
+    const auto d = static_cast<char*>(dst);
+    const auto s = static_cast<const char*>(src);
+    if (n < 2 * kWidth) {
+      std::memcpy(d, s, n);
+      return;
+    }
+    Ops::copyVector(d, s);
+    auto i = kWidth - (reinterpret_cast<std::uintptr_t>(d) & (kWidth - 1));
+    for (; i + 4 * kWidth <= n; i += 4 * kWidth) {
+      Ops::template copyBlock<kNonTemporal>(d + i, s + i);
+    }
+    for (; i + kWidth <= n; i += kWidth) {
+      Ops::copyVector(d + i, s + i);
+    }
+    Ops::copyVector(d + n - kWidth, s + n - kWidth);
+    if (kNonTemporal) {
+      Ops::fence();
+    }
+  }
+
+  template<bool kNonTemporal>
+  static void
+  fill(void* dst, unsigned char value, std::size_t n) noexcept
+  {
+    constexpr std::size_t kWidth = Ops::kWidth;
+    const auto d = static_cast<char*>(dst);
+    if (n < 2 * kWidth) {
+      std::memset(d, value, n);
+      return;
+    }
+    Ops::fillVector(d, value);
+    auto i = kWidth - (reinterpret_cast<std::uintptr_t>(d) & (kWidth - 1));
+    for (; i + 4 * kWidth <= n; i += 4 * kWidth) {
+      Ops::template fillBlock<kNonTemporal>(d + i, value);
+    }
+    for (; i + kWidth <= n; i += kWidth) {
+      Ops::fillVector(d + i, value);
+    }
+    Ops::fillVector(d + n - kWidth, value);
+    if (kNonTemporal) {
+      Ops::fence();
+    }
+  }
+};  // struct MemoryKernel
+
+
+/*!
+ * @brief Copy and fill without a vector ISA: the C library does the work
+ */
+struct MemopsScalar
+{
+  template<bool kNonTemporal>
+  static void
+  copy(void* dst, const void* src, std::size_t n) noexcept
+  {
+    std::memcpy(dst, src, n);
+  }
+
+  template<bool kNonTemporal>
+  static void
+  fill(void* dst, unsigned char value, std::size_t n) noexcept
+  {
+    std::memset(dst, value, n);
+  }
+};  // struct MemopsScalar
+
+
+/*!
+ * @brief SSE copy and fill primitives (16-byte vectors)
+ */
+struct MemopsSse42
+{
+  //! Vector width in bytes
+  static constexpr std::size_t kWidth = 16;
+
+  template<bool kNonTemporal>
+  SIMDUTIL_TARGET_SSE42 SIMDUTIL_FLATTEN static void
+  copy(void* dst, const void* src, std::size_t n) noexcept
+  {
+    MemoryKernel<MemopsSse42>::copy<kNonTemporal>(dst, src, n);
+  }
+
+  template<bool kNonTemporal>
+  SIMDUTIL_TARGET_SSE42 SIMDUTIL_FLATTEN static void
+  fill(void* dst, unsigned char value, std::size_t n) noexcept
+  {
+    MemoryKernel<MemopsSse42>::fill<kNonTemporal>(dst, value, n);
+  }
+
+  SIMDUTIL_TARGET_SSE42 static void
+  copyVector(char* dst, const char* src) noexcept
+  {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(static_cast<void*>(dst)), _mm_loadu_si128(reinterpret_cast<const __m128i*>(static_cast<const void*>(src))));
+  }
+
+  template<bool kNonTemporal>
+  SIMDUTIL_TARGET_SSE42 static void
+  copyBlock(char* dst, const char* src) noexcept
+  {
+    const auto v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(static_cast<const void*>(src)));
+    const auto v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(static_cast<const void*>(src + 16)));
+    const auto v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(static_cast<const void*>(src + 32)));
+    const auto v3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(static_cast<const void*>(src + 48)));
+    store<kNonTemporal>(dst, v0);
+    store<kNonTemporal>(dst + 16, v1);
+    store<kNonTemporal>(dst + 32, v2);
+    store<kNonTemporal>(dst + 48, v3);
+  }
+
+  SIMDUTIL_TARGET_SSE42 static void
+  fillVector(char* dst, unsigned char value) noexcept
+  {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(static_cast<void*>(dst)), _mm_set1_epi8(static_cast<char>(value)));
+  }
+
+  template<bool kNonTemporal>
+  SIMDUTIL_TARGET_SSE42 static void
+  fillBlock(char* dst, unsigned char value) noexcept
+  {
+    const auto v = _mm_set1_epi8(static_cast<char>(value));
+    store<kNonTemporal>(dst, v);
+    store<kNonTemporal>(dst + 16, v);
+    store<kNonTemporal>(dst + 32, v);
+    store<kNonTemporal>(dst + 48, v);
+  }
+
+  SIMDUTIL_TARGET_SSE42 static void
+  fence() noexcept
+  {
+    _mm_sfence();
+  }
+
+private:
+  template<bool kNonTemporal>
+  SIMDUTIL_TARGET_SSE42 static void
+  store(char* dst, const __m128i& v) noexcept
+  {
+    if (kNonTemporal) {
+      _mm_stream_si128(reinterpret_cast<__m128i*>(static_cast<void*>(dst)), v);
+    } else {
+      _mm_store_si128(reinterpret_cast<__m128i*>(static_cast<void*>(dst)), v);
+    }
+  }
+};  // struct MemopsSse42
+
+
+/*!
+ * @brief AVX2 copy and fill primitives (32-byte vectors)
+ */
+struct MemopsAvx2
+{
+  //! Vector width in bytes
+  static constexpr std::size_t kWidth = 32;
+
+  template<bool kNonTemporal>
+  SIMDUTIL_TARGET_AVX2 SIMDUTIL_FLATTEN static void
+  copy(void* dst, const void* src, std::size_t n) noexcept
+  {
+    MemoryKernel<MemopsAvx2>::copy<kNonTemporal>(dst, src, n);
+  }
+
+  template<bool kNonTemporal>
+  SIMDUTIL_TARGET_AVX2 SIMDUTIL_FLATTEN static void
+  fill(void* dst, unsigned char value, std::size_t n) noexcept
+  {
+    MemoryKernel<MemopsAvx2>::fill<kNonTemporal>(dst, value, n);
+  }
+
+  SIMDUTIL_TARGET_AVX2 static void
+  copyVector(char* dst, const char* src) noexcept
+  {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(static_cast<void*>(dst)), _mm256_loadu_si256(reinterpret_cast<const __m256i*>(static_cast<const void*>(src))));
+  }
+
+  template<bool kNonTemporal>
+  SIMDUTIL_TARGET_AVX2 static void
+  copyBlock(char* dst, const char* src) noexcept
+  {
+    const auto v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(static_cast<const void*>(src)));
+    const auto v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(static_cast<const void*>(src + 32)));
+    const auto v2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(static_cast<const void*>(src + 64)));
+    const auto v3 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(static_cast<const void*>(src + 96)));
+    store<kNonTemporal>(dst, v0);
+    store<kNonTemporal>(dst + 32, v1);
+    store<kNonTemporal>(dst + 64, v2);
+    store<kNonTemporal>(dst + 96, v3);
+  }
+
+  SIMDUTIL_TARGET_AVX2 static void
+  fillVector(char* dst, unsigned char value) noexcept
+  {
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(static_cast<void*>(dst)), _mm256_set1_epi8(static_cast<char>(value)));
+  }
+
+  template<bool kNonTemporal>
+  SIMDUTIL_TARGET_AVX2 static void
+  fillBlock(char* dst, unsigned char value) noexcept
+  {
+    const auto v = _mm256_set1_epi8(static_cast<char>(value));
+    store<kNonTemporal>(dst, v);
+    store<kNonTemporal>(dst + 32, v);
+    store<kNonTemporal>(dst + 64, v);
+    store<kNonTemporal>(dst + 96, v);
+  }
+
+  SIMDUTIL_TARGET_AVX2 static void
+  fence() noexcept
+  {
+    _mm_sfence();
+  }
+
+private:
+  template<bool kNonTemporal>
+  SIMDUTIL_TARGET_AVX2 static void
+  store(char* dst, const __m256i& v) noexcept
+  {
+    if (kNonTemporal) {
+      _mm256_stream_si256(reinterpret_cast<__m256i*>(static_cast<void*>(dst)), v);
+    } else {
+      _mm256_store_si256(reinterpret_cast<__m256i*>(static_cast<void*>(dst)), v);
+    }
+  }
+};  // struct MemopsAvx2
+
+
+/*!
+ * @brief AVX-512 copy and fill primitives (64-byte vectors, one cache line per store)
+ */
+struct MemopsAvx512
+{
+  //! Vector width in bytes
+  static constexpr std::size_t kWidth = 64;
+
+  template<bool kNonTemporal>
+  SIMDUTIL_TARGET_AVX512 SIMDUTIL_FLATTEN static void
+  copy(void* dst, const void* src, std::size_t n) noexcept
+  {
+    MemoryKernel<MemopsAvx512>::copy<kNonTemporal>(dst, src, n);
+  }
+
+  template<bool kNonTemporal>
+  SIMDUTIL_TARGET_AVX512 SIMDUTIL_FLATTEN static void
+  fill(void* dst, unsigned char value, std::size_t n) noexcept
+  {
+    MemoryKernel<MemopsAvx512>::fill<kNonTemporal>(dst, value, n);
+  }
+
+  SIMDUTIL_TARGET_AVX512 static void
+  copyVector(char* dst, const char* src) noexcept
+  {
+    _mm512_storeu_si512(dst, _mm512_loadu_si512(src));
+  }
+
+  template<bool kNonTemporal>
+  SIMDUTIL_TARGET_AVX512 static void
+  copyBlock(char* dst, const char* src) noexcept
+  {
+    const auto v0 = _mm512_loadu_si512(src);
+    const auto v1 = _mm512_loadu_si512(src + 64);
+    const auto v2 = _mm512_loadu_si512(src + 128);
+    const auto v3 = _mm512_loadu_si512(src + 192);
+    store<kNonTemporal>(dst, v0);
+    store<kNonTemporal>(dst + 64, v1);
+    store<kNonTemporal>(dst + 128, v2);
+    store<kNonTemporal>(dst + 192, v3);
+  }
+
+  SIMDUTIL_TARGET_AVX512 static void
+  fillVector(char* dst, unsigned char value) noexcept
+  {
+    _mm512_storeu_si512(dst, _mm512_set1_epi8(static_cast<char>(value)));
+  }
+
+  template<bool kNonTemporal>
+  SIMDUTIL_TARGET_AVX512 static void
+  fillBlock(char* dst, unsigned char value) noexcept
+  {
+    const auto v = _mm512_set1_epi8(static_cast<char>(value));
+    store<kNonTemporal>(dst, v);
+    store<kNonTemporal>(dst + 64, v);
+    store<kNonTemporal>(dst + 128, v);
+    store<kNonTemporal>(dst + 192, v);
+  }
+
+  SIMDUTIL_TARGET_AVX512 static void
+  fence() noexcept
+  {
+    _mm_sfence();
+  }
+
+private:
+  template<bool kNonTemporal>
+  SIMDUTIL_TARGET_AVX512 static void
+  store(char* dst, const __m512i& v) noexcept
+  {
+    if (kNonTemporal) {
+      _mm512_stream_si512(reinterpret_cast<__m512i*>(static_cast<void*>(dst)), v);
+    } else {
+      _mm512_store_si512(dst, v);
+    }
+  }
+};  // struct MemopsAvx512
+
+
+/*!
+ * @brief Copy memory, choosing between vector loops, REP MOVSB and non-temporal stores
+ *
+ * With MemoryStrategy::kAuto, MemoryThresholds::select() chooses from the size.
+ * Non-temporal copies are fenced (SFENCE) before returning, so they are ordered like ordinary stores.
+ *
+ * @param [out] dst  Destination
+ * @param [in] src  Source (Must not overlap dst)
+ * @param [in] n  Number of bytes
+ * @param [in] strategy  Strategy to use
+ * @return  dst
+ */
+static inline void*
+copyMemory(void* dst, const void* src, std::size_t n, MemoryStrategy strategy = MemoryStrategy::kAuto) noexcept
+{
+  static const Dispatcher<void(void*, const void*, std::size_t)> vectorDispatcher{
+    {IsaLevel::kAvx512, &MemopsAvx512::copy<false>},
+    {IsaLevel::kAvx2, &MemopsAvx2::copy<false>},
+    {IsaLevel::kSse42, &MemopsSse42::copy<false>},
+    {IsaLevel::kScalar, &MemopsScalar::copy<false>}};
+  static const Dispatcher<void(void*, const void*, std::size_t)> nonTemporalDispatcher{
+    {IsaLevel::kAvx512, &MemopsAvx512::copy<true>},
+    {IsaLevel::kAvx2, &MemopsAvx2::copy<true>},
+    {IsaLevel::kSse42, &MemopsSse42::copy<true>},
+    {IsaLevel::kScalar, &MemopsScalar::copy<true>}};
+  if (strategy == MemoryStrategy::kAuto) {
+    strategy = MemoryThresholds::get().select(n);
+  }
+  if (strategy == MemoryStrategy::kRepString) {
+    repMovsb(dst, src, n);
+  } else if (strategy == MemoryStrategy::kNonTemporal) {
+    nonTemporalDispatcher(dst, src, n);
+  } else {
+    vectorDispatcher(dst, src, n);
+  }
+  return dst;
+}
+
+
+/*!
+ * @brief Fill memory, choosing between vector loops, REP STOSB and non-temporal stores
+ *
+ * With MemoryStrategy::kAuto, MemoryThresholds::select() chooses from the size.
+ * Non-temporal fills are fenced (SFENCE) before returning, so they are ordered like ordinary stores.
+ *
+ * @param [out] dst  Destination
+ * @param [in] value  Byte value
+ * @param [in] n  Number of bytes
+ * @param [in] strategy  Strategy to use
+ * @return  dst
+ */
+static inline void*
+fillMemory(void* dst, unsigned char value, std::size_t n, MemoryStrategy strategy = MemoryStrategy::kAuto) noexcept
+{
+  static const Dispatcher<void(void*, unsigned char, std::size_t)> vectorDispatcher{
+    {IsaLevel::kAvx512, &MemopsAvx512::fill<false>},
+    {IsaLevel::kAvx2, &MemopsAvx2::fill<false>},
+    {IsaLevel::kSse42, &MemopsSse42::fill<false>},
+    {IsaLevel::kScalar, &MemopsScalar::fill<false>}};
+  static const Dispatcher<void(void*, unsigned char, std::size_t)> nonTemporalDispatcher{
+    {IsaLevel::kAvx512, &MemopsAvx512::fill<true>},
+    {IsaLevel::kAvx2, &MemopsAvx2::fill<true>},
+    {IsaLevel::kSse42, &MemopsSse42::fill<true>},
+    {IsaLevel::kScalar, &MemopsScalar::fill<true>}};
+  if (strategy == MemoryStrategy::kAuto) {
+    strategy = MemoryThresholds::get().select(n);
+  }
+  if (strategy == MemoryStrategy::kRepString) {
+    repStosb(dst, value, n);
+  } else if (strategy == MemoryStrategy::kNonTemporal) {
+    nonTemporalDispatcher(dst, value, n);
+  } else {
+    vectorDispatcher(dst, value, n);
+  }
+  return dst;
+}
+
+
+/*!
+ * @brief Zero memory, e.g. to reset a large buffer
+ * @param [out] dst  Destination
+ * @param [in] n  Number of bytes
+ * @param [in] strategy  Strategy to use
+ * @return  dst
+ */
+static inline void*
+zeroMemory(void* dst, std::size_t n, MemoryStrategy strategy = MemoryStrategy::kAuto) noexcept
+{
+  return fillMemory(dst, 0, n, strategy);
+}
+
+
+}  // namespace simdutil
+
+
+#endif  // SIMDUTIL_MEMOPS_HPP
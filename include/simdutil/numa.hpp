@@ -0,0 +1,338 @@
+#ifndef SIMDUTIL_NUMA_HPP
+#define SIMDUTIL_NUMA_HPP
+
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "allocator.hpp"
+#include "cpuid.hpp"
+
+#if defined(__linux__)
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#endif  // defined(__linux__)
+
+
+namespace simdutil
+{
+//! Maximum number of NUMA nodes handled by this header
+constexpr int kMaxNumaNodes = 1024;
+
+
+/*!
+ * @brief Thin wrappers of the Linux NUMA memory policy system calls, without depending on libnuma
+ */
+class NumaSyscall
+{
+public:
+  //! Memory policy: Allocate on the preferred node, falling back to others
+  static constexpr int kMpolPreferred = 1;
+  //! Memory policy: Allocate only on the specified nodes
+  static constexpr int kMpolBind = 2;
+  //! Memory policy: Interleave pages across the specified nodes
+  static constexpr int kMpolInterleave = 3;
+
+  //! Node mask for mbind()
+  using NodeMask = std::array<unsigned long, kMaxNumaNodes / (sizeof(unsigned long) * 8)>;
+
+  /*!
+   * @brief Set the memory policy of an address range
+   * @param [in] addr  Beginning of the range (page aligned)
+   * @param [in] len   Length of the range
+   * @param [in] mode  Memory policy
+   * @param [in] mask  Nodes of the policy
+   * @return  true if succeeded, otherwise false
+   */
+  static bool
+  mbind(void* addr, std::size_t len, int mode, const NodeMask& mask) noexcept
+  {
+#if defined(__linux__) && defined(SYS_mbind)
+    return ::syscall(SYS_mbind, addr, len, mode, mask.data(), static_cast<unsigned long>(kMaxNumaNodes + 1), 0U) == 0;
+#else
+    static_cast<void>(addr);
+    static_cast<void>(len);
+    static_cast<void>(mode);
+    static_cast<void>(mask);
+    return false;
+#endif  // defined(__linux__) && defined(SYS_mbind)
+  }
+
+  /*!
+   * @brief Set the memory policy of the calling thread
+   * @param [in] mode  Memory policy
+   * @param [in] mask  Nodes of the policy
+   * @return  true if succeeded, otherwise false
+   */
+  static bool
+  setMempolicy(int mode, const NodeMask& mask) noexcept
+  {
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+    return ::syscall(SYS_set_mempolicy, mode, mask.data(), static_cast<unsigned long>(kMaxNumaNodes + 1)) == 0;
+#else
+    static_cast<void>(mode);
+    static_cast<void>(mask);
+    return false;
+#endif  // defined(__linux__) && defined(SYS_set_mempolicy)
+  }
+
+  /*!
+   * @brief Make a node mask of one node
+   * @param [in] node  NUMA node
+   * @return  Node mask
+   */
+  static NodeMask
+  makeMask(int node) noexcept
+  {
+    NodeMask mask{};
+    if (node >= 0 && node < kMaxNumaNodes) {
+      const auto bits = static_cast<int>(sizeof(unsigned long) * 8);
+      mask[static_cast<std::size_t>(node / bits)] |= 1UL << (node % bits);
+    }
+    return mask;
+  }
+};  // class NumaSyscall
+
+
+/*!
+ * @brief Get the number of NUMA nodes
+ * @return  Number of possible NUMA nodes (1 on non-NUMA systems)
+ */
+static inline int
+getNumaNodeCount() noexcept
+{
+  static const int nNodes = []() {
+#if defined(__linux__)
+    // Format: "0" or "0-3"
+    std::ifstream ifs{"/sys/devices/system/node/possible"};
+    std::string s;
+    if (!(ifs >> s)) {
+      return 1;
+    }
+    const auto pos = s.find_last_of("-,");
+    const auto last = std::atoi(s.c_str() + (pos == std::string::npos ? 0 : pos + 1));
+    return std::min(std::max(last + 1, 1), kMaxNumaNodes);
+#else
+    return 1;
+#endif  // defined(__linux__)
+  }();
+  return nNodes;
+}
+
+/*!
+ * @brief Get the NUMA node of the CPU which executes the calling thread
+ * @return  NUMA node (0 if unknown)
+ */
+static inline int
+getCurrentNumaNode() noexcept
+{
+#if defined(__linux__) && defined(SYS_getcpu)
+  unsigned int cpu, node;
+  if (::syscall(SYS_getcpu, &cpu, &node, nullptr) == 0) {
+    return static_cast<int>(node);
+  }
+#endif  // defined(__linux__) && defined(SYS_getcpu)
+  return 0;
+}
+
+/*!
+ * @brief Get the NUMA node which backs an address
+ * @param [in] p  Address (its page must already be touched)
+ * @return  NUMA node, or -1 if the page is not present or the node is unknown
+ */
+static inline int
+getNumaNodeOfAddress(const void* p) noexcept
+{
+#if defined(__linux__) && defined(SYS_move_pages)
+  const auto pageSize = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+  void* page = reinterpret_cast<void*>(reinterpret_cast<std::uintptr_t>(p) & ~(pageSize - 1));
+  int status = -1;
+  // move_pages() with no target nodes only reports the node of each page
+  if (::syscall(SYS_move_pages, 0, 1UL, &page, nullptr, &status, 0) != 0 || status < 0) {
+    return -1;
+  }
+  return status;
+#else
+  static_cast<void>(p);
+  return -1;
+#endif  // defined(__linux__) && defined(SYS_move_pages)
+}
+
+/*!
+ * @brief Allocate page-aligned memory with a memory policy
+ * @param [in] nBytes  Memory size
+ * @param [in] mode    Memory policy (NumaSyscall::kMpol*)
+ * @param [in] mask    Nodes of the policy
+ * @return  Allocated memory, or nullptr on failure
+ */
+static inline void*
+numaMallocWithPolicy(std::size_t nBytes, int mode, const NumaSyscall::NodeMask& mask) noexcept
+{
+#if defined(__linux__)
+  const auto p = ::mmap(nullptr, nBytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (p == MAP_FAILED) {
+    return nullptr;
+  }
+  // Pages are placed when first touched, so the policy only has to be set before that.
+  // Failure (e.g. a kernel without NUMA support) leaves the default first-touch policy.
+  NumaSyscall::mbind(p, nBytes, mode, mask);
+  return p;
+#else
+  static_cast<void>(mode);
+  static_cast<void>(mask);
+  return alignedMalloc(nBytes, 4096);
+#endif  // defined(__linux__)
+}
+
+/*!
+ * @brief Allocate page-aligned memory on a NUMA node
+ * @param [in] nBytes  Memory size
+ * @param [in] node    NUMA node
+ * @return  Allocated memory, or nullptr on failure
+ */
+static inline void*
+numaMallocOnNode(std::size_t nBytes, int node) noexcept
+{
+  return numaMallocWithPolicy(nBytes, NumaSyscall::kMpolBind, NumaSyscall::makeMask(node));
+}
+
+/*!
+ * @brief Allocate page-aligned memory on the NUMA node of the calling thread
+ * @param [in] nBytes  Memory size
+ * @return  Allocated memory, or nullptr on failure
+ */
+static inline void*
+numaMallocLocal(std::size_t nBytes) noexcept
+{
+  return numaMallocOnNode(nBytes, getCurrentNumaNode());
+}
+
+/*!
+ * @brief Allocate page-aligned memory interleaved across all NUMA nodes
+ * @param [in] nBytes  Memory size
+ * @return  Allocated memory, or nullptr on failure
+ */
+static inline void*
+numaMallocInterleaved(std::size_t nBytes) noexcept
+{
+  NumaSyscall::NodeMask mask{};
+  for (int node = 0; node < getNumaNodeCount(); node++) {
+    const auto nodeMask = NumaSyscall::makeMask(node);
+    std::transform(mask.begin(), mask.end(), nodeMask.begin(), mask.begin(), [](unsigned long x, unsigned long y) {
+      return x | y;
+    });
+  }
+  return numaMallocWithPolicy(nBytes, NumaSyscall::kMpolInterleave, mask);
+}
+
+/*!
+ * @brief Free memory allocated by numaMalloc*()
+ * @param [in] ptr     Memory to free
+ * @param [in] nBytes  Size which was passed to numaMalloc*()
+ */
+static inline void
+numaFree(void* ptr, std::size_t nBytes) noexcept
+{
+  if (ptr == nullptr) {
+    return;
+  }
+#if defined(__linux__)
+  ::munmap(ptr, nBytes);
+#else
+  static_cast<void>(nBytes);
+  alignedFree(ptr);
+#endif  // defined(__linux__)
+}
+
+/*!
+ * @brief Custom deleter for std::unique_ptr or std::shared_ptr, for memory allocated by numaMalloc*()
+ */
+struct NumaDeleter
+{
+  //! Size which was passed to numaMalloc*()
+  std::size_t nBytes;
+
+  /*!
+   * @brief Operator: () for delete action
+   * @param [in,out] p  A pointer to memory
+   */
+  void
+  operator()(void* p) const noexcept
+  {
+    numaFree(p, nBytes);
+  }
+};  // struct NumaDeleter
+
+
+/*!
+ * @brief Initialize an array in parallel so that each part is first touched by the thread which will use it
+ *
+ * The array is split into cpus.size() contiguous parts, and part i is written by a thread pinned to cpus[i].
+ * Worker threads which later process part i on the same CPU (or NUMA node) then access local memory.
+ * The parts begin at page boundaries, so every page is touched by exactly one thread
+ * (as long as sizeof(T) divides the page size), and its placement does not depend on the scheduling.
+ *
+ * @param [out] data   Array to initialize
+ * @param [in]  n      Number of elements
+ * @param [in]  value  Initial value
+ * @param [in]  cpus   OS processor indices of the threads (e.g. CpuTopology::get().physicalCoreCpus())
+ */
+template<typename T>
+static inline void
+parallelFirstTouch(T* data, std::size_t n, const T& value, const std::vector<int>& cpus)
+{
+  if (cpus.size() <= 1) {
+    std::fill(data, data + n, value);
+    return;
+  }
+#if defined(__linux__)
+  const auto pageSize = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+#else
+  const std::uintptr_t pageSize = 4096;
+#endif  // defined(__linux__)
+  const auto base = reinterpret_cast<std::uintptr_t>(data);
+  // First element of part i: the first one at or after the page boundary which follows an even split
+  const auto boundary = [=, &cpus](std::size_t i) {
+    if (i == cpus.size()) {
+      return n;
+    }
+    const auto address = (base + n * i / cpus.size() * sizeof(T) + pageSize - 1) & ~(pageSize - 1);
+    return std::min<std::size_t>((address - base + sizeof(T) - 1) / sizeof(T), n);
+  };
+  std::vector<std::thread> threads;
+  threads.reserve(cpus.size());
+  try {
+    for (std::size_t i = 0; i < cpus.size(); i++) {
+      const auto first = i == 0 ? std::size_t{0} : boundary(i);
+      const auto last = boundary(i + 1);
+      const auto cpu = cpus[i];
+      threads.emplace_back([=, &value]() {
+        setCurrentThreadAffinity(cpu);
+        std::fill(data + first, data + last, value);
+      });
+    }
+  } catch (...) {
+    // Destroying joinable threads would call std::terminate()
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    throw;
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+
+}  // namespace simdutil
+
+
+#endif  // SIMDUTIL_NUMA_HPP
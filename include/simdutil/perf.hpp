@@ -0,0 +1,726 @@
+#ifndef SIMDUTIL_PERF_HPP
+#define SIMDUTIL_PERF_HPP
+
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#else
+#  include <x86intrin.h>
+#endif  // defined(_MSC_VER)
+
+#if defined(__linux__)
+#  include <linux/perf_event.h>
+#  include <sys/ioctl.h>
+#  include <sys/mman.h>
+#  include <sys/syscall.h>
+#  include <unistd.h>
+#endif  // defined(__linux__)
+
+
+namespace simdutil
+{
+/*!
+ * @brief Hardware events counted by PerfEventGroup
+ */
+enum class PerfCounter
+{
+  //! Core cycles
+  kCycles,
+  //! Retired instructions
+  kInstructions,
+  //! L1 data cache read misses
+  kL1dMisses,
+  //! Last level cache misses
+  kLlcMisses,
+  //! Data TLB read misses
+  kDtlbMisses,
+  //! Mispredicted branches
+  kBranchMisses
+};  // enum class PerfCounter
+
+//! Number of PerfCounter values
+constexpr std::size_t kPerfCounterCount = static_cast<std::size_t>(PerfCounter::kBranchMisses) + 1;
+
+
+/*!
+ * @brief Get the name of a counter
+ * @param [in] counter  Counter
+ * @return  Name of the counter
+ */
+static inline const char*
+getPerfCounterName(PerfCounter counter) noexcept
+{
+  static const char* const kNames[kPerfCounterCount] = {
+    "cycles",
+    "instructions",
+    "l1d-misses",
+    "llc-misses",
+    "dtlb-misses",
+    "branch-misses"};
+  return kNames[static_cast<std::size_t>(counter)];
+}
+
+
+/*!
+ * @brief How PerfEventGroup reads the counters
+ */
+enum class PerfMode
+{
+  //! No hardware counters (not Linux, perf_event_open denied, or disabled by SIMDUTIL_PERF=off): only the TSC
+  kTscOnly,
+  //! read(2) of the group leader, one system call per sample; counts are scaled for multiplexing
+  kRead,
+  //! RDPMC from user space through the mmap'ed event pages, no system call; counts are not scaled
+  kRdpmc
+};  // enum class PerfMode
+
+
+/*!
+ * @brief Counter values at one point in time
+ */
+struct PerfSample
+{
+  //! Time stamp counter
+  std::uint64_t tsc;
+  //! Counter values (meaningful only for the counters in PerfEventGroup::counterMask())
+  std::array<std::uint64_t, kPerfCounterCount> counters;
+  //! false if the counters could not be read, in which case they are all zero
+  bool valid;
+};  // struct PerfSample
+
+
+/*!
+ * @brief Group of hardware counters of the calling thread, opened with perf_event_open
+ *
+ * All events are opened as one group led by the cycle counter, so they are scheduled on the PMU together
+ * and their ratios are consistent. Only user-space execution is counted (exclude_kernel, exclude_hv),
+ * which also lets the group open with perf_event_paranoid up to 2.
+ * Events the PMU does not support are left out; if the cycle counter itself cannot be opened,
+ * the group degrades to PerfMode::kTscOnly.
+ * When the kernel allows it (cap_user_rdpmc, i.e. /sys/bus/event_source/devices/cpu/rdpmc is not 0),
+ * samples are taken with RDPMC through the mmap'ed event pages instead of read(2).
+ * The mode is chosen once, so all samples of a group are comparable: kRead scales every count by
+ * time_enabled / time_running, while kRdpmc reports raw counts, also when it falls back to read(2)
+ * because the group is not on the PMU at that moment.
+ *
+ * The counters count the thread which constructed the object, so an instance must be used only by that thread.
+ */
+class PerfEventGroup
+{
+public:
+#if defined(__linux__)
+  //! Metadata page of an event, mmap'ed for RDPMC
+  using PerfEventPage = perf_event_mmap_page;
+#else
+  //! Metadata page of an event (unused)
+  using PerfEventPage = void;
+#endif  // defined(__linux__)
+
+  PerfEventGroup() noexcept
+    : fds_{}
+    , pages_{}
+    , groupIndex_{}
+    , mode_{PerfMode::kTscOnly}
+    , counterMask_{0}
+    , nOpened_{0}
+  {
+    fds_.fill(-1);
+    pages_.fill(nullptr);
+    open();
+  }
+
+  PerfEventGroup(const PerfEventGroup&) = delete;
+  PerfEventGroup& operator=(const PerfEventGroup&) = delete;
+
+  ~PerfEventGroup()
+  {
+    close();
+  }
+
+  /*!
+   * @brief Get how the counters are read
+   * @return  Read mode
+   */
+  PerfMode
+  mode() const noexcept
+  {
+    return mode_;
+  }
+
+  /*!
+   * @brief Get the counters which could be opened
+   * @return  Bit mask indexed by PerfCounter
+   */
+  std::uint32_t
+  counterMask() const noexcept
+  {
+    return counterMask_;
+  }
+
+  /*!
+   * @brief Read the TSC and all opened counters
+   * @param [out] sample  Counter values
+   */
+  void
+  read(PerfSample& sample) const noexcept
+  {
+    sample.counters.fill(0);
+    sample.valid = true;
+#if defined(__linux__)
+    if (mode_ == PerfMode::kRdpmc) {
+      sample.valid = readRdpmc(sample) || readGroup(sample, false);
+    } else if (mode_ == PerfMode::kRead) {
+      sample.valid = readGroup(sample, true);
+    }
+#endif  // defined(__linux__)
+    sample.tsc = __rdtsc();
+  }
+
+private:
+  /*!
+   * @brief Check whether hardware counters are disabled with the environment variable SIMDUTIL_PERF
+   * @return  true if SIMDUTIL_PERF is "0", "off" or "false"
+   */
+  static bool
+  isDisabledByEnvironment() noexcept
+  {
+    const auto value = std::getenv("SIMDUTIL_PERF");
+    return value != nullptr
+      && (std::strcmp(value, "0") == 0 || std::strcmp(value, "off") == 0 || std::strcmp(value, "false") == 0);
+  }
+
+#if defined(__linux__)
+  static int
+  openEvent(std::uint32_t type, std::uint64_t config, int groupFd) noexcept
+  {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = groupFd == -1 ? 1 : 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0UL));
+  }
+
+  static constexpr std::uint64_t
+  makeCacheConfig(std::uint64_t cache, std::uint64_t op, std::uint64_t result) noexcept
+  {
+    return cache | (op << 8) | (result << 16);
+  }
+
+  void
+  open() noexcept
+  {
+    if (isDisabledByEnvironment()) {
+      return;
+    }
+    static const std::uint32_t kTypes[kPerfCounterCount] = {
+      PERF_TYPE_HARDWARE,
+      PERF_TYPE_HARDWARE,
+      PERF_TYPE_HW_CACHE,
+      PERF_TYPE_HARDWARE,
+      PERF_TYPE_HW_CACHE,
+      PERF_TYPE_HARDWARE};
+    static const std::uint64_t kConfigs[kPerfCounterCount] = {
+      PERF_COUNT_HW_CPU_CYCLES,
+      PERF_COUNT_HW_INSTRUCTIONS,
+      makeCacheConfig(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS),
+      PERF_COUNT_HW_CACHE_MISSES,
+      makeCacheConfig(PERF_COUNT_HW_CACHE_DTLB, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS),
+      PERF_COUNT_HW_BRANCH_MISSES};
+
+    for (std::size_t i = 0; i < kPerfCounterCount; i++) {
+      fds_[i] = openEvent(kTypes[i], kConfigs[i], i == 0 ? -1 : fds_[0]);
+      if (fds_[i] == -1) {
+        if (i == 0) {
+          return;
+        }
+        continue;
+      }
+      // Position of this event in the values of a group read
+      groupIndex_[i] = nOpened_++;
+      counterMask_ |= 1U << i;
+    }
+
+    mode_ = PerfMode::kRead;
+    const auto pageSize = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    bool canRdpmc = true;
+    for (std::size_t i = 0; i < kPerfCounterCount; i++) {
+      if (fds_[i] == -1) {
+        continue;
+      }
+      const auto page = ::mmap(nullptr, pageSize, PROT_READ, MAP_SHARED, fds_[i], 0);
+      if (page == MAP_FAILED) {
+        canRdpmc = false;
+        break;
+      }
+      pages_[i] = static_cast<const PerfEventPage*>(page);
+      canRdpmc = canRdpmc && pages_[i]->cap_user_rdpmc != 0;
+    }
+    ::ioctl(fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ::ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    if (canRdpmc) {
+      mode_ = PerfMode::kRdpmc;
+    }
+  }
+
+  void
+  close() noexcept
+  {
+    const auto pageSize = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    for (std::size_t i = kPerfCounterCount; i > 0; i--) {
+      if (pages_[i - 1] != nullptr) {
+        ::munmap(const_cast<PerfEventPage*>(pages_[i - 1]), pageSize);
+      }
+      if (fds_[i - 1] != -1) {
+        ::close(fds_[i - 1]);
+      }
+    }
+  }
+
+  /*!
+   * @brief Read the counters with RDPMC, following the seqlock protocol of perf_event_mmap_page
+   * @param [out] sample  Counter values
+   * @return  true if succeeded, false if an event is not on a hardware counter right now
+   */
+  bool
+  readRdpmc(PerfSample& sample) const noexcept
+  {
+    for (std::size_t i = 0; i < kPerfCounterCount; i++) {
+      const auto page = pages_[i];
+      if (page == nullptr) {
+        continue;
+      }
+      std::uint32_t seq;
+      std::uint64_t count;
+      do {
+        seq = page->lock;
+        __asm__ __volatile__("" : : : "memory");
+        const auto index = page->index;
+        if (index == 0) {
+          return false;
+        }
+        const auto width = page->pmc_width;
+        count = static_cast<std::uint64_t>(page->offset);
+        // The counter is pmc_width bits wide; sign-extend it before adding to the offset
+        auto pmc = static_cast<std::int64_t>(__rdpmc(static_cast<int>(index - 1)) << (64 - width));
+        pmc >>= 64 - width;
+        count += static_cast<std::uint64_t>(pmc);
+        __asm__ __volatile__("" : : : "memory");
+      } while (page->lock != seq);
+      sample.counters[i] = count;
+    }
+    return true;
+  }
+
+  /*!
+   * @brief Read the counters with one read(2) of the group leader
+   * @param [out] sample  Counter values
+   * @param [in] scaled  true to scale the counts by time_enabled / time_running for multiplexing
+   * @return  true if succeeded, otherwise false
+   */
+  bool
+  readGroup(PerfSample& sample, bool scaled) const noexcept
+  {
+    // Layout of PERF_FORMAT_GROUP with total times: nr, time_enabled, time_running, values[nr]
+    std::array<std::uint64_t, 3 + kPerfCounterCount> buffer{};
+    const auto nRead = ::read(fds_[0], buffer.data(), sizeof(buffer));
+    const auto timeEnabled = buffer[1];
+    const auto timeRunning = buffer[2];
+    if (nRead < static_cast<ssize_t>(3 * sizeof(std::uint64_t)) || (scaled && timeRunning == 0)) {
+      return false;
+    }
+    const auto isScaled = scaled && timeEnabled != timeRunning;
+    const auto scale = isScaled ? static_cast<double>(timeEnabled) / static_cast<double>(timeRunning) : 1.0;
+    for (std::size_t i = 0; i < kPerfCounterCount; i++) {
+      if ((counterMask_ & (1U << i)) != 0 && groupIndex_[i] < buffer[0]) {
+        const auto value = buffer[3 + groupIndex_[i]];
+        sample.counters[i] = isScaled ? static_cast<std::uint64_t>(static_cast<double>(value) * scale) : value;
+      }
+    }
+    return true;
+  }
+
+#else
+  void
+  open() noexcept
+  {
+    static_cast<void>(isDisabledByEnvironment());
+  }
+
+  void
+  close() noexcept
+  {}
+#endif  // defined(__linux__)
+
+  //! File descriptors of the events (-1 if not opened)
+  std::array<int, kPerfCounterCount> fds_;
+  //! mmap'ed pages of the events for RDPMC
+  std::array<const PerfEventPage*, kPerfCounterCount> pages_;
+  //! Position of each event in the values of a group read
+  std::array<std::size_t, kPerfCounterCount> groupIndex_;
+  //! How the counters are read
+  PerfMode mode_;
+  //! Opened counters, indexed by PerfCounter
+  std::uint32_t counterMask_;
+  //! Number of opened events
+  std::size_t nOpened_;
+};  // class PerfEventGroup
+
+
+/*!
+ * @brief Accumulated counters of a profiling region
+ */
+struct ProfileStats
+{
+  //! Number of times the region was executed
+  std::uint64_t count;
+  //! Total TSC ticks
+  std::uint64_t tscTicks;
+  //! Total counter deltas
+  std::array<std::uint64_t, kPerfCounterCount> counters;
+  //! Counters valid for every contributing thread, indexed by PerfCounter
+  std::uint32_t counterMask;
+
+  /*!
+   * @brief Add the statistics of another thread or executions
+   * @param [in] other  Statistics to add
+   */
+  void
+  merge(const ProfileStats& other) noexcept
+  {
+    counterMask = count == 0 ? other.counterMask : counterMask & other.counterMask;
+    count += other.count;
+    tscTicks += other.tscTicks;
+    for (std::size_t i = 0; i < kPerfCounterCount; i++) {
+      counters[i] += other.counters[i];
+    }
+  }
+};  // struct ProfileStats
+
+
+class ProfileThreadState;
+
+
+/*!
+ * @brief Process-wide collection of the per-thread profiling tables
+ *
+ * Each thread accumulates its regions into its own table (see ProfileRegion);
+ * snapshot() and dump() merge the tables of all live threads with the ones of exited threads, by region name.
+ */
+class ProfileRegistry
+{
+public:
+  /*!
+   * @brief Get the process-wide registry
+   * @return  Reference to the registry
+   */
+  static ProfileRegistry&
+  get()
+  {
+    static ProfileRegistry instance;
+    return instance;
+  }
+
+  ProfileRegistry(const ProfileRegistry&) = delete;
+  ProfileRegistry& operator=(const ProfileRegistry&) = delete;
+
+  /*!
+   * @brief Merge the statistics of all threads
+   * @return  Statistics by region name
+   */
+  std::map<std::string, ProfileStats> snapshot() const;
+
+  /*!
+   * @brief Write the statistics of all threads as a table, one region per line
+   *
+   * Columns are per execution of the region; counters unavailable on some contributing thread are shown as "-".
+   *
+   * @param [out] os  Output stream
+   */
+  void
+  dump(std::ostream& os) const
+  {
+    const auto stats = snapshot();
+    std::ostringstream oss;
+    oss << std::fixed << std::left << std::setw(32) << "region" << std::right
+      << ' ' << std::setw(10) << "count"
+      << ' ' << std::setw(14) << "tsc/call"
+      << ' ' << std::setw(14) << "cycles/call"
+      << ' ' << std::setw(8) << "ipc"
+      << ' ' << std::setw(12) << "l1d-miss/call"
+      << ' ' << std::setw(12) << "llc-miss/call"
+      << ' ' << std::setw(12) << "dtlb-miss/call"
+      << ' ' << std::setw(12) << "br-miss/call" << '\n';
+    for (const auto& entry : stats) {
+      const auto& s = entry.second;
+      const auto n = static_cast<double>(std::max<std::uint64_t>(s.count, 1));
+      // Counters unavailable on some contributing thread are shown as "-"
+      const auto perCall = [&oss, &s, n](PerfCounter counter, int width) -> std::ostream& {
+        const auto i = static_cast<std::size_t>(counter);
+        oss << ' ' << std::setw(width);
+        if ((s.counterMask & (1U << i)) == 0) {
+          return oss << "-";
+        }
+        return oss << std::setprecision(1) << static_cast<double>(s.counters[i]) / n;
+      };
+      oss << std::left << std::setw(32) << entry.first << std::right
+        << ' ' << std::setw(10) << s.count
+        << ' ' << std::setw(14) << std::setprecision(1) << static_cast<double>(s.tscTicks) / n;
+      perCall(PerfCounter::kCycles, 14);
+      oss << ' ' << std::setw(8);
+      if ((s.counterMask & 3U) == 3U && s.counters[0] != 0) {
+        oss << std::setprecision(2) << static_cast<double>(s.counters[1]) / static_cast<double>(s.counters[0]);
+      } else {
+        oss << "-";
+      }
+      perCall(PerfCounter::kL1dMisses, 12);
+      perCall(PerfCounter::kLlcMisses, 12);
+      perCall(PerfCounter::kDtlbMisses, 12);
+      perCall(PerfCounter::kBranchMisses, 12) << '\n';
+    }
+    os << oss.str();
+  }
+
+  /*!
+   * @brief Clear the statistics of all threads
+   */
+  void reset();
+
+private:
+  friend class ProfileThreadState;
+
+  ProfileRegistry()
+    : mutex_{}
+    , threads_{}
+    , retired_{}
+  {}
+
+  void
+  attach(ProfileThreadState* state)
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    threads_.push_back(state);
+  }
+
+  void detach(ProfileThreadState* state);
+
+  //! Protects threads_ and retired_
+  mutable std::mutex mutex_;
+  //! Tables of live threads
+  std::vector<ProfileThreadState*> threads_;
+  //! Merged statistics of exited threads
+  std::map<std::string, ProfileStats> retired_;
+};  // class ProfileRegistry
+
+
+/*!
+ * @brief Counters and profiling table of one thread
+ *
+ * Regions are keyed by the address of their name, which avoids hashing the string on every exit;
+ * equal names at different addresses are merged when the table is read.
+ */
+class ProfileThreadState
+{
+public:
+  /*!
+   * @brief Get the state of the calling thread, opening its counters on first use
+   * @return  Reference to the state of the calling thread
+   */
+  static ProfileThreadState&
+  current()
+  {
+    static thread_local ProfileThreadState state;
+    return state;
+  }
+
+  ProfileThreadState(const ProfileThreadState&) = delete;
+  ProfileThreadState& operator=(const ProfileThreadState&) = delete;
+
+  ~ProfileThreadState()
+  {
+    ProfileRegistry::get().detach(this);
+  }
+
+  const PerfEventGroup& group() const noexcept { return group_; }
+
+  /*!
+   * @brief Read the counters of this thread
+   * @param [out] sample  Counter values
+   */
+  void
+  read(PerfSample& sample) const noexcept
+  {
+    group_.read(sample);
+  }
+
+  /*!
+   * @brief Accumulate one execution of a region
+   *
+   * An execution whose start or end sample is not valid is dropped, since its counter deltas would be garbage.
+   *
+   * @param [in] name  Region name
+   * @param [in] start  Sample at the region entry
+   * @param [in] end  Sample at the region exit
+   */
+  void
+  record(const char* name, const PerfSample& start, const PerfSample& end)
+  {
+    if (!start.valid || !end.valid) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock{mutex_};
+    auto& stats = table_[name];
+    stats.counterMask = group_.counterMask();
+    stats.count++;
+    stats.tscTicks += end.tsc - start.tsc;
+    for (std::size_t i = 0; i < kPerfCounterCount; i++) {
+      stats.counters[i] += end.counters[i] - start.counters[i];
+    }
+  }
+
+  /*!
+   * @brief Merge the table of this thread by region name
+   * @param [in,out] stats  Statistics to add to
+   */
+  void
+  mergeInto(std::map<std::string, ProfileStats>& stats) const
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    for (const auto& entry : table_) {
+      stats[entry.first].merge(entry.second);
+    }
+  }
+
+  /*!
+   * @brief Clear the table of this thread
+   */
+  void
+  clear()
+  {
+    std::lock_guard<std::mutex> lock{mutex_};
+    table_.clear();
+  }
+
+private:
+  ProfileThreadState()
+    : group_{}
+    , mutex_{}
+    , table_{}
+  {
+    ProfileRegistry::get().attach(this);
+  }
+
+  //! Hardware counters of this thread
+  PerfEventGroup group_;
+  //! Protects table_ against snapshot() from other threads; uncontended on the recording path
+  mutable std::mutex mutex_;
+  //! Statistics by the address of the region name
+  std::unordered_map<const char*, ProfileStats> table_;
+};  // class ProfileThreadState
+
+
+inline std::map<std::string, ProfileStats>
+ProfileRegistry::snapshot() const
+{
+  std::lock_guard<std::mutex> lock{mutex_};
+  auto stats = retired_;
+  for (const auto state : threads_) {
+    state->mergeInto(stats);
+  }
+  return stats;
+}
+
+inline void
+ProfileRegistry::reset()
+{
+  std::lock_guard<std::mutex> lock{mutex_};
+  retired_.clear();
+  for (const auto state : threads_) {
+    state->clear();
+  }
+}
+
+inline void
+ProfileRegistry::detach(ProfileThreadState* state)
+{
+  std::lock_guard<std::mutex> lock{mutex_};
+  state->mergeInto(retired_);
+  threads_.erase(std::remove(threads_.begin(), threads_.end(), state), threads_.end());
+}
+
+
+/*!
+ * @brief Scoped profiling region: counts the TSC and the hardware counters from construction to destruction
+ *
+ * Executions are accumulated by name in the table of the calling thread; regions may nest,
+ * and each reports inclusive counts. Read the results with ProfileRegistry::get().dump().
+ *
+ * @code
+ * {
+ *   simdutil::ProfileRegion region{"reduceSum"};
+ *   s = simdutil::reduceSum(p, n);
+ * }
+ * simdutil::ProfileRegistry::get().dump(std::cerr);
+ * @endcode
+ */
+class ProfileRegion
+{
+public:
+  /*!
+   * @brief Enter a region
+   * @param [in] name  Region name (Must outlive the thread, e.g. a string literal)
+   */
+  explicit ProfileRegion(const char* name)
+    : state_(ProfileThreadState::current())
+    , name_{name}
+    , start_{}
+  {
+    state_.read(start_);
+  }
+
+  ProfileRegion(const ProfileRegion&) = delete;
+  ProfileRegion& operator=(const ProfileRegion&) = delete;
+
+  /*!
+   * @brief Leave the region and record it
+   */
+  ~ProfileRegion()
+  {
+    PerfSample end;
+    state_.read(end);
+    state_.record(name_, start_, end);
+  }
+
+private:
+  //! State of the thread which entered the region
+  ProfileThreadState& state_;
+  //! Region name
+  const char* name_;
+  //! Sample at the region entry
+  PerfSample start_;
+};  // class ProfileRegion
+
+
+}  // namespace simdutil
+
+
+#endif  // SIMDUTIL_PERF_HPP
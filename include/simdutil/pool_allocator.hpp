@@ -0,0 +1,395 @@
+#ifndef SIMDUTIL_POOL_ALLOCATOR_HPP
+#define SIMDUTIL_POOL_ALLOCATOR_HPP
+
+
+#include <array>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+#include "allocator.hpp"
+
+
+namespace simdutil
+{
+/*!
+ * @brief Get the index of the power-of-two size class which serves a request
+ * @param [in] nBytes        Requested size
+ * @param [in] minBlockSize  Size of the smallest size class
+ * @return  Size class index (block size is minBlockSize << index)
+ */
+static inline constexpr std::size_t
+getPow2ClassIndex(std::size_t nBytes, std::size_t minBlockSize) noexcept
+{
+  return nBytes <= minBlockSize ? 0 : 1 + getPow2ClassIndex((nBytes + 1) / 2, minBlockSize);
+}
+
+
+/*!
+ * @brief Process-wide aligned memory pool with power-of-two size classes
+ *
+ * Each thread keeps a free list (magazine) per size class, so allocation and deallocation
+ * of small blocks take no lock.
+ * When a thread cache runs empty or overflows, a whole magazine is exchanged with a global depot.
+ * New blocks are carved from large chunks obtained by alignedMalloc(), and blocks larger than kMaxBlockSize
+ * go to alignedMalloc() directly.
+ * Chunks are reused but never returned to the system.
+ *
+ * Every block is aligned to kAlignment because every size class is a multiple of kAlignment.
+ */
+template<std::size_t kAlignment>
+class AlignedPool
+{
+  static_assert(kAlignment != 0 && (kAlignment & (kAlignment - 1)) == 0, "Alignment must be power of 2");
+
+public:
+  //! Size of the smallest size class
+  static constexpr std::size_t kMinBlockSize = kAlignment < sizeof(void*) ? sizeof(void*) : kAlignment;
+  //! Size of the largest size class
+  static constexpr std::size_t kMaxBlockSize = kMinBlockSize < 32768 ? 32768 : kMinBlockSize;
+  //! Size of chunks to carve blocks from
+  static constexpr std::size_t kChunkSize = kMaxBlockSize * 4;
+  //! Number of bytes a thread caches per size class before it returns a magazine to the depot
+  static constexpr std::size_t kMagazineBytes = kMaxBlockSize * 2;
+
+  /*!
+   * @brief Allocate an aligned block
+   * @param [in] nBytes  Block size
+   * @return  Aligned block, or nullptr on failure
+   */
+  static void*
+  allocate(std::size_t nBytes) noexcept
+  {
+    if (nBytes > kMaxBlockSize) {
+      return alignedMalloc(nBytes, kMinBlockSize);
+    }
+    const auto index = getClassIndex(nBytes);
+    if (isThreadCacheDestroyed()) {
+      // Called from a thread_local destructor after the thread cache has gone
+      FreeList list{nullptr, 0};
+      if (!refill(index, list)) {
+        return nullptr;
+      }
+      const auto node = take(list);
+      if (list.head != nullptr) {
+        getDepot().push(index, list);
+      }
+      return node;
+    }
+    auto& list = getThreadCache().lists[index];
+    if (list.head == nullptr && !refill(index, list)) {
+      return nullptr;
+    }
+    return take(list);
+  }
+
+  /*!
+   * @brief Free a block allocated by allocate()
+   * @param [in] p       Block to free
+   * @param [in] nBytes  Size which was passed to allocate()
+   */
+  static void
+  deallocate(void* p, std::size_t nBytes) noexcept
+  {
+    if (p == nullptr) {
+      return;
+    }
+    if (nBytes > kMaxBlockSize) {
+      alignedFree(p);
+      return;
+    }
+    const auto index = getClassIndex(nBytes);
+    if (isThreadCacheDestroyed()) {
+      // Called from a thread_local destructor after the thread cache has gone
+      FreeList list{static_cast<Node*>(p), 1};
+      list.head->next = nullptr;
+      getDepot().push(index, list);
+      return;
+    }
+    auto& list = getThreadCache().lists[index];
+    auto node = static_cast<Node*>(p);
+    node->next = list.head;
+    list.head = node;
+    list.count++;
+    if (list.count >= getMagazineCapacity(index) * 2) {
+      getDepot().push(index, split(list, getMagazineCapacity(index)));
+    }
+  }
+
+  /*!
+   * @brief Get the block size of the size class which serves a request
+   * @param [in] nBytes  Requested size
+   * @return  Actual block size (nBytes itself if it is served by alignedMalloc())
+   */
+  static constexpr std::size_t
+  getBlockSize(std::size_t nBytes) noexcept
+  {
+    return nBytes > kMaxBlockSize ? nBytes : kMinBlockSize << getClassIndex(nBytes);
+  }
+
+private:
+  //! Free block
+  struct Node
+  {
+    //! Next free block
+    Node* next;
+  };  // struct Node
+
+  //! Singly-linked list of free blocks
+  struct FreeList
+  {
+    //! First block
+    Node* head;
+    //! Number of blocks
+    std::size_t count;
+  };  // struct FreeList
+
+  //! Number of size classes
+  static constexpr std::size_t kNClasses = getPow2ClassIndex(kMaxBlockSize, kMinBlockSize) + 1;
+
+  //! Free lists of one thread
+  struct ThreadCache
+  {
+    //! Free list per size class
+    std::array<FreeList, kNClasses> lists;
+
+    ThreadCache() noexcept
+      : lists{}
+    {}
+
+    ~ThreadCache()
+    {
+      isThreadCacheDestroyed() = true;
+      for (std::size_t i = 0; i < lists.size(); i++) {
+        if (lists[i].head != nullptr) {
+          getDepot().push(i, lists[i]);
+        }
+      }
+    }
+  };  // struct ThreadCache
+
+  //! Magazines shared by all threads
+  class Depot
+  {
+  public:
+    Depot() noexcept
+      : mutex_{}
+      , magazines_{}
+    {}
+
+    void
+    push(std::size_t index, const FreeList& list) noexcept
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      try {
+        magazines_[index].push_back(list);
+      } catch (...) {
+        // Could not record the magazine; its blocks are leaked
+      }
+    }
+
+    bool
+    pop(std::size_t index, FreeList& list) noexcept
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      auto& magazines = magazines_[index];
+      if (magazines.empty()) {
+        return false;
+      }
+      list = magazines.back();
+      magazines.pop_back();
+      return true;
+    }
+
+  private:
+    //! Mutex for magazines_
+    std::mutex mutex_;
+    //! Magazines per size class
+    std::array<std::vector<FreeList>, kNClasses> magazines_;
+  };  // class Depot
+
+  static constexpr std::size_t
+  getClassIndex(std::size_t nBytes) noexcept
+  {
+    return getPow2ClassIndex(nBytes, kMinBlockSize);
+  }
+
+  static constexpr std::size_t
+  getMagazineCapacity(std::size_t index) noexcept
+  {
+    return (kMagazineBytes / (kMinBlockSize << index)) < 4 ? 4 : kMagazineBytes / (kMinBlockSize << index);
+  }
+
+  static ThreadCache&
+  getThreadCache() noexcept
+  {
+    static thread_local ThreadCache cache;
+    return cache;
+  }
+
+  static bool&
+  isThreadCacheDestroyed() noexcept
+  {
+    static thread_local bool isDestroyed = false;
+    return isDestroyed;
+  }
+
+  static Depot&
+  getDepot() noexcept
+  {
+    // Never destroyed, so that blocks freed during static destruction stay valid
+    static Depot* const depot = new Depot{};
+    return *depot;
+  }
+
+  static Node*
+  take(FreeList& list) noexcept
+  {
+    const auto node = list.head;
+    list.head = node->next;
+    list.count--;
+    return node;
+  }
+
+  static FreeList
+  split(FreeList& list, std::size_t n) noexcept
+  {
+    FreeList result{list.head, n};
+    auto last = list.head;
+    for (std::size_t i = 1; i < n; i++) {
+      last = last->next;
+    }
+    list.head = last->next;
+    list.count -= n;
+    last->next = nullptr;
+    return result;
+  }
+
+  static bool
+  refill(std::size_t index, FreeList& list) noexcept
+  {
+    if (getDepot().pop(index, list)) {
+      return true;
+    }
+    const auto blockSize = kMinBlockSize << index;
+    const auto chunk = alignedMalloc<unsigned char>(kChunkSize, kMinBlockSize);
+    if (chunk == nullptr) {
+      return false;
+    }
+    const auto nBlocks = kChunkSize / blockSize;
+    for (std::size_t i = 0; i < nBlocks; i++) {
+      auto node = static_cast<Node*>(static_cast<void*>(chunk + (nBlocks - 1 - i) * blockSize));
+      node->next = list.head;
+      list.head = node;
+    }
+    list.count += nBlocks;
+    return true;
+  }
+};  // class AlignedPool
+
+
+/*!
+ * @brief Custom allocator for STL. This class allocates aligned memory from AlignedPool.
+ */
+template<
+  typename T,
+  std::size_t kAlignment = alignOf<T>()
+>
+class PoolAllocator
+{
+public:
+  //! Element type
+  using value_type = T;
+  //! Size type
+  using size_type = std::size_t;
+  //! Pointer type
+  using pointer = typename std::add_pointer<value_type>::type;
+  //! Const pointer type
+  using const_pointer = typename std::add_pointer<const value_type>::type;
+
+  /*!
+   * @brief Definition for rebinded allocator.
+   *
+   * This definition is neccessary because type parameter of this class is not only one.
+   */
+  template<class U>
+  struct rebind
+  {
+    //! Rebinded allocator type
+    using other = PoolAllocator<U, kAlignment>;
+  };
+
+  /*!
+   * Default constructor
+   */
+  PoolAllocator() noexcept
+  {}
+
+  /*!
+   * Converting copy constructor
+   */
+  template<typename U>
+  PoolAllocator(const PoolAllocator<U, kAlignment>&) noexcept
+  {}
+
+  /*!
+   * @brief Allocate memory block for STL container
+   * @param [in] n     Number of elements to allocate
+   * @param [in] hint  Hint parameter (unused)
+   * @return  Pointer to aligned memroy
+   */
+  pointer
+  allocate(size_type n, const_pointer /* hint */ = nullptr) const
+  {
+    auto p = static_cast<pointer>(AlignedPool<kAlignment>::allocate(n * sizeof(value_type)));
+    if (p == nullptr) {
+      throw std::bad_alloc{};
+    }
+    return p;
+  }
+
+  /*!
+   * @brief Free allocated STL memory
+   * @param [in,out] p  Pointer to dynamic allocated memory
+   * @param [in]     n  Number of elements
+   */
+  void
+  deallocate(pointer p, size_type n) const noexcept
+  {
+    AlignedPool<kAlignment>::deallocate(p, n * sizeof(value_type));
+  }
+};  // class PoolAllocator
+
+
+template<
+  typename T,
+  std::size_t kAlignment1,
+  typename U,
+  std::size_t kAlignment2
+>
+static inline bool
+operator==(const PoolAllocator<T, kAlignment1>&, const PoolAllocator<U, kAlignment2>&) noexcept
+{
+  return kAlignment1 == kAlignment2;
+}
+
+
+template<
+  typename T,
+  std::size_t kAlignment1,
+  typename U,
+  std::size_t kAlignment2
+>
+static inline bool
+operator!=(const PoolAllocator<T, kAlignment1>& lhs, const PoolAllocator<U, kAlignment2>& rhs) noexcept
+{
+  return !(lhs == rhs);
+}
+
+
+}  // namespace simdutil
+
+
+#endif  // SIMDUTIL_POOL_ALLOCATOR_HPP
@@ -0,0 +1,328 @@
+#ifndef SIMDUTIL_PREFETCH_HPP
+#define SIMDUTIL_PREFETCH_HPP
+
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#else
+#  include <x86intrin.h>
+#endif  // defined(_MSC_VER)
+
+#include "allocator.hpp"
+#include "cache_padded.hpp"
+#include "cpuid.hpp"
+#include "tsc.hpp"
+
+
+namespace simdutil
+{
+/*!
+ * @brief Software prefetch instruction
+ */
+enum class PrefetchHint
+{
+  //! PREFETCHT0: into all cache levels
+  kT0,
+  //! PREFETCHT1: into L2 and outer levels
+  kT1,
+  //! PREFETCHT2: into L3 and outer levels (same as kT1 on most current CPUs)
+  kT2,
+  //! PREFETCHNTA: close to the core while minimizing pollution, for data used once
+  kNta,
+  //! PREFETCHW: into L1 in exclusive state, in anticipation of a write (See isPrefetchwAvailable())
+  kW,
+  //! PREFETCHWT1: into L2 in exclusive state (See isPrefetchwt1Available())
+  kWt1
+};  // enum class PrefetchHint
+
+
+/*!
+ * @brief Check whether a prefetch hint is supported by this CPU
+ *
+ * PREFETCHT0/T1/T2/NTA are part of SSE. PREFETCHW and PREFETCHWT1 execute as NOPs on Intel CPUs
+ * which do not enumerate them, so issuing them is harmless but useless there.
+ *
+ * @param [in] hint  Prefetch hint
+ * @return  true if available, otherwise false
+ */
+static inline bool
+isPrefetchHintAvailable(PrefetchHint hint) noexcept
+{
+  if (hint == PrefetchHint::kW) {
+    return isPrefetchwAvailable();
+  }
+  if (hint == PrefetchHint::kWt1) {
+    return isPrefetchwt1Available();
+  }
+  return true;
+}
+
+/*!
+ * @brief Prefetch the cache line which contains an address
+ *
+ * A prefetch never faults, so p may point past the end of an array.
+ *
+ * @tparam kHint  Prefetch instruction
+ * @param [in] p  Address to prefetch
+ */
+template<PrefetchHint kHint = PrefetchHint::kT0>
+static inline void
+prefetch(const void* p) noexcept
+{
+  const auto address = static_cast<const char*>(p);
+  if (kHint == PrefetchHint::kT0) {
+    _mm_prefetch(address, _MM_HINT_T0);
+  } else if (kHint == PrefetchHint::kT1) {
+    _mm_prefetch(address, _MM_HINT_T1);
+  } else if (kHint == PrefetchHint::kT2) {
+    _mm_prefetch(address, _MM_HINT_T2);
+  } else if (kHint == PrefetchHint::kNta) {
+    _mm_prefetch(address, _MM_HINT_NTA);
+  } else if (kHint == PrefetchHint::kW) {
+#if defined(_MSC_VER)
+    _m_prefetchw(address);
+#else
+    // The assembler accepts PREFETCHW without -mprfchw
+    __asm__("prefetchw %0" : : "m"(*address));
+#endif  // defined(_MSC_VER)
+  } else {
+#if defined(_MSC_VER)
+    _mm_prefetch(address, _MM_HINT_T1);
+#else
+    __asm__("prefetchwt1 %0" : : "m"(*address));
+#endif  // defined(_MSC_VER)
+  }
+}
+
+
+/*!
+ * @brief Prefetch distance calibrated from a memory latency probe
+ *
+ * The probe chases pointers through a random cycle of cache lines which are flushed beforehand,
+ * first one chain at a time (the latency of a miss to memory, page walks included),
+ * then kChains independent chains interleaved (the interval between misses when the core keeps
+ * as many misses in flight as its fill buffers allow).
+ * A loop which misses once per iteration runs at that interval once prefetches are far enough ahead,
+ * so the default distance is latency / interval iterations: about the number of misses the core overlaps,
+ * which differs between Intel and AMD cores and with the memory system.
+ *
+ * The probe takes tens of milliseconds, mostly page faults of its buffer. get() runs it on first use,
+ * so call it at startup rather than from a latency-sensitive path.
+ */
+class PrefetchDistance
+{
+public:
+  //! Number of independent chains of the throughput probe, more than the fill buffers of current cores
+  static constexpr std::size_t kChains = 32;
+  //! Default size of the probe buffer: more pages than the second level TLB covers
+  static constexpr std::size_t kProbeSize = 16 * 1024 * 1024;
+  //! Lower bound of distance()
+  static constexpr std::size_t kMinDistance = 4;
+  //! Upper bound of distance()
+  static constexpr std::size_t kMaxDistance = 64;
+
+  /*!
+   * @brief Get the process-wide calibration, measuring on first use
+   * @return  Reference to the calibration
+   */
+  static const PrefetchDistance&
+  get()
+  {
+    static const PrefetchDistance instance = measure();
+    return instance;
+  }
+
+  /*!
+   * @brief Run the memory latency probe
+   * @param [in] nBytes  Size of the probe buffer
+   * @return  Calibration
+   */
+  static PrefetchDistance
+  measure(std::size_t nBytes = kProbeSize)
+  {
+    // One node per kCachePadSize block, so that the adjacent-line prefetcher does not fetch another node
+    constexpr std::size_t kStride = kCachePadSize / sizeof(std::uint32_t);
+    const auto nNodes = std::max<std::size_t>(nBytes / kCachePadSize, (kChains + 1) * 2);
+    std::vector<std::uint32_t, AlignedAllocator<std::uint32_t, kCachePadSize>> nodes(nNodes * kStride);
+
+    // kChains + 1 disjoint random cycles: the first one for the latency, the others for the throughput
+    std::vector<std::uint32_t> order(nNodes);
+    std::iota(order.begin(), order.end(), 0U);
+    std::mt19937 engine{0x5eed};
+    std::shuffle(order.begin(), order.end(), engine);
+    const auto nHops = nNodes / (kChains + 1);
+    for (std::size_t chain = 0; chain <= kChains; chain++) {
+      const auto cycle = order.data() + chain * nHops;
+      for (std::size_t i = 0; i < nHops; i++) {
+        nodes[cycle[i] * kStride] = cycle[(i + 1) % nHops];
+      }
+    }
+    for (std::size_t i = 0; i < nNodes; i++) {
+      _mm_clflush(&nodes[i * kStride]);
+    }
+    _mm_mfence();
+
+    const auto& clock = TscClock::get();
+    auto position = order[0];
+    auto start = TscClock::start();
+    for (std::size_t i = 0; i < nHops; i++) {
+      position = nodes[position * kStride];
+    }
+    const auto latencyNs = clock.toNs(TscClock::stop() - start) / static_cast<double>(nHops);
+
+    std::array<std::uint32_t, kChains> positions;
+    for (std::size_t chain = 0; chain < kChains; chain++) {
+      positions[chain] = order[(chain + 1) * nHops];
+    }
+    start = TscClock::start();
+    for (std::size_t i = 0; i < nHops; i++) {
+      for (std::size_t chain = 0; chain < kChains; chain++) {
+        positions[chain] = nodes[positions[chain] * kStride];
+      }
+    }
+    const auto intervalNs = clock.toNs(TscClock::stop() - start) / static_cast<double>(nHops * kChains);
+
+    // Keep the chases alive
+    for (const auto p : positions) {
+      position ^= p;
+    }
+    sink() = position;
+    return PrefetchDistance{latencyNs, intervalNs};
+  }
+
+  /*!
+   * @brief Get the latency of a miss to memory
+   * @return  Latency in nanoseconds
+   */
+  double
+  latency() const noexcept
+  {
+    return latencyNs_;
+  }
+
+  /*!
+   * @brief Get the interval between misses with as many misses in flight as possible
+   * @return  Interval in nanoseconds
+   */
+  double
+  missInterval() const noexcept
+  {
+    return intervalNs_;
+  }
+
+  /*!
+   * @brief Get the prefetch distance of a loop which is bound by one miss per iteration
+   * @return  Distance in iterations, in [kMinDistance, kMaxDistance]
+   */
+  std::size_t
+  distance() const noexcept
+  {
+    return distance_;
+  }
+
+  /*!
+   * @brief Get the prefetch distance of a loop whose body takes a known time when its data is cached
+   *
+   * This is latency() / nsPerIteration, the distance which hides the whole latency,
+   * capped by distance() since prefetches beyond the misses the core can overlap only wait in line.
+   *
+   * @param [in] nsPerIteration  Time of one iteration without misses, in nanoseconds
+   * @return  Distance in iterations
+   */
+  std::size_t
+  distance(double nsPerIteration) const noexcept
+  {
+    if (!(nsPerIteration > 0.0)) {
+      return distance_;
+    }
+    const auto d = std::ceil(latencyNs_ / nsPerIteration);
+    return d >= static_cast<double>(distance_) ? distance_ : std::max<std::size_t>(static_cast<std::size_t>(d), 1);
+  }
+
+private:
+  PrefetchDistance(double latencyNs, double intervalNs) noexcept
+    : latencyNs_{latencyNs}
+    , intervalNs_{intervalNs}
+    , distance_{kMinDistance}
+  {
+    if (latencyNs > 0.0 && intervalNs > 0.0) {
+      const auto d = std::ceil(latencyNs / intervalNs);
+      distance_ = d >= static_cast<double>(kMaxDistance) ? kMaxDistance
+        : std::max(static_cast<std::size_t>(d), kMinDistance);
+    }
+  }
+
+  static volatile std::uint32_t&
+  sink() noexcept
+  {
+    static volatile std::uint32_t value = 0;
+    return value;
+  }
+
+  //! Latency of a miss in nanoseconds
+  double latencyNs_;
+  //! Interval between overlapped misses in nanoseconds
+  double intervalNs_;
+  //! Prefetch distance in iterations
+  std::size_t distance_;
+};  // class PrefetchDistance
+
+constexpr std::size_t PrefetchDistance::kChains;
+constexpr std::size_t PrefetchDistance::kProbeSize;
+constexpr std::size_t PrefetchDistance::kMinDistance;
+constexpr std::size_t PrefetchDistance::kMaxDistance;
+
+
+/*!
+ * @brief Run a loop with a software prefetch issued a fixed number of iterations ahead
+ *
+ * Iteration i prefetches address(i + distance) and then calls f(i); the first distance addresses
+ * are prefetched before the loop. This suits gathers and pointer-heavy loops whose next addresses are known
+ * (e.g. through an index array) but which the hardware prefetchers cannot predict.
+ *
+ * @code
+ * // sum += values[indices[i]]
+ * simdutil::forEachPrefetched(
+ *   n,
+ *   [&](std::size_t i) { return &values[indices[i]]; },
+ *   [&](std::size_t i) { sum += values[indices[i]]; });
+ * @endcode
+ *
+ * @tparam kHint  Prefetch instruction (kW for loops which write the data; check isPrefetchHintAvailable())
+ * @param [in] n         Number of iterations
+ * @param [in] address   Function called as address(i), which returns the address used by iteration i
+ * @param [in] f         Loop body, called as f(i)
+ * @param [in] distance  Prefetch distance in iterations (default: PrefetchDistance::get().distance())
+ */
+template<PrefetchHint kHint = PrefetchHint::kT0, typename A, typename F>
+static inline void
+forEachPrefetched(std::size_t n, A&& address, F&& f, std::size_t distance = PrefetchDistance::get().distance())
+{
+  const auto nAhead = std::min(distance, n);
+  for (std::size_t i = 0; i < nAhead; i++) {
+    prefetch<kHint>(address(i));
+  }
+  std::size_t i = 0;
+  for (; i < n - nAhead; i++) {
+    prefetch<kHint>(address(i + distance));
+    f(i);
+  }
+  for (; i < n; i++) {
+    f(i);
+  }
+}
+
+
+}  // namespace simdutil
+
+
+#endif  // SIMDUTIL_PREFETCH_HPP
@@ -0,0 +1,467 @@
+#ifndef SIMDUTIL_REDUCE_HPP
+#define SIMDUTIL_REDUCE_HPP
+
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "vec.hpp"
+
+
+namespace simdutil
+{
+/*!
+ * @brief Check whether a type is supported by the reduction kernels
+ * @return  true if T is float, double, std::int32_t or std::int64_t
+ */
+template<typename T>
+static inline constexpr bool
+isReducibleType() noexcept
+{
+  return std::is_same<T, float>::value
+    || std::is_same<T, double>::value
+    || std::is_same<T, std::int32_t>::value
+    || std::is_same<T, std::int64_t>::value;
+}
+
+
+/*!
+ * @brief Sum kernel with four independent accumulators, which hide the latency of vector additions
+ */
+template<typename V>
+struct SumKernel
+{
+  //! Element type
+  using T = typename V::value_type;
+
+  static T
+  run(const T* p, std::size_t n) noexcept
+  {
+    constexpr auto kWidth = V::kSize;
+    V acc0, acc1, acc2, acc3;
+    std::size_t i = 0;
+    for (; i + 4 * kWidth <= n; i += 4 * kWidth) {
+      acc0 += V::loadu(p + i);
+      acc1 += V::loadu(p + i + kWidth);
+      acc2 += V::loadu(p + i + 2 * kWidth);
+      acc3 += V::loadu(p + i + 3 * kWidth);
+    }
+    for (; i + kWidth <= n; i += kWidth) {
+      acc0 += V::loadu(p + i);
+    }
+    if (i < n) {
+      acc1 += V::loadu(p + i, n - i);
+    }
+    return ((acc0 + acc1) + (acc2 + acc3)).reduceAdd();
+  }
+};  // struct SumKernel
+
+
+/*!
+ * @brief Dot product kernel with four independent FMA accumulators
+ */
+template<typename V>
+struct DotKernel
+{
+  //! Element type
+  using T = typename V::value_type;
+
+  static T
+  run(const T* p, const T* q, std::size_t n) noexcept
+  {
+    constexpr auto kWidth = V::kSize;
+    V acc0, acc1, acc2, acc3;
+    std::size_t i = 0;
+    for (; i + 4 * kWidth <= n; i += 4 * kWidth) {
+      acc0 = fma(V::loadu(p + i), V::loadu(q + i), acc0);
+      acc1 = fma(V::loadu(p + i + kWidth), V::loadu(q + i + kWidth), acc1);
+      acc2 = fma(V::loadu(p + i + 2 * kWidth), V::loadu(q + i + 2 * kWidth), acc2);
+      acc3 = fma(V::loadu(p + i + 3 * kWidth), V::loadu(q + i + 3 * kWidth), acc3);
+    }
+    for (; i + kWidth <= n; i += kWidth) {
+      acc0 = fma(V::loadu(p + i), V::loadu(q + i), acc0);
+    }
+    if (i < n) {
+      acc1 = fma(V::loadu(p + i, n - i), V::loadu(q + i, n - i), acc1);
+    }
+    return ((acc0 + acc1) + (acc2 + acc3)).reduceAdd();
+  }
+};  // struct DotKernel
+
+
+/*!
+ * @brief Minimum / maximum kernel with four independent accumulators
+ * @tparam kIsMax  true for the maximum, false for the minimum
+ */
+template<
+  typename V,
+  bool kIsMax
+>
+struct ExtremumKernel
+{
+  //! Element type
+  using T = typename V::value_type;
+
+  static T
+  run(const T* p, std::size_t n) noexcept
+  {
+    if (n == 0) {
+      return T{};
+    }
+    constexpr auto kWidth = V::kSize;
+    auto acc0 = V::broadcast(p[0]);
+    auto acc1 = acc0;
+    auto acc2 = acc0;
+    auto acc3 = acc0;
+    std::size_t i = 0;
+    for (; i + 4 * kWidth <= n; i += 4 * kWidth) {
+      acc0 = pick(acc0, V::loadu(p + i));
+      acc1 = pick(acc1, V::loadu(p + i + kWidth));
+      acc2 = pick(acc2, V::loadu(p + i + 2 * kWidth));
+      acc3 = pick(acc3, V::loadu(p + i + 3 * kWidth));
+    }
+    for (; i + kWidth <= n; i += kWidth) {
+      acc0 = pick(acc0, V::loadu(p + i));
+    }
+    if (i < n) {
+      // Lanes beyond n are zero-filled, so keep the accumulator there
+      acc1 = pick(acc1, select(V::MaskType::firstN(n - i), V::loadu(p + i, n - i), acc1));
+    }
+    const auto acc = pick(pick(acc0, acc1), pick(acc2, acc3));
+    return kIsMax ? acc.reduceMax() : acc.reduceMin();
+  }
+
+  static V
+  pick(const V& a, const V& b) noexcept
+  {
+    return kIsMax ? max(a, b) : min(a, b);
+  }
+};  // struct ExtremumKernel
+
+//! Minimum kernel
+template<typename V>
+using MinKernel = ExtremumKernel<V, false>;
+
+//! Maximum kernel
+template<typename V>
+using MaxKernel = ExtremumKernel<V, true>;
+
+
+/*!
+ * @brief Index of the first minimum / maximum
+ *
+ * The array is processed in cache-resident blocks.
+ * The extremum of each block is computed with ExtremumKernel, and only a block which improves the result
+ * is scanned again (from L1) for the first index of its extremum.
+ * This avoids carrying index vectors, so the hot loop is the same as reduceMin() / reduceMax().
+ *
+ * @tparam kIsMax  true for the maximum, false for the minimum
+ */
+template<
+  typename V,
+  bool kIsMax
+>
+struct ArgExtremumKernel
+{
+  //! Element type
+  using T = typename V::value_type;
+  //! Number of elements of a block
+  static constexpr std::size_t kBlockSize = 2048;
+
+  static std::size_t
+  run(const T* p, std::size_t n) noexcept
+  {
+    if (n == 0) {
+      return 0;
+    }
+    auto best = p[0];
+    std::size_t bestIndex = 0;
+    for (std::size_t first = 0; first < n; first += kBlockSize) {
+      const auto len = std::min(kBlockSize, n - first);
+      const auto x = ExtremumKernel<V, kIsMax>::run(p + first, len);
+      if (kIsMax ? best < x : x < best) {
+        best = x;
+        bestIndex = first + findFirst(p + first, len, x);
+      }
+    }
+    return bestIndex;
+  }
+
+  static std::size_t
+  findFirst(const T* p, std::size_t n, T x) noexcept
+  {
+    const auto target = V::broadcast(x);
+    for (std::size_t i = 0; i < n; i += V::kSize) {
+      const auto mask = (V::loadu(p + i, n - i) == target) & V::MaskType::firstN(n - i);
+      if (mask.any()) {
+        std::size_t k = 0;
+        while (!mask.test(k)) {
+          k++;
+        }
+        return i + k;
+      }
+    }
+    return 0;
+  }
+};  // struct ArgExtremumKernel
+
+template<
+  typename V,
+  bool kIsMax
+>
+constexpr std::size_t ArgExtremumKernel<V, kIsMax>::kBlockSize;
+
+//! Argmin kernel
+template<typename V>
+using ArgMinKernel = ArgExtremumKernel<V, false>;
+
+//! Argmax kernel
+template<typename V>
+using ArgMaxKernel = ArgExtremumKernel<V, true>;
+
+
+/*!
+ * @brief Kahan-compensated sum kernel
+ *
+ * Each lane of four accumulator pairs runs Kahan summation, and the lanes are combined with Kahan summation too.
+ * The error does not grow with n, at about four times the arithmetic of SumKernel
+ * (still memory bound for large arrays with AVX2 or AVX-512).
+ */
+template<typename V>
+struct KahanSumKernel
+{
+  //! Element type
+  using T = typename V::value_type;
+
+  static T
+  run(const T* p, std::size_t n) noexcept
+  {
+    constexpr auto kWidth = V::kSize;
+    std::array<V, 4> sums, carries;
+    std::size_t i = 0;
+    for (; i + 4 * kWidth <= n; i += 4 * kWidth) {
+      for (std::size_t k = 0; k < 4; k++) {
+        add(sums[k], carries[k], V::loadu(p + i + k * kWidth));
+      }
+    }
+    for (; i < n; i += kWidth) {
+      add(sums[0], carries[0], V::loadu(p + i, n - i));
+    }
+
+    std::array<T, kWidth> lanes;
+    T sum = 0;
+    T carry = 0;
+    for (std::size_t k = 0; k < 4; k++) {
+      (sums[k] - carries[k]).storeu(lanes.data());
+      for (const auto x : lanes) {
+        const auto y = x - carry;
+        const auto t = sum + y;
+        carry = (t - sum) - y;
+        sum = t;
+      }
+    }
+    return sum;
+  }
+
+  static void
+  add(V& sum, V& carry, const V& x) noexcept
+  {
+    const auto y = x - carry;
+    const auto t = sum + y;
+    carry = (t - sum) - y;
+    sum = t;
+  }
+};  // struct KahanSumKernel
+
+
+/*!
+ * @brief Pairwise sum kernel
+ *
+ * Blocks of kBlockSize elements are summed by SumKernel and the block sums are added as a balanced binary tree,
+ * so the error grows with O(log n) instead of O(n), at the speed of SumKernel.
+ * The tree is built bottom-up with a small stack (like a binary counter), without recursion,
+ * so that the whole kernel stays inlined into the dispatched function.
+ */
+template<typename V>
+struct PairwiseSumKernel
+{
+  //! Element type
+  using T = typename V::value_type;
+  //! Number of elements of a leaf block
+  static constexpr std::size_t kBlockSize = 1024;
+
+  static T
+  run(const T* p, std::size_t n) noexcept
+  {
+    std::array<T, 64> sums;
+    std::array<int, 64> levels;
+    std::size_t depth = 0;
+    for (std::size_t first = 0; first < n; first += kBlockSize) {
+      auto sum = SumKernel<V>::run(p + first, std::min(kBlockSize, n - first));
+      auto level = 0;
+      for (; depth > 0 && levels[depth - 1] == level; level++) {
+        sum = sums[--depth] + sum;
+      }
+      sums[depth] = sum;
+      levels[depth++] = level;
+    }
+    T sum = 0;
+    while (depth > 0) {
+      sum = sums[--depth] + sum;
+    }
+    return sum;
+  }
+};  // struct PairwiseSumKernel
+
+template<typename V>
+constexpr std::size_t PairwiseSumKernel<V>::kBlockSize;
+
+
+/*!
+ * @brief Sum of an array
+ *
+ * Four independent accumulators are used, so the result may differ from a sequential sum by rounding
+ * and may differ between instruction set levels.
+ * Integer sums wrap around on overflow in the SIMD paths.
+ *
+ * @param [in] p  Array
+ * @param [in] n  Number of elements
+ * @return  Sum of elements (0 if n == 0)
+ */
+template<typename T>
+static inline T
+reduceSum(const T* p, std::size_t n) noexcept
+{
+  static_assert(isReducibleType<T>(), "Element type must be float, double, std::int32_t or std::int64_t");
+  return VecDispatcher<SumKernel, T, T(const T*, std::size_t)>::call(p, n);
+}
+
+/*!
+ * @brief Minimum of an array
+ *
+ * The result is unspecified if the array contains NaN.
+ *
+ * @param [in] p  Array
+ * @param [in] n  Number of elements
+ * @return  Minimum element (T{} if n == 0)
+ */
+template<typename T>
+static inline T
+reduceMin(const T* p, std::size_t n) noexcept
+{
+  static_assert(isReducibleType<T>(), "Element type must be float, double, std::int32_t or std::int64_t");
+  return VecDispatcher<MinKernel, T, T(const T*, std::size_t)>::call(p, n);
+}
+
+/*!
+ * @brief Maximum of an array
+ *
+ * The result is unspecified if the array contains NaN.
+ *
+ * @param [in] p  Array
+ * @param [in] n  Number of elements
+ * @return  Maximum element (T{} if n == 0)
+ */
+template<typename T>
+static inline T
+reduceMax(const T* p, std::size_t n) noexcept
+{
+  static_assert(isReducibleType<T>(), "Element type must be float, double, std::int32_t or std::int64_t");
+  return VecDispatcher<MaxKernel, T, T(const T*, std::size_t)>::call(p, n);
+}
+
+/*!
+ * @brief Index of the first minimum of an array
+ *
+ * The result is unspecified if the array contains NaN.
+ *
+ * @param [in] p  Array
+ * @param [in] n  Number of elements
+ * @return  Index of the first minimum element (0 if n == 0)
+ */
+template<typename T>
+static inline std::size_t
+argMin(const T* p, std::size_t n) noexcept
+{
+  static_assert(isReducibleType<T>(), "Element type must be float, double, std::int32_t or std::int64_t");
+  return VecDispatcher<ArgMinKernel, T, std::size_t(const T*, std::size_t)>::call(p, n);
+}
+
+/*!
+ * @brief Index of the first maximum of an array
+ *
+ * The result is unspecified if the array contains NaN.
+ *
+ * @param [in] p  Array
+ * @param [in] n  Number of elements
+ * @return  Index of the first maximum element (0 if n == 0)
+ */
+template<typename T>
+static inline std::size_t
+argMax(const T* p, std::size_t n) noexcept
+{
+  static_assert(isReducibleType<T>(), "Element type must be float, double, std::int32_t or std::int64_t");
+  return VecDispatcher<ArgMaxKernel, T, std::size_t(const T*, std::size_t)>::call(p, n);
+}
+
+/*!
+ * @brief Dot product of two arrays
+ *
+ * AVX2 and AVX-512 paths use FMA, which rounds once per element.
+ *
+ * @param [in] p  First array
+ * @param [in] q  Second array
+ * @param [in] n  Number of elements
+ * @return  Dot product (0 if n == 0)
+ */
+template<typename T>
+static inline T
+dotProduct(const T* p, const T* q, std::size_t n) noexcept
+{
+  static_assert(isReducibleType<T>(), "Element type must be float, double, std::int32_t or std::int64_t");
+  return VecDispatcher<DotKernel, T, T(const T*, const T*, std::size_t)>::call(p, q, n);
+}
+
+/*!
+ * @brief Kahan-compensated sum of a floating-point array
+ *
+ * Use this for long sums whose error must not grow with the length.
+ * Do not compile with -ffast-math, which removes the compensation.
+ *
+ * @param [in] p  Array
+ * @param [in] n  Number of elements
+ * @return  Sum of elements (0 if n == 0)
+ */
+template<typename T>
+static inline T
+reduceSumKahan(const T* p, std::size_t n) noexcept
+{
+  static_assert(std::is_floating_point<T>::value && isReducibleType<T>(), "Element type must be float or double");
+  return VecDispatcher<KahanSumKernel, T, T(const T*, std::size_t)>::call(p, n);
+}
+
+/*!
+ * @brief Pairwise sum of a floating-point array
+ *
+ * The error grows with O(log n), at almost the speed of reduceSum().
+ *
+ * @param [in] p  Array
+ * @param [in] n  Number of elements
+ * @return  Sum of elements (0 if n == 0)
+ */
+template<typename T>
+static inline T
+reduceSumPairwise(const T* p, std::size_t n) noexcept
+{
+  static_assert(std::is_floating_point<T>::value && isReducibleType<T>(), "Element type must be float or double");
+  return VecDispatcher<PairwiseSumKernel, T, T(const T*, std::size_t)>::call(p, n);
+}
+
+
+}  // namespace simdutil
+
+
+#endif  // SIMDUTIL_REDUCE_HPP
@@ -0,0 +1,473 @@
+#ifndef SIMDUTIL_RING_HPP
+#define SIMDUTIL_RING_HPP
+
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "allocator.hpp"
+#include "cache_padded.hpp"
+
+
+namespace simdutil
+{
+/*!
+ * @brief Contiguous run of ring slots
+ */
+template<typename T>
+struct RingSpan
+{
+  //! First slot
+  T* data;
+  //! Number of slots
+  std::size_t size;
+};  // struct RingSpan
+
+
+/*!
+ * @brief Round a ring capacity up to a power of 2
+ * @param [in] capacity  Requested capacity
+ * @return  Capacity of the ring (2 or more)
+ */
+static inline std::size_t
+roundUpRingCapacity(std::size_t capacity) noexcept
+{
+  std::size_t p = 2;
+  while (p < capacity) {
+    p <<= 1;
+  }
+  return p;
+}
+
+
+/*!
+ * @brief Bounded wait-free single-producer / single-consumer ring buffer
+ *
+ * One thread may push and one (other) thread may pop; every operation finishes in a bounded number of steps.
+ * The producer and consumer indices are on separate padded lines (CachePadded),
+ * and each side keeps a private copy of the other side's index, so the shared lines only move
+ * when the ring looks full or empty to the cached value.
+ * Batch operations and the reserve() / commit(), peek() / consume() pairs publish many slots with one release store.
+ *
+ * The slots are default-constructed objects in storage from AlignedAllocator (aligned to kCachePadSize),
+ * so reserve() may hand them out for writing in place, e.g. as the destination of a SIMD kernel:
+ *
+ * @code
+ * simdutil::SpscRing<float> ring{1 << 16};
+ * // Producer
+ * auto span = ring.reserve(1024);
+ * kernel(span.data, span.size);
+ * ring.commit(span.size);
+ * // Consumer
+ * auto input = ring.peek(1024);
+ * consume(input.data, input.size);
+ * ring.consume(input.size);
+ * @endcode
+ */
+template<typename T>
+class SpscRing
+{
+  static_assert(std::is_default_constructible<T>::value, "Element type must be default constructible");
+
+public:
+  //! Slot type
+  using value_type = T;
+
+  /*!
+   * @brief Allocate the slots
+   * @param [in] capacity  Minimum number of slots (rounded up to a power of 2)
+   */
+  explicit SpscRing(std::size_t capacity)
+    : mask_{roundUpRingCapacity(capacity) - 1}
+    , slots_(mask_ + 1)
+    , producer_{}
+    , consumer_{}
+  {}
+
+  SpscRing(const SpscRing&) = delete;
+  SpscRing& operator=(const SpscRing&) = delete;
+
+  /*!
+   * @brief Push one element (producer only)
+   * @param [in] value  Element
+   * @return  false if the ring is full
+   */
+  bool
+  tryPush(T value)
+  {
+    const auto tail = producer_->index.load(std::memory_order_relaxed);
+    if (freeSlots(tail, 1) == 0) {
+      return false;
+    }
+    slots_[tail & mask_] = std::move(value);
+    producer_->index.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  /*!
+   * @brief Pop one element (consumer only)
+   * @param [out] value  Popped element
+   * @return  false if the ring is empty
+   */
+  bool
+  tryPop(T& value)
+  {
+    const auto head = consumer_->index.load(std::memory_order_relaxed);
+    if (usedSlots(head, 1) == 0) {
+      return false;
+    }
+    value = std::move(slots_[head & mask_]);
+    consumer_->index.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  /*!
+   * @brief Push as many elements as fit (producer only)
+   * @param [in] values  Elements
+   * @param [in] n       Number of elements
+   * @return  Number of pushed elements
+   */
+  std::size_t
+  pushBatch(const T* values, std::size_t n)
+  {
+    const auto tail = producer_->index.load(std::memory_order_relaxed);
+    const auto count = freeSlots(tail, n);
+    for (std::size_t i = 0; i < count; i++) {
+      slots_[(tail + i) & mask_] = values[i];
+    }
+    if (count != 0) {
+      producer_->index.store(tail + count, std::memory_order_release);
+    }
+    return count;
+  }
+
+  /*!
+   * @brief Pop up to n elements (consumer only)
+   * @param [out] values  Popped elements
+   * @param [in]  n       Maximum number of elements
+   * @return  Number of popped elements
+   */
+  std::size_t
+  popBatch(T* values, std::size_t n)
+  {
+    const auto head = consumer_->index.load(std::memory_order_relaxed);
+    const auto count = usedSlots(head, n);
+    for (std::size_t i = 0; i < count; i++) {
+      values[i] = std::move(slots_[(head + i) & mask_]);
+    }
+    if (count != 0) {
+      consumer_->index.store(head + count, std::memory_order_release);
+    }
+    return count;
+  }
+
+  /*!
+   * @brief Get free slots to write in place (producer only)
+   *
+   * The span is contiguous, so it may be shorter than the free space when it reaches the end of the storage.
+   * Nothing is visible to the consumer until commit().
+   *
+   * @param [in] n  Maximum number of slots
+   * @return  Writable slots (size 0 if the ring is full)
+   */
+  RingSpan<T>
+  reserve(std::size_t n) noexcept
+  {
+    const auto tail = producer_->index.load(std::memory_order_relaxed);
+    const auto index = tail & mask_;
+    return RingSpan<T>{&slots_[index], std::min(freeSlots(tail, n), capacity() - index)};
+  }
+
+  /*!
+   * @brief Publish slots written through reserve() (producer only)
+   * @param [in] n  Number of slots, at most the size of the last reserve()
+   */
+  void
+  commit(std::size_t n) noexcept
+  {
+    producer_->index.store(producer_->index.load(std::memory_order_relaxed) + n, std::memory_order_release);
+  }
+
+  /*!
+   * @brief Get filled slots to read in place (consumer only)
+   * @param [in] n  Maximum number of slots
+   * @return  Readable slots (contiguous; size 0 if the ring is empty)
+   */
+  RingSpan<T>
+  peek(std::size_t n) noexcept
+  {
+    const auto head = consumer_->index.load(std::memory_order_relaxed);
+    const auto index = head & mask_;
+    return RingSpan<T>{&slots_[index], std::min(usedSlots(head, n), capacity() - index)};
+  }
+
+  /*!
+   * @brief Release slots read through peek() to the producer (consumer only)
+   * @param [in] n  Number of slots, at most the size of the last peek()
+   */
+  void
+  consume(std::size_t n) noexcept
+  {
+    consumer_->index.store(consumer_->index.load(std::memory_order_relaxed) + n, std::memory_order_release);
+  }
+
+  /*!
+   * @brief Get the number of slots
+   * @return  Capacity of the ring
+   */
+  std::size_t
+  capacity() const noexcept
+  {
+    return mask_ + 1;
+  }
+
+  /*!
+   * @brief Get the number of elements (exact only when called by the producer or the consumer while the other is idle)
+   * @return  Number of elements
+   */
+  std::size_t
+  size() const noexcept
+  {
+    const auto head = consumer_->index.load(std::memory_order_acquire);
+    return std::min(producer_->index.load(std::memory_order_acquire) - head, capacity());
+  }
+
+private:
+  //! Index of one side and the cached index of the other side
+  struct Side
+  {
+    //! Next slot to push (producer) or pop (consumer)
+    std::atomic<std::size_t> index;
+    //! Last seen index of the other side
+    std::size_t cachedOther;
+  };  // struct Side
+
+  // The other side's index is only reloaded when the cached one does not allow n slots
+  std::size_t
+  freeSlots(std::size_t tail, std::size_t n) noexcept
+  {
+    if (capacity() - (tail - producer_->cachedOther) < n) {
+      producer_->cachedOther = consumer_->index.load(std::memory_order_acquire);
+    }
+    return std::min(capacity() - (tail - producer_->cachedOther), n);
+  }
+
+  std::size_t
+  usedSlots(std::size_t head, std::size_t n) noexcept
+  {
+    if (consumer_->cachedOther - head < n) {
+      consumer_->cachedOther = producer_->index.load(std::memory_order_acquire);
+    }
+    return std::min(consumer_->cachedOther - head, n);
+  }
+
+  //! Capacity - 1
+  std::size_t mask_;
+  //! Slots
+  std::vector<T, AlignedAllocator<T, kCachePadSize>> slots_;
+  //! Producer index, written by the producer
+  CachePadded<Side> producer_;
+  //! Consumer index, written by the consumer
+  CachePadded<Side> consumer_;
+};  // class SpscRing
+
+
+/*!
+ * @brief Bounded lock-free multi-producer / multi-consumer ring buffer (Dmitry Vyukov's algorithm)
+ *
+ * Each slot carries a sequence number which tells producers and consumers of a given lap whether it is theirs,
+ * so a push or pop is one CAS on the shared index plus one release store to the slot.
+ * A full ring fails a push and an empty ring fails a pop immediately; neither blocks.
+ * The enqueue and dequeue indices are on separate padded lines.
+ * pushBatch() / popBatch() claim a run of ready slots with a single CAS.
+ *
+ * The slots are not padded: neighbouring slots may share a line, which costs some false sharing
+ * under heavy contention but keeps batches dense.
+ */
+template<typename T>
+class MpmcRing
+{
+  static_assert(std::is_default_constructible<T>::value, "Element type must be default constructible");
+
+public:
+  //! Slot type
+  using value_type = T;
+
+  /*!
+   * @brief Allocate the slots
+   * @param [in] capacity  Minimum number of slots (rounded up to a power of 2)
+   */
+  explicit MpmcRing(std::size_t capacity)
+    : mask_{roundUpRingCapacity(capacity) - 1}
+    , cells_(mask_ + 1)
+    , enqueuePos_{}
+    , dequeuePos_{}
+  {
+    for (std::size_t i = 0; i <= mask_; i++) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  MpmcRing(const MpmcRing&) = delete;
+  MpmcRing& operator=(const MpmcRing&) = delete;
+
+  /*!
+   * @brief Push one element
+   * @param [in] value  Element
+   * @return  false if the ring is full
+   */
+  bool
+  tryPush(T value)
+  {
+    std::size_t pos;
+    if (claim(enqueuePos_.get(), 0, 1, pos) == 0) {
+      return false;
+    }
+    auto& cell = cells_[pos & mask_];
+    cell.value = std::move(value);
+    cell.sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  /*!
+   * @brief Pop one element
+   * @param [out] value  Popped element
+   * @return  false if the ring is empty
+   */
+  bool
+  tryPop(T& value)
+  {
+    std::size_t pos;
+    if (claim(dequeuePos_.get(), 1, 1, pos) == 0) {
+      return false;
+    }
+    auto& cell = cells_[pos & mask_];
+    value = std::move(cell.value);
+    cell.sequence.store(pos + capacity(), std::memory_order_release);
+    return true;
+  }
+
+  /*!
+   * @brief Push up to n elements into consecutive slots
+   * @param [in] values  Elements
+   * @param [in] n       Number of elements
+   * @return  Number of pushed elements (0 if the ring is full)
+   */
+  std::size_t
+  pushBatch(const T* values, std::size_t n)
+  {
+    std::size_t pos;
+    const auto count = claim(enqueuePos_.get(), 0, n, pos);
+    for (std::size_t i = 0; i < count; i++) {
+      auto& cell = cells_[(pos + i) & mask_];
+      cell.value = values[i];
+      cell.sequence.store(pos + i + 1, std::memory_order_release);
+    }
+    return count;
+  }
+
+  /*!
+   * @brief Pop up to n elements from consecutive slots
+   * @param [out] values  Popped elements
+   * @param [in]  n       Maximum number of elements
+   * @return  Number of popped elements (0 if the ring is empty)
+   */
+  std::size_t
+  popBatch(T* values, std::size_t n)
+  {
+    std::size_t pos;
+    const auto count = claim(dequeuePos_.get(), 1, n, pos);
+    for (std::size_t i = 0; i < count; i++) {
+      auto& cell = cells_[(pos + i) & mask_];
+      values[i] = std::move(cell.value);
+      cell.sequence.store(pos + i + capacity(), std::memory_order_release);
+    }
+    return count;
+  }
+
+  /*!
+   * @brief Get the number of slots
+   * @return  Capacity of the ring
+   */
+  std::size_t
+  capacity() const noexcept
+  {
+    return mask_ + 1;
+  }
+
+  /*!
+   * @brief Get the approximate number of elements
+   * @return  Number of claimed slots (may include slots being written or read)
+   */
+  std::size_t
+  size() const noexcept
+  {
+    const auto head = dequeuePos_->load(std::memory_order_acquire);
+    return std::min(enqueuePos_->load(std::memory_order_acquire) - head, capacity());
+  }
+
+private:
+  //! Slot with its sequence number
+  struct Cell
+  {
+    //! pos while free for the push at pos, pos + 1 while holding the element pushed at pos
+    std::atomic<std::size_t> sequence;
+    //! Element
+    T value;
+  };  // struct Cell
+
+  /*!
+   * @brief Claim a run of slots for pushing (offset 0) or popping (offset 1)
+   *
+   * The slot at pos is ready when its sequence is pos + offset.
+   * A sequence behind that means the ring is full (push) or empty (pop);
+   * one ahead means another thread has claimed pos, so the position is reloaded.
+   *
+   * @param [in,out] position  Enqueue or dequeue position
+   * @param [in]  offset  0 for push, 1 for pop
+   * @param [in]  n       Maximum number of slots
+   * @param [out] pos     First claimed position
+   * @return  Number of claimed slots (0 if none is ready)
+   */
+  std::size_t
+  claim(std::atomic<std::size_t>& position, std::size_t offset, std::size_t n, std::size_t& pos) noexcept
+  {
+    pos = position.load(std::memory_order_relaxed);
+    for (;;) {
+      std::size_t count = 0;
+      while (count < n && cells_[(pos + count) & mask_].sequence.load(std::memory_order_acquire) == pos + count + offset) {
+        count++;
+      }
+      if (count != 0) {
+        if (position.compare_exchange_weak(pos, pos + count, std::memory_order_relaxed)) {
+          return count;
+        }
+        continue;
+      }
+      const auto seq = cells_[pos & mask_].sequence.load(std::memory_order_acquire);
+      if (static_cast<std::ptrdiff_t>(seq - (pos + offset)) < 0) {
+        return 0;
+      }
+      pos = position.load(std::memory_order_relaxed);
+    }
+  }
+
+  //! Capacity - 1
+  std::size_t mask_;
+  //! Slots
+  std::vector<Cell, AlignedAllocator<Cell, kCachePadSize>> cells_;
+  //! Position of the next push
+  CachePadded<std::atomic<std::size_t>> enqueuePos_;
+  //! Position of the next pop
+  CachePadded<std::atomic<std::size_t>> dequeuePos_;
+};  // class MpmcRing
+
+
+}  // namespace simdutil
+
+
+#endif  // SIMDUTIL_RING_HPP
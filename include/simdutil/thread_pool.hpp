@@ -0,0 +1,847 @@
+#ifndef SIMDUTIL_THREAD_POOL_HPP
+#define SIMDUTIL_THREAD_POOL_HPP
+
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <immintrin.h>
+
+#include "allocator.hpp"
+#include "cache_padded.hpp"
+#include "cpuid.hpp"
+#include "numa.hpp"
+
+
+namespace simdutil
+{
+/*!
+ * @brief Chase-Lev work-stealing deque
+ *
+ * The owner thread pushes and pops at the bottom (LIFO, the most recently split and cache-hot work);
+ * other threads steal from the top (FIFO, the largest pieces of recursively split work).
+ * This is the C11 formulation of Lê et al. (PPoPP 2013), with its two sequentially consistent fences
+ * folded into sequentially consistent accesses of top and bottom, which compile to the same instructions on x86.
+ * The circular array doubles when full; retired arrays are kept until destruction because a thief may still read them.
+ */
+template<typename T>
+class ChaseLevDeque
+{
+  static_assert(std::is_trivially_copyable<T>::value, "Element type must be trivially copyable (e.g. a pointer)");
+
+public:
+  /*!
+   * @brief Allocate the circular array
+   * @param [in] capacity  Initial capacity, rounded up to a power of 2
+   */
+  explicit ChaseLevDeque(std::size_t capacity = 256)
+    : top_{0}
+    , bottom_{0}
+    , array_{nullptr}
+    , arrays_{}
+  {
+    std::size_t p = 2;
+    while (p < capacity) {
+      p <<= 1;
+    }
+    arrays_.push_back(std::unique_ptr<Array>{new Array{p}});
+    array_.store(arrays_.back().get(), std::memory_order_relaxed);
+  }
+
+  ChaseLevDeque(const ChaseLevDeque&) = delete;
+  ChaseLevDeque& operator=(const ChaseLevDeque&) = delete;
+
+  /*!
+   * @brief Push an element at the bottom (owner thread only)
+   * @param [in] value  Element to push
+   */
+  void
+  push(T value)
+  {
+    const auto b = bottom_->load(std::memory_order_relaxed);
+    const auto t = top_->load(std::memory_order_acquire);
+    auto array = array_.load(std::memory_order_relaxed);
+    // The owner never sees top above bottom, so b - t is not negative
+    if (static_cast<std::size_t>(b - t) >= array->capacity()) {
+      array = grow(*array, t, b);
+    }
+    array->put(b, value);
+    bottom_->store(b + 1, std::memory_order_release);
+  }
+
+  /*!
+   * @brief Pop the element at the bottom (owner thread only)
+   * @param [out] value  Popped element
+   * @return  true if an element was popped, false if the deque was empty or a thief took the last element
+   */
+  bool
+  pop(T& value) noexcept
+  {
+    const auto b = bottom_->load(std::memory_order_relaxed) - 1;
+    const auto array = array_.load(std::memory_order_relaxed);
+    bottom_->store(b, std::memory_order_seq_cst);
+    auto t = top_->load(std::memory_order_seq_cst);
+    if (t > b) {
+      bottom_->store(b + 1, std::memory_order_relaxed);
+      return false;
+    }
+    value = array->get(b);
+    if (t != b) {
+      return true;
+    }
+    // The last element: thieves may be racing for it
+    const auto isWon = top_->compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+    bottom_->store(b + 1, std::memory_order_relaxed);
+    return isWon;
+  }
+
+  /*!
+   * @brief Steal the element at the top (any thread)
+   * @param [out] value  Stolen element
+   * @return  true if an element was stolen, false if the deque was empty or another thread won the race
+   */
+  bool
+  steal(T& value) noexcept
+  {
+    auto t = top_->load(std::memory_order_seq_cst);
+    const auto b = bottom_->load(std::memory_order_seq_cst);
+    if (t >= b) {
+      return false;
+    }
+    value = array_.load(std::memory_order_acquire)->get(t);
+    return top_->compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+  }
+
+  /*!
+   * @brief Get the number of elements
+   * @return  Number of elements (only a hint while other threads push or steal)
+   */
+  std::size_t
+  size() const noexcept
+  {
+    const auto n = bottom_->load(std::memory_order_relaxed) - top_->load(std::memory_order_relaxed);
+    return n > 0 ? static_cast<std::size_t>(n) : 0;
+  }
+
+private:
+  //! Circular array of atomic slots
+  class Array
+  {
+  public:
+    explicit Array(std::size_t capacity)
+      : mask_{capacity - 1}
+      , slots_{new std::atomic<T>[capacity]}
+    {}
+
+    std::size_t
+    capacity() const noexcept
+    {
+      return mask_ + 1;
+    }
+
+    T
+    get(std::int64_t index) const noexcept
+    {
+      return slots_[static_cast<std::size_t>(index) & mask_].load(std::memory_order_relaxed);
+    }
+
+    void
+    put(std::int64_t index, T value) noexcept
+    {
+      slots_[static_cast<std::size_t>(index) & mask_].store(value, std::memory_order_relaxed);
+    }
+
+  private:
+    //! Capacity - 1
+    std::size_t mask_;
+    //! Slots
+    std::unique_ptr<std::atomic<T>[]> slots_;
+  };  // class Array
+
+  Array*
+  grow(const Array& array, std::int64_t t, std::int64_t b)
+  {
+    arrays_.push_back(std::unique_ptr<Array>{new Array{array.capacity() * 2}});
+    const auto grown = arrays_.back().get();
+    for (auto i = t; i < b; i++) {
+      grown->put(i, array.get(i));
+    }
+    array_.store(grown, std::memory_order_release);
+    return grown;
+  }
+
+  //! Index of the next element to steal, written by thieves and by the owner when it pops the last element
+  CachePadded<std::atomic<std::int64_t>> top_;
+  //! Index of the next element to push, written by the owner
+  CachePadded<std::atomic<std::int64_t>> bottom_;
+  //! Current circular array
+  std::atomic<Array*> array_;
+  //! All arrays allocated so far (owner thread only)
+  std::vector<std::unique_ptr<Array>> arrays_;
+};  // class ChaseLevDeque
+
+
+/*!
+ * @brief Options of ThreadPool
+ */
+struct ThreadPoolOptions
+{
+  //! Number of threads including the calling thread (0: one per CPU selected by useSmt)
+  std::size_t nThreads = 0;
+  //! true to use every logical CPU, false to use one logical CPU per physical core
+  bool useSmt = false;
+  //! true to pin each worker thread to its CPU
+  bool pinThreads = true;
+};  // struct ThreadPoolOptions
+
+
+/*!
+ * @brief Work-stealing thread pool placed by the CPUID topology
+ *
+ * By default there is one thread per physical core (CpuTopology::physicalCoreCpus(), P-cores first);
+ * the thread which calls parallelFor() takes part as one of them, so size() - 1 worker threads are created,
+ * each pinned to its own core.
+ * Every thread owns a ChaseLevDeque; an idle thread steals first from threads on its own NUMA node,
+ * in random order, and only then from the other nodes.
+ * Workers sleep while no parallel loop is running.
+ *
+ * Loops are split recursively in halves down to chunks of a grain size,
+ * whose default comes from the L2 size (see defaultGrainSize()).
+ * Chunk boundaries are multiples of chunkAlignment() elements, counted from index 0,
+ * so two chunks of an array aligned to getFalseSharingRange() never write to the same cache line.
+ *
+ * @code
+ * auto data = simdutil::alignedMalloc<float>(n * sizeof(float), simdutil::getFalseSharingRange());
+ * simdutil::parallelFor<float>(0, n, [&](std::size_t first, std::size_t last) {
+ *   for (auto i = first; i < last; i++) {
+ *     data[i] = f(i);
+ *   }
+ * });
+ * @endcode
+ */
+class ThreadPool
+{
+public:
+  /*!
+   * @brief Start the worker threads
+   * @param [in] options  Options
+   */
+  explicit ThreadPool(const ThreadPoolOptions& options = ThreadPoolOptions{})
+    : workers_(std::max<std::size_t>(options.nThreads != 0 ? options.nThreads : selectCpus(options.useSmt).size(), 1))
+    , mutex_{}
+    , cv_{}
+    , callerMutex_{}
+    , activeJobs_{0}
+    , nReady_{0}
+    , isStarted_{false}
+    , isStopped_{false}
+  {
+    const auto cpus = selectCpus(options.useSmt);
+    for (std::size_t i = 0; i < workers_.size(); i++) {
+      workers_[i].pool = this;
+      workers_[i].cpu = options.pinThreads && i != 0 && !cpus.empty() ? cpus[i % cpus.size()] : -1;
+      workers_[i].rng = static_cast<std::uint32_t>(i * 0x9e3779b9U) | 1U;
+    }
+    try {
+      for (std::size_t i = 1; i < workers_.size(); i++) {
+        workers_[i].thread = std::thread{&ThreadPool::workerLoop, this, std::ref(workers_[i])};
+      }
+    } catch (...) {
+      stop();
+      throw;
+    }
+
+    // The NUMA node of each worker is known once it runs on its CPU
+    std::unique_lock<std::mutex> lock{mutex_};
+    cv_.wait(lock, [this] { return nReady_ == workers_.size() - 1; });
+    for (std::size_t i = 0; i < workers_.size(); i++) {
+      buildVictims(i);
+    }
+    isStarted_ = true;
+    lock.unlock();
+    cv_.notify_all();
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  ~ThreadPool()
+  {
+    stop();
+  }
+
+  /*!
+   * @brief Get the process-wide pool with the default options, started on first use
+   * @return  Reference to the pool
+   */
+  static ThreadPool&
+  get()
+  {
+    static ThreadPool instance;
+    return instance;
+  }
+
+  /*!
+   * @brief Get the number of threads, including the calling thread
+   * @return  Number of threads
+   */
+  std::size_t
+  size() const noexcept
+  {
+    return workers_.size();
+  }
+
+  /*!
+   * @brief Get the granularity of chunk boundaries
+   *
+   * This is the smallest number of elements which spans a whole number of getFalseSharingRange() blocks
+   * (or of alignOf<T>() for over-aligned types).
+   *
+   * @return  Number of elements
+   */
+  template<typename T>
+  static std::size_t
+  chunkAlignment() noexcept
+  {
+    const auto nBytes = std::max(getFalseSharingRange(), alignOf<T>());
+    return nBytes / gcd(nBytes, sizeof(T));
+  }
+
+  /*!
+   * @brief Get the default number of elements per chunk
+   *
+   * A chunk of T covers half of the L2 cache, leaving room for the other operands of the loop body,
+   * but the range is cut into at least four chunks per thread so that stealing can balance uneven chunks.
+   * The result is a multiple of chunkAlignment<T>().
+   *
+   * @param [in] n  Number of elements of the loop
+   * @return  Number of elements per chunk
+   */
+  template<typename T>
+  std::size_t
+  defaultGrainSize(std::size_t n) const noexcept
+  {
+    const auto unit = chunkAlignment<T>();
+    auto l2Size = CacheHierarchy::get().dataCacheSize(2);
+    if (l2Size == 0) {
+      l2Size = kDefaultL2Size;
+    }
+    const auto cacheGrain = l2Size / 2 / sizeof(T) / unit * unit;
+    const auto nChunks = size() * kChunksPerThread;
+    const auto balanceGrain = ((n + nChunks - 1) / nChunks + unit - 1) / unit * unit;
+    return std::max(unit, std::min(cacheGrain, balanceGrain));
+  }
+
+  /*!
+   * @brief Call a function on chunks of an index range in parallel
+   *
+   * The calling thread takes part and returns when all chunks are done.
+   * If calls of the function throw, the remaining chunks are skipped and the first exception is rethrown.
+   *
+   * @tparam T  Element type of the arrays indexed by the loop, which determines the chunk size and boundaries
+   * @param [in] first  First index
+   * @param [in] last   Last index (exclusive)
+   * @param [in] f      Function called as f(chunkFirst, chunkLast)
+   * @param [in] grain  Number of elements per chunk (0: defaultGrainSize<T>()), rounded up to chunkAlignment<T>()
+   */
+  template<typename T, typename F>
+  void
+  parallelFor(std::size_t first, std::size_t last, F&& f, std::size_t grain = 0)
+  {
+    if (first >= last) {
+      return;
+    }
+    auto body = [&f](std::size_t chunkFirst, std::size_t chunkLast, std::size_t) {
+      f(chunkFirst, chunkLast);
+    };
+    FunctionJob<decltype(body)> job{first, last, roundGrainSize<T>(first, last, grain), chunkAlignment<T>(), body};
+    run(job);
+  }
+
+  /*!
+   * @brief Reduce an index range in parallel
+   *
+   * Each chunk is mapped to a value, and the values are reduced in chunk order by the calling thread,
+   * so the result for the same chunks does not depend on the scheduling.
+   *
+   * @tparam T  Element type of the arrays indexed by the loop, which determines the chunk size and boundaries
+   * @param [in] first     First index
+   * @param [in] last      Last index (exclusive)
+   * @param [in] identity  Identity value of the reduction
+   * @param [in] map       Function called as map(chunkFirst, chunkLast), which returns the value of a chunk
+   * @param [in] reduce    Function called as reduce(accumulated, value)
+   * @param [in] grain     Number of elements per chunk (0: defaultGrainSize<T>()), rounded up to chunkAlignment<T>()
+   * @return  Reduced value
+   */
+  template<typename T, typename U, typename F, typename R>
+  U
+  parallelReduce(std::size_t first, std::size_t last, U identity, F&& map, R&& reduce, std::size_t grain = 0)
+  {
+    if (first >= last) {
+      return identity;
+    }
+    const auto grainSize = roundGrainSize<T>(first, last, grain);
+    // One padded slot per chunk: workers write distinct objects (unlike the bits of std::vector<bool>)
+    // on distinct cache lines
+    CachePaddedVector<U> values;
+    auto body = [&map, &values](std::size_t chunkFirst, std::size_t chunkLast, std::size_t chunk) {
+      *values[chunk] = map(chunkFirst, chunkLast);
+    };
+    FunctionJob<decltype(body)> job{first, last, grainSize, chunkAlignment<T>(), body};
+    values.assign(job.chunkCount(), CachePadded<U>{identity});
+    run(job);
+    for (const auto& value : values) {
+      identity = reduce(std::move(identity), *value);
+    }
+    return identity;
+  }
+
+private:
+  //! Assumed L2 size if CPUID does not report one
+  static constexpr std::size_t kDefaultL2Size = 256 * 1024;
+  //! Minimum number of chunks per thread of the default grain size
+  static constexpr std::size_t kChunksPerThread = 4;
+  //! Number of failed steal rounds with PAUSE before yielding the CPU
+  static constexpr unsigned int kSpinCount = 64;
+
+  class Job;
+
+  //! Range of chunks of a job
+  struct Task
+  {
+    //! Job
+    Job* job;
+    //! First chunk
+    std::size_t firstChunk;
+    //! Last chunk (exclusive)
+    std::size_t lastChunk;
+  };  // struct Task
+
+  //! One parallel loop: its chunk geometry, its tasks and its completion state
+  class Job
+  {
+  public:
+    Job(std::size_t first, std::size_t last, std::size_t grain, std::size_t unit)
+      : first_{first}
+      , last_{last}
+      , origin_{first / unit * unit}
+      , grain_{grain}
+      , tasks_((last - first / unit * unit + grain - 1) / grain)
+      , nTasks_{1}
+      , remaining_{tasks_.size()}
+      , isFailed_{false}
+      , exceptionMutex_{}
+      , exception_{}
+    {
+      tasks_[0] = Task{this, 0, tasks_.size()};
+    }
+
+    Job(const Job&) = delete;
+    Job& operator=(const Job&) = delete;
+
+    virtual ~Job() = default;
+
+    std::size_t
+    chunkCount() const noexcept
+    {
+      return tasks_.size();
+    }
+
+    Task&
+    rootTask() noexcept
+    {
+      return tasks_[0];
+    }
+
+    //! Take one of the preallocated tasks; splitting n chunks in halves never needs more than n
+    Task*
+    newTask(std::size_t firstChunk, std::size_t lastChunk) noexcept
+    {
+      auto& task = tasks_[nTasks_.fetch_add(1, std::memory_order_relaxed)];
+      task = Task{this, firstChunk, lastChunk};
+      return &task;
+    }
+
+    void
+    runChunk(std::size_t chunk) noexcept
+    {
+      if (!isFailed_.load(std::memory_order_relaxed)) {
+        try {
+          invoke(std::max(first_, origin_ + chunk * grain_), std::min(last_, origin_ + (chunk + 1) * grain_), chunk);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock{exceptionMutex_};
+          if (!exception_) {
+            exception_ = std::current_exception();
+          }
+          isFailed_.store(true, std::memory_order_relaxed);
+        }
+      }
+      // The job may be destroyed by its caller as soon as this reaches 0
+      remaining_.fetch_sub(1, std::memory_order_release);
+    }
+
+    bool
+    isDone() const noexcept
+    {
+      return remaining_.load(std::memory_order_acquire) == 0;
+    }
+
+    void
+    rethrowIfFailed()
+    {
+      if (exception_) {
+        std::rethrow_exception(exception_);
+      }
+    }
+
+  protected:
+    virtual void
+    invoke(std::size_t first, std::size_t last, std::size_t chunk) = 0;
+
+  private:
+    //! First index
+    std::size_t first_;
+    //! Last index (exclusive)
+    std::size_t last_;
+    //! Aligned index where chunk 0 starts
+    std::size_t origin_;
+    //! Number of elements per chunk
+    std::size_t grain_;
+    //! Preallocated tasks
+    std::vector<Task> tasks_;
+    //! Number of tasks taken
+    std::atomic<std::size_t> nTasks_;
+    //! Number of chunks not done yet
+    std::atomic<std::size_t> remaining_;
+    //! true if a chunk threw an exception
+    std::atomic<bool> isFailed_;
+    //! Guard of exception_
+    std::mutex exceptionMutex_;
+    //! The first exception thrown by a chunk
+    std::exception_ptr exception_;
+  };  // class Job
+
+  template<typename F>
+  class FunctionJob final : public Job
+  {
+  public:
+    FunctionJob(std::size_t first, std::size_t last, std::size_t grain, std::size_t unit, F& f)
+      : Job{first, last, grain, unit}
+      , f_(f)
+    {}
+
+  protected:
+    void
+    invoke(std::size_t first, std::size_t last, std::size_t chunk) override
+    {
+      f_(first, last, chunk);
+    }
+
+  private:
+    //! Loop body
+    F& f_;
+  };  // class FunctionJob
+
+  //! Per-thread state; slot 0 belongs to the thread calling parallelFor() from outside the pool
+  struct Worker
+  {
+    Worker()
+      : deque{}
+      , thread{}
+      , pool{nullptr}
+      , cpu{-1}
+      , node{0}
+      , victims{}
+      , nLocalVictims{0}
+      , rng{1}
+    {}
+
+    Worker(const Worker&) = delete;
+    Worker& operator=(const Worker&) = delete;
+
+    //! Tasks of this thread
+    ChaseLevDeque<Task*> deque;
+    //! Thread (not joinable for slot 0)
+    std::thread thread;
+    //! Owner pool
+    ThreadPool* pool;
+    //! OS processor index, or -1 if not pinned
+    int cpu;
+    //! NUMA node
+    int node;
+    //! Slots to steal from: those on the same NUMA node first
+    std::vector<std::size_t> victims;
+    //! Number of victims on the same NUMA node
+    std::size_t nLocalVictims;
+    //! State of the xorshift generator which picks the first victim
+    std::uint32_t rng;
+  };  // struct Worker
+
+  static std::size_t
+  gcd(std::size_t a, std::size_t b) noexcept
+  {
+    while (b != 0) {
+      const auto r = a % b;
+      a = b;
+      b = r;
+    }
+    return a;
+  }
+
+  static std::vector<int>
+  selectCpus(bool useSmt)
+  {
+    const auto& topology = CpuTopology::get();
+    auto cpus = topology.physicalCoreCpus();
+    if (useSmt) {
+      // SMT siblings after all physical cores, so that a smaller nThreads still gets distinct cores
+      for (const auto& info : topology.cpus()) {
+        if (std::find(cpus.begin(), cpus.end(), info.cpu) == cpus.end()) {
+          cpus.push_back(info.cpu);
+        }
+      }
+    }
+    return cpus;
+  }
+
+  static Worker*&
+  currentWorker() noexcept
+  {
+    static thread_local Worker* worker = nullptr;
+    return worker;
+  }
+
+  static void
+  backoff(unsigned int& nFailures) noexcept
+  {
+    if (++nFailures < kSpinCount) {
+      _mm_pause();
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+  template<typename T>
+  std::size_t
+  roundGrainSize(std::size_t first, std::size_t last, std::size_t grain) const noexcept
+  {
+    const auto unit = chunkAlignment<T>();
+    return grain == 0 ? defaultGrainSize<T>(last - first) : (grain + unit - 1) / unit * unit;
+  }
+
+  void
+  buildVictims(std::size_t index)
+  {
+    auto& self = workers_[index];
+    std::vector<std::size_t> remote;
+    for (std::size_t i = 0; i < workers_.size(); i++) {
+      if (i == index) {
+        continue;
+      }
+      // Slot 0 receives every loop started from outside the pool, and its thread is not pinned
+      if (i == 0 || index == 0 || workers_[i].node == self.node) {
+        self.victims.push_back(i);
+      } else {
+        remote.push_back(i);
+      }
+    }
+    self.nLocalVictims = self.victims.size();
+    self.victims.insert(self.victims.end(), remote.begin(), remote.end());
+  }
+
+  bool
+  steal(Worker& self, Task*& task) noexcept
+  {
+    self.rng ^= self.rng << 13;
+    self.rng ^= self.rng >> 17;
+    self.rng ^= self.rng << 5;
+    const auto nLocal = self.nLocalVictims;
+    const auto nRemote = self.victims.size() - nLocal;
+    for (std::size_t i = 0; i < nLocal; i++) {
+      if (workers_[self.victims[(self.rng + i) % nLocal]].deque.steal(task)) {
+        return true;
+      }
+    }
+    for (std::size_t i = 0; i < nRemote; i++) {
+      if (workers_[self.victims[nLocal + (self.rng + i) % nRemote]].deque.steal(task)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static void
+  execute(Worker& self, Task& task)
+  {
+    auto& job = *task.job;
+    const auto firstChunk = task.firstChunk;
+    auto lastChunk = task.lastChunk;
+    // Keep the first half and expose the second half to thieves, down to a single chunk
+    while (lastChunk - firstChunk > 1) {
+      const auto middleChunk = firstChunk + (lastChunk - firstChunk) / 2;
+      self.deque.push(job.newTask(middleChunk, lastChunk));
+      lastChunk = middleChunk;
+    }
+    job.runChunk(firstChunk);
+  }
+
+  void
+  run(Job& job)
+  {
+    auto previous = currentWorker();
+    auto self = previous;
+    std::unique_lock<std::mutex> callerLock{callerMutex_, std::defer_lock};
+    if (self == nullptr || self->pool != this) {
+      // Threads outside the pool share slot 0, one at a time
+      callerLock.lock();
+      self = &workers_[0];
+      currentWorker() = self;
+    }
+    if (workers_.size() > 1) {
+      {
+        std::lock_guard<std::mutex> lock{mutex_};
+        activeJobs_.fetch_add(1, std::memory_order_relaxed);
+      }
+      cv_.notify_all();
+    }
+
+    execute(*self, job.rootTask());
+    // Help with any task while waiting, including tasks of other jobs (nested loops)
+    unsigned int nFailures = 0;
+    while (!job.isDone()) {
+      Task* task;
+      if (self->deque.pop(task) || steal(*self, task)) {
+        execute(*self, *task);
+        nFailures = 0;
+      } else {
+        backoff(nFailures);
+      }
+    }
+
+    if (workers_.size() > 1) {
+      std::lock_guard<std::mutex> lock{mutex_};
+      activeJobs_.fetch_sub(1, std::memory_order_relaxed);
+    }
+    currentWorker() = previous;
+    job.rethrowIfFailed();
+  }
+
+  void
+  workerLoop(Worker& self)
+  {
+    currentWorker() = &self;
+    if (self.cpu >= 0) {
+      setCurrentThreadAffinity(self.cpu);
+    }
+    self.node = getCurrentNumaNode();
+    {
+      std::unique_lock<std::mutex> lock{mutex_};
+      nReady_++;
+      cv_.notify_all();
+      cv_.wait(lock, [this] { return isStarted_ || isStopped_; });
+    }
+
+    unsigned int nFailures = 0;
+    for (;;) {
+      Task* task;
+      if (self.deque.pop(task) || steal(self, task)) {
+        execute(self, *task);
+        nFailures = 0;
+      } else if (activeJobs_.load(std::memory_order_relaxed) != 0) {
+        backoff(nFailures);
+      } else {
+        std::unique_lock<std::mutex> lock{mutex_};
+        cv_.wait(lock, [this] { return activeJobs_.load(std::memory_order_relaxed) != 0 || isStopped_; });
+        if (isStopped_) {
+          return;
+        }
+      }
+    }
+  }
+
+  void
+  stop() noexcept
+  {
+    {
+      std::lock_guard<std::mutex> lock{mutex_};
+      isStopped_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) {
+      if (worker.thread.joinable()) {
+        worker.thread.join();
+      }
+    }
+  }
+
+  //! Per-thread state, padded so that the deques of two threads never share a line
+  std::vector<Worker, AlignedAllocator<Worker, kCachePadSize>> workers_;
+  //! Guard of activeJobs_ updates, nReady_, isStarted_ and isStopped_
+  std::mutex mutex_;
+  //! Wakes sleeping workers
+  std::condition_variable cv_;
+  //! Serializes the threads which use slot 0
+  std::mutex callerMutex_;
+  //! Number of running loops; workers sleep while it is 0
+  std::atomic<std::size_t> activeJobs_;
+  //! Number of workers which have pinned themselves
+  std::size_t nReady_;
+  //! true once the steal order is built
+  bool isStarted_;
+  //! true when the pool is being destroyed
+  bool isStopped_;
+};  // class ThreadPool
+
+constexpr std::size_t ThreadPool::kDefaultL2Size;
+constexpr std::size_t ThreadPool::kChunksPerThread;
+constexpr unsigned int ThreadPool::kSpinCount;
+
+
+/*!
+ * @brief Call a function on chunks of an index range in parallel on ThreadPool::get()
+ * @tparam T  Element type of the arrays indexed by the loop, which determines the chunk size and boundaries
+ * @param [in] first  First index
+ * @param [in] last   Last index (exclusive)
+ * @param [in] f      Function called as f(chunkFirst, chunkLast)
+ * @param [in] grain  Number of elements per chunk (0: the default)
+ */
+template<typename T, typename F>
+static inline void
+parallelFor(std::size_t first, std::size_t last, F&& f, std::size_t grain = 0)
+{
+  ThreadPool::get().parallelFor<T>(first, last, std::forward<F>(f), grain);
+}
+
+/*!
+ * @brief Reduce an index range in parallel on ThreadPool::get()
+ * @tparam T  Element type of the arrays indexed by the loop, which determines the chunk size and boundaries
+ * @param [in] first     First index
+ * @param [in] last      Last index (exclusive)
+ * @param [in] identity  Identity value of the reduction
+ * @param [in] map       Function called as map(chunkFirst, chunkLast), which returns the value of a chunk
+ * @param [in] reduce    Function called as reduce(accumulated, value)
+ * @param [in] grain     Number of elements per chunk (0: the default)
+ * @return  Reduced value
+ */
+template<typename T, typename U, typename F, typename R>
+static inline U
+parallelReduce(std::size_t first, std::size_t last, U identity, F&& map, R&& reduce, std::size_t grain = 0)
+{
+  return ThreadPool::get().parallelReduce<T>(first, last, std::move(identity), std::forward<F>(map), std::forward<R>(reduce), grain);
+}
+
+
+}  // namespace simdutil
+
+
+#endif  // SIMDUTIL_THREAD_POOL_HPP
@@ -0,0 +1,542 @@
+#ifndef SIMDUTIL_TSC_HPP
+#define SIMDUTIL_TSC_HPP
+
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#else
+#  include <x86intrin.h>
+#endif  // defined(_MSC_VER)
+
+#include "bitops.hpp"
+#include "cpuid.hpp"
+
+
+namespace simdutil
+{
+/*!
+ * @brief Where TscClock got the TSC frequency from
+ */
+enum class TscFrequencySource
+{
+  //! CPUID leaf 0x15 / 0x16, or the hypervisor timing leaf (See getCpuidTscFrequency())
+  kCpuid,
+  //! Measured against std::chrono::steady_clock
+  kCalibrated
+};  // enum class TscFrequencySource
+
+
+/*!
+ * @brief Clock on the time stamp counter
+ *
+ * Reading the TSC takes a few nanoseconds, against 20-40 ns for std::chrono::steady_clock under many hypervisors.
+ * Ticks are converted to nanoseconds with the frequency from CPUID when it is reported,
+ * otherwise with a frequency calibrated once against std::chrono::steady_clock.
+ * The conversion is only meaningful with an invariant TSC (isInvariant()), which all x86 CPUs of the last decade have.
+ *
+ * now() is not ordered with surrounding instructions. To time a short code sequence,
+ * bracket it with start() and stop(), which fence so that the measured instructions neither start
+ * before start() nor retire after stop().
+ */
+class TscClock
+{
+public:
+  /*!
+   * @brief Get the process-wide clock parameters, calibrating on first use
+   * @return  Reference to the clock
+   */
+  static const TscClock&
+  get()
+  {
+    static const TscClock instance;
+    return instance;
+  }
+
+  /*!
+   * @brief Read the TSC without ordering (RDTSC)
+   * @return  Ticks
+   */
+  static std::uint64_t
+  now() noexcept
+  {
+    return __rdtsc();
+  }
+
+  /*!
+   * @brief Read the TSC at the beginning of a measured region (LFENCE; RDTSC; LFENCE)
+   * @return  Ticks
+   */
+  static std::uint64_t
+  start() noexcept
+  {
+    _mm_lfence();
+    const auto ticks = __rdtsc();
+    _mm_lfence();
+    return ticks;
+  }
+
+  /*!
+   * @brief Read the TSC at the end of a measured region (RDTSCP; LFENCE), falling back to LFENCE; RDTSC
+   * @return  Ticks
+   */
+  static std::uint64_t
+  stop() noexcept
+  {
+    if (hasRdtscp()) {
+      unsigned int aux;
+      const auto ticks = __rdtscp(&aux);
+      _mm_lfence();
+      return ticks;
+    }
+    _mm_lfence();
+    const auto ticks = __rdtsc();
+    _mm_lfence();
+    return ticks;
+  }
+
+  /*!
+   * @brief Read the TSC and the processor ID (RDTSCP)
+   *
+   * Ticks read on different processors are only comparable if the TSCs are synchronized,
+   * which the OS usually guarantees with an invariant TSC; the ID tells whether the thread migrated.
+   *
+   * @param [out] processorId  IA32_TSC_AUX, which Linux sets to (NUMA node << 12) | CPU number
+   * @return  Ticks
+   */
+  static std::uint64_t
+  now(unsigned int& processorId) noexcept
+  {
+    return __rdtscp(&processorId);
+  }
+
+  /*!
+   * @brief Get the TSC frequency
+   * @return  Ticks per second
+   */
+  std::uint64_t
+  frequency() const noexcept
+  {
+    return frequency_;
+  }
+
+  /*!
+   * @brief Get the TSC frequency in ticks per nanosecond
+   * @return  Ticks per nanosecond (GHz)
+   */
+  double
+  ticksPerNs() const noexcept
+  {
+    return ticksPerNs_;
+  }
+
+  /*!
+   * @brief Get where the frequency came from
+   * @return  Frequency source
+   */
+  TscFrequencySource
+  source() const noexcept
+  {
+    return source_;
+  }
+
+  /*!
+   * @brief Check whether the TSC is invariant, i.e. ticks can be converted to time
+   * @return  true if the TSC is invariant
+   */
+  bool
+  isInvariant() const noexcept
+  {
+    return isInvariant_;
+  }
+
+  /*!
+   * @brief Convert ticks to nanoseconds
+   * @param [in] ticks  Ticks
+   * @return  Nanoseconds
+   */
+  double
+  toNs(std::uint64_t ticks) const noexcept
+  {
+    return static_cast<double>(ticks) * nsPerTick_;
+  }
+
+  /*!
+   * @brief Convert nanoseconds to ticks
+   * @param [in] ns  Nanoseconds
+   * @return  Ticks
+   */
+  std::uint64_t
+  toTicks(double ns) const noexcept
+  {
+    return static_cast<std::uint64_t>(ns * ticksPerNs_);
+  }
+
+private:
+  //! Duration of the calibration against std::chrono::steady_clock
+  static constexpr int kCalibrationMs = 20;
+
+  TscClock()
+    : frequency_{getCpuidTscFrequency()}
+    , ticksPerNs_{}
+    , nsPerTick_{}
+    , source_{TscFrequencySource::kCpuid}
+    , isInvariant_{isInvariantTscAvailable()}
+  {
+    if (frequency_ == 0) {
+      frequency_ = calibrate();
+      source_ = TscFrequencySource::kCalibrated;
+    }
+    ticksPerNs_ = static_cast<double>(frequency_) * 1.0e-9;
+    nsPerTick_ = 1.0 / ticksPerNs_;
+  }
+
+  static bool
+  hasRdtscp() noexcept
+  {
+    static const bool hasRdtscp = isRdtscpAvailable();
+    return hasRdtscp;
+  }
+
+  /*!
+   * @brief Measure the TSC frequency against std::chrono::steady_clock
+   *
+   * Each end point reads steady_clock between two TSC reads and keeps the tightest of a few tries,
+   * so that a preemption or a slow clock read does not skew the result.
+   *
+   * @return  Ticks per second
+   */
+  static std::uint64_t
+  calibrate() noexcept
+  {
+    using Clock = std::chrono::steady_clock;
+    const auto sample = [](std::uint64_t& ticks, Clock::time_point& time) {
+      auto best = ~std::uint64_t{0};
+      for (int i = 0; i < 5; i++) {
+        const auto t0 = start();
+        const auto now = Clock::now();
+        const auto t1 = stop();
+        if (t1 - t0 < best) {
+          best = t1 - t0;
+          ticks = t0 + (t1 - t0) / 2;
+          time = now;
+        }
+      }
+    };
+
+    std::uint64_t ticks0 = 0, ticks1 = 0;
+    Clock::time_point time0, time1;
+    sample(ticks0, time0);
+    while (Clock::now() - time0 < std::chrono::milliseconds(kCalibrationMs)) {
+    }
+    sample(ticks1, time1);
+    const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(time1 - time0).count();
+    return static_cast<std::uint64_t>(static_cast<double>(ticks1 - ticks0) * 1.0e9 / static_cast<double>(ns));
+  }
+
+  //! Ticks per second
+  std::uint64_t frequency_;
+  //! Ticks per nanosecond
+  double ticksPerNs_;
+  //! Nanoseconds per tick
+  double nsPerTick_;
+  //! Where frequency_ came from
+  TscFrequencySource source_;
+  //! true if the TSC is invariant
+  bool isInvariant_;
+};  // class TscClock
+
+constexpr int TscClock::kCalibrationMs;
+
+
+/*!
+ * @brief Logarithmic bucketing of LatencyHistogram, in the style of HdrHistogram
+ *
+ * Values below 2^kSubBucketBits have a bucket each; above, every power of two is split into 2^kSubBucketBits
+ * linear sub-buckets, so the relative error of a bucketed value is below 2^-kSubBucketBits (about 3 %)
+ * over the whole 64-bit range.
+ */
+struct LatencyBuckets
+{
+  //! log2 of the number of sub-buckets per power of two
+  static constexpr int kSubBucketBits = 5;
+  //! Number of sub-buckets per power of two
+  static constexpr std::size_t kSubBucketCount = std::size_t{1} << kSubBucketBits;
+  //! Number of buckets
+  static constexpr std::size_t kBucketCount = (64 - kSubBucketBits + 1) * kSubBucketCount;
+
+  /*!
+   * @brief Get the bucket of a value
+   * @param [in] value  Value
+   * @return  Bucket index
+   */
+  static std::size_t
+  indexOf(std::uint64_t value) noexcept
+  {
+    if (value < kSubBucketCount) {
+      return static_cast<unsigned int>(value);
+    }
+    const auto shift = 63 - countLeadingZeros(value) - kSubBucketBits;
+    return (static_cast<std::size_t>(shift + 1) << kSubBucketBits) + static_cast<unsigned int>(value >> shift) - kSubBucketCount;
+  }
+
+  /*!
+   * @brief Get the smallest value of a bucket
+   * @param [in] index  Bucket index
+   * @return  Lower bound of the bucket
+   */
+  static std::uint64_t
+  lowerBound(std::size_t index) noexcept
+  {
+    if (index < kSubBucketCount) {
+      return index;
+    }
+    const auto shift = static_cast<int>(index >> kSubBucketBits) - 1;
+    return std::uint64_t{kSubBucketCount + (index & (kSubBucketCount - 1))} << shift;
+  }
+
+  /*!
+   * @brief Get the largest value of a bucket
+   * @param [in] index  Bucket index
+   * @return  Upper bound of the bucket (inclusive)
+   */
+  static std::uint64_t
+  upperBound(std::size_t index) noexcept
+  {
+    return index + 1 < kBucketCount ? lowerBound(index + 1) - 1 : ~std::uint64_t{0};
+  }
+};  // struct LatencyBuckets
+
+constexpr int LatencyBuckets::kSubBucketBits;
+constexpr std::size_t LatencyBuckets::kSubBucketCount;
+constexpr std::size_t LatencyBuckets::kBucketCount;
+
+
+/*!
+ * @brief Plain copy of a LatencyHistogram, which can be merged and queried
+ */
+class LatencyHistogramSnapshot
+{
+public:
+  LatencyHistogramSnapshot() noexcept
+    : counts_{}
+    , count_{0}
+    , sum_{0}
+    , min_{~std::uint64_t{0}}
+    , max_{0}
+  {}
+
+  std::uint64_t count() const noexcept { return count_; }
+  std::uint64_t sum() const noexcept { return sum_; }
+  std::uint64_t min() const noexcept { return count_ == 0 ? 0 : min_; }
+  std::uint64_t max() const noexcept { return max_; }
+  double mean() const noexcept { return count_ == 0 ? 0.0 : static_cast<double>(sum_) / static_cast<double>(count_); }
+
+  /*!
+   * @brief Get the number of values in a bucket
+   * @param [in] index  Bucket index (See LatencyBuckets)
+   * @return  Number of values
+   */
+  std::uint64_t
+  bucketCount(std::size_t index) const noexcept
+  {
+    return counts_[index];
+  }
+
+  /*!
+   * @brief Get a percentile
+   * @param [in] percentile  Percentile in [0, 100]
+   * @return  Upper bound of the bucket containing the percentile, clamped to [min(), max()] (0 if empty)
+   */
+  std::uint64_t
+  valueAtPercentile(double percentile) const noexcept
+  {
+    if (count_ == 0) {
+      return 0;
+    }
+    const auto rank = std::max<std::uint64_t>(
+      static_cast<std::uint64_t>(std::min(std::max(percentile, 0.0), 100.0) / 100.0 * static_cast<double>(count_) + 0.5),
+      1);
+    std::uint64_t cumulative = 0;
+    for (std::size_t i = 0; i < counts_.size(); i++) {
+      cumulative += counts_[i];
+      if (cumulative >= rank) {
+        return std::min(std::max(LatencyBuckets::upperBound(i), min_), max_);
+      }
+    }
+    return max_;
+  }
+
+  /*!
+   * @brief Add another snapshot, e.g. of another thread
+   * @param [in] other  Snapshot to add
+   */
+  void
+  merge(const LatencyHistogramSnapshot& other) noexcept
+  {
+    for (std::size_t i = 0; i < counts_.size(); i++) {
+      counts_[i] += other.counts_[i];
+    }
+    count_ += other.count_;
+    sum_ += other.sum_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+  }
+
+private:
+  friend class LatencyHistogram;
+
+  //! Number of values per bucket
+  std::array<std::uint64_t, LatencyBuckets::kBucketCount> counts_;
+  //! Number of values
+  std::uint64_t count_;
+  //! Sum of values
+  std::uint64_t sum_;
+  //! Smallest value
+  std::uint64_t min_;
+  //! Largest value
+  std::uint64_t max_;
+};  // class LatencyHistogramSnapshot
+
+
+/*!
+ * @brief Single-writer latency histogram for the hot path
+ *
+ * Each thread records into its own histogram (e.g. a thread_local one, or one per worker),
+ * so record() is a handful of plain loads and stores with no atomic read-modify-write and no lock.
+ * Other threads may call snapshot() at any time; counters are relaxed atomics,
+ * so a snapshot taken during recording is consistent per counter, not across counters.
+ * Values are unitless; recording TscClock ticks and converting percentiles with TscClock::toNs() keeps
+ * the conversion off the hot path.
+ */
+class LatencyHistogram
+{
+public:
+  LatencyHistogram() noexcept
+    : counts_{}
+    , count_{0}
+    , sum_{0}
+    , min_{~std::uint64_t{0}}
+    , max_{0}
+  {}
+
+  LatencyHistogram(const LatencyHistogram&) = delete;
+  LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+  /*!
+   * @brief Record a value (only from the owning thread)
+   * @param [in] value  Value, e.g. a latency in ticks or nanoseconds
+   */
+  void
+  record(std::uint64_t value) noexcept
+  {
+    increment(counts_[LatencyBuckets::indexOf(value)], 1);
+    increment(count_, 1);
+    increment(sum_, value);
+    if (value < min_.load(std::memory_order_relaxed)) {
+      min_.store(value, std::memory_order_relaxed);
+    }
+    if (value > max_.load(std::memory_order_relaxed)) {
+      max_.store(value, std::memory_order_relaxed);
+    }
+  }
+
+  /*!
+   * @brief Copy the counters (from any thread)
+   * @return  Snapshot of the histogram
+   */
+  LatencyHistogramSnapshot
+  snapshot() const noexcept
+  {
+    LatencyHistogramSnapshot result;
+    for (std::size_t i = 0; i < counts_.size(); i++) {
+      result.counts_[i] = counts_[i].load(std::memory_order_relaxed);
+    }
+    result.count_ = count_.load(std::memory_order_relaxed);
+    result.sum_ = sum_.load(std::memory_order_relaxed);
+    result.min_ = min_.load(std::memory_order_relaxed);
+    result.max_ = max_.load(std::memory_order_relaxed);
+    return result;
+  }
+
+  /*!
+   * @brief Clear the histogram (only from the owning thread)
+   */
+  void
+  reset() noexcept
+  {
+    for (auto& count : counts_) {
+      count.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    sum_.store(0, std::memory_order_relaxed);
+    min_.store(~std::uint64_t{0}, std::memory_order_relaxed);
+    max_.store(0, std::memory_order_relaxed);
+  }
+
+private:
+  /*!
+   * @brief Add to a counter which only this thread writes: a load and a store, not a locked RMW
+   * @param [in,out] counter  Counter
+   * @param [in] value  Value to add
+   */
+  static void
+  increment(std::atomic<std::uint64_t>& counter, std::uint64_t value) noexcept
+  {
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+  }
+
+  //! Number of values per bucket
+  std::array<std::atomic<std::uint64_t>, LatencyBuckets::kBucketCount> counts_;
+  //! Number of values
+  std::atomic<std::uint64_t> count_;
+  //! Sum of values
+  std::atomic<std::uint64_t> sum_;
+  //! Smallest value
+  std::atomic<std::uint64_t> min_;
+  //! Largest value
+  std::atomic<std::uint64_t> max_;
+};  // class LatencyHistogram
+
+
+/*!
+ * @brief Records the TSC ticks from construction to destruction into a LatencyHistogram
+ */
+class ScopedLatency
+{
+public:
+  /*!
+   * @brief Start timing
+   * @param [in,out] histogram  Histogram of the calling thread
+   */
+  explicit ScopedLatency(LatencyHistogram& histogram) noexcept
+    : histogram_(histogram)
+    , start_{TscClock::start()}
+  {}
+
+  ScopedLatency(const ScopedLatency&) = delete;
+  ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+  ~ScopedLatency()
+  {
+    histogram_.record(TscClock::stop() - start_);
+  }
+
+private:
+  //! Histogram to record to
+  LatencyHistogram& histogram_;
+  //! Ticks at construction
+  std::uint64_t start_;
+};  // class ScopedLatency
+
+
+}  // namespace simdutil
+
+
+#endif  // SIMDUTIL_TSC_HPP
@@ -0,0 +1,694 @@
+#ifndef SIMDUTIL_VEC_HPP
+#define SIMDUTIL_VEC_HPP
+
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+
+#include "dispatch.hpp"
+
+
+#if defined(__GNUC__)
+#  define SIMDUTIL_FLATTEN __attribute__((flatten))
+#else
+#  define SIMDUTIL_FLATTEN
+#endif  // defined(__GNUC__)
+
+#if defined(__GNUC__)
+#  define SIMDUTIL_PURE __attribute__((pure))
+#else
+#  define SIMDUTIL_PURE
+#endif  // defined(__GNUC__)
+
+
+namespace simdutil
+{
+/*!
+ * @brief Lane mask held as an integer bitmask (bit i is lane i)
+ *
+ * Used by the scalar fallback and by the AVX-512 backend,
+ * where NativeType is exactly __mmask8 / __mmask16 and lives in an opmask register.
+ */
+template<std::size_t N>
+class BitMask
+{
+  static_assert(N != 0 && N <= 64, "Number of lanes must be in [1, 64]");
+
+public:
+  //! Integer type of the bitmask (__mmask8, __mmask16, __mmask32 or __mmask64)
+  using NativeType = typename std::conditional<
+    N <= 8,
+    std::uint8_t,
+    typename std::conditional<
+      N <= 16,
+      std::uint16_t,
+      typename std::conditional<N <= 32, std::uint32_t, std::uint64_t>::type
+    >::type
+  >::type;
+  //! Number of lanes
+  static constexpr std::size_t kSize = N;
+  //! Bitmask of all lanes
+  static constexpr NativeType kAllBits = static_cast<NativeType>(N == 64 ? ~0ULL : (1ULL << (N % 64)) - 1);
+
+  /*!
+   * @brief Construct a mask with no lane set
+   */
+  constexpr BitMask() noexcept
+    : bits_{0}
+  {}
+
+  /*!
+   * @brief Construct from a bitmask
+   * @param [in] bits  Bitmask (bits beyond N are ignored)
+   */
+  explicit constexpr BitMask(NativeType bits) noexcept
+    : bits_{static_cast<NativeType>(bits & kAllBits)}
+  {}
+
+  /*!
+   * @brief Make a mask of the first n lanes, used for loop remainders
+   * @param [in] n  Number of lanes to set
+   * @return  Mask of lanes [0, n)
+   */
+  static constexpr BitMask
+  firstN(std::size_t n) noexcept
+  {
+    return BitMask{n >= N ? kAllBits : static_cast<NativeType>((1ULL << n) - 1)};
+  }
+
+  NativeType native() const noexcept { return bits_; }
+  std::uint64_t bits() const noexcept { return bits_; }
+  bool test(std::size_t i) const noexcept { return ((bits_ >> i) & 1) != 0; }
+  bool any() const noexcept { return bits_ != 0; }
+  bool all() const noexcept { return bits_ == kAllBits; }
+  bool none() const noexcept { return bits_ == 0; }
+
+  BitMask operator&(const BitMask& rhs) const noexcept { return BitMask{static_cast<NativeType>(bits_ & rhs.bits_)}; }
+  BitMask operator|(const BitMask& rhs) const noexcept { return BitMask{static_cast<NativeType>(bits_ | rhs.bits_)}; }
+  BitMask operator^(const BitMask& rhs) const noexcept { return BitMask{static_cast<NativeType>(bits_ ^ rhs.bits_)}; }
+  BitMask operator~() const noexcept { return BitMask{static_cast<NativeType>(~bits_)}; }
+  bool operator==(const BitMask& rhs) const noexcept { return bits_ == rhs.bits_; }
+  bool operator!=(const BitMask& rhs) const noexcept { return bits_ != rhs.bits_; }
+
+private:
+  //! Bitmask
+  NativeType bits_;
+};  // class BitMask
+
+template<std::size_t N>
+constexpr std::size_t BitMask<N>::kSize;
+
+template<std::size_t N>
+constexpr typename BitMask<N>::NativeType BitMask<N>::kAllBits;
+
+
+/*!
+ * @brief Check the lane indices of Vec::permute()
+ * @tparam N         Number of lanes
+ * @tparam kIndices  Source lane of each destination lane
+ * @return  true if there are N indices and all of them are less than N, otherwise false
+ */
+template<
+  std::size_t N,
+  std::size_t... kIndices
+>
+static inline constexpr bool
+isPermuteValid() noexcept
+{
+  const std::size_t indices[] = {kIndices...};
+  for (const auto index : indices) {
+    if (index >= N) {
+      return false;
+    }
+  }
+  return sizeof...(kIndices) == N;
+}
+
+/*!
+ * @brief Pack lane indices into the immediate operand of a shuffle instruction
+ *
+ * Field i of the immediate is kBits wide and holds the source of destination lane i,
+ * which is the layout of pshufd / shufps (kBits = 2), shufpd (kBits = 1) and vpermq / vpermpd (kBits = 2).
+ *
+ * @tparam kBits     Width of a field
+ * @tparam kIndices  Source lane of each destination lane
+ * @return  Immediate operand
+ */
+template<
+  std::size_t kBits,
+  std::size_t... kIndices
+>
+static inline constexpr int
+getShuffleImmediate() noexcept
+{
+  const std::size_t indices[] = {kIndices...};
+  std::size_t imm = 0;
+  for (std::size_t i = 0; i < sizeof...(kIndices); i++) {
+    imm |= indices[i] << (i * kBits);
+  }
+  return static_cast<int>(imm);
+}
+
+/*!
+ * @brief Type in which the scalar Vec computes +, - and * of lane type T
+ *
+ * Integers are computed in an unsigned type at least as wide as unsigned int (to escape integral promotion),
+ * so the results wrap around like the SIMD backends instead of overflowing a signed type.
+ */
+template<
+  typename T,
+  bool kIsIntegral = std::is_integral<T>::value
+>
+struct WrappingType
+{
+  //! Type of the arithmetic
+  using type = T;
+};  // struct WrappingType
+
+template<typename T>
+struct WrappingType<T, true>
+{
+  //! Type of the arithmetic
+  using type = typename std::common_type<typename std::make_unsigned<T>::type, unsigned int>::type;
+};  // struct WrappingType
+
+
+/*!
+ * @brief Fixed-size SIMD vector of N lanes of T
+ *
+ * This primary template is the portable scalar fallback, holding lanes in std::array.
+ * Specializations for float, double, std::int32_t and std::int64_t map to native registers:
+ *
+ * | Lanes x Type                          | Backend | Header         |
+ * |---------------------------------------|---------|----------------|
+ * | 4 x float, 2 x double, 4 / 2 x intN   | SSE4.2  | vec_sse42.hpp  |
+ * | 8 x float, 4 x double, 8 / 4 x intN   | AVX2    | vec_avx2.hpp   |
+ * | 16 x float, 8 x double, 16 / 8 x intN | AVX-512 | vec_avx512.hpp |
+ *
+ * All backends share this interface, so kernels are written once as templates over the vector type.
+ * The members of native backends carry SIMDUTIL_TARGET_* attributes, which makes it possible to
+ * compile every backend in one translation unit and choose one at run time with Dispatcher.
+ * Kernel templates must be instantiated from a function with the matching SIMDUTIL_TARGET_* attribute
+ * and SIMDUTIL_FLATTEN, so that the whole kernel is inlined and compiled for that instruction set:
+ *
+ * @code
+ * template<typename V>
+ * static inline float
+ * sumKernel(const float* p, std::size_t n) noexcept
+ * {
+ *   V acc;
+ *   for (std::size_t i = 0; i < n; i += V::kSize) {
+ *     acc += V::loadu(p + i, n - i);
+ *   }
+ *   return acc.reduceAdd();
+ * }
+ *
+ * SIMDUTIL_TARGET_AVX2 SIMDUTIL_FLATTEN static float
+ * sumAvx2(const float* p, std::size_t n) noexcept
+ * {
+ *   return sumKernel<simdutil::Vec<float, 8>>(p, n);
+ * }
+ * @endcode
+ *
+ * Native backends have a user-provided copy constructor on purpose: vector types are then passed and returned
+ * through memory, so calls which are not inlined (e.g. at -O0) do not mix the SSE and AVX calling conventions
+ * of __m256 / __m512.
+ * With optimization, the copies vanish after inlining.
+ *
+ * Masks (MaskType) are BitMask for the scalar and AVX-512 backends, and XmmMask / YmmMask (all-ones lanes)
+ * for the SSE4.2 and AVX2 backends.
+ */
+template<
+  typename T,
+  std::size_t N
+>
+class Vec
+{
+  static_assert(std::is_arithmetic<T>::value, "Lane type must be arithmetic");
+
+public:
+  //! Lane type
+  using value_type = T;
+  //! Underlying storage type
+  using NativeType = std::array<T, N>;
+  //! Mask type returned by comparisons
+  using MaskType = BitMask<N>;
+  //! Number of lanes
+  static constexpr std::size_t kSize = N;
+
+  /*!
+   * @brief Construct a vector with all lanes zero
+   */
+  Vec() noexcept
+    : v_{}
+  {}
+
+  /*!
+   * @brief Construct from the underlying storage
+   * @param [in] v  Lanes
+   */
+  explicit Vec(const NativeType& v) noexcept
+    : v_(v)
+  {}
+
+  /*!
+   * @brief Make a vector with all lanes zero
+   * @return  Zero vector
+   */
+  static Vec
+  zero() noexcept
+  {
+    return Vec{};
+  }
+
+  /*!
+   * @brief Make a vector with all lanes set to a value
+   * @param [in] x  Value of lanes
+   * @return  Broadcasted vector
+   */
+  static Vec
+  broadcast(T x) noexcept
+  {
+    Vec r;
+    r.v_.fill(x);
+    return r;
+  }
+
+  /*!
+   * @brief Load from memory aligned to sizeof(Vec)
+   * @param [in] p  Aligned address
+   * @return  Loaded vector
+   */
+  static Vec
+  load(const T* p) noexcept
+  {
+    return loadu(p);
+  }
+
+  /*!
+   * @brief Load from memory of any alignment
+   * @param [in] p  Address
+   * @return  Loaded vector
+   */
+  static Vec
+  loadu(const T* p) noexcept
+  {
+    Vec r;
+    std::copy_n(p, N, r.v_.begin());
+    return r;
+  }
+
+  /*!
+   * @brief Load the first n lanes, without reading memory beyond them, and zero the rest
+   * @param [in] p  Address
+   * @param [in] n  Number of lanes to load (all lanes if n >= kSize)
+   * @return  Loaded vector
+   */
+  static Vec
+  loadu(const T* p, std::size_t n) noexcept
+  {
+    Vec r;
+    std::copy_n(p, std::min(n, N), r.v_.begin());
+    return r;
+  }
+
+  /*!
+   * @brief Store to memory aligned to sizeof(Vec)
+   * @param [out] p  Aligned address
+   */
+  void
+  store(T* p) const noexcept
+  {
+    storeu(p);
+  }
+
+  /*!
+   * @brief Store to memory of any alignment
+   * @param [out] p  Address
+   */
+  void
+  storeu(T* p) const noexcept
+  {
+    std::copy_n(v_.begin(), N, p);
+  }
+
+  /*!
+   * @brief Store the first n lanes, without writing memory beyond them
+   * @param [out] p  Address
+   * @param [in]  n  Number of lanes to store (all lanes if n >= kSize)
+   */
+  void
+  storeu(T* p, std::size_t n) const noexcept
+  {
+    std::copy_n(v_.begin(), std::min(n, N), p);
+  }
+
+  const NativeType& native() const noexcept { return v_; }
+  T operator[](std::size_t i) const noexcept { return v_[i]; }
+
+  Vec
+  operator+(const Vec& rhs) const noexcept
+  {
+    return map(rhs, [](T x, T y) { return static_cast<T>(static_cast<WrapType>(x) + static_cast<WrapType>(y)); });
+  }
+
+  Vec
+  operator-(const Vec& rhs) const noexcept
+  {
+    return map(rhs, [](T x, T y) { return static_cast<T>(static_cast<WrapType>(x) - static_cast<WrapType>(y)); });
+  }
+
+  Vec
+  operator*(const Vec& rhs) const noexcept
+  {
+    return map(rhs, [](T x, T y) { return static_cast<T>(static_cast<WrapType>(x) * static_cast<WrapType>(y)); });
+  }
+
+  Vec operator/(const Vec& rhs) const noexcept { return map(rhs, [](T x, T y) { return static_cast<T>(x / y); }); }
+  Vec operator&(const Vec& rhs) const noexcept { return map(rhs, [](T x, T y) { return static_cast<T>(x & y); }); }
+  Vec operator|(const Vec& rhs) const noexcept { return map(rhs, [](T x, T y) { return static_cast<T>(x | y); }); }
+  Vec operator^(const Vec& rhs) const noexcept { return map(rhs, [](T x, T y) { return static_cast<T>(x ^ y); }); }
+  Vec& operator+=(const Vec& rhs) noexcept { return *this = *this + rhs; }
+  Vec& operator-=(const Vec& rhs) noexcept { return *this = *this - rhs; }
+  Vec& operator*=(const Vec& rhs) noexcept { return *this = *this * rhs; }
+
+  MaskType operator==(const Vec& rhs) const noexcept { return compare(rhs, std::equal_to<T>{}); }
+  MaskType operator!=(const Vec& rhs) const noexcept { return compare(rhs, std::not_equal_to<T>{}); }
+  MaskType operator<(const Vec& rhs) const noexcept { return compare(rhs, std::less<T>{}); }
+  MaskType operator<=(const Vec& rhs) const noexcept { return compare(rhs, std::less_equal<T>{}); }
+  MaskType operator>(const Vec& rhs) const noexcept { return compare(rhs, std::greater<T>{}); }
+  MaskType operator>=(const Vec& rhs) const noexcept { return compare(rhs, std::greater_equal<T>{}); }
+
+  /*!
+   * @brief Reverse the order of lanes
+   * @return  Vector whose lane i is lane (kSize - 1 - i) of this vector
+   */
+  Vec
+  reverse() const noexcept
+  {
+    Vec r;
+    std::reverse_copy(v_.begin(), v_.end(), r.v_.begin());
+    return r;
+  }
+
+  /*!
+   * @brief Rearrange lanes by indices fixed at compile time
+   *
+   * This compiles to one pshufd / shufps / shufpd on SSE4.2, vpermd / vpermps / vpermq / vpermpd on AVX2
+   * and vpermd / vpermps / vpermq / vpermpd with an index register on AVX-512.
+   * In a template over the vector type, call it as v.template permute<...>().
+   *
+   * @code
+   * // {a, b, c, d} -> {b, a, d, c}
+   * const auto swapped = v.permute<1, 0, 3, 2>();
+   * @endcode
+   *
+   * @tparam kIndices  Source lane of each destination lane (kSize indices in [0, kSize))
+   * @return  Vector whose lane i is lane kIndices[i] of this vector
+   */
+  template<std::size_t... kIndices>
+  Vec
+  permute() const noexcept
+  {
+    static_assert(isPermuteValid<N, kIndices...>(), "permute() takes kSize lane indices less than kSize");
+    return Vec{NativeType{{v_[kIndices]...}}};
+  }
+
+  /*!
+   * @brief Sum all lanes
+   * @return  Sum of lanes
+   */
+  T
+  reduceAdd() const noexcept
+  {
+    T s = v_[0];
+    for (std::size_t i = 1; i < N; i++) {
+      s = static_cast<T>(s + v_[i]);
+    }
+    return s;
+  }
+
+  /*!
+   * @brief Get the minimum lane
+   * @return  Minimum of lanes
+   */
+  T
+  reduceMin() const noexcept
+  {
+    return *std::min_element(v_.begin(), v_.end());
+  }
+
+  /*!
+   * @brief Get the maximum lane
+   * @return  Maximum of lanes
+   */
+  T
+  reduceMax() const noexcept
+  {
+    return *std::max_element(v_.begin(), v_.end());
+  }
+
+  /*!
+   * @brief Lane-wise minimum
+   *
+   * As minps / minpd, a lane is taken from b unless a < b holds,
+   * so b is returned when either lane is NaN (and for -0.0 vs +0.0).
+   *
+   * @param [in] a  First operand
+   * @param [in] b  Second operand
+   * @return  Lane-wise minimum
+   */
+  friend Vec
+  min(const Vec& a, const Vec& b) noexcept
+  {
+    return a.map(b, [](T x, T y) { return x < y ? x : y; });
+  }
+
+  /*!
+   * @brief Lane-wise maximum
+   *
+   * As maxps / maxpd, a lane is taken from b unless a > b holds,
+   * so b is returned when either lane is NaN (and for -0.0 vs +0.0).
+   *
+   * @param [in] a  First operand
+   * @param [in] b  Second operand
+   * @return  Lane-wise maximum
+   */
+  friend Vec
+  max(const Vec& a, const Vec& b) noexcept
+  {
+    return a.map(b, [](T x, T y) { return x > y ? x : y; });
+  }
+
+  /*!
+   * @brief Fused multiply-add (a * b + c)
+   *
+   * Rounded once on backends with FMA (AVX2 and AVX-512); the SSE4.2 and scalar backends round twice.
+   *
+   * @param [in] a  Multiplicand
+   * @param [in] b  Multiplier
+   * @param [in] c  Addend
+   * @return  a * b + c
+   */
+  friend Vec
+  fma(const Vec& a, const Vec& b, const Vec& c) noexcept
+  {
+    return a * b + c;
+  }
+
+  /*!
+   * @brief Blend two vectors by a mask
+   * @param [in] mask  Lanes to take from a
+   * @param [in] a     Vector selected where mask is set
+   * @param [in] b     Vector selected where mask is clear
+   * @return  Blended vector
+   */
+  friend Vec
+  select(const MaskType& mask, const Vec& a, const Vec& b) noexcept
+  {
+    Vec r;
+    for (std::size_t i = 0; i < N; i++) {
+      r.v_[i] = mask.test(i) ? a.v_[i] : b.v_[i];
+    }
+    return r;
+  }
+
+private:
+  //! Type of +, - and * on lanes, which wraps around for integers
+  using WrapType = typename WrappingType<T>::type;
+
+  template<typename F>
+  Vec
+  map(const Vec& rhs, F f) const noexcept
+  {
+    Vec r;
+    for (std::size_t i = 0; i < N; i++) {
+      r.v_[i] = f(v_[i], rhs.v_[i]);
+    }
+    return r;
+  }
+
+  template<typename F>
+  SIMDUTIL_PURE MaskType
+  compare(const Vec& rhs, F f) const noexcept
+  {
+    typename MaskType::NativeType bits = 0;
+    for (std::size_t i = 0; i < N; i++) {
+      if (f(v_[i], rhs.v_[i])) {
+        bits = static_cast<typename MaskType::NativeType>(bits | (1ULL << i));
+      }
+    }
+    return MaskType{bits};
+  }
+
+  //! Lanes
+  NativeType v_;
+};  // class Vec
+
+template<
+  typename T,
+  std::size_t N
+>
+constexpr std::size_t Vec<T, N>::kSize;
+
+
+//! Mask type of Vec<T, N>
+template<
+  typename T,
+  std::size_t N
+>
+using Mask = typename Vec<T, N>::MaskType;
+
+
+/*!
+ * @brief Get the number of lanes of the widest vector of an instruction set level
+ *
+ * Levels below SSE4.2 use the scalar fallback with one lane,
+ * and AVX (without AVX2) uses 128-bit vectors since it lacks 256-bit integer instructions.
+ *
+ * @param [in] level  Instruction set level
+ * @return  Number of lanes
+ */
+template<typename T>
+static inline constexpr std::size_t
+getNativeVecSize(IsaLevel level) noexcept
+{
+  return level >= IsaLevel::kAvx512 ? 64 / sizeof(T)
+    : level >= IsaLevel::kAvx2 ? 32 / sizeof(T)
+    : level >= IsaLevel::kSse42 ? 16 / sizeof(T)
+    : 1;
+}
+
+
+//! Widest vector of T for an instruction set level
+template<
+  typename T,
+  IsaLevel kLevel
+>
+using NativeVec = Vec<T, getNativeVecSize<T>(kLevel)>;
+
+
+template<
+  template<typename> class Kernel,
+  typename T,
+  typename F
+>
+class VecDispatcher;
+
+/*!
+ * @brief Runtime dispatcher of a kernel written once as a template over the vector type
+ *
+ * Kernel<V> must provide a static member function run(Args...) which returns R.
+ * This class instantiates it with NativeVec<T, level> for the scalar, SSE4.2, AVX2 and AVX-512 levels,
+ * each inside a wrapper with the matching SIMDUTIL_TARGET_* attribute and SIMDUTIL_FLATTEN,
+ * and registers the wrappers to a Dispatcher.
+ *
+ * @code
+ * template<typename V>
+ * struct SumKernel
+ * {
+ *   static float run(const float* p, std::size_t n) noexcept { ... }
+ * };
+ *
+ * auto s = simdutil::VecDispatcher<SumKernel, float, float(const float*, std::size_t)>::call(p, n);
+ * @endcode
+ */
+template<
+  template<typename> class Kernel,
+  typename T,
+  typename R,
+  typename... Args
+>
+class VecDispatcher<Kernel, T, R(Args...)>
+{
+public:
+  //! Dispatcher type
+  using DispatcherType = Dispatcher<R(Args...)>;
+
+  /*!
+   * @brief Get the dispatcher of the kernel
+   * @return  Dispatcher shared by all callers
+   */
+  static const DispatcherType&
+  get() noexcept
+  {
+    static const DispatcherType dispatcher{
+      {IsaLevel::kAvx512, &runAvx512},
+      {IsaLevel::kAvx2, &runAvx2},
+      {IsaLevel::kSse42, &runSse42},
+      {IsaLevel::kScalar, &runScalar}};
+    return dispatcher;
+  }
+
+  /*!
+   * @brief Call the kernel for the best available instruction set level
+   * @param [in] args  Arguments of the kernel
+   * @return  Return value of the kernel
+   */
+  static R
+  call(Args... args)
+  {
+    return get()(std::forward<Args>(args)...);
+  }
+
+private:
+  static R
+  runScalar(Args... args)
+  {
+    return Kernel<NativeVec<T, IsaLevel::kScalar>>::run(std::forward<Args>(args)...);
+  }
+
+  SIMDUTIL_TARGET_SSE42 SIMDUTIL_FLATTEN static R
+  runSse42(Args... args)
+  {
+    return Kernel<NativeVec<T, IsaLevel::kSse42>>::run(std::forward<Args>(args)...);
+  }
+
+  SIMDUTIL_TARGET_AVX2 SIMDUTIL_FLATTEN static R
+  runAvx2(Args... args)
+  {
+    return Kernel<NativeVec<T, IsaLevel::kAvx2>>::run(std::forward<Args>(args)...);
+  }
+
+  SIMDUTIL_TARGET_AVX512 SIMDUTIL_FLATTEN static R
+  runAvx512(Args... args)
+  {
+    return Kernel<NativeVec<T, IsaLevel::kAvx512>>::run(std::forward<Args>(args)...);
+  }
+};  // class VecDispatcher
+
+
+}  // namespace simdutil
+
+
+#include "vec_sse42.hpp"
+#include "vec_avx2.hpp"
+#include "vec_avx512.hpp"
+
+
+#endif  // SIMDUTIL_VEC_HPP
@@ -0,0 +1,525 @@
+#ifndef SIMDUTIL_VEC_AVX2_HPP
+#define SIMDUTIL_VEC_AVX2_HPP
+
+#if !defined(SIMDUTIL_VEC_HPP)
+#  error "Do not include vec_avx2.hpp directly; include vec.hpp instead"
+#endif  // !defined(SIMDUTIL_VEC_HPP)
+
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#else
+#  include <immintrin.h>
+#endif  // defined(_MSC_VER)
+
+
+namespace simdutil
+{
+/*!
+ * @brief Lane mask of a 256-bit vector, held as all-ones / all-zeros lanes
+ */
+template<std::size_t kLaneBytes>
+class YmmMask
+{
+  static_assert(kLaneBytes == 4 || kLaneBytes == 8, "Lane size must be 4 or 8 bytes");
+
+public:
+  //! Register type
+  using NativeType = __m256i;
+  //! Number of lanes
+  static constexpr std::size_t kSize = 32 / kLaneBytes;
+
+  SIMDUTIL_TARGET_AVX2 YmmMask() noexcept : m_{_mm256_setzero_si256()} {}
+  SIMDUTIL_TARGET_AVX2 explicit YmmMask(__m256i m) noexcept : m_{m} {}
+  SIMDUTIL_TARGET_AVX2 YmmMask(const YmmMask& other) noexcept : m_{other.m_} {}
+  SIMDUTIL_TARGET_AVX2 YmmMask& operator=(const YmmMask& other) noexcept { m_ = other.m_; return *this; }
+
+  /*!
+   * @brief Make a mask of the first n lanes, used for loop remainders
+   * @param [in] n  Number of lanes to set
+   * @return  Mask of lanes [0, n)
+   */
+  SIMDUTIL_TARGET_AVX2 static YmmMask
+  firstN(std::size_t n) noexcept
+  {
+    const auto m = static_cast<int>(std::min(n, kSize));
+    return YmmMask{kLaneBytes == 4
+      ? _mm256_cmpgt_epi32(_mm256_set1_epi32(m), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7))
+      : _mm256_cmpgt_epi64(_mm256_set1_epi64x(m), _mm256_setr_epi64x(0, 1, 2, 3))};
+  }
+
+  SIMDUTIL_TARGET_AVX2 __m256i native() const noexcept { return m_; }
+  SIMDUTIL_TARGET_AVX2 bool test(std::size_t i) const noexcept { return ((bits() >> i) & 1) != 0; }
+  SIMDUTIL_TARGET_AVX2 bool any() const noexcept { return _mm256_testz_si256(m_, m_) == 0; }
+  SIMDUTIL_TARGET_AVX2 bool all() const noexcept { return _mm256_testc_si256(m_, _mm256_set1_epi32(-1)) != 0; }
+  SIMDUTIL_TARGET_AVX2 bool none() const noexcept { return _mm256_testz_si256(m_, m_) != 0; }
+
+  /*!
+   * @brief Get the mask as an integer bitmask (bit i is lane i)
+   * @return  Bitmask
+   */
+  SIMDUTIL_TARGET_AVX2 std::uint64_t
+  bits() const noexcept
+  {
+    return static_cast<std::uint64_t>(kLaneBytes == 4
+      ? _mm256_movemask_ps(_mm256_castsi256_ps(m_))
+      : _mm256_movemask_pd(_mm256_castsi256_pd(m_)));
+  }
+
+  SIMDUTIL_TARGET_AVX2 YmmMask operator&(const YmmMask& rhs) const noexcept { return YmmMask{_mm256_and_si256(m_, rhs.m_)}; }
+  SIMDUTIL_TARGET_AVX2 YmmMask operator|(const YmmMask& rhs) const noexcept { return YmmMask{_mm256_or_si256(m_, rhs.m_)}; }
+  SIMDUTIL_TARGET_AVX2 YmmMask operator^(const YmmMask& rhs) const noexcept { return YmmMask{_mm256_xor_si256(m_, rhs.m_)}; }
+  SIMDUTIL_TARGET_AVX2 YmmMask operator~() const noexcept { return YmmMask{_mm256_xor_si256(m_, _mm256_set1_epi32(-1))}; }
+  SIMDUTIL_TARGET_AVX2 bool operator==(const YmmMask& rhs) const noexcept { return bits() == rhs.bits(); }
+  SIMDUTIL_TARGET_AVX2 bool operator!=(const YmmMask& rhs) const noexcept { return bits() != rhs.bits(); }
+
+private:
+  //! All-ones / all-zeros lanes
+  __m256i m_;
+};  // class YmmMask
+
+template<std::size_t kLaneBytes>
+constexpr std::size_t YmmMask<kLaneBytes>::kSize;
+
+
+/*!
+ * @brief 8 x float on AVX2 + FMA (See the primary template Vec for the interface)
+ */
+template<>
+class Vec<float, 8>
+{
+public:
+  using value_type = float;
+  using NativeType = __m256;
+  using MaskType = YmmMask<4>;
+  static constexpr std::size_t kSize = 8;
+
+  SIMDUTIL_TARGET_AVX2 Vec() noexcept : v_{_mm256_setzero_ps()} {}
+  SIMDUTIL_TARGET_AVX2 explicit Vec(__m256 v) noexcept : v_{v} {}
+  SIMDUTIL_TARGET_AVX2 Vec(const Vec& other) noexcept : v_{other.v_} {}
+  SIMDUTIL_TARGET_AVX2 Vec& operator=(const Vec& other) noexcept { v_ = other.v_; return *this; }
+
+  SIMDUTIL_TARGET_AVX2 static Vec zero() noexcept { return Vec{}; }
+  SIMDUTIL_TARGET_AVX2 static Vec broadcast(float x) noexcept { return Vec{_mm256_set1_ps(x)}; }
+  SIMDUTIL_TARGET_AVX2 static Vec load(const float* p) noexcept { return Vec{_mm256_load_ps(p)}; }
+  SIMDUTIL_TARGET_AVX2 static Vec loadu(const float* p) noexcept { return Vec{_mm256_loadu_ps(p)}; }
+
+  SIMDUTIL_TARGET_AVX2 static Vec
+  loadu(const float* p, std::size_t n) noexcept
+  {
+    return n >= kSize ? loadu(p) : Vec{_mm256_maskload_ps(p, MaskType::firstN(n).native())};
+  }
+
+  SIMDUTIL_TARGET_AVX2 void store(float* p) const noexcept { _mm256_store_ps(p, v_); }
+  SIMDUTIL_TARGET_AVX2 void storeu(float* p) const noexcept { _mm256_storeu_ps(p, v_); }
+
+  SIMDUTIL_TARGET_AVX2 void
+  storeu(float* p, std::size_t n) const noexcept
+  {
+    if (n >= kSize) {
+      storeu(p);
+    } else {
+      _mm256_maskstore_ps(p, MaskType::firstN(n).native(), v_);
+    }
+  }
+
+  SIMDUTIL_TARGET_AVX2 __m256 native() const noexcept { return v_; }
+
+  SIMDUTIL_TARGET_AVX2 float
+  operator[](std::size_t i) const noexcept
+  {
+    std::array<float, kSize> a;
+    storeu(a.data());
+    return a[i];
+  }
+
+  SIMDUTIL_TARGET_AVX2 Vec operator+(const Vec& rhs) const noexcept { return Vec{_mm256_add_ps(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX2 Vec operator-(const Vec& rhs) const noexcept { return Vec{_mm256_sub_ps(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX2 Vec operator*(const Vec& rhs) const noexcept { return Vec{_mm256_mul_ps(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX2 Vec operator/(const Vec& rhs) const noexcept { return Vec{_mm256_div_ps(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX2 Vec& operator+=(const Vec& rhs) noexcept { return *this = *this + rhs; }
+  SIMDUTIL_TARGET_AVX2 Vec& operator-=(const Vec& rhs) noexcept { return *this = *this - rhs; }
+  SIMDUTIL_TARGET_AVX2 Vec& operator*=(const Vec& rhs) noexcept { return *this = *this * rhs; }
+
+  SIMDUTIL_TARGET_AVX2 MaskType operator==(const Vec& rhs) const noexcept { return toMask(_mm256_cmp_ps(v_, rhs.v_, _CMP_EQ_OQ)); }
+  SIMDUTIL_TARGET_AVX2 MaskType operator!=(const Vec& rhs) const noexcept { return toMask(_mm256_cmp_ps(v_, rhs.v_, _CMP_NEQ_UQ)); }
+  SIMDUTIL_TARGET_AVX2 MaskType operator<(const Vec& rhs) const noexcept { return toMask(_mm256_cmp_ps(v_, rhs.v_, _CMP_LT_OQ)); }
+  SIMDUTIL_TARGET_AVX2 MaskType operator<=(const Vec& rhs) const noexcept { return toMask(_mm256_cmp_ps(v_, rhs.v_, _CMP_LE_OQ)); }
+  SIMDUTIL_TARGET_AVX2 MaskType operator>(const Vec& rhs) const noexcept { return toMask(_mm256_cmp_ps(v_, rhs.v_, _CMP_GT_OQ)); }
+  SIMDUTIL_TARGET_AVX2 MaskType operator>=(const Vec& rhs) const noexcept { return toMask(_mm256_cmp_ps(v_, rhs.v_, _CMP_GE_OQ)); }
+
+  SIMDUTIL_TARGET_AVX2 Vec
+  reverse() const noexcept
+  {
+    return Vec{_mm256_permutevar8x32_ps(v_, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0))};
+  }
+
+  template<std::size_t... kIndices>
+  SIMDUTIL_TARGET_AVX2 Vec
+  permute() const noexcept
+  {
+    static_assert(isPermuteValid<kSize, kIndices...>(), "permute() takes kSize lane indices less than kSize");
+    return Vec{_mm256_permutevar8x32_ps(v_, _mm256_setr_epi32(static_cast<int>(kIndices)...))};
+  }
+
+  SIMDUTIL_TARGET_AVX2 float reduceAdd() const noexcept { return (lo() + hi()).reduceAdd(); }
+  SIMDUTIL_TARGET_AVX2 float reduceMin() const noexcept { return min(lo(), hi()).reduceMin(); }
+  SIMDUTIL_TARGET_AVX2 float reduceMax() const noexcept { return max(lo(), hi()).reduceMax(); }
+
+  SIMDUTIL_TARGET_AVX2 friend Vec min(const Vec& a, const Vec& b) noexcept { return Vec{_mm256_min_ps(a.v_, b.v_)}; }
+  SIMDUTIL_TARGET_AVX2 friend Vec max(const Vec& a, const Vec& b) noexcept { return Vec{_mm256_max_ps(a.v_, b.v_)}; }
+  SIMDUTIL_TARGET_AVX2 friend Vec fma(const Vec& a, const Vec& b, const Vec& c) noexcept { return Vec{_mm256_fmadd_ps(a.v_, b.v_, c.v_)}; }
+
+  SIMDUTIL_TARGET_AVX2 friend Vec
+  select(const MaskType& mask, const Vec& a, const Vec& b) noexcept
+  {
+    return Vec{_mm256_blendv_ps(b.v_, a.v_, _mm256_castsi256_ps(mask.native()))};
+  }
+
+private:
+  SIMDUTIL_TARGET_AVX2 static MaskType toMask(__m256 m) noexcept { return MaskType{_mm256_castps_si256(m)}; }
+  SIMDUTIL_TARGET_AVX2 Vec<float, 4> lo() const noexcept { return Vec<float, 4>{_mm256_castps256_ps128(v_)}; }
+  SIMDUTIL_TARGET_AVX2 Vec<float, 4> hi() const noexcept { return Vec<float, 4>{_mm256_extractf128_ps(v_, 1)}; }
+
+  //! Register
+  __m256 v_;
+};  // class Vec<float, 8>
+
+constexpr std::size_t Vec<float, 8>::kSize;
+
+
+/*!
+ * @brief 4 x double on AVX2 + FMA (See the primary template Vec for the interface)
+ */
+template<>
+class Vec<double, 4>
+{
+public:
+  using value_type = double;
+  using NativeType = __m256d;
+  using MaskType = YmmMask<8>;
+  static constexpr std::size_t kSize = 4;
+
+  SIMDUTIL_TARGET_AVX2 Vec() noexcept : v_{_mm256_setzero_pd()} {}
+  SIMDUTIL_TARGET_AVX2 explicit Vec(__m256d v) noexcept : v_{v} {}
+  SIMDUTIL_TARGET_AVX2 Vec(const Vec& other) noexcept : v_{other.v_} {}
+  SIMDUTIL_TARGET_AVX2 Vec& operator=(const Vec& other) noexcept { v_ = other.v_; return *this; }
+
+  SIMDUTIL_TARGET_AVX2 static Vec zero() noexcept { return Vec{}; }
+  SIMDUTIL_TARGET_AVX2 static Vec broadcast(double x) noexcept { return Vec{_mm256_set1_pd(x)}; }
+  SIMDUTIL_TARGET_AVX2 static Vec load(const double* p) noexcept { return Vec{_mm256_load_pd(p)}; }
+  SIMDUTIL_TARGET_AVX2 static Vec loadu(const double* p) noexcept { return Vec{_mm256_loadu_pd(p)}; }
+
+  SIMDUTIL_TARGET_AVX2 static Vec
+  loadu(const double* p, std::size_t n) noexcept
+  {
+    return n >= kSize ? loadu(p) : Vec{_mm256_maskload_pd(p, MaskType::firstN(n).native())};
+  }
+
+  SIMDUTIL_TARGET_AVX2 void store(double* p) const noexcept { _mm256_store_pd(p, v_); }
+  SIMDUTIL_TARGET_AVX2 void storeu(double* p) const noexcept { _mm256_storeu_pd(p, v_); }
+
+  SIMDUTIL_TARGET_AVX2 void
+  storeu(double* p, std::size_t n) const noexcept
+  {
+    if (n >= kSize) {
+      storeu(p);
+    } else {
+      _mm256_maskstore_pd(p, MaskType::firstN(n).native(), v_);
+    }
+  }
+
+  SIMDUTIL_TARGET_AVX2 __m256d native() const noexcept { return v_; }
+
+  SIMDUTIL_TARGET_AVX2 double
+  operator[](std::size_t i) const noexcept
+  {
+    std::array<double, kSize> a;
+    storeu(a.data());
+    return a[i];
+  }
+
+  SIMDUTIL_TARGET_AVX2 Vec operator+(const Vec& rhs) const noexcept { return Vec{_mm256_add_pd(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX2 Vec operator-(const Vec& rhs) const noexcept { return Vec{_mm256_sub_pd(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX2 Vec operator*(const Vec& rhs) const noexcept { return Vec{_mm256_mul_pd(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX2 Vec operator/(const Vec& rhs) const noexcept { return Vec{_mm256_div_pd(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX2 Vec& operator+=(const Vec& rhs) noexcept { return *this = *this + rhs; }
+  SIMDUTIL_TARGET_AVX2 Vec& operator-=(const Vec& rhs) noexcept { return *this = *this - rhs; }
+  SIMDUTIL_TARGET_AVX2 Vec& operator*=(const Vec& rhs) noexcept { return *this = *this * rhs; }
+
+  SIMDUTIL_TARGET_AVX2 MaskType operator==(const Vec& rhs) const noexcept { return toMask(_mm256_cmp_pd(v_, rhs.v_, _CMP_EQ_OQ)); }
+  SIMDUTIL_TARGET_AVX2 MaskType operator!=(const Vec& rhs) const noexcept { return toMask(_mm256_cmp_pd(v_, rhs.v_, _CMP_NEQ_UQ)); }
+  SIMDUTIL_TARGET_AVX2 MaskType operator<(const Vec& rhs) const noexcept { return toMask(_mm256_cmp_pd(v_, rhs.v_, _CMP_LT_OQ)); }
+  SIMDUTIL_TARGET_AVX2 MaskType operator<=(const Vec& rhs) const noexcept { return toMask(_mm256_cmp_pd(v_, rhs.v_, _CMP_LE_OQ)); }
+  SIMDUTIL_TARGET_AVX2 MaskType operator>(const Vec& rhs) const noexcept { return toMask(_mm256_cmp_pd(v_, rhs.v_, _CMP_GT_OQ)); }
+  SIMDUTIL_TARGET_AVX2 MaskType operator>=(const Vec& rhs) const noexcept { return toMask(_mm256_cmp_pd(v_, rhs.v_, _CMP_GE_OQ)); }
+
+  SIMDUTIL_TARGET_AVX2 Vec reverse() const noexcept { return Vec{_mm256_permute4x64_pd(v_, _MM_SHUFFLE(0, 1, 2, 3))}; }
+
+  template<std::size_t... kIndices>
+  SIMDUTIL_TARGET_AVX2 Vec
+  permute() const noexcept
+  {
+    static_assert(isPermuteValid<kSize, kIndices...>(), "permute() takes kSize lane indices less than kSize");
+    constexpr int kImm = getShuffleImmediate<2, kIndices...>();
+    return Vec{_mm256_permute4x64_pd(v_, kImm)};
+  }
+
+  SIMDUTIL_TARGET_AVX2 double reduceAdd() const noexcept { return (lo() + hi()).reduceAdd(); }
+  SIMDUTIL_TARGET_AVX2 double reduceMin() const noexcept { return min(lo(), hi()).reduceMin(); }
+  SIMDUTIL_TARGET_AVX2 double reduceMax() const noexcept { return max(lo(), hi()).reduceMax(); }
+
+  SIMDUTIL_TARGET_AVX2 friend Vec min(const Vec& a, const Vec& b) noexcept { return Vec{_mm256_min_pd(a.v_, b.v_)}; }
+  SIMDUTIL_TARGET_AVX2 friend Vec max(const Vec& a, const Vec& b) noexcept { return Vec{_mm256_max_pd(a.v_, b.v_)}; }
+  SIMDUTIL_TARGET_AVX2 friend Vec fma(const Vec& a, const Vec& b, const Vec& c) noexcept { return Vec{_mm256_fmadd_pd(a.v_, b.v_, c.v_)}; }
+
+  SIMDUTIL_TARGET_AVX2 friend Vec
+  select(const MaskType& mask, const Vec& a, const Vec& b) noexcept
+  {
+    return Vec{_mm256_blendv_pd(b.v_, a.v_, _mm256_castsi256_pd(mask.native()))};
+  }
+
+private:
+  SIMDUTIL_TARGET_AVX2 static MaskType toMask(__m256d m) noexcept { return MaskType{_mm256_castpd_si256(m)}; }
+  SIMDUTIL_TARGET_AVX2 Vec<double, 2> lo() const noexcept { return Vec<double, 2>{_mm256_castpd256_pd128(v_)}; }
+  SIMDUTIL_TARGET_AVX2 Vec<double, 2> hi() const noexcept { return Vec<double, 2>{_mm256_extractf128_pd(v_, 1)}; }
+
+  //! Register
+  __m256d v_;
+};  // class Vec<double, 4>
+
+constexpr std::size_t Vec<double, 4>::kSize;
+
+
+/*!
+ * @brief 8 x std::int32_t on AVX2 (See the primary template Vec for the interface)
+ */
+template<>
+class Vec<std::int32_t, 8>
+{
+public:
+  using value_type = std::int32_t;
+  using NativeType = __m256i;
+  using MaskType = YmmMask<4>;
+  static constexpr std::size_t kSize = 8;
+
+  SIMDUTIL_TARGET_AVX2 Vec() noexcept : v_{_mm256_setzero_si256()} {}
+  SIMDUTIL_TARGET_AVX2 explicit Vec(__m256i v) noexcept : v_{v} {}
+  SIMDUTIL_TARGET_AVX2 Vec(const Vec& other) noexcept : v_{other.v_} {}
+  SIMDUTIL_TARGET_AVX2 Vec& operator=(const Vec& other) noexcept { v_ = other.v_; return *this; }
+
+  SIMDUTIL_TARGET_AVX2 static Vec zero() noexcept { return Vec{}; }
+  SIMDUTIL_TARGET_AVX2 static Vec broadcast(std::int32_t x) noexcept { return Vec{_mm256_set1_epi32(x)}; }
+  SIMDUTIL_TARGET_AVX2 static Vec load(const std::int32_t* p) noexcept { return Vec{_mm256_load_si256(reinterpret_cast<const __m256i*>(static_cast<const void*>(p)))}; }
+  SIMDUTIL_TARGET_AVX2 static Vec loadu(const std::int32_t* p) noexcept { return Vec{_mm256_loadu_si256(reinterpret_cast<const __m256i*>(static_cast<const void*>(p)))}; }
+
+  SIMDUTIL_TARGET_AVX2 static Vec
+  loadu(const std::int32_t* p, std::size_t n) noexcept
+  {
+    return n >= kSize ? loadu(p) : Vec{_mm256_maskload_epi32(p, MaskType::firstN(n).native())};
+  }
+
+  SIMDUTIL_TARGET_AVX2 void store(std::int32_t* p) const noexcept { _mm256_store_si256(reinterpret_cast<__m256i*>(static_cast<void*>(p)), v_); }
+  SIMDUTIL_TARGET_AVX2 void storeu(std::int32_t* p) const noexcept { _mm256_storeu_si256(reinterpret_cast<__m256i*>(static_cast<void*>(p)), v_); }
+
+  SIMDUTIL_TARGET_AVX2 void
+  storeu(std::int32_t* p, std::size_t n) const noexcept
+  {
+    if (n >= kSize) {
+      storeu(p);
+    } else {
+      _mm256_maskstore_epi32(p, MaskType::firstN(n).native(), v_);
+    }
+  }
+
+  SIMDUTIL_TARGET_AVX2 __m256i native() const noexcept { return v_; }
+
+  SIMDUTIL_TARGET_AVX2 std::int32_t
+  operator[](std::size_t i) const noexcept
+  {
+    std::array<std::int32_t, kSize> a;
+    storeu(a.data());
+    return a[i];
+  }
+
+  SIMDUTIL_TARGET_AVX2 Vec operator+(const Vec& rhs) const noexcept { return Vec{_mm256_add_epi32(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX2 Vec operator-(const Vec& rhs) const noexcept { return Vec{_mm256_sub_epi32(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX2 Vec operator*(const Vec& rhs) const noexcept { return Vec{_mm256_mullo_epi32(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX2 Vec operator&(const Vec& rhs) const noexcept { return Vec{_mm256_and_si256(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX2 Vec operator|(const Vec& rhs) const noexcept { return Vec{_mm256_or_si256(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX2 Vec operator^(const Vec& rhs) const noexcept { return Vec{_mm256_xor_si256(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX2 Vec& operator+=(const Vec& rhs) noexcept { return *this = *this + rhs; }
+  SIMDUTIL_TARGET_AVX2 Vec& operator-=(const Vec& rhs) noexcept { return *this = *this - rhs; }
+  SIMDUTIL_TARGET_AVX2 Vec& operator*=(const Vec& rhs) noexcept { return *this = *this * rhs; }
+
+  SIMDUTIL_TARGET_AVX2 MaskType operator==(const Vec& rhs) const noexcept { return MaskType{_mm256_cmpeq_epi32(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX2 MaskType operator!=(const Vec& rhs) const noexcept { return ~(*this == rhs); }
+  SIMDUTIL_TARGET_AVX2 MaskType operator<(const Vec& rhs) const noexcept { return rhs > *this; }
+  SIMDUTIL_TARGET_AVX2 MaskType operator<=(const Vec& rhs) const noexcept { return ~(*this > rhs); }
+  SIMDUTIL_TARGET_AVX2 MaskType operator>(const Vec& rhs) const noexcept { return MaskType{_mm256_cmpgt_epi32(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX2 MaskType operator>=(const Vec& rhs) const noexcept { return ~(rhs > *this); }
+
+  SIMDUTIL_TARGET_AVX2 Vec
+  reverse() const noexcept
+  {
+    return Vec{_mm256_permutevar8x32_epi32(v_, _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0))};
+  }
+
+  template<std::size_t... kIndices>
+  SIMDUTIL_TARGET_AVX2 Vec
+  permute() const noexcept
+  {
+    static_assert(isPermuteValid<kSize, kIndices...>(), "permute() takes kSize lane indices less than kSize");
+    return Vec{_mm256_permutevar8x32_epi32(v_, _mm256_setr_epi32(static_cast<int>(kIndices)...))};
+  }
+
+  SIMDUTIL_TARGET_AVX2 std::int32_t reduceAdd() const noexcept { return (lo() + hi()).reduceAdd(); }
+  SIMDUTIL_TARGET_AVX2 std::int32_t reduceMin() const noexcept { return min(lo(), hi()).reduceMin(); }
+  SIMDUTIL_TARGET_AVX2 std::int32_t reduceMax() const noexcept { return max(lo(), hi()).reduceMax(); }
+
+  SIMDUTIL_TARGET_AVX2 friend Vec min(const Vec& a, const Vec& b) noexcept { return Vec{_mm256_min_epi32(a.v_, b.v_)}; }
+  SIMDUTIL_TARGET_AVX2 friend Vec max(const Vec& a, const Vec& b) noexcept { return Vec{_mm256_max_epi32(a.v_, b.v_)}; }
+  SIMDUTIL_TARGET_AVX2 friend Vec fma(const Vec& a, const Vec& b, const Vec& c) noexcept { return a * b + c; }
+
+  SIMDUTIL_TARGET_AVX2 friend Vec
+  select(const MaskType& mask, const Vec& a, const Vec& b) noexcept
+  {
+    return Vec{_mm256_blendv_epi8(b.v_, a.v_, mask.native())};
+  }
+
+private:
+  SIMDUTIL_TARGET_AVX2 Vec<std::int32_t, 4> lo() const noexcept { return Vec<std::int32_t, 4>{_mm256_castsi256_si128(v_)}; }
+  SIMDUTIL_TARGET_AVX2 Vec<std::int32_t, 4> hi() const noexcept { return Vec<std::int32_t, 4>{_mm256_extracti128_si256(v_, 1)}; }
+
+  //! Register
+  __m256i v_;
+};  // class Vec<std::int32_t, 8>
+
+constexpr std::size_t Vec<std::int32_t, 8>::kSize;
+
+
+/*!
+ * @brief 4 x std::int64_t on AVX2 (See the primary template Vec for the interface)
+ *
+ * Multiplication is emulated with three 32-bit multiplications since AVX2 has no 64-bit multiply,
+ * and min/max with a comparison and a blend.
+ */
+template<>
+class Vec<std::int64_t, 4>
+{
+public:
+  using value_type = std::int64_t;
+  using NativeType = __m256i;
+  using MaskType = YmmMask<8>;
+  static constexpr std::size_t kSize = 4;
+
+  SIMDUTIL_TARGET_AVX2 Vec() noexcept : v_{_mm256_setzero_si256()} {}
+  SIMDUTIL_TARGET_AVX2 explicit Vec(__m256i v) noexcept : v_{v} {}
+  SIMDUTIL_TARGET_AVX2 Vec(const Vec& other) noexcept : v_{other.v_} {}
+  SIMDUTIL_TARGET_AVX2 Vec& operator=(const Vec& other) noexcept { v_ = other.v_; return *this; }
+
+  SIMDUTIL_TARGET_AVX2 static Vec zero() noexcept { return Vec{}; }
+  SIMDUTIL_TARGET_AVX2 static Vec broadcast(std::int64_t x) noexcept { return Vec{_mm256_set1_epi64x(x)}; }
+  SIMDUTIL_TARGET_AVX2 static Vec load(const std::int64_t* p) noexcept { return Vec{_mm256_load_si256(reinterpret_cast<const __m256i*>(static_cast<const void*>(p)))}; }
+  SIMDUTIL_TARGET_AVX2 static Vec loadu(const std::int64_t* p) noexcept { return Vec{_mm256_loadu_si256(reinterpret_cast<const __m256i*>(static_cast<const void*>(p)))}; }
+
+  SIMDUTIL_TARGET_AVX2 static Vec
+  loadu(const std::int64_t* p, std::size_t n) noexcept
+  {
+    return n >= kSize ? loadu(p) : Vec{_mm256_maskload_epi64(reinterpret_cast<const long long*>(p), MaskType::firstN(n).native())};
+  }
+
+  SIMDUTIL_TARGET_AVX2 void store(std::int64_t* p) const noexcept { _mm256_store_si256(reinterpret_cast<__m256i*>(static_cast<void*>(p)), v_); }
+  SIMDUTIL_TARGET_AVX2 void storeu(std::int64_t* p) const noexcept { _mm256_storeu_si256(reinterpret_cast<__m256i*>(static_cast<void*>(p)), v_); }
+
+  SIMDUTIL_TARGET_AVX2 void
+  storeu(std::int64_t* p, std::size_t n) const noexcept
+  {
+    if (n >= kSize) {
+      storeu(p);
+    } else {
+      _mm256_maskstore_epi64(reinterpret_cast<long long*>(p), MaskType::firstN(n).native(), v_);
+    }
+  }
+
+  SIMDUTIL_TARGET_AVX2 __m256i native() const noexcept { return v_; }
+
+  SIMDUTIL_TARGET_AVX2 std::int64_t
+  operator[](std::size_t i) const noexcept
+  {
+    std::array<std::int64_t, kSize> a;
+    storeu(a.data());
+    return a[i];
+  }
+
+  SIMDUTIL_TARGET_AVX2 Vec operator+(const Vec& rhs) const noexcept { return Vec{_mm256_add_epi64(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX2 Vec operator-(const Vec& rhs) const noexcept { return Vec{_mm256_sub_epi64(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX2 Vec operator&(const Vec& rhs) const noexcept { return Vec{_mm256_and_si256(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX2 Vec operator|(const Vec& rhs) const noexcept { return Vec{_mm256_or_si256(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX2 Vec operator^(const Vec& rhs) const noexcept { return Vec{_mm256_xor_si256(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX2 Vec& operator+=(const Vec& rhs) noexcept { return *this = *this + rhs; }
+  SIMDUTIL_TARGET_AVX2 Vec& operator-=(const Vec& rhs) noexcept { return *this = *this - rhs; }
+  SIMDUTIL_TARGET_AVX2 Vec& operator*=(const Vec& rhs) noexcept { return *this = *this * rhs; }
+
+  SIMDUTIL_TARGET_AVX2 Vec
+  operator*(const Vec& rhs) const noexcept
+  {
+    // lo(a) * lo(b) + ((hi(a) * lo(b) + lo(a) * hi(b)) << 32)
+    const auto lo = _mm256_mul_epu32(v_, rhs.v_);
+    const auto cross = _mm256_add_epi64(
+      _mm256_mul_epu32(_mm256_srli_epi64(v_, 32), rhs.v_),
+      _mm256_mul_epu32(v_, _mm256_srli_epi64(rhs.v_, 32)));
+    return Vec{_mm256_add_epi64(lo, _mm256_slli_epi64(cross, 32))};
+  }
+
+  SIMDUTIL_TARGET_AVX2 MaskType operator==(const Vec& rhs) const noexcept { return MaskType{_mm256_cmpeq_epi64(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX2 MaskType operator!=(const Vec& rhs) const noexcept { return ~(*this == rhs); }
+  SIMDUTIL_TARGET_AVX2 MaskType operator<(const Vec& rhs) const noexcept { return rhs > *this; }
+  SIMDUTIL_TARGET_AVX2 MaskType operator<=(const Vec& rhs) const noexcept { return ~(*this > rhs); }
+  SIMDUTIL_TARGET_AVX2 MaskType operator>(const Vec& rhs) const noexcept { return MaskType{_mm256_cmpgt_epi64(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX2 MaskType operator>=(const Vec& rhs) const noexcept { return ~(rhs > *this); }
+
+  SIMDUTIL_TARGET_AVX2 Vec reverse() const noexcept { return Vec{_mm256_permute4x64_epi64(v_, _MM_SHUFFLE(0, 1, 2, 3))}; }
+
+  template<std::size_t... kIndices>
+  SIMDUTIL_TARGET_AVX2 Vec
+  permute() const noexcept
+  {
+    static_assert(isPermuteValid<kSize, kIndices...>(), "permute() takes kSize lane indices less than kSize");
+    constexpr int kImm = getShuffleImmediate<2, kIndices...>();
+    return Vec{_mm256_permute4x64_epi64(v_, kImm)};
+  }
+
+  SIMDUTIL_TARGET_AVX2 std::int64_t reduceAdd() const noexcept { return (lo() + hi()).reduceAdd(); }
+  SIMDUTIL_TARGET_AVX2 std::int64_t reduceMin() const noexcept { return min(lo(), hi()).reduceMin(); }
+  SIMDUTIL_TARGET_AVX2 std::int64_t reduceMax() const noexcept { return max(lo(), hi()).reduceMax(); }
+
+  SIMDUTIL_TARGET_AVX2 friend Vec min(const Vec& a, const Vec& b) noexcept { return select(a < b, a, b); }
+  SIMDUTIL_TARGET_AVX2 friend Vec max(const Vec& a, const Vec& b) noexcept { return select(a > b, a, b); }
+  SIMDUTIL_TARGET_AVX2 friend Vec fma(const Vec& a, const Vec& b, const Vec& c) noexcept { return a * b + c; }
+
+  SIMDUTIL_TARGET_AVX2 friend Vec
+  select(const MaskType& mask, const Vec& a, const Vec& b) noexcept
+  {
+    return Vec{_mm256_blendv_epi8(b.v_, a.v_, mask.native())};
+  }
+
+private:
+  SIMDUTIL_TARGET_AVX2 Vec<std::int64_t, 2> lo() const noexcept { return Vec<std::int64_t, 2>{_mm256_castsi256_si128(v_)}; }
+  SIMDUTIL_TARGET_AVX2 Vec<std::int64_t, 2> hi() const noexcept { return Vec<std::int64_t, 2>{_mm256_extracti128_si256(v_, 1)}; }
+
+  //! Register
+  __m256i v_;
+};  // class Vec<std::int64_t, 4>
+
+constexpr std::size_t Vec<std::int64_t, 4>::kSize;
+
+
+}  // namespace simdutil
+
+
+#endif  // SIMDUTIL_VEC_AVX2_HPP
@@ -0,0 +1,375 @@
+#ifndef SIMDUTIL_VEC_AVX512_HPP
+#define SIMDUTIL_VEC_AVX512_HPP
+
+#if !defined(SIMDUTIL_VEC_HPP)
+#  error "Do not include vec_avx512.hpp directly; include vec.hpp instead"
+#endif  // !defined(SIMDUTIL_VEC_HPP)
+
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#else
+#  include <immintrin.h>
+#endif  // defined(_MSC_VER)
+
+
+namespace simdutil
+{
+// GCC 12 implements the unmasked forms of many AVX-512 intrinsics (min, max, permutexvar, extracti64x4, ...)
+// as masked builtins with an _mm512_undefined_*() passthrough, which -Wmaybe-uninitialized reports once inlined.
+// This backend uses the zero-masked forms with a full mask and the AVX512DQ 32x8 extracts instead:
+// they compile to the same unmasked instructions.
+
+
+/*!
+ * @brief 16 x float on AVX-512 (See the primary template Vec for the interface)
+ *
+ * Comparisons return BitMask<16>, which is an opmask register (__mmask16).
+ */
+template<>
+class Vec<float, 16>
+{
+public:
+  using value_type = float;
+  using NativeType = __m512;
+  using MaskType = BitMask<16>;
+  static constexpr std::size_t kSize = 16;
+
+  SIMDUTIL_TARGET_AVX512 Vec() noexcept : v_{_mm512_setzero_ps()} {}
+  SIMDUTIL_TARGET_AVX512 explicit Vec(__m512 v) noexcept : v_{v} {}
+  SIMDUTIL_TARGET_AVX512 Vec(const Vec& other) noexcept : v_{other.v_} {}
+  SIMDUTIL_TARGET_AVX512 Vec& operator=(const Vec& other) noexcept { v_ = other.v_; return *this; }
+
+  SIMDUTIL_TARGET_AVX512 static Vec zero() noexcept { return Vec{}; }
+  SIMDUTIL_TARGET_AVX512 static Vec broadcast(float x) noexcept { return Vec{_mm512_set1_ps(x)}; }
+  SIMDUTIL_TARGET_AVX512 static Vec load(const float* p) noexcept { return Vec{_mm512_load_ps(p)}; }
+  SIMDUTIL_TARGET_AVX512 static Vec loadu(const float* p) noexcept { return Vec{_mm512_loadu_ps(p)}; }
+  SIMDUTIL_TARGET_AVX512 static Vec loadu(const float* p, std::size_t n) noexcept { return Vec{_mm512_maskz_loadu_ps(MaskType::firstN(n).native(), p)}; }
+  SIMDUTIL_TARGET_AVX512 void store(float* p) const noexcept { _mm512_store_ps(p, v_); }
+  SIMDUTIL_TARGET_AVX512 void storeu(float* p) const noexcept { _mm512_storeu_ps(p, v_); }
+  SIMDUTIL_TARGET_AVX512 void storeu(float* p, std::size_t n) const noexcept { _mm512_mask_storeu_ps(p, MaskType::firstN(n).native(), v_); }
+  SIMDUTIL_TARGET_AVX512 __m512 native() const noexcept { return v_; }
+
+  SIMDUTIL_TARGET_AVX512 float
+  operator[](std::size_t i) const noexcept
+  {
+    std::array<float, kSize> a;
+    storeu(a.data());
+    return a[i];
+  }
+
+  SIMDUTIL_TARGET_AVX512 Vec operator+(const Vec& rhs) const noexcept { return Vec{_mm512_add_ps(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX512 Vec operator-(const Vec& rhs) const noexcept { return Vec{_mm512_sub_ps(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX512 Vec operator*(const Vec& rhs) const noexcept { return Vec{_mm512_mul_ps(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX512 Vec operator/(const Vec& rhs) const noexcept { return Vec{_mm512_div_ps(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX512 Vec& operator+=(const Vec& rhs) noexcept { return *this = *this + rhs; }
+  SIMDUTIL_TARGET_AVX512 Vec& operator-=(const Vec& rhs) noexcept { return *this = *this - rhs; }
+  SIMDUTIL_TARGET_AVX512 Vec& operator*=(const Vec& rhs) noexcept { return *this = *this * rhs; }
+
+  SIMDUTIL_TARGET_AVX512 MaskType operator==(const Vec& rhs) const noexcept { return MaskType{_mm512_cmp_ps_mask(v_, rhs.v_, _CMP_EQ_OQ)}; }
+  SIMDUTIL_TARGET_AVX512 MaskType operator!=(const Vec& rhs) const noexcept { return MaskType{_mm512_cmp_ps_mask(v_, rhs.v_, _CMP_NEQ_UQ)}; }
+  SIMDUTIL_TARGET_AVX512 MaskType operator<(const Vec& rhs) const noexcept { return MaskType{_mm512_cmp_ps_mask(v_, rhs.v_, _CMP_LT_OQ)}; }
+  SIMDUTIL_TARGET_AVX512 MaskType operator<=(const Vec& rhs) const noexcept { return MaskType{_mm512_cmp_ps_mask(v_, rhs.v_, _CMP_LE_OQ)}; }
+  SIMDUTIL_TARGET_AVX512 MaskType operator>(const Vec& rhs) const noexcept { return MaskType{_mm512_cmp_ps_mask(v_, rhs.v_, _CMP_GT_OQ)}; }
+  SIMDUTIL_TARGET_AVX512 MaskType operator>=(const Vec& rhs) const noexcept { return MaskType{_mm512_cmp_ps_mask(v_, rhs.v_, _CMP_GE_OQ)}; }
+
+  SIMDUTIL_TARGET_AVX512 Vec
+  reverse() const noexcept
+  {
+    return Vec{_mm512_maskz_permutexvar_ps(MaskType::kAllBits, _mm512_setr_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0), v_)};
+  }
+
+  template<std::size_t... kIndices>
+  SIMDUTIL_TARGET_AVX512 Vec
+  permute() const noexcept
+  {
+    static_assert(isPermuteValid<kSize, kIndices...>(), "permute() takes kSize lane indices less than kSize");
+    const auto indices = _mm512_maskz_cvtepu8_epi32(MaskType::kAllBits, _mm_setr_epi8(static_cast<char>(kIndices)...));
+    return Vec{_mm512_maskz_permutexvar_ps(MaskType::kAllBits, indices, v_)};
+  }
+
+  SIMDUTIL_TARGET_AVX512 float reduceAdd() const noexcept { return (lo() + hi()).reduceAdd(); }
+  SIMDUTIL_TARGET_AVX512 float reduceMin() const noexcept { return min(lo(), hi()).reduceMin(); }
+  SIMDUTIL_TARGET_AVX512 float reduceMax() const noexcept { return max(lo(), hi()).reduceMax(); }
+
+  SIMDUTIL_TARGET_AVX512 friend Vec min(const Vec& a, const Vec& b) noexcept { return Vec{_mm512_maskz_min_ps(MaskType::kAllBits, a.v_, b.v_)}; }
+  SIMDUTIL_TARGET_AVX512 friend Vec max(const Vec& a, const Vec& b) noexcept { return Vec{_mm512_maskz_max_ps(MaskType::kAllBits, a.v_, b.v_)}; }
+  SIMDUTIL_TARGET_AVX512 friend Vec fma(const Vec& a, const Vec& b, const Vec& c) noexcept { return Vec{_mm512_fmadd_ps(a.v_, b.v_, c.v_)}; }
+  SIMDUTIL_TARGET_AVX512 friend Vec select(const MaskType& mask, const Vec& a, const Vec& b) noexcept { return Vec{_mm512_mask_blend_ps(mask.native(), b.v_, a.v_)}; }
+
+private:
+  SIMDUTIL_TARGET_AVX512 Vec<float, 8> lo() const noexcept { return Vec<float, 8>{_mm512_extractf32x8_ps(v_, 0)}; }
+  SIMDUTIL_TARGET_AVX512 Vec<float, 8> hi() const noexcept { return Vec<float, 8>{_mm512_extractf32x8_ps(v_, 1)}; }
+
+  //! Register
+  __m512 v_;
+};  // class Vec<float, 16>
+
+constexpr std::size_t Vec<float, 16>::kSize;
+
+
+/*!
+ * @brief 8 x double on AVX-512 (See the primary template Vec for the interface)
+ *
+ * Comparisons return BitMask<8>, which is an opmask register (__mmask8).
+ */
+template<>
+class Vec<double, 8>
+{
+public:
+  using value_type = double;
+  using NativeType = __m512d;
+  using MaskType = BitMask<8>;
+  static constexpr std::size_t kSize = 8;
+
+  SIMDUTIL_TARGET_AVX512 Vec() noexcept : v_{_mm512_setzero_pd()} {}
+  SIMDUTIL_TARGET_AVX512 explicit Vec(__m512d v) noexcept : v_{v} {}
+  SIMDUTIL_TARGET_AVX512 Vec(const Vec& other) noexcept : v_{other.v_} {}
+  SIMDUTIL_TARGET_AVX512 Vec& operator=(const Vec& other) noexcept { v_ = other.v_; return *this; }
+
+  SIMDUTIL_TARGET_AVX512 static Vec zero() noexcept { return Vec{}; }
+  SIMDUTIL_TARGET_AVX512 static Vec broadcast(double x) noexcept { return Vec{_mm512_set1_pd(x)}; }
+  SIMDUTIL_TARGET_AVX512 static Vec load(const double* p) noexcept { return Vec{_mm512_load_pd(p)}; }
+  SIMDUTIL_TARGET_AVX512 static Vec loadu(const double* p) noexcept { return Vec{_mm512_loadu_pd(p)}; }
+  SIMDUTIL_TARGET_AVX512 static Vec loadu(const double* p, std::size_t n) noexcept { return Vec{_mm512_maskz_loadu_pd(MaskType::firstN(n).native(), p)}; }
+  SIMDUTIL_TARGET_AVX512 void store(double* p) const noexcept { _mm512_store_pd(p, v_); }
+  SIMDUTIL_TARGET_AVX512 void storeu(double* p) const noexcept { _mm512_storeu_pd(p, v_); }
+  SIMDUTIL_TARGET_AVX512 void storeu(double* p, std::size_t n) const noexcept { _mm512_mask_storeu_pd(p, MaskType::firstN(n).native(), v_); }
+  SIMDUTIL_TARGET_AVX512 __m512d native() const noexcept { return v_; }
+
+  SIMDUTIL_TARGET_AVX512 double
+  operator[](std::size_t i) const noexcept
+  {
+    std::array<double, kSize> a;
+    storeu(a.data());
+    return a[i];
+  }
+
+  SIMDUTIL_TARGET_AVX512 Vec operator+(const Vec& rhs) const noexcept { return Vec{_mm512_add_pd(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX512 Vec operator-(const Vec& rhs) const noexcept { return Vec{_mm512_sub_pd(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX512 Vec operator*(const Vec& rhs) const noexcept { return Vec{_mm512_mul_pd(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX512 Vec operator/(const Vec& rhs) const noexcept { return Vec{_mm512_div_pd(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX512 Vec& operator+=(const Vec& rhs) noexcept { return *this = *this + rhs; }
+  SIMDUTIL_TARGET_AVX512 Vec& operator-=(const Vec& rhs) noexcept { return *this = *this - rhs; }
+  SIMDUTIL_TARGET_AVX512 Vec& operator*=(const Vec& rhs) noexcept { return *this = *this * rhs; }
+
+  SIMDUTIL_TARGET_AVX512 MaskType operator==(const Vec& rhs) const noexcept { return MaskType{_mm512_cmp_pd_mask(v_, rhs.v_, _CMP_EQ_OQ)}; }
+  SIMDUTIL_TARGET_AVX512 MaskType operator!=(const Vec& rhs) const noexcept { return MaskType{_mm512_cmp_pd_mask(v_, rhs.v_, _CMP_NEQ_UQ)}; }
+  SIMDUTIL_TARGET_AVX512 MaskType operator<(const Vec& rhs) const noexcept { return MaskType{_mm512_cmp_pd_mask(v_, rhs.v_, _CMP_LT_OQ)}; }
+  SIMDUTIL_TARGET_AVX512 MaskType operator<=(const Vec& rhs) const noexcept { return MaskType{_mm512_cmp_pd_mask(v_, rhs.v_, _CMP_LE_OQ)}; }
+  SIMDUTIL_TARGET_AVX512 MaskType operator>(const Vec& rhs) const noexcept { return MaskType{_mm512_cmp_pd_mask(v_, rhs.v_, _CMP_GT_OQ)}; }
+  SIMDUTIL_TARGET_AVX512 MaskType operator>=(const Vec& rhs) const noexcept { return MaskType{_mm512_cmp_pd_mask(v_, rhs.v_, _CMP_GE_OQ)}; }
+
+  SIMDUTIL_TARGET_AVX512 Vec reverse() const noexcept { return Vec{_mm512_maskz_permutexvar_pd(MaskType::kAllBits, _mm512_setr_epi64(7, 6, 5, 4, 3, 2, 1, 0), v_)}; }
+
+  template<std::size_t... kIndices>
+  SIMDUTIL_TARGET_AVX512 Vec
+  permute() const noexcept
+  {
+    static_assert(isPermuteValid<kSize, kIndices...>(), "permute() takes kSize lane indices less than kSize");
+    const auto indices = _mm512_maskz_cvtepu32_epi64(MaskType::kAllBits, _mm256_setr_epi32(static_cast<int>(kIndices)...));
+    return Vec{_mm512_maskz_permutexvar_pd(MaskType::kAllBits, indices, v_)};
+  }
+
+  SIMDUTIL_TARGET_AVX512 double reduceAdd() const noexcept { return (lo() + hi()).reduceAdd(); }
+  SIMDUTIL_TARGET_AVX512 double reduceMin() const noexcept { return min(lo(), hi()).reduceMin(); }
+  SIMDUTIL_TARGET_AVX512 double reduceMax() const noexcept { return max(lo(), hi()).reduceMax(); }
+
+  SIMDUTIL_TARGET_AVX512 friend Vec min(const Vec& a, const Vec& b) noexcept { return Vec{_mm512_maskz_min_pd(MaskType::kAllBits, a.v_, b.v_)}; }
+  SIMDUTIL_TARGET_AVX512 friend Vec max(const Vec& a, const Vec& b) noexcept { return Vec{_mm512_maskz_max_pd(MaskType::kAllBits, a.v_, b.v_)}; }
+  SIMDUTIL_TARGET_AVX512 friend Vec fma(const Vec& a, const Vec& b, const Vec& c) noexcept { return Vec{_mm512_fmadd_pd(a.v_, b.v_, c.v_)}; }
+  SIMDUTIL_TARGET_AVX512 friend Vec select(const MaskType& mask, const Vec& a, const Vec& b) noexcept { return Vec{_mm512_mask_blend_pd(mask.native(), b.v_, a.v_)}; }
+
+private:
+  SIMDUTIL_TARGET_AVX512 Vec<double, 4> lo() const noexcept { return Vec<double, 4>{_mm256_castps_pd(_mm512_extractf32x8_ps(_mm512_castpd_ps(v_), 0))}; }
+  SIMDUTIL_TARGET_AVX512 Vec<double, 4> hi() const noexcept { return Vec<double, 4>{_mm256_castps_pd(_mm512_extractf32x8_ps(_mm512_castpd_ps(v_), 1))}; }
+
+  //! Register
+  __m512d v_;
+};  // class Vec<double, 8>
+
+constexpr std::size_t Vec<double, 8>::kSize;
+
+
+/*!
+ * @brief 16 x std::int32_t on AVX-512 (See the primary template Vec for the interface)
+ *
+ * Comparisons return BitMask<16>, which is an opmask register (__mmask16).
+ */
+template<>
+class Vec<std::int32_t, 16>
+{
+public:
+  using value_type = std::int32_t;
+  using NativeType = __m512i;
+  using MaskType = BitMask<16>;
+  static constexpr std::size_t kSize = 16;
+
+  SIMDUTIL_TARGET_AVX512 Vec() noexcept : v_{_mm512_setzero_si512()} {}
+  SIMDUTIL_TARGET_AVX512 explicit Vec(__m512i v) noexcept : v_{v} {}
+  SIMDUTIL_TARGET_AVX512 Vec(const Vec& other) noexcept : v_{other.v_} {}
+  SIMDUTIL_TARGET_AVX512 Vec& operator=(const Vec& other) noexcept { v_ = other.v_; return *this; }
+
+  SIMDUTIL_TARGET_AVX512 static Vec zero() noexcept { return Vec{}; }
+  SIMDUTIL_TARGET_AVX512 static Vec broadcast(std::int32_t x) noexcept { return Vec{_mm512_set1_epi32(x)}; }
+  SIMDUTIL_TARGET_AVX512 static Vec load(const std::int32_t* p) noexcept { return Vec{_mm512_load_si512(p)}; }
+  SIMDUTIL_TARGET_AVX512 static Vec loadu(const std::int32_t* p) noexcept { return Vec{_mm512_loadu_si512(p)}; }
+  SIMDUTIL_TARGET_AVX512 static Vec loadu(const std::int32_t* p, std::size_t n) noexcept { return Vec{_mm512_maskz_loadu_epi32(MaskType::firstN(n).native(), p)}; }
+  SIMDUTIL_TARGET_AVX512 void store(std::int32_t* p) const noexcept { _mm512_store_si512(p, v_); }
+  SIMDUTIL_TARGET_AVX512 void storeu(std::int32_t* p) const noexcept { _mm512_storeu_si512(p, v_); }
+  SIMDUTIL_TARGET_AVX512 void storeu(std::int32_t* p, std::size_t n) const noexcept { _mm512_mask_storeu_epi32(p, MaskType::firstN(n).native(), v_); }
+  SIMDUTIL_TARGET_AVX512 __m512i native() const noexcept { return v_; }
+
+  SIMDUTIL_TARGET_AVX512 std::int32_t
+  operator[](std::size_t i) const noexcept
+  {
+    std::array<std::int32_t, kSize> a;
+    storeu(a.data());
+    return a[i];
+  }
+
+  SIMDUTIL_TARGET_AVX512 Vec operator+(const Vec& rhs) const noexcept { return Vec{_mm512_add_epi32(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX512 Vec operator-(const Vec& rhs) const noexcept { return Vec{_mm512_sub_epi32(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX512 Vec operator*(const Vec& rhs) const noexcept { return Vec{_mm512_mullo_epi32(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX512 Vec operator&(const Vec& rhs) const noexcept { return Vec{_mm512_and_si512(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX512 Vec operator|(const Vec& rhs) const noexcept { return Vec{_mm512_or_si512(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX512 Vec operator^(const Vec& rhs) const noexcept { return Vec{_mm512_xor_si512(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX512 Vec& operator+=(const Vec& rhs) noexcept { return *this = *this + rhs; }
+  SIMDUTIL_TARGET_AVX512 Vec& operator-=(const Vec& rhs) noexcept { return *this = *this - rhs; }
+  SIMDUTIL_TARGET_AVX512 Vec& operator*=(const Vec& rhs) noexcept { return *this = *this * rhs; }
+
+  SIMDUTIL_TARGET_AVX512 MaskType operator==(const Vec& rhs) const noexcept { return MaskType{_mm512_cmp_epi32_mask(v_, rhs.v_, _MM_CMPINT_EQ)}; }
+  SIMDUTIL_TARGET_AVX512 MaskType operator!=(const Vec& rhs) const noexcept { return MaskType{_mm512_cmp_epi32_mask(v_, rhs.v_, _MM_CMPINT_NE)}; }
+  SIMDUTIL_TARGET_AVX512 MaskType operator<(const Vec& rhs) const noexcept { return MaskType{_mm512_cmp_epi32_mask(v_, rhs.v_, _MM_CMPINT_LT)}; }
+  SIMDUTIL_TARGET_AVX512 MaskType operator<=(const Vec& rhs) const noexcept { return MaskType{_mm512_cmp_epi32_mask(v_, rhs.v_, _MM_CMPINT_LE)}; }
+  SIMDUTIL_TARGET_AVX512 MaskType operator>(const Vec& rhs) const noexcept { return MaskType{_mm512_cmp_epi32_mask(v_, rhs.v_, _MM_CMPINT_NLE)}; }
+  SIMDUTIL_TARGET_AVX512 MaskType operator>=(const Vec& rhs) const noexcept { return MaskType{_mm512_cmp_epi32_mask(v_, rhs.v_, _MM_CMPINT_NLT)}; }
+
+  SIMDUTIL_TARGET_AVX512 Vec
+  reverse() const noexcept
+  {
+    return Vec{_mm512_maskz_permutexvar_epi32(MaskType::kAllBits, _mm512_setr_epi32(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0), v_)};
+  }
+
+  template<std::size_t... kIndices>
+  SIMDUTIL_TARGET_AVX512 Vec
+  permute() const noexcept
+  {
+    static_assert(isPermuteValid<kSize, kIndices...>(), "permute() takes kSize lane indices less than kSize");
+    const auto indices = _mm512_maskz_cvtepu8_epi32(MaskType::kAllBits, _mm_setr_epi8(static_cast<char>(kIndices)...));
+    return Vec{_mm512_maskz_permutexvar_epi32(MaskType::kAllBits, indices, v_)};
+  }
+
+  SIMDUTIL_TARGET_AVX512 std::int32_t reduceAdd() const noexcept { return (lo() + hi()).reduceAdd(); }
+  SIMDUTIL_TARGET_AVX512 std::int32_t reduceMin() const noexcept { return min(lo(), hi()).reduceMin(); }
+  SIMDUTIL_TARGET_AVX512 std::int32_t reduceMax() const noexcept { return max(lo(), hi()).reduceMax(); }
+
+  SIMDUTIL_TARGET_AVX512 friend Vec min(const Vec& a, const Vec& b) noexcept { return Vec{_mm512_maskz_min_epi32(MaskType::kAllBits, a.v_, b.v_)}; }
+  SIMDUTIL_TARGET_AVX512 friend Vec max(const Vec& a, const Vec& b) noexcept { return Vec{_mm512_maskz_max_epi32(MaskType::kAllBits, a.v_, b.v_)}; }
+  SIMDUTIL_TARGET_AVX512 friend Vec fma(const Vec& a, const Vec& b, const Vec& c) noexcept { return a * b + c; }
+  SIMDUTIL_TARGET_AVX512 friend Vec select(const MaskType& mask, const Vec& a, const Vec& b) noexcept { return Vec{_mm512_mask_blend_epi32(mask.native(), b.v_, a.v_)}; }
+
+private:
+  SIMDUTIL_TARGET_AVX512 Vec<std::int32_t, 8> lo() const noexcept { return Vec<std::int32_t, 8>{_mm512_extracti32x8_epi32(v_, 0)}; }
+  SIMDUTIL_TARGET_AVX512 Vec<std::int32_t, 8> hi() const noexcept { return Vec<std::int32_t, 8>{_mm512_extracti32x8_epi32(v_, 1)}; }
+
+  //! Register
+  __m512i v_;
+};  // class Vec<std::int32_t, 16>
+
+constexpr std::size_t Vec<std::int32_t, 16>::kSize;
+
+
+/*!
+ * @brief 8 x std::int64_t on AVX-512 (See the primary template Vec for the interface)
+ *
+ * Comparisons return BitMask<8>, which is an opmask register (__mmask8).
+ */
+template<>
+class Vec<std::int64_t, 8>
+{
+public:
+  using value_type = std::int64_t;
+  using NativeType = __m512i;
+  using MaskType = BitMask<8>;
+  static constexpr std::size_t kSize = 8;
+
+  SIMDUTIL_TARGET_AVX512 Vec() noexcept : v_{_mm512_setzero_si512()} {}
+  SIMDUTIL_TARGET_AVX512 explicit Vec(__m512i v) noexcept : v_{v} {}
+  SIMDUTIL_TARGET_AVX512 Vec(const Vec& other) noexcept : v_{other.v_} {}
+  SIMDUTIL_TARGET_AVX512 Vec& operator=(const Vec& other) noexcept { v_ = other.v_; return *this; }
+
+  SIMDUTIL_TARGET_AVX512 static Vec zero() noexcept { return Vec{}; }
+  SIMDUTIL_TARGET_AVX512 static Vec broadcast(std::int64_t x) noexcept { return Vec{_mm512_set1_epi64(x)}; }
+  SIMDUTIL_TARGET_AVX512 static Vec load(const std::int64_t* p) noexcept { return Vec{_mm512_load_si512(p)}; }
+  SIMDUTIL_TARGET_AVX512 static Vec loadu(const std::int64_t* p) noexcept { return Vec{_mm512_loadu_si512(p)}; }
+  SIMDUTIL_TARGET_AVX512 static Vec loadu(const std::int64_t* p, std::size_t n) noexcept { return Vec{_mm512_maskz_loadu_epi64(MaskType::firstN(n).native(), p)}; }
+  SIMDUTIL_TARGET_AVX512 void store(std::int64_t* p) const noexcept { _mm512_store_si512(p, v_); }
+  SIMDUTIL_TARGET_AVX512 void storeu(std::int64_t* p) const noexcept { _mm512_storeu_si512(p, v_); }
+  SIMDUTIL_TARGET_AVX512 void storeu(std::int64_t* p, std::size_t n) const noexcept { _mm512_mask_storeu_epi64(p, MaskType::firstN(n).native(), v_); }
+  SIMDUTIL_TARGET_AVX512 __m512i native() const noexcept { return v_; }
+
+  SIMDUTIL_TARGET_AVX512 std::int64_t
+  operator[](std::size_t i) const noexcept
+  {
+    std::array<std::int64_t, kSize> a;
+    storeu(a.data());
+    return a[i];
+  }
+
+  SIMDUTIL_TARGET_AVX512 Vec operator+(const Vec& rhs) const noexcept { return Vec{_mm512_add_epi64(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX512 Vec operator-(const Vec& rhs) const noexcept { return Vec{_mm512_sub_epi64(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX512 Vec operator*(const Vec& rhs) const noexcept { return Vec{_mm512_mullo_epi64(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX512 Vec operator&(const Vec& rhs) const noexcept { return Vec{_mm512_and_si512(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX512 Vec operator|(const Vec& rhs) const noexcept { return Vec{_mm512_or_si512(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX512 Vec operator^(const Vec& rhs) const noexcept { return Vec{_mm512_xor_si512(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_AVX512 Vec& operator+=(const Vec& rhs) noexcept { return *this = *this + rhs; }
+  SIMDUTIL_TARGET_AVX512 Vec& operator-=(const Vec& rhs) noexcept { return *this = *this - rhs; }
+  SIMDUTIL_TARGET_AVX512 Vec& operator*=(const Vec& rhs) noexcept { return *this = *this * rhs; }
+
+  SIMDUTIL_TARGET_AVX512 MaskType operator==(const Vec& rhs) const noexcept { return MaskType{_mm512_cmp_epi64_mask(v_, rhs.v_, _MM_CMPINT_EQ)}; }
+  SIMDUTIL_TARGET_AVX512 MaskType operator!=(const Vec& rhs) const noexcept { return MaskType{_mm512_cmp_epi64_mask(v_, rhs.v_, _MM_CMPINT_NE)}; }
+  SIMDUTIL_TARGET_AVX512 MaskType operator<(const Vec& rhs) const noexcept { return MaskType{_mm512_cmp_epi64_mask(v_, rhs.v_, _MM_CMPINT_LT)}; }
+  SIMDUTIL_TARGET_AVX512 MaskType operator<=(const Vec& rhs) const noexcept { return MaskType{_mm512_cmp_epi64_mask(v_, rhs.v_, _MM_CMPINT_LE)}; }
+  SIMDUTIL_TARGET_AVX512 MaskType operator>(const Vec& rhs) const noexcept { return MaskType{_mm512_cmp_epi64_mask(v_, rhs.v_, _MM_CMPINT_NLE)}; }
+  SIMDUTIL_TARGET_AVX512 MaskType operator>=(const Vec& rhs) const noexcept { return MaskType{_mm512_cmp_epi64_mask(v_, rhs.v_, _MM_CMPINT_NLT)}; }
+
+  SIMDUTIL_TARGET_AVX512 Vec reverse() const noexcept { return Vec{_mm512_maskz_permutexvar_epi64(MaskType::kAllBits, _mm512_setr_epi64(7, 6, 5, 4, 3, 2, 1, 0), v_)}; }
+
+  template<std::size_t... kIndices>
+  SIMDUTIL_TARGET_AVX512 Vec
+  permute() const noexcept
+  {
+    static_assert(isPermuteValid<kSize, kIndices...>(), "permute() takes kSize lane indices less than kSize");
+    const auto indices = _mm512_maskz_cvtepu32_epi64(MaskType::kAllBits, _mm256_setr_epi32(static_cast<int>(kIndices)...));
+    return Vec{_mm512_maskz_permutexvar_epi64(MaskType::kAllBits, indices, v_)};
+  }
+
+  SIMDUTIL_TARGET_AVX512 std::int64_t reduceAdd() const noexcept { return (lo() + hi()).reduceAdd(); }
+  SIMDUTIL_TARGET_AVX512 std::int64_t reduceMin() const noexcept { return min(lo(), hi()).reduceMin(); }
+  SIMDUTIL_TARGET_AVX512 std::int64_t reduceMax() const noexcept { return max(lo(), hi()).reduceMax(); }
+
+  SIMDUTIL_TARGET_AVX512 friend Vec min(const Vec& a, const Vec& b) noexcept { return Vec{_mm512_maskz_min_epi64(MaskType::kAllBits, a.v_, b.v_)}; }
+  SIMDUTIL_TARGET_AVX512 friend Vec max(const Vec& a, const Vec& b) noexcept { return Vec{_mm512_maskz_max_epi64(MaskType::kAllBits, a.v_, b.v_)}; }
+  SIMDUTIL_TARGET_AVX512 friend Vec fma(const Vec& a, const Vec& b, const Vec& c) noexcept { return a * b + c; }
+  SIMDUTIL_TARGET_AVX512 friend Vec select(const MaskType& mask, const Vec& a, const Vec& b) noexcept { return Vec{_mm512_mask_blend_epi64(mask.native(), b.v_, a.v_)}; }
+
+private:
+  SIMDUTIL_TARGET_AVX512 Vec<std::int64_t, 4> lo() const noexcept { return Vec<std::int64_t, 4>{_mm512_extracti32x8_epi32(v_, 0)}; }
+  SIMDUTIL_TARGET_AVX512 Vec<std::int64_t, 4> hi() const noexcept { return Vec<std::int64_t, 4>{_mm512_extracti32x8_epi32(v_, 1)}; }
+
+  //! Register
+  __m512i v_;
+};  // class Vec<std::int64_t, 8>
+
+constexpr std::size_t Vec<std::int64_t, 8>::kSize;
+
+
+}  // namespace simdutil
+
+
+#endif  // SIMDUTIL_VEC_AVX512_HPP
@@ -0,0 +1,556 @@
+#ifndef SIMDUTIL_VEC_SSE42_HPP
+#define SIMDUTIL_VEC_SSE42_HPP
+
+#if !defined(SIMDUTIL_VEC_HPP)
+#  error "Do not include vec_sse42.hpp directly; include vec.hpp instead"
+#endif  // !defined(SIMDUTIL_VEC_HPP)
+
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#else
+#  include <immintrin.h>
+#endif  // defined(_MSC_VER)
+
+
+namespace simdutil
+{
+/*!
+ * @brief Lane mask of a 128-bit vector, held as all-ones / all-zeros lanes
+ */
+template<std::size_t kLaneBytes>
+class XmmMask
+{
+  static_assert(kLaneBytes == 4 || kLaneBytes == 8, "Lane size must be 4 or 8 bytes");
+
+public:
+  //! Register type
+  using NativeType = __m128i;
+  //! Number of lanes
+  static constexpr std::size_t kSize = 16 / kLaneBytes;
+
+  SIMDUTIL_TARGET_SSE42 XmmMask() noexcept : m_{_mm_setzero_si128()} {}
+  SIMDUTIL_TARGET_SSE42 explicit XmmMask(__m128i m) noexcept : m_{m} {}
+  SIMDUTIL_TARGET_SSE42 XmmMask(const XmmMask& other) noexcept : m_{other.m_} {}
+  SIMDUTIL_TARGET_SSE42 XmmMask& operator=(const XmmMask& other) noexcept { m_ = other.m_; return *this; }
+
+  /*!
+   * @brief Make a mask of the first n lanes, used for loop remainders
+   * @param [in] n  Number of lanes to set
+   * @return  Mask of lanes [0, n)
+   */
+  SIMDUTIL_TARGET_SSE42 static XmmMask
+  firstN(std::size_t n) noexcept
+  {
+    const auto m = static_cast<std::int8_t>(std::min(n, kSize) * kLaneBytes);
+    const auto index = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    return XmmMask{_mm_cmpgt_epi8(_mm_set1_epi8(m), index)};
+  }
+
+  SIMDUTIL_TARGET_SSE42 __m128i native() const noexcept { return m_; }
+  SIMDUTIL_TARGET_SSE42 bool test(std::size_t i) const noexcept { return ((bits() >> i) & 1) != 0; }
+  SIMDUTIL_TARGET_SSE42 bool any() const noexcept { return _mm_testz_si128(m_, m_) == 0; }
+  SIMDUTIL_TARGET_SSE42 bool all() const noexcept { return _mm_test_all_ones(m_) != 0; }
+  SIMDUTIL_TARGET_SSE42 bool none() const noexcept { return _mm_testz_si128(m_, m_) != 0; }
+
+  /*!
+   * @brief Get the mask as an integer bitmask (bit i is lane i)
+   * @return  Bitmask
+   */
+  SIMDUTIL_TARGET_SSE42 std::uint64_t
+  bits() const noexcept
+  {
+    return static_cast<std::uint64_t>(kLaneBytes == 4
+      ? _mm_movemask_ps(_mm_castsi128_ps(m_))
+      : _mm_movemask_pd(_mm_castsi128_pd(m_)));
+  }
+
+  SIMDUTIL_TARGET_SSE42 XmmMask operator&(const XmmMask& rhs) const noexcept { return XmmMask{_mm_and_si128(m_, rhs.m_)}; }
+  SIMDUTIL_TARGET_SSE42 XmmMask operator|(const XmmMask& rhs) const noexcept { return XmmMask{_mm_or_si128(m_, rhs.m_)}; }
+  SIMDUTIL_TARGET_SSE42 XmmMask operator^(const XmmMask& rhs) const noexcept { return XmmMask{_mm_xor_si128(m_, rhs.m_)}; }
+  SIMDUTIL_TARGET_SSE42 XmmMask operator~() const noexcept { return XmmMask{_mm_xor_si128(m_, _mm_set1_epi32(-1))}; }
+  SIMDUTIL_TARGET_SSE42 bool operator==(const XmmMask& rhs) const noexcept { return bits() == rhs.bits(); }
+  SIMDUTIL_TARGET_SSE42 bool operator!=(const XmmMask& rhs) const noexcept { return bits() != rhs.bits(); }
+
+private:
+  //! All-ones / all-zeros lanes
+  __m128i m_;
+};  // class XmmMask
+
+template<std::size_t kLaneBytes>
+constexpr std::size_t XmmMask<kLaneBytes>::kSize;
+
+
+/*!
+ * @brief 4 x float on SSE4.2 (See the primary template Vec for the interface)
+ */
+template<>
+class Vec<float, 4>
+{
+public:
+  using value_type = float;
+  using NativeType = __m128;
+  using MaskType = XmmMask<4>;
+  static constexpr std::size_t kSize = 4;
+
+  SIMDUTIL_TARGET_SSE42 Vec() noexcept : v_{_mm_setzero_ps()} {}
+  SIMDUTIL_TARGET_SSE42 explicit Vec(__m128 v) noexcept : v_{v} {}
+  SIMDUTIL_TARGET_SSE42 Vec(const Vec& other) noexcept : v_{other.v_} {}
+  SIMDUTIL_TARGET_SSE42 Vec& operator=(const Vec& other) noexcept { v_ = other.v_; return *this; }
+
+  SIMDUTIL_TARGET_SSE42 static Vec zero() noexcept { return Vec{}; }
+  SIMDUTIL_TARGET_SSE42 static Vec broadcast(float x) noexcept { return Vec{_mm_set1_ps(x)}; }
+  SIMDUTIL_TARGET_SSE42 static Vec load(const float* p) noexcept { return Vec{_mm_load_ps(p)}; }
+  SIMDUTIL_TARGET_SSE42 static Vec loadu(const float* p) noexcept { return Vec{_mm_loadu_ps(p)}; }
+
+  SIMDUTIL_TARGET_SSE42 static Vec
+  loadu(const float* p, std::size_t n) noexcept
+  {
+    if (n >= kSize) {
+      return loadu(p);
+    }
+    std::array<float, kSize> a{};
+    std::memcpy(a.data(), p, n * sizeof(float));
+    return loadu(a.data());
+  }
+
+  SIMDUTIL_TARGET_SSE42 void store(float* p) const noexcept { _mm_store_ps(p, v_); }
+  SIMDUTIL_TARGET_SSE42 void storeu(float* p) const noexcept { _mm_storeu_ps(p, v_); }
+
+  SIMDUTIL_TARGET_SSE42 void
+  storeu(float* p, std::size_t n) const noexcept
+  {
+    std::array<float, kSize> a;
+    storeu(a.data());
+    std::memcpy(p, a.data(), std::min(n, kSize) * sizeof(float));
+  }
+
+  SIMDUTIL_TARGET_SSE42 __m128 native() const noexcept { return v_; }
+
+  SIMDUTIL_TARGET_SSE42 float
+  operator[](std::size_t i) const noexcept
+  {
+    std::array<float, kSize> a;
+    storeu(a.data());
+    return a[i];
+  }
+
+  SIMDUTIL_TARGET_SSE42 Vec operator+(const Vec& rhs) const noexcept { return Vec{_mm_add_ps(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_SSE42 Vec operator-(const Vec& rhs) const noexcept { return Vec{_mm_sub_ps(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_SSE42 Vec operator*(const Vec& rhs) const noexcept { return Vec{_mm_mul_ps(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_SSE42 Vec operator/(const Vec& rhs) const noexcept { return Vec{_mm_div_ps(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_SSE42 Vec& operator+=(const Vec& rhs) noexcept { return *this = *this + rhs; }
+  SIMDUTIL_TARGET_SSE42 Vec& operator-=(const Vec& rhs) noexcept { return *this = *this - rhs; }
+  SIMDUTIL_TARGET_SSE42 Vec& operator*=(const Vec& rhs) noexcept { return *this = *this * rhs; }
+
+  SIMDUTIL_TARGET_SSE42 MaskType operator==(const Vec& rhs) const noexcept { return toMask(_mm_cmpeq_ps(v_, rhs.v_)); }
+  SIMDUTIL_TARGET_SSE42 MaskType operator!=(const Vec& rhs) const noexcept { return toMask(_mm_cmpneq_ps(v_, rhs.v_)); }
+  SIMDUTIL_TARGET_SSE42 MaskType operator<(const Vec& rhs) const noexcept { return toMask(_mm_cmplt_ps(v_, rhs.v_)); }
+  SIMDUTIL_TARGET_SSE42 MaskType operator<=(const Vec& rhs) const noexcept { return toMask(_mm_cmple_ps(v_, rhs.v_)); }
+  SIMDUTIL_TARGET_SSE42 MaskType operator>(const Vec& rhs) const noexcept { return toMask(_mm_cmpgt_ps(v_, rhs.v_)); }
+  SIMDUTIL_TARGET_SSE42 MaskType operator>=(const Vec& rhs) const noexcept { return toMask(_mm_cmpge_ps(v_, rhs.v_)); }
+
+  SIMDUTIL_TARGET_SSE42 Vec reverse() const noexcept { return Vec{_mm_shuffle_ps(v_, v_, _MM_SHUFFLE(0, 1, 2, 3))}; }
+
+  template<std::size_t... kIndices>
+  SIMDUTIL_TARGET_SSE42 Vec
+  permute() const noexcept
+  {
+    static_assert(isPermuteValid<kSize, kIndices...>(), "permute() takes kSize lane indices less than kSize");
+    constexpr int kImm = getShuffleImmediate<2, kIndices...>();
+    return Vec{_mm_shuffle_ps(v_, v_, kImm)};
+  }
+
+  SIMDUTIL_TARGET_SSE42 float
+  reduceAdd() const noexcept
+  {
+    const auto t = _mm_add_ps(v_, _mm_movehl_ps(v_, v_));
+    return _mm_cvtss_f32(_mm_add_ss(t, _mm_shuffle_ps(t, t, 1)));
+  }
+
+  SIMDUTIL_TARGET_SSE42 float
+  reduceMin() const noexcept
+  {
+    const auto t = _mm_min_ps(v_, _mm_movehl_ps(v_, v_));
+    return _mm_cvtss_f32(_mm_min_ss(t, _mm_shuffle_ps(t, t, 1)));
+  }
+
+  SIMDUTIL_TARGET_SSE42 float
+  reduceMax() const noexcept
+  {
+    const auto t = _mm_max_ps(v_, _mm_movehl_ps(v_, v_));
+    return _mm_cvtss_f32(_mm_max_ss(t, _mm_shuffle_ps(t, t, 1)));
+  }
+
+  SIMDUTIL_TARGET_SSE42 friend Vec min(const Vec& a, const Vec& b) noexcept { return Vec{_mm_min_ps(a.v_, b.v_)}; }
+  SIMDUTIL_TARGET_SSE42 friend Vec max(const Vec& a, const Vec& b) noexcept { return Vec{_mm_max_ps(a.v_, b.v_)}; }
+  SIMDUTIL_TARGET_SSE42 friend Vec fma(const Vec& a, const Vec& b, const Vec& c) noexcept { return a * b + c; }
+
+  SIMDUTIL_TARGET_SSE42 friend Vec
+  select(const MaskType& mask, const Vec& a, const Vec& b) noexcept
+  {
+    return Vec{_mm_blendv_ps(b.v_, a.v_, _mm_castsi128_ps(mask.native()))};
+  }
+
+private:
+  SIMDUTIL_TARGET_SSE42 static MaskType toMask(__m128 m) noexcept { return MaskType{_mm_castps_si128(m)}; }
+
+  //! Register
+  __m128 v_;
+};  // class Vec<float, 4>
+
+constexpr std::size_t Vec<float, 4>::kSize;
+
+
+/*!
+ * @brief 2 x double on SSE4.2 (See the primary template Vec for the interface)
+ */
+template<>
+class Vec<double, 2>
+{
+public:
+  using value_type = double;
+  using NativeType = __m128d;
+  using MaskType = XmmMask<8>;
+  static constexpr std::size_t kSize = 2;
+
+  SIMDUTIL_TARGET_SSE42 Vec() noexcept : v_{_mm_setzero_pd()} {}
+  SIMDUTIL_TARGET_SSE42 explicit Vec(__m128d v) noexcept : v_{v} {}
+  SIMDUTIL_TARGET_SSE42 Vec(const Vec& other) noexcept : v_{other.v_} {}
+  SIMDUTIL_TARGET_SSE42 Vec& operator=(const Vec& other) noexcept { v_ = other.v_; return *this; }
+
+  SIMDUTIL_TARGET_SSE42 static Vec zero() noexcept { return Vec{}; }
+  SIMDUTIL_TARGET_SSE42 static Vec broadcast(double x) noexcept { return Vec{_mm_set1_pd(x)}; }
+  SIMDUTIL_TARGET_SSE42 static Vec load(const double* p) noexcept { return Vec{_mm_load_pd(p)}; }
+  SIMDUTIL_TARGET_SSE42 static Vec loadu(const double* p) noexcept { return Vec{_mm_loadu_pd(p)}; }
+
+  SIMDUTIL_TARGET_SSE42 static Vec
+  loadu(const double* p, std::size_t n) noexcept
+  {
+    if (n >= kSize) {
+      return loadu(p);
+    }
+    return n == 0 ? Vec{} : Vec{_mm_load_sd(p)};
+  }
+
+  SIMDUTIL_TARGET_SSE42 void store(double* p) const noexcept { _mm_store_pd(p, v_); }
+  SIMDUTIL_TARGET_SSE42 void storeu(double* p) const noexcept { _mm_storeu_pd(p, v_); }
+
+  SIMDUTIL_TARGET_SSE42 void
+  storeu(double* p, std::size_t n) const noexcept
+  {
+    if (n >= kSize) {
+      storeu(p);
+    } else if (n == 1) {
+      _mm_store_sd(p, v_);
+    }
+  }
+
+  SIMDUTIL_TARGET_SSE42 __m128d native() const noexcept { return v_; }
+
+  SIMDUTIL_TARGET_SSE42 double
+  operator[](std::size_t i) const noexcept
+  {
+    std::array<double, kSize> a;
+    storeu(a.data());
+    return a[i];
+  }
+
+  SIMDUTIL_TARGET_SSE42 Vec operator+(const Vec& rhs) const noexcept { return Vec{_mm_add_pd(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_SSE42 Vec operator-(const Vec& rhs) const noexcept { return Vec{_mm_sub_pd(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_SSE42 Vec operator*(const Vec& rhs) const noexcept { return Vec{_mm_mul_pd(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_SSE42 Vec operator/(const Vec& rhs) const noexcept { return Vec{_mm_div_pd(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_SSE42 Vec& operator+=(const Vec& rhs) noexcept { return *this = *this + rhs; }
+  SIMDUTIL_TARGET_SSE42 Vec& operator-=(const Vec& rhs) noexcept { return *this = *this - rhs; }
+  SIMDUTIL_TARGET_SSE42 Vec& operator*=(const Vec& rhs) noexcept { return *this = *this * rhs; }
+
+  SIMDUTIL_TARGET_SSE42 MaskType operator==(const Vec& rhs) const noexcept { return toMask(_mm_cmpeq_pd(v_, rhs.v_)); }
+  SIMDUTIL_TARGET_SSE42 MaskType operator!=(const Vec& rhs) const noexcept { return toMask(_mm_cmpneq_pd(v_, rhs.v_)); }
+  SIMDUTIL_TARGET_SSE42 MaskType operator<(const Vec& rhs) const noexcept { return toMask(_mm_cmplt_pd(v_, rhs.v_)); }
+  SIMDUTIL_TARGET_SSE42 MaskType operator<=(const Vec& rhs) const noexcept { return toMask(_mm_cmple_pd(v_, rhs.v_)); }
+  SIMDUTIL_TARGET_SSE42 MaskType operator>(const Vec& rhs) const noexcept { return toMask(_mm_cmpgt_pd(v_, rhs.v_)); }
+  SIMDUTIL_TARGET_SSE42 MaskType operator>=(const Vec& rhs) const noexcept { return toMask(_mm_cmpge_pd(v_, rhs.v_)); }
+
+  SIMDUTIL_TARGET_SSE42 Vec reverse() const noexcept { return Vec{_mm_shuffle_pd(v_, v_, 1)}; }
+
+  template<std::size_t... kIndices>
+  SIMDUTIL_TARGET_SSE42 Vec
+  permute() const noexcept
+  {
+    static_assert(isPermuteValid<kSize, kIndices...>(), "permute() takes kSize lane indices less than kSize");
+    constexpr int kImm = getShuffleImmediate<1, kIndices...>();
+    return Vec{_mm_shuffle_pd(v_, v_, kImm)};
+  }
+
+  SIMDUTIL_TARGET_SSE42 double reduceAdd() const noexcept { return _mm_cvtsd_f64(_mm_add_sd(v_, _mm_unpackhi_pd(v_, v_))); }
+  SIMDUTIL_TARGET_SSE42 double reduceMin() const noexcept { return _mm_cvtsd_f64(_mm_min_sd(v_, _mm_unpackhi_pd(v_, v_))); }
+  SIMDUTIL_TARGET_SSE42 double reduceMax() const noexcept { return _mm_cvtsd_f64(_mm_max_sd(v_, _mm_unpackhi_pd(v_, v_))); }
+
+  SIMDUTIL_TARGET_SSE42 friend Vec min(const Vec& a, const Vec& b) noexcept { return Vec{_mm_min_pd(a.v_, b.v_)}; }
+  SIMDUTIL_TARGET_SSE42 friend Vec max(const Vec& a, const Vec& b) noexcept { return Vec{_mm_max_pd(a.v_, b.v_)}; }
+  SIMDUTIL_TARGET_SSE42 friend Vec fma(const Vec& a, const Vec& b, const Vec& c) noexcept { return a * b + c; }
+
+  SIMDUTIL_TARGET_SSE42 friend Vec
+  select(const MaskType& mask, const Vec& a, const Vec& b) noexcept
+  {
+    return Vec{_mm_blendv_pd(b.v_, a.v_, _mm_castsi128_pd(mask.native()))};
+  }
+
+private:
+  SIMDUTIL_TARGET_SSE42 static MaskType toMask(__m128d m) noexcept { return MaskType{_mm_castpd_si128(m)}; }
+
+  //! Register
+  __m128d v_;
+};  // class Vec<double, 2>
+
+constexpr std::size_t Vec<double, 2>::kSize;
+
+
+/*!
+ * @brief 4 x std::int32_t on SSE4.2 (See the primary template Vec for the interface)
+ */
+template<>
+class Vec<std::int32_t, 4>
+{
+public:
+  using value_type = std::int32_t;
+  using NativeType = __m128i;
+  using MaskType = XmmMask<4>;
+  static constexpr std::size_t kSize = 4;
+
+  SIMDUTIL_TARGET_SSE42 Vec() noexcept : v_{_mm_setzero_si128()} {}
+  SIMDUTIL_TARGET_SSE42 explicit Vec(__m128i v) noexcept : v_{v} {}
+  SIMDUTIL_TARGET_SSE42 Vec(const Vec& other) noexcept : v_{other.v_} {}
+  SIMDUTIL_TARGET_SSE42 Vec& operator=(const Vec& other) noexcept { v_ = other.v_; return *this; }
+
+  SIMDUTIL_TARGET_SSE42 static Vec zero() noexcept { return Vec{}; }
+  SIMDUTIL_TARGET_SSE42 static Vec broadcast(std::int32_t x) noexcept { return Vec{_mm_set1_epi32(x)}; }
+  SIMDUTIL_TARGET_SSE42 static Vec load(const std::int32_t* p) noexcept { return Vec{_mm_load_si128(reinterpret_cast<const __m128i*>(static_cast<const void*>(p)))}; }
+  SIMDUTIL_TARGET_SSE42 static Vec loadu(const std::int32_t* p) noexcept { return Vec{_mm_loadu_si128(reinterpret_cast<const __m128i*>(static_cast<const void*>(p)))}; }
+
+  SIMDUTIL_TARGET_SSE42 static Vec
+  loadu(const std::int32_t* p, std::size_t n) noexcept
+  {
+    if (n >= kSize) {
+      return loadu(p);
+    }
+    std::array<std::int32_t, kSize> a{};
+    std::memcpy(a.data(), p, n * sizeof(std::int32_t));
+    return loadu(a.data());
+  }
+
+  SIMDUTIL_TARGET_SSE42 void store(std::int32_t* p) const noexcept { _mm_store_si128(reinterpret_cast<__m128i*>(static_cast<void*>(p)), v_); }
+  SIMDUTIL_TARGET_SSE42 void storeu(std::int32_t* p) const noexcept { _mm_storeu_si128(reinterpret_cast<__m128i*>(static_cast<void*>(p)), v_); }
+
+  SIMDUTIL_TARGET_SSE42 void
+  storeu(std::int32_t* p, std::size_t n) const noexcept
+  {
+    std::array<std::int32_t, kSize> a;
+    storeu(a.data());
+    std::memcpy(p, a.data(), std::min(n, kSize) * sizeof(std::int32_t));
+  }
+
+  SIMDUTIL_TARGET_SSE42 __m128i native() const noexcept { return v_; }
+
+  SIMDUTIL_TARGET_SSE42 std::int32_t
+  operator[](std::size_t i) const noexcept
+  {
+    std::array<std::int32_t, kSize> a;
+    storeu(a.data());
+    return a[i];
+  }
+
+  SIMDUTIL_TARGET_SSE42 Vec operator+(const Vec& rhs) const noexcept { return Vec{_mm_add_epi32(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_SSE42 Vec operator-(const Vec& rhs) const noexcept { return Vec{_mm_sub_epi32(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_SSE42 Vec operator*(const Vec& rhs) const noexcept { return Vec{_mm_mullo_epi32(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_SSE42 Vec operator&(const Vec& rhs) const noexcept { return Vec{_mm_and_si128(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_SSE42 Vec operator|(const Vec& rhs) const noexcept { return Vec{_mm_or_si128(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_SSE42 Vec operator^(const Vec& rhs) const noexcept { return Vec{_mm_xor_si128(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_SSE42 Vec& operator+=(const Vec& rhs) noexcept { return *this = *this + rhs; }
+  SIMDUTIL_TARGET_SSE42 Vec& operator-=(const Vec& rhs) noexcept { return *this = *this - rhs; }
+  SIMDUTIL_TARGET_SSE42 Vec& operator*=(const Vec& rhs) noexcept { return *this = *this * rhs; }
+
+  SIMDUTIL_TARGET_SSE42 MaskType operator==(const Vec& rhs) const noexcept { return MaskType{_mm_cmpeq_epi32(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_SSE42 MaskType operator!=(const Vec& rhs) const noexcept { return ~(*this == rhs); }
+  SIMDUTIL_TARGET_SSE42 MaskType operator<(const Vec& rhs) const noexcept { return MaskType{_mm_cmplt_epi32(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_SSE42 MaskType operator<=(const Vec& rhs) const noexcept { return ~(*this > rhs); }
+  SIMDUTIL_TARGET_SSE42 MaskType operator>(const Vec& rhs) const noexcept { return MaskType{_mm_cmpgt_epi32(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_SSE42 MaskType operator>=(const Vec& rhs) const noexcept { return ~(*this < rhs); }
+
+  SIMDUTIL_TARGET_SSE42 Vec reverse() const noexcept { return Vec{_mm_shuffle_epi32(v_, _MM_SHUFFLE(0, 1, 2, 3))}; }
+
+  template<std::size_t... kIndices>
+  SIMDUTIL_TARGET_SSE42 Vec
+  permute() const noexcept
+  {
+    static_assert(isPermuteValid<kSize, kIndices...>(), "permute() takes kSize lane indices less than kSize");
+    constexpr int kImm = getShuffleImmediate<2, kIndices...>();
+    return Vec{_mm_shuffle_epi32(v_, kImm)};
+  }
+
+  SIMDUTIL_TARGET_SSE42 std::int32_t
+  reduceAdd() const noexcept
+  {
+    const auto t = _mm_add_epi32(v_, _mm_shuffle_epi32(v_, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtsi128_si32(_mm_add_epi32(t, _mm_shuffle_epi32(t, _MM_SHUFFLE(2, 3, 0, 1))));
+  }
+
+  SIMDUTIL_TARGET_SSE42 std::int32_t
+  reduceMin() const noexcept
+  {
+    const auto t = _mm_min_epi32(v_, _mm_shuffle_epi32(v_, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtsi128_si32(_mm_min_epi32(t, _mm_shuffle_epi32(t, _MM_SHUFFLE(2, 3, 0, 1))));
+  }
+
+  SIMDUTIL_TARGET_SSE42 std::int32_t
+  reduceMax() const noexcept
+  {
+    const auto t = _mm_max_epi32(v_, _mm_shuffle_epi32(v_, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtsi128_si32(_mm_max_epi32(t, _mm_shuffle_epi32(t, _MM_SHUFFLE(2, 3, 0, 1))));
+  }
+
+  SIMDUTIL_TARGET_SSE42 friend Vec min(const Vec& a, const Vec& b) noexcept { return Vec{_mm_min_epi32(a.v_, b.v_)}; }
+  SIMDUTIL_TARGET_SSE42 friend Vec max(const Vec& a, const Vec& b) noexcept { return Vec{_mm_max_epi32(a.v_, b.v_)}; }
+  SIMDUTIL_TARGET_SSE42 friend Vec fma(const Vec& a, const Vec& b, const Vec& c) noexcept { return a * b + c; }
+
+  SIMDUTIL_TARGET_SSE42 friend Vec
+  select(const MaskType& mask, const Vec& a, const Vec& b) noexcept
+  {
+    return Vec{_mm_blendv_epi8(b.v_, a.v_, mask.native())};
+  }
+
+private:
+  //! Register
+  __m128i v_;
+};  // class Vec<std::int32_t, 4>
+
+constexpr std::size_t Vec<std::int32_t, 4>::kSize;
+
+
+/*!
+ * @brief 2 x std::int64_t on SSE4.2 (See the primary template Vec for the interface)
+ *
+ * Multiplication is emulated with three 32-bit multiplications since SSE has no 64-bit multiply,
+ * and min/max with a comparison and a blend.
+ */
+template<>
+class Vec<std::int64_t, 2>
+{
+public:
+  using value_type = std::int64_t;
+  using NativeType = __m128i;
+  using MaskType = XmmMask<8>;
+  static constexpr std::size_t kSize = 2;
+
+  SIMDUTIL_TARGET_SSE42 Vec() noexcept : v_{_mm_setzero_si128()} {}
+  SIMDUTIL_TARGET_SSE42 explicit Vec(__m128i v) noexcept : v_{v} {}
+  SIMDUTIL_TARGET_SSE42 Vec(const Vec& other) noexcept : v_{other.v_} {}
+  SIMDUTIL_TARGET_SSE42 Vec& operator=(const Vec& other) noexcept { v_ = other.v_; return *this; }
+
+  SIMDUTIL_TARGET_SSE42 static Vec zero() noexcept { return Vec{}; }
+  SIMDUTIL_TARGET_SSE42 static Vec broadcast(std::int64_t x) noexcept { return Vec{_mm_set1_epi64x(x)}; }
+  SIMDUTIL_TARGET_SSE42 static Vec load(const std::int64_t* p) noexcept { return Vec{_mm_load_si128(reinterpret_cast<const __m128i*>(static_cast<const void*>(p)))}; }
+  SIMDUTIL_TARGET_SSE42 static Vec loadu(const std::int64_t* p) noexcept { return Vec{_mm_loadu_si128(reinterpret_cast<const __m128i*>(static_cast<const void*>(p)))}; }
+
+  SIMDUTIL_TARGET_SSE42 static Vec
+  loadu(const std::int64_t* p, std::size_t n) noexcept
+  {
+    if (n >= kSize) {
+      return loadu(p);
+    }
+    return n == 0 ? Vec{} : Vec{_mm_loadl_epi64(reinterpret_cast<const __m128i*>(static_cast<const void*>(p)))};
+  }
+
+  SIMDUTIL_TARGET_SSE42 void store(std::int64_t* p) const noexcept { _mm_store_si128(reinterpret_cast<__m128i*>(static_cast<void*>(p)), v_); }
+  SIMDUTIL_TARGET_SSE42 void storeu(std::int64_t* p) const noexcept { _mm_storeu_si128(reinterpret_cast<__m128i*>(static_cast<void*>(p)), v_); }
+
+  SIMDUTIL_TARGET_SSE42 void
+  storeu(std::int64_t* p, std::size_t n) const noexcept
+  {
+    if (n >= kSize) {
+      storeu(p);
+    } else if (n == 1) {
+      _mm_storel_epi64(reinterpret_cast<__m128i*>(static_cast<void*>(p)), v_);
+    }
+  }
+
+  SIMDUTIL_TARGET_SSE42 __m128i native() const noexcept { return v_; }
+
+  SIMDUTIL_TARGET_SSE42 std::int64_t
+  operator[](std::size_t i) const noexcept
+  {
+    std::array<std::int64_t, kSize> a;
+    storeu(a.data());
+    return a[i];
+  }
+
+  SIMDUTIL_TARGET_SSE42 Vec operator+(const Vec& rhs) const noexcept { return Vec{_mm_add_epi64(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_SSE42 Vec operator-(const Vec& rhs) const noexcept { return Vec{_mm_sub_epi64(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_SSE42 Vec operator&(const Vec& rhs) const noexcept { return Vec{_mm_and_si128(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_SSE42 Vec operator|(const Vec& rhs) const noexcept { return Vec{_mm_or_si128(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_SSE42 Vec operator^(const Vec& rhs) const noexcept { return Vec{_mm_xor_si128(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_SSE42 Vec& operator+=(const Vec& rhs) noexcept { return *this = *this + rhs; }
+  SIMDUTIL_TARGET_SSE42 Vec& operator-=(const Vec& rhs) noexcept { return *this = *this - rhs; }
+  SIMDUTIL_TARGET_SSE42 Vec& operator*=(const Vec& rhs) noexcept { return *this = *this * rhs; }
+
+  SIMDUTIL_TARGET_SSE42 Vec
+  operator*(const Vec& rhs) const noexcept
+  {
+    // lo(a) * lo(b) + ((hi(a) * lo(b) + lo(a) * hi(b)) << 32)
+    const auto lo = _mm_mul_epu32(v_, rhs.v_);
+    const auto cross = _mm_add_epi64(
+      _mm_mul_epu32(_mm_srli_epi64(v_, 32), rhs.v_),
+      _mm_mul_epu32(v_, _mm_srli_epi64(rhs.v_, 32)));
+    return Vec{_mm_add_epi64(lo, _mm_slli_epi64(cross, 32))};
+  }
+
+  SIMDUTIL_TARGET_SSE42 MaskType operator==(const Vec& rhs) const noexcept { return MaskType{_mm_cmpeq_epi64(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_SSE42 MaskType operator!=(const Vec& rhs) const noexcept { return ~(*this == rhs); }
+  SIMDUTIL_TARGET_SSE42 MaskType operator<(const Vec& rhs) const noexcept { return rhs > *this; }
+  SIMDUTIL_TARGET_SSE42 MaskType operator<=(const Vec& rhs) const noexcept { return ~(*this > rhs); }
+  SIMDUTIL_TARGET_SSE42 MaskType operator>(const Vec& rhs) const noexcept { return MaskType{_mm_cmpgt_epi64(v_, rhs.v_)}; }
+  SIMDUTIL_TARGET_SSE42 MaskType operator>=(const Vec& rhs) const noexcept { return ~(rhs > *this); }
+
+  SIMDUTIL_TARGET_SSE42 Vec reverse() const noexcept { return Vec{_mm_shuffle_epi32(v_, _MM_SHUFFLE(1, 0, 3, 2))}; }
+
+  template<std::size_t... kIndices>
+  SIMDUTIL_TARGET_SSE42 Vec
+  permute() const noexcept
+  {
+    static_assert(isPermuteValid<kSize, kIndices...>(), "permute() takes kSize lane indices less than kSize");
+    // pshufd moves the two 32-bit halves of each lane
+    constexpr int kImm = getShuffleImmediate<4, (kIndices * 2) | ((kIndices * 2 + 1) << 2)...>();
+    return Vec{_mm_shuffle_epi32(v_, kImm)};
+  }
+
+  SIMDUTIL_TARGET_SSE42 std::int64_t reduceAdd() const noexcept { return (*this + reverse())[0]; }
+  SIMDUTIL_TARGET_SSE42 std::int64_t reduceMin() const noexcept { return min(*this, reverse())[0]; }
+  SIMDUTIL_TARGET_SSE42 std::int64_t reduceMax() const noexcept { return max(*this, reverse())[0]; }
+
+  SIMDUTIL_TARGET_SSE42 friend Vec min(const Vec& a, const Vec& b) noexcept { return select(a < b, a, b); }
+  SIMDUTIL_TARGET_SSE42 friend Vec max(const Vec& a, const Vec& b) noexcept { return select(a > b, a, b); }
+  SIMDUTIL_TARGET_SSE42 friend Vec fma(const Vec& a, const Vec& b, const Vec& c) noexcept { return a * b + c; }
+
+  SIMDUTIL_TARGET_SSE42 friend Vec
+  select(const MaskType& mask, const Vec& a, const Vec& b) noexcept
+  {
+    return Vec{_mm_blendv_epi8(b.v_, a.v_, mask.native())};
+  }
+
+private:
+  //! Register
+  __m128i v_;
+};  // class Vec<std::int64_t, 2>
+
+constexpr std::size_t Vec<std::int64_t, 2>::kSize;
+
+
+}  // namespace simdutil
+
+
+#endif  // SIMDUTIL_VEC_SSE42_HPP
@@ -0,0 +1,15 @@
+// y = a * x + y, left to the auto-vectorizer, so that each build shows what the compiler makes of its level.
+
+#include "saxpy.hpp"
+
+
+namespace SIMDUTIL_KERNEL_NAMESPACE
+{
+void
+saxpy(float* y, const float* x, float a, std::size_t n)
+{
+  for (std::size_t i = 0; i < n; i++) {
+    y[i] = a * x[i] + y[i];
+  }
+}
+}  // namespace SIMDUTIL_KERNEL_NAMESPACE
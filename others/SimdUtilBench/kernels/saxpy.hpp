@@ -0,0 +1,14 @@
+#ifndef SIMDUTIL_BENCH_KERNELS_SAXPY_HPP
+#define SIMDUTIL_BENCH_KERNELS_SAXPY_HPP
+
+
+#include <cstddef>
+
+#include <simdutil/dispatch.hpp>
+
+
+// Built once per instruction set level by add_multi_isa_kernel_library() (See ../CMakeLists.txt)
+SIMDUTIL_DECLARE_MULTI_ISA_KERNEL(bench_kernels, void, saxpy, (float* y, const float* x, float a, std::size_t n))
+
+
+#endif  // SIMDUTIL_BENCH_KERNELS_SAXPY_HPP
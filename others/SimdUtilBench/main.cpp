@@ -0,0 +1,834 @@
+// Micro-benchmarks of the simdutil allocators and kernels.
+//
+// Every kernel is run at each instruction set level the host supports (and SIMDUTIL_MAX_ISA allows),
+// on working sets sized to fit in L1, L2 and L3 and to spill to DRAM.
+// Human-readable results go to stderr, JSON goes to stdout (or to the file given with --json=FILE),
+// so that runs on the same host can be diffed between commits.
+//
+// Usage: simdutil_bench [--filter=SUBSTR] [--reps=N] [--warmup=N] [--min-sample-ms=X] [--max-mib=N] [--json=FILE]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#else
+#  include <x86intrin.h>
+#endif  // defined(_MSC_VER)
+
+#include <simdutil/aligned_vector.hpp>
+#include <simdutil/allocator.hpp>
+#include <simdutil/bitset.hpp>
+#include <simdutil/bytescan.hpp>
+#include <simdutil/cpuid.hpp>
+#include <simdutil/dispatch.hpp>
+#include <simdutil/layout.hpp>
+#include <simdutil/memops.hpp>
+#include <simdutil/reduce.hpp>
+
+#include "kernels/saxpy.hpp"
+
+
+/*!
+ * @brief Keep a value alive without storing it anywhere
+ * @param [in] value  Value the compiler must materialize
+ */
+template<typename T>
+static inline void
+doNotOptimize(const T& value) noexcept
+{
+#if defined(_MSC_VER)
+  static volatile const void* sink;
+  sink = &value;
+#else
+  __asm__ __volatile__("" : : "r,m"(value) : "memory");
+#endif  // defined(_MSC_VER)
+}
+
+
+static inline std::uint64_t
+readTsc() noexcept
+{
+  return __rdtsc();
+}
+
+
+/*!
+ * @brief Time stamp counter frequency, measured once against std::chrono::steady_clock
+ *
+ * Elements per cycle are reported in TSC (reference) cycles, which differ from core cycles
+ * when the core runs above or below its nominal frequency.
+ */
+class TscFrequency
+{
+public:
+  static const TscFrequency&
+  get()
+  {
+    static const TscFrequency instance;
+    return instance;
+  }
+
+  double ticksPerNs() const noexcept { return ticksPerNs_; }
+
+private:
+  TscFrequency()
+    : ticksPerNs_{}
+  {
+    const auto t0 = std::chrono::steady_clock::now();
+    const auto c0 = readTsc();
+    std::chrono::steady_clock::time_point t1;
+    do {
+      t1 = std::chrono::steady_clock::now();
+    } while (t1 - t0 < std::chrono::milliseconds(50));
+    const auto c1 = readTsc();
+    ticksPerNs_ = static_cast<double>(c1 - c0) / static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+  }
+
+  //! TSC ticks per nanosecond
+  double ticksPerNs_;
+};  // class TscFrequency
+
+
+/*!
+ * @brief Benchmark settings, from the command line
+ */
+struct BenchConfig
+{
+  //! Only run benchmarks whose "group/name" contains this
+  std::string filter;
+  //! JSON output file (stdout if empty)
+  std::string jsonPath;
+  //! Number of measured samples per benchmark
+  int repetitions;
+  //! Number of discarded samples before measuring
+  int warmup;
+  //! Minimum duration of one sample in milliseconds
+  double minSampleMs;
+  //! Upper limit of the DRAM working set in MiB
+  std::size_t maxMib;
+};  // struct BenchConfig
+
+
+/*!
+ * @brief Working set size of a benchmark, relative to the cache hierarchy
+ */
+struct SizeClass
+{
+  //! "L1", "L2", "L3" or "DRAM"
+  const char* name;
+  //! Working set in bytes (all buffers of a benchmark together)
+  std::size_t bytes;
+};  // struct SizeClass
+
+
+/*!
+ * @brief One measured benchmark
+ */
+struct BenchResult
+{
+  std::string group;
+  std::string name;
+  std::string isa;
+  std::string sizeClass;
+  //! Bytes read and written by one iteration (0 if throughput is meaningless)
+  std::size_t bytes;
+  //! Elements processed by one iteration
+  std::size_t elements;
+  //! Iterations per sample
+  std::size_t iterations;
+  //! Median time of one iteration in nanoseconds
+  double medianNs;
+  //! Median absolute deviation of the time of one iteration in nanoseconds
+  double madNs;
+};  // struct BenchResult
+
+
+/*!
+ * @brief Measures benchmarks and collects the results
+ */
+class BenchRunner
+{
+public:
+  explicit BenchRunner(const BenchConfig& config)
+    : config_(config)
+    , results_{}
+  {}
+
+  const BenchConfig& config() const noexcept { return config_; }
+  const std::vector<BenchResult>& results() const noexcept { return results_; }
+
+  bool
+  isSelected(const char* group, const char* name) const
+  {
+    return config_.filter.empty() || (std::string{group} + "/" + name).find(config_.filter) != std::string::npos;
+  }
+
+  /*!
+   * @brief Measure one benchmark
+   *
+   * One warm-up call estimates the time per iteration, from which the number of iterations per sample is chosen
+   * so that a sample lasts at least BenchConfig::minSampleMs. Then config().warmup samples are discarded
+   * and config().repetitions samples are measured.
+   *
+   * @param [in] group  Group name (header)
+   * @param [in] name  Benchmark name
+   * @param [in] isa  Instruction set level name
+   * @param [in] sizeClass  Working set size class name
+   * @param [in] bytes  Bytes read and written per iteration
+   * @param [in] elements  Elements processed per iteration
+   * @param [in] f  Function to measure
+   */
+  template<typename F>
+  void
+  run(const char* group, const char* name, const char* isa, const char* sizeClass, std::size_t bytes, std::size_t elements, F&& f)
+  {
+    const auto ticksPerNs = TscFrequency::get().ticksPerNs();
+    auto t0 = readTsc();
+    f();
+    const auto estimate = static_cast<double>(readTsc() - t0) / ticksPerNs;
+    const auto iterations = static_cast<std::size_t>(std::max(1.0, std::ceil(config_.minSampleMs * 1.0e6 / std::max(estimate, 1.0))));
+
+    std::vector<double> samples;
+    samples.reserve(static_cast<std::size_t>(config_.repetitions));
+    for (int k = -config_.warmup; k < config_.repetitions; k++) {
+      t0 = readTsc();
+      for (std::size_t i = 0; i < iterations; i++) {
+        f();
+      }
+      const auto t1 = readTsc();
+      if (k >= 0) {
+        samples.push_back(static_cast<double>(t1 - t0) / ticksPerNs / static_cast<double>(iterations));
+      }
+    }
+
+    const auto medianNs = median(samples);
+    for (auto& sample : samples) {
+      sample = std::abs(sample - medianNs);
+    }
+    const BenchResult result{group, name, isa, sizeClass, bytes, elements, iterations, medianNs, median(samples)};
+    results_.push_back(result);
+    print(result);
+  }
+
+private:
+  static double
+  median(std::vector<double> values)
+  {
+    const auto middle = values.begin() + static_cast<std::ptrdiff_t>(values.size() / 2);
+    std::nth_element(values.begin(), middle, values.end());
+    if (values.size() % 2 != 0) {
+      return *middle;
+    }
+    return (*middle + *std::max_element(values.begin(), middle)) / 2.0;
+  }
+
+  static void
+  print(const BenchResult& r)
+  {
+    const auto ticksPerNs = TscFrequency::get().ticksPerNs();
+    std::fprintf(
+      stderr,
+      "%-8s %-22s %-10s %-5s %12.1f ns +- %5.1f%%",
+      r.group.c_str(),
+      r.name.c_str(),
+      r.isa.c_str(),
+      r.sizeClass.c_str(),
+      r.medianNs,
+      r.medianNs > 0.0 ? r.madNs / r.medianNs * 100.0 : 0.0);
+    if (r.bytes != 0) {
+      std::fprintf(stderr, " %8.2f GB/s", static_cast<double>(r.bytes) / r.medianNs);
+    }
+    std::fprintf(stderr, " %8.3f elem/cycle\n", static_cast<double>(r.elements) / (r.medianNs * ticksPerNs));
+  }
+
+  //! Settings
+  const BenchConfig& config_;
+  //! Results in the order of measurement
+  std::vector<BenchResult> results_;
+};  // class BenchRunner
+
+
+/*!
+ * @brief Call f(level, function) for each distinct implementation a dispatcher selects up to the maximum level
+ * @param [in] dispatcher  Dispatcher of the kernel
+ * @param [in] f  Function called with the lowest level which selects each implementation
+ */
+template<
+  typename FunctionType,
+  typename F
+>
+static inline void
+forEachIsaLevel(const simdutil::Dispatcher<FunctionType>& dispatcher, F&& f)
+{
+  FunctionType* previous = nullptr;
+  const auto maxLevel = simdutil::IsaLevelSetting::maximum();
+  for (int i = static_cast<int>(simdutil::IsaLevel::kScalar); i <= static_cast<int>(maxLevel); i++) {
+    const auto level = static_cast<simdutil::IsaLevel>(i);
+    const auto function = dispatcher.select(level);
+    if (function != nullptr && function != previous) {
+      f(level, function);
+      previous = function;
+    }
+  }
+}
+
+
+/*!
+ * @brief Working set sizes: half of L1D and L2, half of this thread's share of L3, and four times L3 for DRAM
+ *
+ * The DRAM size is capped by --max-mib, and the class is skipped when the cap does not exceed the last level cache,
+ * since it would measure a cache level again under the DRAM label.
+ *
+ * @param [in] config  Settings
+ * @return  Size classes to sweep
+ */
+static inline std::vector<SizeClass>
+getSizeClasses(const BenchConfig& config)
+{
+  const auto& hierarchy = simdutil::CacheHierarchy::get();
+  const auto l1Size = hierarchy.dataCacheSize(1) != 0 ? hierarchy.dataCacheSize(1) : 32 * 1024;
+  const auto l2Size = hierarchy.dataCacheSize(2) != 0 ? hierarchy.dataCacheSize(2) : 8 * l1Size;
+  std::size_t llcSize = 0;
+  std::size_t llcShare = 0;
+  for (int level = 4; level >= 3 && llcSize == 0; level--) {
+    const auto cache = hierarchy.findData(level);
+    if (cache != nullptr && cache->size != 0) {
+      llcSize = cache->size;
+      llcShare = cache->size / static_cast<std::size_t>(std::max(cache->nSharingThreads, 1));
+    }
+  }
+
+  std::vector<SizeClass> sizeClasses{{"L1", l1Size / 2}, {"L2", l2Size / 2}};
+  if (llcSize != 0 && llcShare / 2 > l2Size) {
+    sizeClasses.push_back({"L3", llcShare / 2});
+  }
+  const auto cacheSize = std::max(llcSize, l2Size);
+  const auto dramSize = std::min(std::max(4 * cacheSize, std::size_t{64} << 20), config.maxMib << 20);
+  if (dramSize > cacheSize) {
+    sizeClasses.push_back({"DRAM", dramSize});
+  } else {
+    std::cerr << "Skipping DRAM: --max-mib=" << config.maxMib << " fits in the " << (cacheSize >> 10) << " KiB last level cache\n";
+  }
+  return sizeClasses;
+}
+
+
+/*!
+ * @brief Buffers of pseudo-random test data, all aligned to the widest SIMD register
+ */
+class BenchData
+{
+public:
+  explicit BenchData(std::size_t maxBytes)
+    : floats_(maxBytes / sizeof(float))
+    , floats2_(maxBytes / sizeof(float))
+    , words_(maxBytes / sizeof(std::uint64_t))
+    , words2_(maxBytes / sizeof(std::uint64_t))
+    , text_(maxBytes)
+    , utf8_(maxBytes)
+    , bytes_(maxBytes)
+  {
+    std::mt19937_64 engine{12345};
+    std::uniform_real_distribution<float> floatDist{-1.0f, 1.0f};
+    std::uniform_int_distribution<int> printableDist{0x20, 0x7e};
+    for (std::size_t i = 0; i < floats_.size(); i++) {
+      floats_[i] = floatDist(engine);
+      floats2_[i] = floatDist(engine);
+    }
+    for (std::size_t i = 0; i < words_.size(); i++) {
+      words_[i] = engine();
+      words2_[i] = engine();
+    }
+    for (auto& c : text_) {
+      c = static_cast<char>(printableDist(engine));
+    }
+    // Mixed 1- to 4-byte sequences, so the UTF-8 validator takes its multi-byte path
+    static const char kSample[] = "plain ASCII text, caf\xc3\xa9, \xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e, \xf0\x9f\x98\x80; ";
+    for (std::size_t i = 0; i < utf8_.size(); i++) {
+      utf8_[i] = kSample[i % (sizeof(kSample) - 1)];
+    }
+    for (std::size_t i = utf8_.size(); i > 0 && static_cast<unsigned char>(utf8_[i - 1]) >= 0x80; i--) {
+      utf8_[i - 1] = ' ';
+    }
+  }
+
+  float* floats() noexcept { return floats_.data(); }
+  float* floats2() noexcept { return floats2_.data(); }
+  std::uint64_t* words() noexcept { return words_.data(); }
+  std::uint64_t* words2() noexcept { return words2_.data(); }
+  const char* text() const noexcept { return text_.data(); }
+  const char* utf8() const noexcept { return utf8_.data(); }
+  char* bytes() noexcept { return bytes_.data(); }
+
+private:
+  simdutil::AlignedVector<float> floats_;
+  simdutil::AlignedVector<float> floats2_;
+  simdutil::AlignedVector<std::uint64_t> words_;
+  simdutil::AlignedVector<std::uint64_t> words2_;
+  simdutil::AlignedVector<char> text_;
+  simdutil::AlignedVector<char> utf8_;
+  simdutil::AlignedVector<char> bytes_;
+};  // class BenchData
+
+
+/*!
+ * @brief Run a dispatched kernel at every level and size class
+ * @param [in,out] runner  Benchmark runner
+ * @param [in] sizeClasses  Working set sizes
+ * @param [in] group  Group name
+ * @param [in] name  Benchmark name
+ * @param [in] dispatcher  Dispatcher of the kernel
+ * @param [in] elementBytes  Bytes of the working set per element
+ * @param [in] call  Function called with (kernel function pointer, number of elements)
+ */
+template<
+  typename FunctionType,
+  typename Call
+>
+static inline void
+benchDispatched(
+  BenchRunner& runner,
+  const std::vector<SizeClass>& sizeClasses,
+  const char* group,
+  const char* name,
+  const simdutil::Dispatcher<FunctionType>& dispatcher,
+  std::size_t elementBytes,
+  Call&& call)
+{
+  if (!runner.isSelected(group, name)) {
+    return;
+  }
+  for (const auto& sizeClass : sizeClasses) {
+    const auto n = sizeClass.bytes / elementBytes;
+    forEachIsaLevel(dispatcher, [&](simdutil::IsaLevel level, FunctionType* function) {
+      runner.run(group, name, simdutil::getIsaLevelName(level), sizeClass.name, n * elementBytes, n, [&] {
+        call(function, n);
+      });
+    });
+  }
+}
+
+
+static inline void
+benchAllocators(BenchRunner& runner)
+{
+  static const std::size_t kSizes[] = {64, 4096, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024};
+  for (const auto size : kSizes) {
+    const auto sizeName = std::to_string(size);
+    if (runner.isSelected("alloc", "malloc")) {
+      runner.run("alloc", "malloc", "none", sizeName.c_str(), 0, 1, [size] {
+        const auto p = std::malloc(size);
+        doNotOptimize(p);
+        std::free(p);
+      });
+    }
+    if (runner.isSelected("alloc", "alignedMalloc")) {
+      runner.run("alloc", "alignedMalloc", "none", sizeName.c_str(), 0, 1, [size] {
+        const auto p = simdutil::alignedMalloc(size, simdutil::getMaxSimdRegisterSize());
+        doNotOptimize(p);
+        simdutil::alignedFree(p);
+      });
+    }
+    if (runner.isSelected("alloc", "AlignedAllocator")) {
+      // Allocation plus value-initialization through std::vector, as containers use the allocator
+      runner.run("alloc", "AlignedAllocator", "none", sizeName.c_str(), size, size / sizeof(float), [size] {
+        std::vector<float, simdutil::AlignedAllocator<float, 64>> v(size / sizeof(float));
+        doNotOptimize(v.data());
+      });
+    }
+  }
+}
+
+
+template<template<typename> class Kernel>
+static inline void
+benchReduce(BenchRunner& runner, const std::vector<SizeClass>& sizeClasses, BenchData& data, const char* name)
+{
+  using Dispatcher = simdutil::VecDispatcher<Kernel, float, float(const float*, std::size_t)>;
+  benchDispatched(runner, sizeClasses, "reduce", name, Dispatcher::get(), sizeof(float), [&](float (*f)(const float*, std::size_t), std::size_t n) {
+    doNotOptimize(f(data.floats(), n));
+  });
+}
+
+
+static inline void
+benchReduceAll(BenchRunner& runner, const std::vector<SizeClass>& sizeClasses, BenchData& data)
+{
+  benchReduce<simdutil::SumKernel>(runner, sizeClasses, data, "sum_f32");
+  benchReduce<simdutil::MaxKernel>(runner, sizeClasses, data, "max_f32");
+  benchReduce<simdutil::KahanSumKernel>(runner, sizeClasses, data, "kahan_sum_f32");
+  benchReduce<simdutil::PairwiseSumKernel>(runner, sizeClasses, data, "pairwise_sum_f32");
+
+  using ArgMinDispatcher = simdutil::VecDispatcher<simdutil::ArgMinKernel, float, std::size_t(const float*, std::size_t)>;
+  benchDispatched(runner, sizeClasses, "reduce", "argmin_f32", ArgMinDispatcher::get(), sizeof(float), [&](std::size_t (*f)(const float*, std::size_t), std::size_t n) {
+    doNotOptimize(f(data.floats(), n));
+  });
+
+  using DotDispatcher = simdutil::VecDispatcher<simdutil::DotKernel, float, float(const float*, const float*, std::size_t)>;
+  benchDispatched(runner, sizeClasses, "reduce", "dot_f32", DotDispatcher::get(), 2 * sizeof(float), [&](float (*f)(const float*, const float*, std::size_t), std::size_t n) {
+    doNotOptimize(f(data.floats(), data.floats2(), n));
+  });
+}
+
+
+static inline void
+benchByteScan(BenchRunner& runner, const std::vector<SizeClass>& sizeClasses, BenchData& data)
+{
+  using FindFunction = std::size_t(const char*, std::size_t, char);
+  using CheckFunction = bool(const char*, std::size_t);
+
+  // The text is printable ASCII, so searching for '\n' scans all of it
+  static const simdutil::Dispatcher<FindFunction> findDispatcher{
+    {simdutil::IsaLevel::kAvx512, &simdutil::ByteScanAvx512::findByte},
+    {simdutil::IsaLevel::kAvx2, &simdutil::ByteScanAvx2::findByte},
+    {simdutil::IsaLevel::kSse42, &simdutil::ByteScanSse42::findByte},
+    {simdutil::IsaLevel::kScalar, &simdutil::ByteScanScalar::findByte}};
+  benchDispatched(runner, sizeClasses, "bytescan", "find_byte", findDispatcher, 1, [&](FindFunction* f, std::size_t n) {
+    doNotOptimize(f(data.text(), n, '\n'));
+  });
+
+  static const simdutil::Dispatcher<FindFunction> countDispatcher{
+    {simdutil::IsaLevel::kAvx512, &simdutil::ByteScanAvx512::countByte},
+    {simdutil::IsaLevel::kAvx2, &simdutil::ByteScanAvx2::countByte},
+    {simdutil::IsaLevel::kSse42, &simdutil::ByteScanSse42::countByte},
+    {simdutil::IsaLevel::kScalar, &simdutil::ByteScanScalar::countByte}};
+  benchDispatched(runner, sizeClasses, "bytescan", "count_byte", countDispatcher, 1, [&](FindFunction* f, std::size_t n) {
+    doNotOptimize(f(data.text(), n, 'e'));
+  });
+
+  using FindAnyOfFunction = std::size_t(const char*, std::size_t, const simdutil::ByteSet&);
+  static const simdutil::Dispatcher<FindAnyOfFunction> findAnyOfDispatcher{
+    {simdutil::IsaLevel::kAvx512, &simdutil::ByteScanAvx512::findAnyOf},
+    {simdutil::IsaLevel::kAvx2, &simdutil::ByteScanAvx2::findAnyOf},
+    {simdutil::IsaLevel::kSse42, &simdutil::ByteScanSse42::findAnyOf},
+    {simdutil::IsaLevel::kScalar, &simdutil::ByteScanScalar::findAnyOf}};
+  const simdutil::ByteSet set{"\r\n\t\x7f"};
+  benchDispatched(runner, sizeClasses, "bytescan", "find_any_of", findAnyOfDispatcher, 1, [&](FindAnyOfFunction* f, std::size_t n) {
+    doNotOptimize(f(data.text(), n, set));
+  });
+
+  static const simdutil::Dispatcher<CheckFunction> asciiDispatcher{
+    {simdutil::IsaLevel::kAvx512, &simdutil::ByteScanAvx512::isAscii},
+    {simdutil::IsaLevel::kAvx2, &simdutil::ByteScanAvx2::isAscii},
+    {simdutil::IsaLevel::kSse42, &simdutil::ByteScanSse42::isAscii},
+    {simdutil::IsaLevel::kScalar, &simdutil::ByteScanScalar::isAscii}};
+  benchDispatched(runner, sizeClasses, "bytescan", "is_ascii", asciiDispatcher, 1, [&](CheckFunction* f, std::size_t n) {
+    doNotOptimize(f(data.text(), n));
+  });
+
+  static const simdutil::Dispatcher<CheckFunction> utf8Dispatcher{
+    {simdutil::IsaLevel::kAvx512, &simdutil::ByteScanAvx512::isValidUtf8},
+    {simdutil::IsaLevel::kAvx2, &simdutil::ByteScanAvx2::isValidUtf8},
+    {simdutil::IsaLevel::kSse42, &simdutil::ByteScanSse42::isValidUtf8},
+    {simdutil::IsaLevel::kScalar, &simdutil::ByteScanScalar::isValidUtf8}};
+  benchDispatched(runner, sizeClasses, "bytescan", "is_valid_utf8", utf8Dispatcher, 1, [&](CheckFunction* f, std::size_t n) {
+    doNotOptimize(f(data.utf8(), n));
+  });
+}
+
+
+template<
+  typename Op,
+  bool kStore,
+  bool kSameOperands
+>
+static inline void
+benchCombine(BenchRunner& runner, const std::vector<SizeClass>& sizeClasses, BenchData& data, const char* name, std::size_t elementBytes)
+{
+  using CombineFunction = std::size_t(std::uint64_t*, const std::uint64_t*, const std::uint64_t*, std::size_t);
+  static const simdutil::Dispatcher<CombineFunction> dispatcher{
+    {simdutil::IsaLevel::kAvx512Icl, &simdutil::BitsetAvx512Icl::combine<Op, kStore>},
+    {simdutil::IsaLevel::kAvx2, &simdutil::BitsetAvx2::combine<Op, kStore>},
+    {simdutil::IsaLevel::kSse42, &simdutil::BitsetPopcnt::combine<Op, kStore>},
+    {simdutil::IsaLevel::kScalar, &simdutil::BitsetScalar::combine<Op, kStore>}};
+  // The destination is a third buffer taken from the byte area, so the operands stay unchanged
+  benchDispatched(runner, sizeClasses, "bitset", name, dispatcher, elementBytes, [&](CombineFunction* f, std::size_t n) {
+    doNotOptimize(f(reinterpret_cast<std::uint64_t*>(static_cast<void*>(data.bytes())), data.words(), kSameOperands ? data.words() : data.words2(), n));
+  });
+}
+
+
+static inline void
+benchBitset(BenchRunner& runner, const std::vector<SizeClass>& sizeClasses, BenchData& data)
+{
+  // bitsetCount() passes the same words as both operands, which are read only once
+  benchCombine<simdutil::BitFirst, false, true>(runner, sizeClasses, data, "count", sizeof(std::uint64_t));
+  benchCombine<simdutil::BitAnd, false, false>(runner, sizeClasses, data, "and_count", 2 * sizeof(std::uint64_t));
+  benchCombine<simdutil::BitAnd, true, false>(runner, sizeClasses, data, "and", 3 * sizeof(std::uint64_t));
+}
+
+
+static inline void
+benchLayout(BenchRunner& runner, const std::vector<SizeClass>& sizeClasses, BenchData& data)
+{
+  // Records of three floats, e.g. xyz coordinates; planes are carved out of the second float buffer
+  static const std::size_t kFields = 3;
+  using AosToSoaFunction = void(const float*, std::size_t, std::size_t, float* const*);
+  using SoaToAosFunction = void(const float* const*, std::size_t, std::size_t, float*);
+  static const simdutil::Dispatcher<AosToSoaFunction> aosToSoaDispatcher{
+    {simdutil::IsaLevel::kAvx512, &simdutil::LayoutAvx512::aosToSoa<float>},
+    {simdutil::IsaLevel::kAvx2, &simdutil::LayoutAvx2::aosToSoa<float>},
+    {simdutil::IsaLevel::kSse42, &simdutil::LayoutSse42::aosToSoa<float>},
+    {simdutil::IsaLevel::kScalar, &simdutil::LayoutScalar::aosToSoa<float>}};
+  static const simdutil::Dispatcher<SoaToAosFunction> soaToAosDispatcher{
+    {simdutil::IsaLevel::kAvx512, &simdutil::LayoutAvx512::soaToAos<float>},
+    {simdutil::IsaLevel::kAvx2, &simdutil::LayoutAvx2::soaToAos<float>},
+    {simdutil::IsaLevel::kSse42, &simdutil::LayoutSse42::soaToAos<float>},
+    {simdutil::IsaLevel::kScalar, &simdutil::LayoutScalar::soaToAos<float>}};
+
+  const auto elementBytes = 2 * kFields * sizeof(float);
+  benchDispatched(runner, sizeClasses, "layout", "aos_to_soa_3xf32", aosToSoaDispatcher, elementBytes, [&](AosToSoaFunction* f, std::size_t n) {
+    float* const planes[kFields] = {data.floats2(), data.floats2() + n, data.floats2() + 2 * n};
+    f(data.floats(), n, kFields, planes);
+    doNotOptimize(planes[0][0]);
+  });
+  benchDispatched(runner, sizeClasses, "layout", "soa_to_aos_3xf32", soaToAosDispatcher, elementBytes, [&](SoaToAosFunction* f, std::size_t n) {
+    const float* const planes[kFields] = {data.floats2(), data.floats2() + n, data.floats2() + 2 * n};
+    f(planes, n, kFields, data.floats());
+    doNotOptimize(data.floats()[0]);
+  });
+}
+
+
+static inline void
+benchMemops(BenchRunner& runner, const std::vector<SizeClass>& sizeClasses, BenchData& data)
+{
+  using CopyFunction = void(void*, const void*, std::size_t);
+  using FillFunction = void(void*, unsigned char, std::size_t);
+  static const simdutil::Dispatcher<CopyFunction> copyDispatcher{
+    {simdutil::IsaLevel::kAvx512, &simdutil::MemopsAvx512::copy<false>},
+    {simdutil::IsaLevel::kAvx2, &simdutil::MemopsAvx2::copy<false>},
+    {simdutil::IsaLevel::kSse42, &simdutil::MemopsSse42::copy<false>},
+    {simdutil::IsaLevel::kScalar, &simdutil::MemopsScalar::copy<false>}};
+  static const simdutil::Dispatcher<CopyFunction> copyNonTemporalDispatcher{
+    {simdutil::IsaLevel::kAvx512, &simdutil::MemopsAvx512::copy<true>},
+    {simdutil::IsaLevel::kAvx2, &simdutil::MemopsAvx2::copy<true>},
+    {simdutil::IsaLevel::kSse42, &simdutil::MemopsSse42::copy<true>},
+    {simdutil::IsaLevel::kScalar, &simdutil::MemopsScalar::copy<true>}};
+  static const simdutil::Dispatcher<FillFunction> fillDispatcher{
+    {simdutil::IsaLevel::kAvx512, &simdutil::MemopsAvx512::fill<false>},
+    {simdutil::IsaLevel::kAvx2, &simdutil::MemopsAvx2::fill<false>},
+    {simdutil::IsaLevel::kSse42, &simdutil::MemopsSse42::fill<false>},
+    {simdutil::IsaLevel::kScalar, &simdutil::MemopsScalar::fill<false>}};
+  static const simdutil::Dispatcher<FillFunction> fillNonTemporalDispatcher{
+    {simdutil::IsaLevel::kAvx512, &simdutil::MemopsAvx512::fill<true>},
+    {simdutil::IsaLevel::kAvx2, &simdutil::MemopsAvx2::fill<true>},
+    {simdutil::IsaLevel::kSse42, &simdutil::MemopsSse42::fill<true>},
+    {simdutil::IsaLevel::kScalar, &simdutil::MemopsScalar::fill<true>}};
+
+  const auto copy = [&](CopyFunction* f, std::size_t n) {
+    f(data.bytes(), data.text(), n);
+    doNotOptimize(data.bytes()[0]);
+  };
+  const auto fill = [&](FillFunction* f, std::size_t n) {
+    f(data.bytes(), 0, n);
+    doNotOptimize(data.bytes()[0]);
+  };
+  benchDispatched(runner, sizeClasses, "memops", "copy", copyDispatcher, 2, copy);
+  benchDispatched(runner, sizeClasses, "memops", "copy_nt", copyNonTemporalDispatcher, 2, copy);
+  benchDispatched(runner, sizeClasses, "memops", "zero", fillDispatcher, 1, fill);
+  benchDispatched(runner, sizeClasses, "memops", "zero_nt", fillNonTemporalDispatcher, 1, fill);
+
+  // REP string instructions and the automatic choice do not depend on the instruction set level
+  for (const auto& sizeClass : sizeClasses) {
+    const auto n = sizeClass.bytes;
+    if (runner.isSelected("memops", "copy_rep")) {
+      runner.run("memops", "copy_rep", "none", sizeClass.name, n, n / 2, [&] {
+        simdutil::repMovsb(data.bytes(), data.text(), n / 2);
+        doNotOptimize(data.bytes()[0]);
+      });
+    }
+    if (runner.isSelected("memops", "zero_rep")) {
+      runner.run("memops", "zero_rep", "none", sizeClass.name, n, n, [&] {
+        simdutil::repStosb(data.bytes(), 0, n);
+        doNotOptimize(data.bytes()[0]);
+      });
+    }
+    if (runner.isSelected("memops", "zero_auto")) {
+      runner.run("memops", "zero_auto", "auto", sizeClass.name, n, n, [&] {
+        simdutil::zeroMemory(data.bytes(), n);
+        doNotOptimize(data.bytes()[0]);
+      });
+    }
+    if (runner.isSelected("memops", "memset")) {
+      runner.run("memops", "memset", "libc", sizeClass.name, n, n, [&] {
+        std::memset(data.bytes(), 0, n);
+        doNotOptimize(data.bytes()[0]);
+      });
+    }
+  }
+}
+
+
+static inline void
+benchMultiIsa(BenchRunner& runner, const std::vector<SizeClass>& sizeClasses, BenchData& data)
+{
+  using SaxpyFunction = void(float*, const float*, float, std::size_t);
+  static const simdutil::Dispatcher<SaxpyFunction> saxpyDispatcher{
+    SIMDUTIL_MULTI_ISA_KERNEL_ENTRIES(bench_kernels, saxpy)};
+
+  benchDispatched(runner, sizeClasses, "multi_isa", "saxpy_f32", saxpyDispatcher, 2 * sizeof(float), [&](SaxpyFunction* f, std::size_t n) {
+    f(data.floats2(), data.floats(), 0.5f, n);
+    doNotOptimize(data.floats2()[0]);
+  });
+}
+
+
+static inline std::string
+escapeJson(const std::string& s)
+{
+  std::string escaped;
+  for (const auto c : s) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+      escaped += c;
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      char buffer[8];
+      std::snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned int>(c));
+      escaped += buffer;
+    } else {
+      escaped += c;
+    }
+  }
+  return escaped;
+}
+
+
+static inline void
+writeJson(std::ostream& os, const BenchRunner& runner, const std::vector<SizeClass>& sizeClasses)
+{
+  const auto& config = runner.config();
+  const auto ticksPerNs = TscFrequency::get().ticksPerNs();
+  const auto& hierarchy = simdutil::CacheHierarchy::get();
+  std::ostringstream oss;
+  oss.precision(6);
+  oss << "{\n"
+      << "  \"host\": {\n"
+      << "    \"vendor\": \"" << escapeJson(simdutil::getCpuVendorId()) << "\",\n"
+      << "    \"detectedIsa\": \"" << simdutil::getIsaLevelName(simdutil::IsaLevelSetting::detected()) << "\",\n"
+      << "    \"maxIsa\": \"" << simdutil::getIsaLevelName(simdutil::IsaLevelSetting::maximum()) << "\",\n"
+      << "    \"tscGhz\": " << ticksPerNs << ",\n"
+      << "    \"l1dBytes\": " << hierarchy.dataCacheSize(1) << ",\n"
+      << "    \"l2Bytes\": " << hierarchy.dataCacheSize(2) << ",\n"
+      << "    \"l3Bytes\": " << hierarchy.dataCacheSize(3) << "\n"
+      << "  },\n"
+      << "  \"config\": {\n"
+      << "    \"repetitions\": " << config.repetitions << ",\n"
+      << "    \"warmup\": " << config.warmup << ",\n"
+      << "    \"minSampleMs\": " << config.minSampleMs << ",\n"
+      << "    \"sizeClasses\": {";
+  for (std::size_t i = 0; i < sizeClasses.size(); i++) {
+    oss << (i == 0 ? "" : ", ") << "\"" << sizeClasses[i].name << "\": " << sizeClasses[i].bytes;
+  }
+  oss << "}\n"
+      << "  },\n"
+      << "  \"results\": [";
+  const auto& results = runner.results();
+  for (std::size_t i = 0; i < results.size(); i++) {
+    const auto& r = results[i];
+    oss << (i == 0 ? "\n" : ",\n")
+        << "    {\"group\": \"" << escapeJson(r.group) << "\""
+        << ", \"name\": \"" << escapeJson(r.name) << "\""
+        << ", \"isa\": \"" << escapeJson(r.isa) << "\""
+        << ", \"size\": \"" << escapeJson(r.sizeClass) << "\""
+        << ", \"bytes\": " << r.bytes
+        << ", \"elements\": " << r.elements
+        << ", \"iterations\": " << r.iterations
+        << ", \"medianNs\": " << r.medianNs
+        << ", \"madNs\": " << r.madNs
+        << ", \"gbps\": ";
+    if (r.bytes != 0) {
+      oss << static_cast<double>(r.bytes) / r.medianNs;
+    } else {
+      oss << "null";
+    }
+    oss << ", \"elementsPerCycle\": " << static_cast<double>(r.elements) / (r.medianNs * ticksPerNs) << "}";
+  }
+  oss << "\n  ]\n"
+      << "}\n";
+  os << oss.str();
+}
+
+
+static inline bool
+parseArgs(int argc, const char* argv[], BenchConfig& config)
+{
+  for (int i = 1; i < argc; i++) {
+    const std::string arg{argv[i]};
+    const auto eq = arg.find('=');
+    const auto key = arg.substr(0, eq);
+    const auto value = eq == std::string::npos ? std::string{} : arg.substr(eq + 1);
+    if (key == "--filter") {
+      config.filter = value;
+    } else if (key == "--json") {
+      config.jsonPath = value;
+    } else if (key == "--reps") {
+      config.repetitions = std::max(1, std::atoi(value.c_str()));
+    } else if (key == "--warmup") {
+      config.warmup = std::max(0, std::atoi(value.c_str()));
+    } else if (key == "--min-sample-ms") {
+      config.minSampleMs = std::max(0.0, std::atof(value.c_str()));
+    } else if (key == "--max-mib") {
+      config.maxMib = static_cast<std::size_t>(std::max(1, std::atoi(value.c_str())));
+    } else {
+      std::cerr << "Usage: " << argv[0]
+                << " [--filter=SUBSTR] [--reps=N] [--warmup=N] [--min-sample-ms=X] [--max-mib=N] [--json=FILE]\n";
+      return false;
+    }
+  }
+  return true;
+}
+
+
+int
+main(int argc, const char* argv[])
+{
+  BenchConfig config{"", "", 15, 3, 2.0, 1024};
+  if (!parseArgs(argc, argv, config)) {
+    return EXIT_FAILURE;
+  }
+
+  const auto sizeClasses = getSizeClasses(config);
+  std::size_t maxBytes = 0;
+  for (const auto& sizeClass : sizeClasses) {
+    maxBytes = std::max(maxBytes, sizeClass.bytes);
+  }
+  std::cerr << "TSC: " << TscFrequency::get().ticksPerNs() << " GHz, ISA: "
+            << simdutil::getIsaLevelName(simdutil::IsaLevelSetting::maximum()) << "\n";
+
+  BenchRunner runner{config};
+  benchAllocators(runner);
+  {
+    BenchData data{maxBytes};
+    benchReduceAll(runner, sizeClasses, data);
+    benchByteScan(runner, sizeClasses, data);
+    benchBitset(runner, sizeClasses, data);
+    benchLayout(runner, sizeClasses, data);
+    benchMemops(runner, sizeClasses, data);
+    benchMultiIsa(runner, sizeClasses, data);
+  }
+
+  if (config.jsonPath.empty()) {
+    writeJson(std::cout, runner, sizeClasses);
+  } else {
+    std::ofstream ofs{config.jsonPath};
+    if (!ofs) {
+      std::cerr << "Cannot open " << config.jsonPath << "\n";
+      return EXIT_FAILURE;
+    }
+    writeJson(ofs, runner, sizeClasses);
+  }
+  return EXIT_SUCCESS;
+}